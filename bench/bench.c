@@ -0,0 +1,175 @@
+/** @file bench.c
+ *  @brief Microbenchmark harness, @see bench.h
+ */
+#include "bench.h"
+#include "sndx/sys.h"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static u64 bench_cycles(bench_t* b)
+{
+    if (b->perf_fd >= 0)
+    {
+        u64 count = 0;
+        if (read(b->perf_fd, &count, sizeof(count)) == sizeof(count)) return count;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+int bench_open(bench_t** bp, f64 min_secs, output_t* output)
+{
+    bench_t* b;
+    b = calloc(1, sizeof(*b));
+    RetVal_(!b, -ENOMEM, "Failed calloc bench_t* b");
+
+    b->min_secs = min_secs;
+    b->output   = output;
+
+    // Cycles of this thread in user space, usually denied in containers (perf_event_paranoid)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    b->perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+#if defined(__x86_64__) || defined(__i386__)
+    b->cycles_source = b->perf_fd >= 0 ? "perf" : "tsc";
+#else
+    b->cycles_source = b->perf_fd >= 0 ? "perf" : "none";
+#endif
+
+    *bp = b;
+
+    return 0;
+}
+
+void bench_close(bench_t* b)
+{
+    if (!b) return;
+
+    if (b->perf_fd >= 0) close(b->perf_fd);
+
+    Free(b->results);
+    Free(b);
+}
+
+int bench_run(              //
+    bench_t*    b,          //
+    const char* name,       //
+    const char* format,     //
+    u32         channels,   //
+    uframes_t   frames,     //
+    usize       bytes,      //
+    bench_fn_t  fn,         //
+    void*       arg)
+{
+    output_t* output = b->output;
+
+    if (b->nresults == b->capacity)
+    {
+        isize           capacity = b->capacity ? 2 * b->capacity : 64;
+        bench_result_t* results  = realloc(b->results, capacity * sizeof(bench_result_t));
+        RetVal_(!results, -ENOMEM, "Failed realloc bench_result_t* results");
+
+        b->results  = results;
+        b->capacity = capacity;
+    }
+
+    // Warm up caches and branch predictors, then find a batch taking a tenth of the time
+    fn(arg);
+
+    u64 iterations = 1;
+    u64 nsecs      = 0;
+    u64 min_nsecs  = (u64)(b->min_secs * 1e9);
+
+    while (true)
+    {
+        u64 t0 = sndx_nsecs();
+        RANGE(i, iterations) { fn(arg); }
+        nsecs = sndx_nsecs() - t0;
+
+        if (nsecs >= min_nsecs / 10 || iterations >= (1ull << 40)) break;
+        iterations *= 2;
+    }
+
+    // Timed run sized to the full time
+    iterations = nsecs ? (u64)((f64)iterations * min_nsecs / nsecs) + 1 : iterations;
+
+    u64 c0 = bench_cycles(b);
+    u64 t0 = sndx_nsecs();
+    RANGE(i, iterations) { fn(arg); }
+    nsecs      = sndx_nsecs() - t0;
+    u64 cycles = bench_cycles(b) - c0;
+
+    bench_result_t* r = &b->results[b->nresults++];
+
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    snprintf(r->format, sizeof(r->format), "%s", format);
+
+    r->channels          = channels;
+    r->frames            = frames;
+    r->iterations        = iterations;
+    r->ns_per_frame      = (f64)nsecs / ((f64)iterations * frames);
+    r->gb_per_s          = (f64)bytes * iterations / nsecs;
+    r->cycles_per_sample = (f64)cycles / ((f64)iterations * frames * channels);
+
+    a_info("%-20s %-8s %3d ch %5ld frames: %8.3f ns/frame %7.2f GB/s %7.3f cycles/sample", name, format, channels,
+           frames, r->ns_per_frame, r->gb_per_s, r->cycles_per_sample);
+
+    return 0;
+}
+
+int bench_write_json(bench_t* b, const char* path)
+{
+    output_t* output = b->output;
+
+    FILE* f = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    RetVal_(!f, -errno, "Failed fopen %s: %s", path, strerror(errno));
+
+    char      date[32];
+    time_t    now = time(nullptr);
+    struct tm tm;
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime_r(&now, &tm));
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"context\": {\n");
+    fprintf(f, "    \"date\": \"%s\",\n", date);
+    fprintf(f, "    \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(f, "    \"cycles_source\": \"%s\",\n", b->cycles_source);
+    fprintf(f, "    \"min_secs\": %g\n", b->min_secs);
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"benchmarks\": [\n");
+
+    RANGE(i, b->nresults)
+    {
+        bench_result_t* r = &b->results[i];
+
+        fprintf(f,
+                "    {\"name\": \"%s\", \"format\": \"%s\", \"channels\": %u, \"frames\": %lu, \"iterations\": %lu, "
+                "\"ns_per_frame\": %.4f, \"gb_per_s\": %.4f, \"cycles_per_sample\": %.4f}%s\n",
+                r->name, r->format, r->channels, (unsigned long)r->frames, (unsigned long)r->iterations,
+                r->ns_per_frame, r->gb_per_s, r->cycles_per_sample, i + 1 < b->nresults ? "," : "");
+    }
+
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    if (f != stdout) fclose(f);
+
+    a_info("Wrote %ld results to %s", b->nresults, path);
+
+    return 0;
+}
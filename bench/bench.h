@@ -0,0 +1,70 @@
+/** @file bench.h
+ *  @brief Microbenchmark harness for the kernels of the library, no hardware needed.
+ *
+ *  Every case is run in batches of doubling size until a batch takes a tenth of the
+ *  time per case, then once more sized to the full time (like google benchmark).
+ *  Results are kept for the JSON report, one object per case:
+ *
+ *      {"name": "ring_write_read", "format": "S16_LE", "channels": 8, "frames": 256,
+ *       "iterations": 81920, "ns_per_frame": 3.1, "gb_per_s": 7.2, "cycles_per_sample": 1.2}
+ *
+ *  Cycles come from the hardware counter (perf_event_open) if allowed, else from the
+ *  time stamp counter (x86 only, counts at the nominal clock), else are reported as 0.
+ */
+#pragma once
+
+#include "sndx/types.h"
+
+/** @brief One kernel call on prepared data, `arg` is owned by the caller. */
+typedef void (*bench_fn_t)(void* arg);
+
+/** @brief Result of one case. */
+typedef struct
+{
+    char      name[32];   ///< Kernel
+    char      format[16]; ///< Sample format of the device side
+    u32       channels;   ///< Audio channels
+    uframes_t frames;     ///< Frames per call
+
+    u64 iterations;        ///< Calls timed
+    f64 ns_per_frame;      ///< Per frame of all channels
+    f64 gb_per_s;          ///< Bytes read and written per second
+    f64 cycles_per_sample; ///< Per frame per channel
+
+} bench_result_t;
+
+/** @brief Harness state and results so far. */
+typedef struct
+{
+    f64 min_secs; ///< Time per case
+
+    int         perf_fd;       ///< Cycle counter, -1 if not available
+    const char* cycles_source; ///< "perf", "tsc" or "none"
+
+    bench_result_t* results;  ///< Results in order of the runs
+    isize           nresults; ///< Cases run
+    isize           capacity; ///< Results allocated
+
+    output_t* output; ///< Progress and errors
+
+} bench_t;
+
+/** @brief Set up the cycle counter, `min_secs` of timed calls per case. */
+int bench_open(bench_t** bp, f64 min_secs, output_t* output);
+
+/** @brief Free results and counter. */
+void bench_close(bench_t* b);
+
+/** @brief Time `fn(arg)`, which moves `bytes` per call (read + written), and keep the result. */
+int bench_run(              //
+    bench_t*    b,          //
+    const char* name,       //
+    const char* format,     //
+    u32         channels,   //
+    uframes_t   frames,     //
+    usize       bytes,      //
+    bench_fn_t  fn,         //
+    void*       arg);
+
+/** @brief Write results as JSON to `path`, "-" for stdout. */
+int bench_write_json(bench_t* b, const char* path);
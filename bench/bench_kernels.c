@@ -0,0 +1,238 @@
+/** @file bench_kernels.c
+ *  @brief Conversion, ring and callback kernels over formats x channels x frames.
+ *
+ *  Usage: bench_kernels [JSON path, "-" for stdout] [seconds per case]
+ *
+ *  Kernels, on the buffers the duplex path uses (interleaved device side, planar float side):
+ *      dev_to_buf        : `sndx_buffer_dev_to_buf_skew`, device format to float
+ *      buf_to_dev        : `sndx_buffer_buf_to_dev_skew`, float to device format
+ *      ring_write_read   : `sndx_ring_write_from_areas` + `sndx_ring_read_to_areas` from/to device areas
+ *                          (FLOAT: ring of floats from/to planar float areas)
+ *      copy_capt_to_play : `sndx_duplex_copy_capt_to_play`, all channels with gain
+ *      router_copy       : `sndx_router_process` on the same 1:1 matrix, settled
+ *      router_ramp       : same, every call ramping (a gain change that never ends)
+ *
+ *  GB/s counts bytes read plus bytes written by one call, cycles/sample are per frame per channel.
+ */
+#include "bench.h"
+#include "sndx/buffer.h"
+#include "sndx/callback.h"
+#include "sndx/ring.h"
+#include "sndx/router.h"
+
+static const format_t formats[] = {SND_PCM_FORMAT_S16_LE, SND_PCM_FORMAT_S24_3LE, SND_PCM_FORMAT_S32_LE};
+
+static const u32       channel_counts[] = {2, 8, 32};
+static const uframes_t frame_counts[]   = {64, 256, 1024};
+
+#define COUNT(x) ((isize)(sizeof(x) / sizeof(x[0])))
+
+typedef struct
+{
+    sndx_buffer_t* capt;   ///< Source of every kernel
+    sndx_buffer_t* play;   ///< Destination of the callback
+    sndx_ring_t*   rb;     ///< Ring of the ring kernel
+    sndx_router_t* router; ///< Matrix of the router kernels
+    uframes_t      frames; ///< Frames per call
+    float          gain;   ///< Callback data
+
+} kernel_arg_t;
+
+static void kernel_dev_to_buf(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_buffer_dev_to_buf_skew(k->capt, k->frames, 0, 0);
+}
+
+static void kernel_buf_to_dev(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_buffer_buf_to_dev_skew(k->capt, k->frames, 0, 0);
+}
+
+static void kernel_ring_write_read(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_ring_write_from_areas(k->rb, k->capt->dev, 0, k->capt->channels, k->frames);
+    sndx_ring_read_to_areas(k->rb, k->capt->dev, 0, k->capt->channels, k->frames);
+}
+
+static void kernel_ring_float(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_ring_write_from_areas(k->rb, k->capt->buf, 0, k->capt->channels, k->frames);
+    sndx_ring_read_to_areas(k->rb, k->capt->buf, 0, k->capt->channels, k->frames);
+}
+
+static void kernel_copy_capt_to_play(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_duplex_copy_capt_to_play(k->capt, k->play, (sframes_t)k->frames, &k->gain);
+}
+
+static void kernel_router(void* arg)
+{
+    kernel_arg_t* k = arg;
+    sndx_router_process(k->router, k->capt, k->play, (sframes_t)k->frames);
+}
+
+static void kernel_router_ramp(void* arg)
+{
+    kernel_arg_t* k = arg;
+
+    k->router->current->ramp_left = 2 * k->frames;
+    sndx_router_process(k->router, k->capt, k->play, (sframes_t)k->frames);
+}
+
+/** @brief Smallest power of two holding two calls, ring capacity must be a power of two. */
+static uframes_t ring_capacity(uframes_t frames)
+{
+    uframes_t capacity = 1;
+    while (capacity < 2 * frames) capacity *= 2;
+    return capacity;
+}
+
+/** @brief Noise on both sides, so conversions see real samples and not only zeros. */
+static void fill_buffer(sndx_buffer_t* b)
+{
+    u32 seed = 1;
+
+    RANGE(i, (isize)(b->frames * b->channels * b->bytes))
+    {
+        seed          = seed * 1664525 + 1013904223;
+        b->devdata[i] = (char)(seed >> 24);
+    }
+
+    RANGE(i, (isize)(b->frames * b->channels))
+    {
+        seed          = seed * 1664525 + 1013904223;
+        b->bufdata[i] = (float)((i32)seed) / 2147483648.0f;
+    }
+}
+
+static int bench_format(bench_t* bench, format_t format, u32 channels, uframes_t frames, output_t* output)
+{
+    int err;
+
+    kernel_arg_t k = {.frames = frames, .gain = 0.5f};
+
+    const char* name  = snd_pcm_format_name(format);
+    usize       bytes = frames * channels * (snd_pcm_format_width(format) / 8 + sizeof(float));
+
+    err = sndx_buffer_open(&k.capt, format, channels, frames, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    fill_buffer(k.capt);
+
+    err = sndx_ring_open(&k.rb, format, channels, ring_capacity(frames), output);
+    SndGoto_(err, __close, "Failed sndx_ring_open: %s");
+
+    err = bench_run(bench, "dev_to_buf", name, channels, frames, bytes, kernel_dev_to_buf, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+    err = bench_run(bench, "buf_to_dev", name, channels, frames, bytes, kernel_buf_to_dev, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+    err = bench_run(bench, "ring_write_read", name, channels, frames, 2 * bytes, kernel_ring_write_read, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+__close:
+    sndx_ring_close(k.rb);
+    sndx_buffer_close(k.capt);
+
+    return err;
+}
+
+static int bench_float(bench_t* bench, u32 channels, uframes_t frames, output_t* output)
+{
+    int err;
+
+    kernel_arg_t k = {.frames = frames, .gain = 0.5f};
+
+    const char* name  = snd_pcm_format_name(SND_PCM_FORMAT_FLOAT);
+    usize       bytes = frames * channels * 2 * sizeof(float);
+
+    err = sndx_buffer_open(&k.capt, SND_PCM_FORMAT_S32_LE, channels, frames, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_buffer_open(&k.play, SND_PCM_FORMAT_S32_LE, channels, frames, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    fill_buffer(k.capt);
+
+    err = sndx_ring_open(&k.rb, SND_PCM_FORMAT_FLOAT, channels, ring_capacity(frames), output);
+    SndGoto_(err, __close, "Failed sndx_ring_open: %s");
+
+    err = bench_run(bench, "ring_write_read", name, channels, frames, 2 * bytes, kernel_ring_float, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+    err = bench_run(bench, "copy_capt_to_play", name, channels, frames, bytes, kernel_copy_capt_to_play, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+    // Same matrix as copy_capt_to_play, picked up and settled before timing
+    err = sndx_router_open(&k.router, channels, channels, frames, output);
+    Goto_(err, __close, "Failed sndx_router_open");
+
+    sndx_router_preset_copy(k.router, k.gain);
+
+    err = sndx_router_commit(k.router);
+    Goto_(err, __close, "Failed sndx_router_commit");
+
+    kernel_router(&k);
+
+    err = bench_run(bench, "router_copy", name, channels, frames, bytes, kernel_router, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+    // Ramp path on every call, with gains that stay put
+    RANGE(i, k.router->current->npoints) { k.router->current->points[i].step = 0.0f; }
+
+    err = bench_run(bench, "router_ramp", name, channels, frames, bytes, kernel_router_ramp, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+__close:
+    sndx_router_close(k.router);
+    sndx_ring_close(k.rb);
+    sndx_buffer_close(k.capt);
+    sndx_buffer_close(k.play);
+
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    int err = 0;
+
+    const char* json = argc > 1 ? argv[1] : nullptr;
+    f64         secs = argc > 2 ? atof(argv[2]) : 0.2;
+
+    // JSON on stdout: progress goes to stderr
+    output_t* output;
+    err = snd_output_stdio_attach(&output, json && !strcmp(json, "-") ? stderr : stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    bench_t* bench;
+    err = bench_open(&bench, secs, output);
+    SndFatal_(err, "Failed bench_open: %s");
+
+    a_title("Kernels, %.2f s per case, cycles from %s", secs, bench->cycles_source);
+
+    RANGE(f, COUNT(formats))
+    RANGE(c, COUNT(channel_counts))
+    RANGE(n, COUNT(frame_counts))
+    {
+        if (!err) err = bench_format(bench, formats[f], channel_counts[c], frame_counts[n], output);
+    }
+
+    RANGE(c, COUNT(channel_counts))
+    RANGE(n, COUNT(frame_counts))
+    {
+        if (!err) err = bench_float(bench, channel_counts[c], frame_counts[n], output);
+    }
+
+    if (!err && json) err = bench_write_json(bench, json);
+
+    bench_close(bench);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
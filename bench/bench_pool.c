@@ -0,0 +1,161 @@
+/** @file bench_pool.c
+ *  @brief What the worker pool costs and saves per period, at each period size.
+ *
+ *  Usage: bench_pool [threads = 3] [priority = 0] [runs = 2000]
+ *
+ *  Per period size, medians over `runs` periods of:
+ *      serial   : 64 channels through 4 biquads each, on the calling thread
+ *      pool     : the same, one task per channel, split across the pool
+ *      dispatch : a run of 64 empty tasks, the latency the pool adds to a period on its own
+ *
+ *  The pool pays off when `pool` is below `serial`, and `dispatch` has to stay a small part of
+ *  the period (it comes out of the time left to the callback). Priority 0 keeps the default policy,
+ *  SCHED_FIFO needs the rights (rtprio in limits.conf, or CAP_SYS_NICE).
+ */
+#include "sndx/pool.h"
+#include "sndx/sys.h"
+
+#define RATE     48000
+#define CHANNELS 64
+#define STAGES   4
+
+#define COUNT(x) ((isize)(sizeof(x) / sizeof(x[0])))
+
+static const uframes_t period_sizes[] = {32, 64, 128, 256, 512, 1024};
+
+/** @brief Direct form I, state per channel and stage. */
+typedef struct
+{
+    f32 b0, b1, b2, a1, a2;
+    f32 x1, x2, y1, y2;
+
+} biquad_t;
+
+typedef struct
+{
+    float*    data;   ///< CHANNELS * frames, planar
+    biquad_t* bq;     ///< CHANNELS * STAGES
+    uframes_t frames; ///< Period size
+
+} work_t;
+
+static int u64_cmp(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return (x > y) - (x < y);
+}
+
+static void channel(work_t* w, u32 chn)
+{
+    float* x = w->data + chn * w->frames;
+
+    RANGE(s, STAGES)
+    {
+        biquad_t* q = &w->bq[chn * STAGES + s];
+
+        RANGE(i, (isize)w->frames)
+        {
+            f32 y  = q->b0 * x[i] + q->b1 * q->x1 + q->b2 * q->x2 - q->a1 * q->y1 - q->a2 * q->y2;
+            q->x2  = q->x1;
+            q->x1  = x[i];
+            q->y2  = q->y1;
+            q->y1  = y;
+            x[i]   = y;
+        }
+    }
+}
+
+static void task_channel(sndx_pool_t* pool [[maybe_unused]], u32 worker [[maybe_unused]], void* arg, u32 index)
+{
+    channel(arg, index);
+}
+
+static void task_empty(sndx_pool_t* pool [[maybe_unused]], u32 worker [[maybe_unused]], void* arg [[maybe_unused]],
+                       u32 index [[maybe_unused]])
+{
+}
+
+/** @brief Median nanoseconds of `runs` periods of `fn` (null: serial). */
+static u64 measure(sndx_pool_t* pool, sndx_pool_fn_t fn, work_t* w, u32 runs, u64* samples)
+{
+    RANGE(r, runs)
+    {
+        u64 start = sndx_nsecs();
+
+        if (fn)
+        {
+            sndx_pool_run(pool, fn, w, CHANNELS);
+        }
+        else
+        {
+            RANGE(chn, CHANNELS) { channel(w, (u32)chn); }
+        }
+
+        samples[r] = sndx_nsecs() - start;
+    }
+
+    qsort(samples, runs, sizeof(u64), u64_cmp);
+
+    return samples[runs / 2];
+}
+
+int main(int argc, char** argv)
+{
+    int err = 0;
+
+    u32 threads  = argc > 1 ? (u32)atoi(argv[1]) : 3;
+    int priority = argc > 2 ? atoi(argv[2]) : 0;
+    u32 runs     = argc > 3 ? (u32)atoi(argv[3]) : 2000;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    uframes_t max_frames = period_sizes[COUNT(period_sizes) - 1];
+
+    sndx_pool_t* pool    = nullptr;
+    u64*         samples = calloc(runs ? runs : 1, sizeof(u64));
+    work_t       w       = {
+                    .data = calloc(CHANNELS * max_frames, sizeof(float)),
+                    .bq   = calloc(CHANNELS * STAGES, sizeof(biquad_t)),
+    };
+
+    err = -(!samples || !w.data || !w.bq || !runs);
+    Goto_(err, __close, "Failed calloc bench data (or no runs)");
+
+    // Gentle low pass, stable, keeps the data finite over any number of runs
+    RANGE(i, CHANNELS * STAGES) { w.bq[i] = (biquad_t){.b0 = 0.2f, .b1 = 0.4f, .b2 = 0.2f, .a1 = -0.4f, .a2 = 0.2f}; }
+    RANGE(i, CHANNELS * (isize)max_frames) { w.data[i] = (float)((i * 7919) % 2001 - 1000) / 1000.0f; }
+
+    err = sndx_pool_open(&pool, threads, nullptr, priority, output);
+    SndGoto_(err, __close, "Failed sndx_pool_open: %s");
+
+    a_title("Worker pool, %d channels x %d biquads, %d threads + caller, %d runs per case", CHANNELS, STAGES, threads,
+            runs);
+    a_info("%6s %9s %9s %9s %8s %9s", "frames", "period", "serial", "pool", "speedup", "dispatch");
+
+    RANGE(n, COUNT(period_sizes))
+    {
+        w.frames = period_sizes[n];
+
+        f64 period   = w.frames * 1e6 / RATE;
+        f64 serial   = measure(pool, nullptr, &w, runs, samples) / 1000.0;
+        f64 parallel = measure(pool, task_channel, &w, runs, samples) / 1000.0;
+        f64 dispatch = measure(pool, task_empty, &w, runs, samples) / 1000.0;
+
+        a_info("%6ld %7.0fus %7.1fus %7.1fus %7.2fx %7.1fus  (%.1f%% of the period)", w.frames, period, serial,
+               parallel, serial / parallel, dispatch, 100.0 * dispatch / period);
+    }
+
+    sndx_pool_dump(pool, output);
+
+__close:
+    sndx_pool_close(pool);
+    Free(w.bq);
+    Free(w.data);
+    Free(samples);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
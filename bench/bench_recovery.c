@@ -0,0 +1,211 @@
+/** @file bench_recovery.c
+ *  @brief Time to audio after each fault class, on the simulated pair.
+ *
+ *  Usage: bench_recovery [faults per class = 10] [period size = 128]
+ *
+ *  Runs the `dump_trace` loop (wait, avail, read, write, and on failure `sndx_pollfds_xrun` +
+ *  `sndx_duplex_restart`) with a fault every 100 wakeups, and times from the fault to the end of
+ *  the first full cycle after it. Stalls count from the moment the device comes back.
+ *
+ *  Classes:
+ *      capture xrun  : POLLERR on capture
+ *      playback xrun : POLLERR on playback (playback polled too)
+ *      disconnect    : POLLNVAL on capture, fatal for pollfds, restarted anyway
+ *      timeout       : capture stalled for 8 periods, polls time out after 2
+ *      suspend       : capture suspended, prepared by `sndx_pollfds_xrun`
+ *
+ *  Target is 1 to 2 periods: about one period for capture to fill again after the restart.
+ */
+#include "sndx/duplex.h"
+#include "sndx/sim.h"
+#include "sndx/sys.h"
+
+#define RATE    48000
+#define PERIODS 3
+#define BUDGET  2 // Periods
+
+typedef struct
+{
+    const char*           name;  ///< Printed
+    sndx_sim_fault_kind_t kind;  ///< Fault
+    u32                   stall; ///< Stall length in periods
+    bool                  play;  ///< On playback, else on capture
+
+} fault_class_t;
+
+typedef struct
+{
+    u32 measured; ///< Faults recovered
+    f64 min;      ///< Periods
+    f64 median;   ///< Periods
+    f64 max;      ///< Periods
+    f64 usecs;    ///< Median
+
+} recovery_t;
+
+static const fault_class_t classes[] = {
+    {"capture xrun", SNDX_SIM_FAULT_XRUN, 0, false},
+    {"playback xrun", SNDX_SIM_FAULT_XRUN, 0, true},
+    {"disconnect", SNDX_SIM_FAULT_NVAL, 0, false},
+    {"timeout", SNDX_SIM_FAULT_STALL, 8, false},
+    {"suspend", SNDX_SIM_FAULT_SUSPEND, 0, false},
+};
+
+#define COUNT(x) ((isize)(sizeof(x) / sizeof(x[0])))
+
+static int u64_cmp(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return (x > y) - (x < y);
+}
+
+static int bench_class(const fault_class_t* fc, u32 repeats, uframes_t period_size, recovery_t* r, output_t* output)
+{
+    int err;
+
+    sndx_sim_fault_t* faults  = calloc(repeats, sizeof(sndx_sim_fault_t));
+    u64*              samples = calloc(repeats, sizeof(u64));
+    sndx_sim_t*       sim     = nullptr;
+    sndx_duplex_t*    d       = nullptr;
+
+    err = -(!faults || !samples);
+    Goto_(err, __close, "Failed calloc faults, samples");
+
+    // After the start settled, then far enough apart for each recovery to finish
+    RANGE(i, repeats)
+    {
+        faults[i] = (sndx_sim_fault_t){.wakeup = 50 + 100 * i, .kind = fc->kind, .periods = fc->stall};
+    }
+
+    sndx_sim_config_t config = {.play = {.channels = 2}, .capt = {.channels = 2}};
+
+    sndx_sim_stream_config_t* sc = fc->play ? &config.play : &config.capt;
+    sc->faults                   = faults;
+    sc->nfaults                  = repeats;
+
+    err = sndx_sim_open(&sim, &config, output);
+    SndGoto_(err, __close, "Failed sndx_sim_open: %s");
+
+    err = sndx_duplex_open_pcm(             //
+        &d,                                 //
+        sim->play.io.pcm, sim->capt.io.pcm, //
+        SND_PCM_FORMAT_S16_LE,              //
+        RATE, period_size, PERIODS,         //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED,    //
+        output);
+    SndGoto_(err, __close, "Failed sndx_duplex_open_pcm: %s");
+
+    u64 period_nsecs = (u64)period_size * 1000000000ULL / RATE;
+
+    d->pfd->capture_only = !fc->play;
+    d->pfd->poll_timeout = 2 * period_nsecs / 1000000 + 1;
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed sndx_duplex_start: %s");
+
+    sndx_sim_stream_t* s = fc->play ? &sim->play : &sim->capt;
+
+    u32  measured = 0;
+    u64  seen     = 0;
+    bool pending  = false;
+    u64  end      = sndx_nsecs() + 4 * (50 + 100 * repeats) * period_nsecs;
+
+    while (measured < repeats && sndx_nsecs() < end)
+    {
+        uframes_t frames = 0;
+
+        sndx_pollfds_error_t perr = sndx_pollfds_wait(d->pfd, d->play, d->capt, d->out);
+        if (perr == POLLFD_SUCCESS) perr = sndx_duplex_passthrough(d, &frames);
+
+        if (perr == POLLFD_SUCCESS)
+        {
+            bool audio = frames > 0;
+
+            if (pending && audio) samples[measured++] = sndx_nsecs() - s->fault_nsecs;
+            pending = pending && !audio;
+            continue;
+        }
+
+        // Only failures caused by a scheduled fault are timed
+        if (s->faults[fc->kind] > seen)
+        {
+            seen    = s->faults[fc->kind];
+            pending = true;
+        }
+
+        sndx_pollfds_xrun(d->pfd, d->play, d->capt, d->out);
+
+        err = sndx_duplex_restart(d);
+        SndGoto_(err, __stop, "Failed sndx_duplex_restart: %s");
+    }
+
+    err = -(measured == 0);
+    Goto_(err, __stop, "%s: no fault recovered", fc->name);
+
+    qsort(samples, measured, sizeof(u64), u64_cmp);
+
+    r->measured = measured;
+    r->min      = (f64)samples[0] / period_nsecs;
+    r->median   = (f64)samples[measured / 2] / period_nsecs;
+    r->max      = (f64)samples[measured - 1] / period_nsecs;
+    r->usecs    = samples[measured / 2] / 1000.0;
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+    sndx_sim_close(sim);
+    Free(faults);
+    Free(samples);
+
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    int err = 0;
+
+    u32       repeats     = argc > 1 ? (u32)atoi(argv[1]) : 10;
+    uframes_t period_size = argc > 2 ? (uframes_t)atoi(argv[2]) : 128;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    // Pollfds and duplex print on every xrun, only the table goes to stdout
+    output_t* quiet;
+    err = snd_output_buffer_open(&quiet);
+    SndFatal(err, "Failed snd_output_buffer_open: %s");
+
+    a_title("Time to audio after a fault, %ld frames per period at %d Hz, budget %d periods", period_size, RATE,
+            BUDGET);
+    a_info("%-14s %7s %9s %9s %9s %9s", "fault", "n", "min", "median", "max", "usecs");
+
+    RANGE(i, COUNT(classes))
+    {
+        recovery_t r = {};
+
+        err = bench_class(&classes[i], repeats, period_size, &r, quiet);
+
+        // Keep the log of a failed class only
+        if (err < 0)
+        {
+            char* log;
+            a_error("%s failed:", classes[i].name);
+            if (snd_output_buffer_string(quiet, &log)) fputs(log, stdout);
+            break;
+        }
+
+        a_info("%-14s %3d/%-3d %9.3f %9.3f %9.3f %9.1f   %s", classes[i].name, r.measured, repeats, r.min, r.median,
+               r.max, r.usecs, r.median <= BUDGET ? "ok" : "over");
+
+        snd_output_flush(quiet);
+    }
+
+    snd_output_close(quiet);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+/** @file bench_resampler.c
+ *  @brief `sndx_resampler_t` over every quality x channels, a period per call.
+ *
+ *  Usage: bench_resampler [JSON path, "-" for stdout] [seconds per case]
+ *
+ *  Kernels, planar float in and out as the duplex path has them:
+ *      resampler_drift_<quality> : drift ratio (+100 ppm), the ratio changing every call like under the controller
+ *      resampler_44k1_<quality>  : fixed 48k -> 44.1k
+ *
+ *  GB/s counts the period read plus the frames written, cycles/sample are per input frame per channel.
+ */
+#include "bench.h"
+#include "sndx/resampler.h"
+
+constexpr uframes_t period_size = 128;
+
+static const u32 channel_counts[] = {1, 2, 8, 32};
+
+#define COUNT(x) ((isize)(sizeof(x) / sizeof(x[0])))
+
+typedef struct
+{
+    sndx_resampler_t* r;         ///< Resampler under test
+    area_t*           in_areas;  ///< A period of every channel
+    area_t*           out_areas; ///< Room for `out_cap` frames of every channel
+    uframes_t         out_cap;   ///< Output frames per channel
+    f64               ratio;     ///< Nominal ratio
+    bool              drift;     ///< Wobble around `ratio` every call
+    u64               calls;     ///< So far
+
+} kernel_arg_t;
+
+static void kernel_resampler(void* arg)
+{
+    kernel_arg_t* k = arg;
+
+    // Controller output wobbles around the drift every cycle
+    if (k->drift) sndx_resampler_set_ratio(k->r, k->ratio + ((k->calls & 1) ? 1e-6 : -1e-6));
+
+    uframes_t n = period_size;
+    uframes_t m = k->out_cap;
+    sndx_resampler_process(k->r, k->in_areas, 0, &n, k->out_areas, 0, &m);
+
+    k->calls++;
+}
+
+static int bench_case( //
+    bench_t* bench, sndx_resampler_quality_t quality, u32 channels, f64 ratio, bool drift, output_t* output)
+{
+    int err;
+
+    uframes_t out_cap = 2 * period_size + 16;
+
+    float*  in        = calloc(channels * period_size, sizeof(float));
+    float*  out       = calloc(channels * out_cap, sizeof(float));
+    area_t* in_areas  = calloc(channels, sizeof(area_t));
+    area_t* out_areas = calloc(channels, sizeof(area_t));
+
+    kernel_arg_t k = {.in_areas = in_areas, .out_areas = out_areas, .out_cap = out_cap, .ratio = ratio, .drift = drift};
+
+    err = -(!in || !out || !in_areas || !out_areas);
+    Goto_(err, __close, "Failed calloc");
+
+    RANGE(chn, channels)
+    {
+        in_areas[chn]  = (area_t){.addr = in, .first = chn * period_size * 32, .step = 32};
+        out_areas[chn] = (area_t){.addr = out, .first = chn * out_cap * 32, .step = 32};
+
+        RANGE(i, period_size) { in[chn * period_size + i] = (float)sin(0.1 * i + chn); }
+    }
+
+    err = sndx_resampler_open(&k.r, quality, channels, ratio, period_size, output);
+    SndGoto_(err, __close, "Failed sndx_resampler_open: %s");
+
+    char name[32];
+    snprintf(name, sizeof(name), "resampler_%s_%s", drift ? "drift" : "44k1", sndx_resampler_quality_name(quality));
+
+    usize bytes = (usize)(channels * period_size * (1.0 + ratio) * sizeof(float));
+
+    err = bench_run(bench, name, "FLOAT", channels, period_size, bytes, kernel_resampler, &k);
+    Goto_(err, __close, "Failed bench_run");
+
+__close:
+    sndx_resampler_close(k.r);
+    Free(in);
+    Free(out);
+    Free(in_areas);
+    Free(out_areas);
+
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    int err = 0;
+
+    const char* json = argc > 1 ? argv[1] : nullptr;
+    f64         secs = argc > 2 ? atof(argv[2]) : 0.2;
+
+    // JSON on stdout: progress goes to stderr
+    output_t* output;
+    err = snd_output_stdio_attach(&output, json && !strcmp(json, "-") ? stderr : stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    bench_t* bench;
+    err = bench_open(&bench, secs, output);
+    SndFatal_(err, "Failed bench_open: %s");
+
+    a_title("Resampler, %.2f s per case, period %ld, cycles from %s", secs, period_size, bench->cycles_source);
+
+    RANGE(q, SNDX_RESAMPLER_QUALITY_LAST + 1)
+    RANGE(c, COUNT(channel_counts))
+    {
+        if (!err) err = bench_case(bench, q, channel_counts[c], 1.0 + 100e-6, true, output);
+        if (!err) err = bench_case(bench, q, channel_counts[c], 44100.0 / 48000.0, false, output);
+    }
+
+    if (!err && json) err = bench_write_json(bench, json);
+
+    bench_close(bench);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
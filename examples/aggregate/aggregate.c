@@ -0,0 +1,95 @@
+/** @file aggregate.c
+ *  @brief Pass-through across any number of capture and playback devices with `sndx_aggregate_t`.
+ *
+ *  Usage: aggregate [c:|p:]device ...
+ *      The first device is the clock master, e.g.
+ *      aggregate c:hw:A96,0 p:hw:A96,0 p:hw:PCH,0 c:hw:USB,0
+ *
+ *  Capture channel `chn % ch_capt` goes to playback channel `chn`, for 10 seconds.
+ */
+#include "sndx/aggregate.h"
+
+#define MAX_DEVS 32
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_aggregate_desc_t desc[MAX_DEVS] = {
+        {.name = "hw:A96,0", .stream = SND_PCM_STREAM_CAPTURE},
+        {.name = "hw:A96,0", .stream = SND_PCM_STREAM_PLAYBACK},
+    };
+    u32 ndevs = 2;
+
+    if (argc > 1)
+    {
+        ndevs = 0;
+        RANGE(i, 1, argc)
+        {
+            if (ndevs == MAX_DEVS) break;
+
+            const char* arg  = argv[i];
+            bool        capt = strncmp(arg, "c:", 2) == 0;
+            bool        play = strncmp(arg, "p:", 2) == 0;
+
+            desc[ndevs].name   = capt || play ? arg + 2 : arg;
+            desc[ndevs].stream = play ? SND_PCM_STREAM_PLAYBACK : SND_PCM_STREAM_CAPTURE;
+            ndevs++;
+        }
+    }
+
+    sndx_aggregate_t* a;
+    err = sndx_aggregate_open(&a, desc, ndevs, 0, SND_PCM_FORMAT_S32_LE, 48000, 128, 2, output);
+    SndFatal_(err, "Failed sndx_aggregate_open: %s");
+
+    sndx_dump_aggregate(a, output);
+
+    err = sndx_aggregate_start(a);
+    SndGoto_(err, __close, "Failed: sndx_aggregate_start: %s");
+
+    u64 restarts = 0;
+
+    while (a->cycles * a->period_size < a->rate * 10)
+    {
+        err = sndx_aggregate_wait(a);
+        if (err >= 0) err = sndx_aggregate_read(a);
+
+        if (err >= 0 && a->ch_capt)
+        {
+            RANGE(chn, a->ch_play)
+            {
+                memcpy(&a->play[chn * a->period_size], &a->capt[(chn % a->ch_capt) * a->period_size],
+                       a->period_size * sizeof(float));
+            }
+        }
+
+        if (err >= 0) err = sndx_aggregate_write(a);
+
+        if (err < 0)
+        {
+            a_info("Restart after: %s", snd_strerror(err));
+
+            err = sndx_aggregate_restart(a);
+            SndGoto_(err, __stop, "Failed: sndx_aggregate_restart: %s");
+
+            restarts++;
+        }
+    }
+
+    a_info("Restarts: %ld", restarts);
+
+__stop:
+    sndx_aggregate_stop(a);
+
+    sndx_dump_aggregate(a, output);
+
+__close:
+    sndx_aggregate_close(a);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
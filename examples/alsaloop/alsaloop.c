@@ -1,10 +1,64 @@
-#include "alsaloop.h"
+/** @file alsaloop.c
+ *  @brief Capture -> playback loops between any devices, several per thread, like alsaloop.
+ *
+ *  Usage: alsaloop [-r RATE] [-l FRAMES] [-s SYNC] [-R PRIORITY] CAPT>PLAY[@THREAD] ...
+ *      -r  rate of every loop (48000)
+ *      -l  latency target in frames, also the buffer (256, two periods of 128)
+ *      -s  none, simple, samplerate, playshift or captshift, for pairs that cannot be linked (samplerate),
+ *          the shift modes need snd-aloop on that side and use samplerate otherwise
+ *      -R  SCHED_FIFO priority of the loop threads, 0 for the default policy (0)
+ *
+ *  Loops with the same THREAD (0 if not given) share a thread, e.g.
+ *      alsaloop -l 512 "hw:A96,0>hw:PCH,0" "hw:USB,0>hw:PCH,1@1"
+ *
+ *  Runs until SIGINT or SIGTERM, dumps the loops every 5 seconds and with `kill -USR1 <pid>`.
+ *  Old structure of alsaloop kept for reference in alsaloop.h.
+ */
+#include "sndx/loopback.h"
+#include <signal.h>
 
-int                     loopbacks_count = 0;
-struct loopback**       loopbacks       = NULL;
-struct loopback_thread* threads         = NULL;
+#define MAX_LOOPS 32
 
-int main()
+static int stop = 0;
+static int dump = 0;
+
+static void sig_handler(int sig ATTRIBUTE_UNUSED) { stop = 1; }
+static void sig_handler_dump(int sig ATTRIBUTE_UNUSED) { dump = 1; }
+
+/** @brief "CAPT>PLAY[@THREAD]" into desc, in place: `arg` is cut at '>' and '@'. */
+static int parse_loop(char* arg, sndx_loopback_desc_t* desc)
+{
+    char* play = strchr(arg, '>');
+    if (!play) return -EINVAL;
+
+    *play++    = '\0';
+    desc->capt = arg;
+    desc->play = play;
+
+    char* thread = strchr(play, '@');
+    if (thread)
+    {
+        *thread++    = '\0';
+        desc->thread = (u32)atoi(thread);
+    }
+
+    return 0;
+}
+
+static int parse_sync(const char* name, sndx_sync_type_t* sync)
+{
+    RANGE(s, SNDX_SYNC_LAST + 1)
+    {
+        if (strcasecmp(name, sndx_sync_type_name(s)) != 0) continue;
+
+        *sync = s;
+        return 0;
+    }
+
+    return -EINVAL;
+}
+
+int main(int argc, char** argv)
 {
     int err;
 
@@ -12,57 +66,102 @@ int main()
     err = snd_output_stdio_attach(&output, stderr, 0);
     SndFatal(err, "Failed snd_output_stdio_attach: %s");
 
-    // err = create_loopback_handle(&play, arg_pdevice, arg_pctl, "playback");
-    // err = create_loopback_handle(&capt, arg_cdevice, arg_cctl, "capture");
-    // err = create_loopback(&loop, play, capt, output);
-    // set_loop_time(loop, arg_loop_time);
-    // add_loop(loop);
-
-    // threads_count = j;
-    // main_job = pthread_self();
-
-    // signal(SIGINT, signal_handler);
-    // signal(SIGTERM, signal_handler);
-    // signal(SIGABRT, signal_handler);
-    // signal(SIGUSR1, signal_handler_state);
-    // signal(SIGUSR2, signal_handler_ignore);
-
-    // for (k = 0; k < threads_count; k++)
-    //     thread_job(&threads[k]) {
-    //
-    //         setscheduler();
-    //
-    //         for (i = 0; i < thread->loopbacks_count; i++)
-    //             err = pcmjob_init(thread->loopbacks[i]);
-    //
-    //         for (i = 0; i < thread->loopbacks_count; i++)
-    //             err = pcmjob_start(thread->loopbacks[i]);
-    //
-    //         while (!quit) {
-    //
-    //             for (i = j = 0; i < thread->loopbacks_count; i++)
-    //                 err = pcmjob_pollfds_init(thread->loopbacks[i], &pfds[j]);
-    //
-    //                 err = poll(pfds, j, wake);
-    //
-    //                 for (i = j = 0; i < thread->loopbacks_count; i++) {
-    //                     struct loopback* loop = thread->loopbacks[i];
-    //                     if (j < loop->active_pollfd_count)
-    //                         err = pcmjob_pollfds_handle(loop, &pfds[j]);
-    //                     j += loop->active_pollfd_count;
-    //                }
-    //
-    //         }
-    //
-    //     }
-    //
-    // if (j > 1)
-    //     for (k = 0; k < threads_count; k++)
-    //         pthread_join(threads[k].thread, NULL);
-
-    // __close:
+    sndx_loopback_desc_t desc[MAX_LOOPS];
+    u32                  nloops   = 0;
+    u32                  rate     = 48000;
+    uframes_t            latency  = 256;
+    sndx_sync_type_t     sync     = SNDX_SYNC_SAMPLERATE;
+    int                  priority = 0;
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
 
+        if (opt[0] == '-' && !value)
+        {
+            SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+        }
+        else if (strcmp(opt, "-r") == 0)
+        {
+            rate = (u32)atoi(value);
+            i++;
+        }
+        else if (strcmp(opt, "-l") == 0)
+        {
+            latency = (uframes_t)atol(value);
+            i++;
+        }
+        else if (strcmp(opt, "-s") == 0)
+        {
+            err = parse_sync(value, &sync);
+            SndFatal_(err, "Unknown sync %s: %s", value);
+            i++;
+        }
+        else if (strcmp(opt, "-R") == 0)
+        {
+            priority = atoi(value);
+            i++;
+        }
+        else if (nloops < MAX_LOOPS)
+        {
+            desc[nloops] = (sndx_loopback_desc_t){.format = SND_PCM_FORMAT_S32_LE};
+
+            err = parse_loop(argv[i], &desc[nloops]);
+            SndFatal_(err, "Expected CAPT>PLAY[@THREAD], got %s: %s", opt);
+            nloops++;
+        }
+    }
+
+    if (!nloops)
+    {
+        desc[0] = (sndx_loopback_desc_t){.capt = "hw:A96,0", .play = "hw:A96,0", .format = SND_PCM_FORMAT_S32_LE};
+        nloops  = 1;
+    }
+
+    sndx_loopback_t* lb;
+    err = sndx_loopback_open(&lb, priority, output);
+    SndFatal_(err, "Failed sndx_loopback_open: %s");
+
+    RANGE(i, nloops)
+    {
+        desc[i].rate        = rate;
+        desc[i].latency_req = latency;
+        desc[i].sync        = sync;
+
+        err = sndx_loopback_add(lb, &desc[i]);
+        SndGoto_(err, __close, "Failed sndx_loopback_add: %s");
+    }
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+    signal(SIGUSR1, sig_handler_dump);
+
+    err = sndx_loopback_start(lb);
+    SndGoto_(err, __close, "Failed sndx_loopback_start: %s");
+
+    sndx_loopback_dump(lb, output);
+    a_info("Running, dump with: kill -USR1 %d", getpid());
+
+    u32 ticks = 0;
+    while (!stop)
+    {
+        usleep(100000);
+
+        if (!dump && ++ticks % 50) continue;
+
+        dump = 0;
+        sndx_loopback_dump(lb, output);
+    }
+
+    err = sndx_loopback_stop(lb);
+    SndCheck_(err, "Loop thread stopped early: %s");
+
+    sndx_loopback_dump(lb, output);
+
+__close:
+    sndx_loopback_close(lb);
     snd_output_close(output);
 
-    return 0;
+    return err < 0 ? 1 : 0;
 }
@@ -119,12 +119,19 @@ int jack_xrun(jack_t* j)
     // Cannot return error
     sndx_pollfds_xrun(j->p, j->d->play, j->d->capt, j->d->out);
 
-    // Jack calls it restart
-    err = jack_stop(j);
-    SndReturn_(err, "Failed: jack_stop: %s");
-
-    err = jack_start(j);
-    SndReturn_(err, "Failed: jack_start: %s");
+    // Jack calls it restart, here the cheapest recovery that works, full restart only as fallback
+    err = sndx_duplex_recover(d);
+    SndReturn_(err, "Failed: sndx_duplex_recover: %s");
+
+    a_info("Recovered: play %s (lost %ld), capt %s (lost %ld)%s",             //
+           sndx_xrun_strategy_name(d->xrun_play.strategy), d->xrun_play.lost, //
+           sndx_xrun_strategy_name(d->xrun_capt.strategy), d->xrun_capt.lost, //
+           err == 1 ? ", needed restart" : "");
+
+    // Own pollfds, duplex only resets `d->pfd`
+    j->p->poll_last   = 0;
+    j->p->poll_next   = 0;
+    j->p->retry_count = 0;
 
     return 0;
 }
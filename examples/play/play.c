@@ -0,0 +1,119 @@
+/** @file play.c
+ *  @brief Backing track playback from disk, @see player.h
+ *
+ *  Usage: play [-P PLAY] [-C CAPT] [-p PERIOD] [-s SECONDS] [-l] [-f] PATH
+ *      -P, -C  playback and capture devices (hw:A96,0), capture is read and dropped
+ *      -p      period size (128)
+ *      -s      start this far into the file (0)
+ *      -l      loop
+ *      -f      through libsndfile even if the file could be mapped
+ *
+ *  Runs at the rate of the file, until its end.
+ */
+#include "sndx/duplex.h"
+#include "sndx/player.h"
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char* play   = "hw:A96,0";
+    const char* capt   = "hw:A96,0";
+    uframes_t   period = 128;
+    f64         start  = 0.0;
+
+    sndx_player_desc_t desc = {};
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(opt, "-l") == 0)
+        {
+            desc.loop = true;
+            continue;
+        }
+
+        if (strcmp(opt, "-f") == 0)
+        {
+            desc.source = SNDX_PLAYER_SNDFILE;
+            continue;
+        }
+
+        if (opt[0] != '-')
+        {
+            desc.path = opt;
+            continue;
+        }
+
+        if (!value) SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+
+        if (strcmp(opt, "-P") == 0) play = value;
+        else if (strcmp(opt, "-C") == 0) capt = value;
+        else if (strcmp(opt, "-p") == 0) period = (uframes_t)atol(value);
+        else if (strcmp(opt, "-s") == 0) start = atof(value);
+        else SndFatal_(-EINVAL, "Unknown option %s: %s", opt);
+
+        i++;
+    }
+
+    if (!desc.path) SndFatal_(-EINVAL, "Missing PATH, see the usage in play.c: %s");
+
+    sndx_player_t* p;
+    err = sndx_player_open(&p, &desc, output);
+    Fatal_(err, "Failed sndx_player_open");
+
+    if (start > 0.0) sndx_player_seek(p, (uframes_t)(start * p->rate));
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        play, capt,                      //
+        SND_PCM_FORMAT_S32_LE,           //
+        p->rate, period, 2,              //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        output);
+    SndGoto_(err, __close_player, "Failed sndx_duplex_open: %s");
+
+    // PREPARED -> RUNNING
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed: sndx_duplex_start: %s");
+
+    while (!sndx_player_done(p))
+    {
+        uframes_t avail = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_wait: %s");
+
+        uframes_t frames = avail;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_read: %s");
+
+        // Only the ring, the disk is the prefetch thread's problem
+        sndx_player_pull(p, d->buf_play->buf, d->ch_play, offset, frames);
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_write: %s");
+    }
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+
+__close_player:
+    sndx_player_dump(p, output);
+    sndx_player_close(p);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+/** @file record.c
+ *  @brief Multitrack recording of every capture channel to disk, @see recorder.h
+ *
+ *  Usage: record [-P PLAY] [-C CAPT] [-r RATE] [-p PERIOD] [-t SECONDS] [-d] PATH
+ *      -P, -C  playback and capture devices (hw:A96,0), playback gets silence
+ *      -r      rate (48000)
+ *      -p      period size (128)
+ *      -t      seconds to record (10)
+ *      -d      raw float with O_DIRECT instead of W64 through libsndfile
+ */
+#include "sndx/duplex.h"
+#include "sndx/recorder.h"
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char* play    = "hw:A96,0";
+    const char* capt    = "hw:A96,0";
+    u32         rate    = 48000;
+    uframes_t   period  = 128;
+    f64         seconds = 10.0;
+
+    sndx_recorder_desc_t desc = {.mode = SNDX_RECORDER_SNDFILE};
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(opt, "-d") == 0)
+        {
+            desc.mode = SNDX_RECORDER_DIRECT;
+            continue;
+        }
+
+        if (opt[0] != '-')
+        {
+            desc.path = opt;
+            continue;
+        }
+
+        if (!value) SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+
+        if (strcmp(opt, "-P") == 0) play = value;
+        else if (strcmp(opt, "-C") == 0) capt = value;
+        else if (strcmp(opt, "-r") == 0) rate = (u32)atoi(value);
+        else if (strcmp(opt, "-p") == 0) period = (uframes_t)atol(value);
+        else if (strcmp(opt, "-t") == 0) seconds = atof(value);
+        else SndFatal_(-EINVAL, "Unknown option %s: %s", opt);
+
+        i++;
+    }
+
+    if (!desc.path) SndFatal_(-EINVAL, "Missing PATH, see the usage in record.c: %s");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        play, capt,                      //
+        SND_PCM_FORMAT_S32_LE,           //
+        rate, period, 2,                 //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        output);
+    SndFatal_(err, "Failed sndx_duplex_open: %s");
+
+    desc.channels = d->ch_capt;
+    desc.rate     = d->rate;
+
+    sndx_recorder_t* rec;
+    err = sndx_recorder_open(&rec, &desc, output);
+    Goto_(err, __close_duplex, "Failed sndx_recorder_open");
+
+    // PREPARED -> RUNNING
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed: sndx_duplex_start: %s");
+
+    uframes_t frames_total = (uframes_t)(seconds * d->rate);
+    uframes_t frames_done  = 0;
+
+    while (frames_done < frames_total)
+    {
+        uframes_t avail = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_wait: %s");
+
+        uframes_t frames = avail;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_read: %s");
+
+        // Only a copy into the ring, the disk is the writer thread's problem
+        sndx_recorder_push(rec, d->buf_capt->buf, offset, frames);
+
+        RANGE(chn, d->ch_play)
+        {
+            memset(d->buf_play->bufdata + chn * d->buf_play->frames + offset, 0, frames * sizeof(float));
+        }
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_write: %s");
+
+        frames_done += frames;
+    }
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_recorder_dump(rec, output);
+
+    int errc = sndx_recorder_close(rec);
+    if (errc < 0) a_error("Recording %s incomplete: %s", desc.path, strerror(-errc));
+    if (!err) err = errc;
+
+__close_duplex:
+    sndx_duplex_close(d);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
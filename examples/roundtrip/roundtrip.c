@@ -0,0 +1,111 @@
+/** @file roundtrip.c
+ *  @brief True round-trip latency of a device pair, through a loopback cable, @see roundtrip.h
+ *
+ *  Usage: roundtrip [-P PLAY] [-C CAPT] [-r RATE] [-p PERIOD] [-n PERIODS] [-s mls|chirp] [-o ORDER] [-c CHANNEL]
+ *                   [-k REPEATS]
+ *      -P, -C  playback and capture devices (hw:A96,0)
+ *      -r      rate (48000)
+ *      -p, -n  period size and periods, the configuration measured (128, 2)
+ *      -s      stimulus (mls)
+ *      -o      stimulus of 2^ORDER - 1 frames (15)
+ *      -c      capture channel the cable comes back on (0), the stimulus goes out on every channel
+ *      -k      measurements on the running stream (3), they should agree to a fraction of a frame
+ *
+ *  Prints the latency to shift recordings by, in frames and ms, for this configuration.
+ */
+#include "sndx/roundtrip.h"
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char*             play    = "hw:A96,0";
+    const char*             capt    = "hw:A96,0";
+    u32                     rate    = 48000;
+    uframes_t               period  = 128;
+    u32                     periods = 2;
+    sndx_roundtrip_signal_t signal  = SNDX_ROUNDTRIP_MLS;
+    u32                     order   = 15;
+    u32                     channel = 0;
+    u32                     repeats = 3;
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+
+        if (strcmp(opt, "-P") == 0) play = value;
+        else if (strcmp(opt, "-C") == 0) capt = value;
+        else if (strcmp(opt, "-r") == 0) rate = (u32)atoi(value);
+        else if (strcmp(opt, "-p") == 0) period = (uframes_t)atol(value);
+        else if (strcmp(opt, "-n") == 0) periods = (u32)atoi(value);
+        else if (strcmp(opt, "-s") == 0) signal = strcmp(value, "chirp") ? SNDX_ROUNDTRIP_MLS : SNDX_ROUNDTRIP_CHIRP;
+        else if (strcmp(opt, "-o") == 0) order = (u32)atoi(value);
+        else if (strcmp(opt, "-c") == 0) channel = (u32)atoi(value);
+        else if (strcmp(opt, "-k") == 0) repeats = atoi(value) > 0 ? (u32)atoi(value) : 1;
+        else SndFatal_(-EINVAL, "Unknown option %s: %s", opt);
+
+        i++;
+    }
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        play, capt,                      //
+        SND_PCM_FORMAT_S32_LE,           //
+        rate, period, periods,           //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        output);
+    SndFatal_(err, "Failed sndx_duplex_open: %s");
+
+    // Anything longer than a second is not a loopback
+    sndx_roundtrip_t* rt;
+    err = sndx_roundtrip_open(&rt, signal, order, rate, 0.5f, rate, output);
+    SndGoto_(err, __close_duplex, "Failed sndx_roundtrip_open: %s");
+
+    // PREPARED -> RUNNING
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed: sndx_duplex_start: %s");
+
+    f64 sum = 0.0;
+    f64 min = INFINITY;
+    f64 max = -INFINITY;
+
+    RANGE(k, repeats)
+    {
+        sndx_roundtrip_reset(rt);
+
+        err = sndx_roundtrip_run(rt, d, channel);
+        SndGoto_(err, __stop, "Failed sndx_roundtrip_run: %s");
+
+        err = sndx_roundtrip_analyse(rt, output);
+        SndGoto_(err, __stop, "Failed sndx_roundtrip_analyse: %s");
+
+        sndx_roundtrip_dump(rt, output);
+
+        sum += rt->latency;
+        min  = rt->latency < min ? rt->latency : min;
+        max  = rt->latency > max ? rt->latency : max;
+    }
+
+    a_info("%s -> %s, %d Hz, %ld x %d: round trip %.2f frames (%.3f ms), spread %.2f frames", play, capt, rate,
+           period, periods, sum / repeats, 1000.0 * sum / repeats / rate, max - min);
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_roundtrip_close(rt);
+
+__close_duplex:
+    sndx_duplex_close(d);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/** @file tune.c
+ *  @brief Lowest stable period size / periods of a device pair, @see tune.h
+ *
+ *  Usage: tune [-P PLAY] [-C CAPT] [-r RATE] [-t SECONDS] [-x XRUNS_PER_HOUR] [-R PRIORITY] [-a]
+ *              [-p SIZE,SIZE,..] [-n PERIODS,PERIODS,..]
+ *      -P, -C  playback and capture devices (hw:A96,0)
+ *      -r      rate (48000)
+ *      -t      run per candidate (10)
+ *      -x      xruns per hour a candidate may have to count as stable (0)
+ *      -R      SCHED_FIFO priority while measuring, 0 for the default policy (0)
+ *      -a      run every candidate, not only up to the first stable one
+ *      -p, -n  candidates (16 to 1024 in powers of two, and 2,3,4)
+ */
+#include "sndx/tune.h"
+
+#define MAX_LIST 16
+
+/** @brief Comma separated numbers into `list`, returns how many. */
+static u32 parse_list(const char* arg, u64* list)
+{
+    u32 n = 0;
+
+    while (*arg && n < MAX_LIST)
+    {
+        char* end;
+        list[n++] = strtoull(arg, &end, 10);
+        if (*end != ',') break;
+        arg = end + 1;
+    }
+
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_tune_desc_t desc = {
+        .play   = "hw:A96,0",
+        .capt   = "hw:A96,0",
+        .format = SND_PCM_FORMAT_S32_LE,
+        .rate   = 48000,
+        .access = SND_PCM_ACCESS_MMAP_INTERLEAVED,
+    };
+
+    u64       list[MAX_LIST];
+    uframes_t sizes[MAX_LIST];
+    u32       periods[MAX_LIST];
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(opt, "-a") == 0)
+        {
+            desc.sweep_all = true;
+            continue;
+        }
+
+        if (!value) SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+
+        if (strcmp(opt, "-P") == 0) desc.play = value;
+        else if (strcmp(opt, "-C") == 0) desc.capt = value;
+        else if (strcmp(opt, "-r") == 0) desc.rate = (u32)atoi(value);
+        else if (strcmp(opt, "-t") == 0) desc.seconds = atof(value);
+        else if (strcmp(opt, "-x") == 0) desc.max_xrun_rate = atof(value);
+        else if (strcmp(opt, "-R") == 0) desc.priority = atoi(value);
+        else if (strcmp(opt, "-p") == 0)
+        {
+            desc.nperiod_sizes = parse_list(value, list);
+            RANGE(k, desc.nperiod_sizes) { sizes[k] = (uframes_t)list[k]; }
+            desc.period_sizes = sizes;
+        }
+        else if (strcmp(opt, "-n") == 0)
+        {
+            desc.nperiods = parse_list(value, list);
+            RANGE(k, desc.nperiods) { periods[k] = (u32)list[k]; }
+            desc.periods = periods;
+        }
+        else SndFatal_(-EINVAL, "Unknown option %s: %s", opt);
+
+        i++;
+    }
+
+    sndx_tune_result_t results[SNDX_TUNE_MAX_CANDIDATES];
+    u32                nresults = 0;
+
+    int best = sndx_tune_run(&desc, results, SNDX_TUNE_MAX_CANDIDATES, &nresults, output);
+
+    a_info("%s -> %s at %d Hz, %.1f xruns per hour allowed:", desc.play, desc.capt, desc.rate, desc.max_xrun_rate);
+    sndx_tune_dump(results, nresults, best, desc.rate, output);
+
+    if (best >= 0)
+    {
+        sndx_tune_result_t* r = &results[best];
+        a_info("Recommended: period_size %ld, periods %d (%.2f ms)", r->period_size, r->periods,
+               sndx_tune_latency(r) * 1000.0 / desc.rate);
+    }
+
+    snd_output_close(output);
+
+    return best < 0 ? 1 : 0;
+}
@@ -1,52 +1,208 @@
 /** @file tuner.c
- *  @brief Computing fft for each period to estimate pitch
+ *  @brief Pitch of one channel, live from capture or streamed from a file, @see pitch.h
+ *
+ *  Usage: tuner [-P PLAY] [-C CAPT] [-r RATE] [-p PERIOD] [-c CHANNEL] [-w WINDOW] [-t SECONDS] [PATH]
+ *      -P, -C  playback and capture devices (hw:A96,0), playback gets silence
+ *      -r      rate (48000), a file has its own
+ *      -p      period size (128)
+ *      -c      channel to follow (0)
+ *      -w      analysis window, power of two (4096), an estimate every quarter of it
+ *      -t      seconds to listen (10)
+ *
+ *  With PATH the file is read a hop at a time, never whole, and every estimate is printed with its time.
+ *  Without, the capture channel is followed and the note is shown in place.
  */
-#include "sndx/types.h" // IWYU pragma: keep
+#include "sndx/duplex.h"
+#include "sndx/pitch.h"
 #include <sndfile.h>
 
-#define max(a, b)                                                                                                      \
-    ({                                                                                                                 \
-        __typeof__(a) _a = (a);                                                                                        \
-        __typeof__(b) _b = (b);                                                                                        \
-        _a > _b ? _a : _b;                                                                                             \
-    })
+static void print_estimate(const sndx_pitch_estimate_t* est, u32 rate, bool live)
+{
+    const char* end = live ? "\r" : "\n";
+
+    if (!live) printf("%9.3f s  ", (f64)est->frame / rate);
 
-// Application
-int main(int argc, char* argv[])
+    if (!est->valid)
+    {
+        printf("   --                               %6.1f dBFS     %s", est->level_db, end);
+        fflush(stdout);
+        return;
+    }
+
+    int         octave;
+    f64         cents;
+    const char* name = sndx_pitch_note(est->freq, &octave, &cents);
+
+    printf("%3s%-2d %+6.1f cents %9.2f Hz %4.0f%% %6.1f dBFS%s", name, octave, cents, est->freq,
+           100.0 * est->confidence, est->level_db, end);
+    fflush(stdout);
+}
+
+/** @brief Streaming file analyzer, a hop of frames in memory at a time. */
+static int tune_file(const char* path, u32 channel, u32 window, output_t* output)
 {
     int err;
 
-    err = -(argc < 2);
-    Fatal(err, "USAGE: tuner PATH");
-
-    const char* path = argv[1];
+    SF_INFO  info = {};
+    SNDFILE* f    = sf_open(path, SFM_READ, &info);
+    RetVal_(!f, -ENOENT, "Failed sf_open %s: %s", path, sf_strerror(nullptr));
 
-    SNDFILE* f;
-    SF_INFO  info;
-    f = sf_open(path, SFM_READ, &info);
+    sndx_pitch_t* p    = nullptr;
+    float*        buf  = nullptr;
+    float*        mono = nullptr;
 
-    float* samples = calloc(info.frames * info.channels, sizeof(float));
-    err            = -(!samples);
-    Fatal(err, "Failed: calloc(info.frames * info.channels, sizeof(float))");
+    err = -(channel >= (u32)info.channels);
+    Goto_(err, __close, "Channel %d, %s has %d", channel, path, info.channels);
 
-    isize count = sf_readf_float(f, samples, info.frames);
-    err         = -(count != info.frames);
-    Fatal(err, "Failed: sf_readf_float: count != info.frames: %ld != %ld", count, info.frames);
+    err = sndx_pitch_open(&p, (u32)info.samplerate, window, 0, output);
+    Goto_(err, __close, "Failed sndx_pitch_open");
 
-    print_(info.frames);
+    buf  = calloc(p->hop * (u32)info.channels, sizeof(float));
+    mono = calloc(p->hop, sizeof(float));
+    err  = -(!buf || !mono);
+    Goto_(err, __close, "Failed calloc for a hop of %d frames", p->hop);
 
-    float max_left  = 0;
-    float max_right = 0;
+    a_info("%s: %ld frames, %d channels at %d, following channel %d", path, info.frames, info.channels,
+           info.samplerate, channel);
 
-    RANGE(i, count)
+    sf_count_t count;
+    while ((count = sf_readf_float(f, buf, p->hop)) > 0)
     {
-        max_left  = max(max_left, samples[2 * i]);
-        max_right = max(max_right, samples[2 * i + 1]);
+        RANGE(i, count) { mono[i] = buf[i * info.channels + channel]; }
+
+        if (sndx_pitch_push(p, mono, (uframes_t)count)) print_estimate(&p->last, p->rate, false);
     }
-    p_info("max_left, max_right: %f, %f", max_left, max_right);
 
-    free(samples);
+__close:
+    free(mono);
+    free(buf);
+    sndx_pitch_close(p);
     sf_close(f);
 
-    return 0;
+    return err;
+}
+
+/** @brief Live, the capture period goes straight into the estimator. */
+static int tune_live( //
+    const char* play, const char* capt, u32 rate, uframes_t period, u32 channel, u32 window, f64 seconds,
+    output_t* output)
+{
+    int err;
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        play, capt,                      //
+        SND_PCM_FORMAT_S32_LE,           //
+        rate, period, 2,                 //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        output);
+    SndReturn_(err, "Failed sndx_duplex_open: %s");
+
+    sndx_pitch_t* p = nullptr;
+
+    err = -(channel >= d->ch_capt);
+    Goto_(err, __close, "Channel %d, capture has %d", channel, d->ch_capt);
+
+    err = sndx_pitch_open(&p, d->rate, window, 0, output);
+    Goto_(err, __close, "Failed sndx_pitch_open");
+
+    // PREPARED -> RUNNING
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed: sndx_duplex_start: %s");
+
+    uframes_t frames_total = (uframes_t)(seconds * d->rate);
+    uframes_t frames_done  = 0;
+
+    while (frames_done < frames_total)
+    {
+        uframes_t avail = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_wait: %s");
+
+        uframes_t frames = avail;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_read: %s");
+
+        // Planar, the channel is contiguous
+        const float* samples = d->buf_capt->bufdata + channel * d->buf_capt->frames + offset;
+        bool         fresh   = sndx_pitch_push(p, samples, frames);
+
+        RANGE(chn, d->ch_play)
+        {
+            memset(d->buf_play->bufdata + chn * d->buf_play->frames + offset, 0, frames * sizeof(float));
+        }
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_write: %s");
+
+        // After the period is handed back
+        if (fresh) print_estimate(&p->last, p->rate, true);
+
+        frames_done += frames;
+    }
+
+    printf("\n");
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_pitch_close(p);
+    sndx_duplex_close(d);
+
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char* play    = "hw:A96,0";
+    const char* capt    = "hw:A96,0";
+    const char* path    = nullptr;
+    u32         rate    = 48000;
+    uframes_t   period  = 128;
+    u32         channel = 0;
+    u32         window  = 4096;
+    f64         seconds = 10.0;
+
+    RANGE(i, 1, argc)
+    {
+        const char* opt   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (opt[0] != '-')
+        {
+            path = opt;
+            continue;
+        }
+
+        if (!value) SndFatal_(-EINVAL, "Option %s needs a value: %s", opt);
+
+        if (strcmp(opt, "-P") == 0) play = value;
+        else if (strcmp(opt, "-C") == 0) capt = value;
+        else if (strcmp(opt, "-r") == 0) rate = (u32)atoi(value);
+        else if (strcmp(opt, "-p") == 0) period = (uframes_t)atol(value);
+        else if (strcmp(opt, "-c") == 0) channel = (u32)atoi(value);
+        else if (strcmp(opt, "-w") == 0) window = (u32)atoi(value);
+        else if (strcmp(opt, "-t") == 0) seconds = atof(value);
+        else SndFatal_(-EINVAL, "Unknown option %s: %s", opt);
+
+        i++;
+    }
+
+    if (path) err = tune_file(path, channel, window, output);
+    else err = tune_live(play, capt, rate, period, channel, window, seconds, output);
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
 }
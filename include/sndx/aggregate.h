@@ -0,0 +1,133 @@
+/** @file aggregate.h
+ *  @brief Several capture and playback handles driven as one device from a single thread.
+ *
+ *  Generalizes `sndx_duplex_t` from one capture + one playback handle to N + M:
+ *      1. Unified channel map : channels of all capture (playback) devices are concatenated
+ *                               in the order given, into one planar float buffer per direction
+ *      2. Single poll set     : descriptors of all handles in one `poll()`, only the master
+ *                               wakes the loop, the others only report errors
+ *      3. Master clock        : one device paces the loop, handles that can be linked to it
+ *                               share its clock and are moved without any compensation
+ *      4. Per slave drift     : every handle that cannot be linked gets its own `sndx_drift_t`,
+ *                               capture pulls a fixed period out of a FIFO, playback is resampled
+ *
+ *  There are no per-device threads: a cycle is wait, read every capture device, process,
+ *  write every playback device. Conversion goes straight between the mmapped areas and
+ *  the unified buffers, linked devices take no extra copy.
+ *
+ *  Usage in loop:
+ *      1. open
+ *      2. start
+ *      3. wait
+ *      4. read   -> `capt` holds a period of every capture channel
+ *      5. write  <- `play` holds a period of every playback channel
+ *      6. restart on error
+ *      7. stop
+ *      8. close
+ *
+ *  Only mmap interleaved access, all devices share format, rate, period size and periods.
+ */
+#pragma once
+
+#include "sndx/buffer.h"
+#include "sndx/drift.h"
+
+/** @brief One device of the aggregate, as passed to `sndx_aggregate_open`. */
+typedef struct
+{
+    const char*      name;     ///< ALSA device name
+    snd_pcm_stream_t stream;   ///< Capture or playback
+    u32              channels; ///< Requested channels, 0 for the minimum of the device
+
+} sndx_aggregate_desc_t;
+
+/** @brief Handle, channel range and clock domain of one device. */
+typedef struct
+{
+    snd_pcm_t*       pcm;      ///< Pcm handle
+    const char*      name;     ///< Name as given in `sndx_aggregate_desc_t`
+    snd_pcm_stream_t stream;   ///< Capture or playback
+    u32              channels; ///< Channels of the device
+    u32              first;    ///< First channel in the unified map of its direction
+
+    bool linked; ///< Master itself, or linked to it, runs on the master clock
+
+    sndx_buffer_t* buf;   ///< Linked only: buf areas point into the unified buffer
+    sndx_drift_t*  drift; ///< Unlinked only: FIFO and resampler against the master clock
+
+    u32 pfd_first; ///< First descriptor in `pfds`
+    u32 nfds;      ///< Number of descriptors
+
+    u64 missed; ///< Linked only: frames the device could not move in its cycle (zeroed or skipped)
+
+} sndx_aggregate_dev_t;
+
+/** @brief N capture + M playback handles, one of them the clock master. */
+typedef struct
+{
+    sndx_aggregate_dev_t* devs;   ///< Capture and playback devices, in the order given
+    u32                   ndevs;  ///< Number of devices
+    u32                   master; ///< Index of the device that paces the loop
+
+    u32 ch_capt; ///< Channels of all capture devices
+    u32 ch_play; ///< Channels of all playback devices
+
+    float* capt; ///< Unified capture channels, planar: `capt[chn * period_size + i]`
+    float* play; ///< Unified playback channels, planar: `play[chn * period_size + i]`
+
+    format_t  format;      ///< Same for all devices
+    u32       rate;        ///< Same for all devices
+    uframes_t period_size; ///< Frames per cycle
+    u32       periods;     ///< buffer_size = period_size * periods
+
+    struct pollfd* pfds;         ///< Single poll set of all devices
+    u32            nfds;         ///< Number of descriptors
+    int            poll_timeout; ///< Milliseconds, a few buffers
+
+    u64 cycles; ///< Completed read cycles
+
+    output_t* out; ///< Alsa's builtin message buffer
+
+} sndx_aggregate_t;
+
+/** @brief Open and configure all devices, link what can be linked to `master`, allocate buffers.
+ *
+ *  Channel counts are taken from the devices when `desc[i].channels` is 0 or not available.
+ */
+int sndx_aggregate_open(                      //
+    sndx_aggregate_t**           aggp,        //
+    const sndx_aggregate_desc_t* desc,        //
+    u32                          ndevs,       //
+    u32                          master,      //
+    format_t                     format,      //
+    u32                          rate,        //
+    uframes_t                    period_size, //
+    u32                          periods,     //
+    output_t*                    output);
+
+/** @brief Close all handles and free. */
+int sndx_aggregate_close(sndx_aggregate_t* a);
+
+/** @brief Fill playback with silence, start the master group and every unlinked device. */
+int sndx_aggregate_start(sndx_aggregate_t* a);
+
+/** @brief Drop all devices. */
+int sndx_aggregate_stop(sndx_aggregate_t* a);
+
+/** @brief Drop, prepare and start all devices again, after an error of wait/read/write. */
+int sndx_aggregate_restart(sndx_aggregate_t* a);
+
+/** @brief Block until the master has a period, -EPIPE if any device reports an error. */
+int sndx_aggregate_wait(sndx_aggregate_t* a);
+
+/** @brief Read a period of every capture device into `capt`. */
+int sndx_aggregate_read(sndx_aggregate_t* a);
+
+/** @brief Write a period of `play` to every playback device. */
+int sndx_aggregate_write(sndx_aggregate_t* a);
+
+/** @brief Device and its channel behind channel `chn` of the unified map of `stream`, nullptr if out of range. */
+sndx_aggregate_dev_t* sndx_aggregate_channel(sndx_aggregate_t* a, snd_pcm_stream_t stream, u32 chn, u32* dev_chn);
+
+/** @brief Dump devices, channel map and drift of unlinked devices to output. */
+void sndx_dump_aggregate(sndx_aggregate_t* a, output_t* output);
@@ -1,15 +1,24 @@
 #pragma once
 
 #include "sndx/buffer.h"
+#include "sndx/graph.h"
 
 /** @fn sndx_duplex_copy_capt_to_play(sndx_buffer_t* buf_capt, sndx_buffer_t* buf_play, sframes_t len, void* data)
  *  @brief Helper to copy first channel of capture to all channels of playback (for mono -> stereo)
  *
  * Most cheap USB audio dongles have 2 playback and 1 capture channel.
  * Here we use float* gain as data
+ *
+ * Other layouts, per channel gains and clickless changes: `sndx_router_process` (sndx/router.h).
  */
 void sndx_duplex_copy_capt_to_play( //
     sndx_buffer_t* buf_capt,
     sndx_buffer_t* buf_play,
     sframes_t      len,
     float*         gain);
+
+/** @brief Graph node: output channel k is input channel k (modulo inputs) times `*(float*)data`.
+ *
+ *  Same job as `sndx_duplex_copy_capt_to_play` inside a graph (mono to stereo with nin = 1).
+ */
+void sndx_graph_gain(const sndx_graph_step_t* step, uframes_t frames);
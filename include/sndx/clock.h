@@ -0,0 +1,101 @@
+/** @file clock.h
+ *  @brief Audio clock vs system clock drift of a device, estimated over the whole run.
+ *
+ *  Each snapshot of `sndx_hstats_t` pairs the system time since trigger (`tstamp - trigger`) with
+ *  the audio time the device reports for the same instant (`audio`, of the type asked for in
+ *  `sndx_hstats_enable`, link types give the best resolution). Their difference grows linearly
+ *  with the drift of the audio clock:
+ *
+ *      audio - sys = offset + drift * sys
+ *
+ *  `drift` is found by a weighted linear regression, updated in O(1) per snapshot (no history):
+ *  exponentially forgotten means and co-moments (Welford form, no large sums to cancel), with a
+ *  memory of `window` seconds so that slow thermal drift is followed (a change of drift settles
+ *  over a few windows).
+ *
+ *  Outliers (late wakeups, timestamps taken around an interrupt) are residuals beyond `reject`
+ *  deviations of the recent residuals, or `floor` if more, and are counted but not used.
+ *  A run of `SNDX_CLOCK_RESET_RUN` of them is a step in the timeline (xrun, restart), the estimate
+ *  starts over from there. So does a new trigger timestamp.
+ *
+ *  The owner thread updates, any thread reads the published estimate with `sndx_clock_get`,
+ *  which never blocks the owner (sequence counter, the reader retries on a concurrent update).
+ */
+#pragma once
+
+#include "sndx/timer.h"
+
+/** @brief Default memory of the regression, in seconds. */
+#define SNDX_CLOCK_WINDOW 60.0
+
+/** @brief Default rejection threshold, in deviations of the residuals. */
+#define SNDX_CLOCK_REJECT 4.0
+
+/** @brief Residuals within this many nanoseconds are never outliers (timestamp resolution). */
+#define SNDX_CLOCK_FLOOR_NS 20000.0
+
+/** @brief Snapshots accepted unconditionally before rejection starts and the estimate is valid. */
+#define SNDX_CLOCK_WARMUP 16
+
+/** @brief Consecutive outliers taken as a step in the timeline. */
+#define SNDX_CLOCK_RESET_RUN 16
+
+/** @brief Published estimate, consistent as a whole. */
+typedef struct
+{
+    bool valid;     ///< Past warmup
+    f64  ppm;       ///< Audio clock against system clock, positive when audio runs fast
+    f64  offset_us; ///< Audio minus system time at trigger, from the fit
+    f64  jitter_us; ///< Deviation of the residuals
+    f64  span_s;    ///< System time covered since the last start over
+    u64  samples;   ///< Snapshots used since the last start over
+    u64  rejected;  ///< Outliers, in total
+    u64  resets;    ///< Start overs, in total
+
+} sndx_clock_estimate_t;
+
+/** @brief Estimator of a single device, owned by the thread that takes its snapshots. */
+typedef struct
+{
+    f64 lambda; ///< Forgetting factor per snapshot, from window and snapshot interval
+    f64 reject; ///< Rejection threshold in deviations
+    f64 floor;  ///< Rejection floor in seconds
+
+    htstamp_t trigger; ///< Of the current run, a new one starts over
+    f64       first;   ///< System time of the first snapshot of the run (s)
+
+    f64 w;   ///< Sum of weights
+    f64 mx;  ///< Weighted mean of system time (s)
+    f64 my;  ///< Weighted mean of audio - system time (s)
+    f64 cxx; ///< Weighted co-moments
+    f64 cxy; ///< Weighted co-moments
+    f64 var; ///< Smoothed squared residual (s^2)
+    u32 run; ///< Consecutive outliers
+
+    sndx_clock_estimate_t est; ///< Owner's copy
+
+    u32                   seq; ///< Odd while `pub` is written
+    sndx_clock_estimate_t pub; ///< Copy for readers
+
+} sndx_clock_t;
+
+/** @brief Clear and set the memory to `window` seconds of snapshots taken every `period_size` frames. */
+void sndx_clock_init(sndx_clock_t* c, u32 rate, uframes_t period_size, f64 window);
+
+/** @brief Start over, keeps the totals (on start/restart). */
+void sndx_clock_reset(sndx_clock_t* c);
+
+/** @brief Add one pair of system and audio time since trigger, in nanoseconds, RT safe.
+ *
+ *  Returns false if it was taken for an outlier.
+ */
+bool sndx_clock_update_ns(sndx_clock_t* c, i64 sys_ns, i64 audio_ns);
+
+/** @brief Same from the last snapshot of `t`, starts over on a new trigger. Skips if there is no audio time. */
+bool sndx_clock_update(sndx_clock_t* c, const sndx_hstats_t* t);
+
+/** @brief Latest estimate, lock-free, from any thread. */
+void sndx_clock_get(sndx_clock_t* c, sndx_clock_estimate_t* est);
+
+/** @brief Dump the latest estimate of `name` to output. */
+void sndx_clock_dump(sndx_clock_t* c, const char* name, output_t* output);
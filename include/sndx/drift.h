@@ -0,0 +1,159 @@
+/** @file drift.h
+ *  @brief Drift compensation for playback and capture running on independent clocks.
+ *
+ *  When `snd_pcm_link` is not possible (e.g. USB capture with a different playback card),
+ *  capture drives the loop and playback slowly fills up or drains.
+ *  The fill level (playback delay + capture delay, from `sndx_hstats_t`) is fed to a
+ *  PI controller, whose output is the ratio of frames written to playback per frame read.
+ *
+ *  Sync types follow alsaloop (@see examples/alsaloop/alsaloop.h, loopback.h for many loops):
+ *      NONE       : no compensation, an unlinked pair eventually xruns
+ *      SIMPLE     : add or drop a single frame whenever the error reaches a frame
+ *      SAMPLERATE : adaptive resampler (`sndx_resampler_t`, linear by default, @see sndx_drift_set_quality)
+ *      PLAYRATESHIFT, CAPTRATESHIFT :
+ *                   frames pass as they are, the clock of the playback (capture) device is shifted instead
+ *                   through its "PCM Rate Shift 100000" control (snd-aloop), no resampling cost at all.
+ *                   Playback runs at 1 / ratio, capture at ratio, both consume the error the same way.
+ *                   Devices without the control fall back to SAMPLERATE (@see sndx_duplex_set_sync).
+ */
+#pragma once
+
+#include "sndx/buffer.h"
+#include "sndx/resampler.h"
+
+/** @brief Default PI gains, ratio change per frame of fill error (and per frame per cycle). */
+#define SNDX_DRIFT_KP 1e-5
+#define SNDX_DRIFT_KI 2e-8
+
+/** @brief Default clamp on the correction, in ppm. */
+#define SNDX_DRIFT_MAX_PPM 1000.0
+
+/** @brief Smoothing of the measured fill level, weight of the newest measurement. */
+#define SNDX_DRIFT_FILL_ALPHA 0.05
+
+/** @brief Rate shift control of snd-aloop, and its value at the nominal rate (10 ppm per step). */
+#define SNDX_DRIFT_RATE_SHIFT_NAME  "PCM Rate Shift 100000"
+#define SNDX_DRIFT_RATE_SHIFT_UNITY 100000
+
+/** @brief How playback is kept in sync with capture. */
+typedef enum sndx_sync_type_t
+{
+    SNDX_SYNC_NONE = 0,      ///< Pass through
+    SNDX_SYNC_SIMPLE,        ///< Add or remove frames
+    SNDX_SYNC_SAMPLERATE,    ///< Adaptive resampler
+    SNDX_SYNC_PLAYRATESHIFT, ///< Shift the playback clock
+    SNDX_SYNC_CAPTRATESHIFT, ///< Shift the capture clock
+    SNDX_SYNC_LAST = SNDX_SYNC_CAPTRATESHIFT,
+
+} sndx_sync_type_t;
+
+/** @brief PI controller, input is error in frames, output is ratio around 1. */
+typedef struct
+{
+    f64 kp;       ///< Proportional gain
+    f64 ki;       ///< Integral gain
+    f64 max;      ///< Clamp of output around 1 (ppm * 1e-6)
+    f64 integral; ///< Accumulated error, clamped so that ki * integral stays within max
+
+} sndx_pi_t;
+
+/** @brief Initialize gains and clear state. */
+void sndx_pi_init(sndx_pi_t* pi, f64 kp, f64 ki, f64 max_ppm);
+
+/** @brief Single step, returns ratio to apply. */
+f64 sndx_pi_step(sndx_pi_t* pi, f64 error);
+
+/** @brief Resampler and controller, sits between `buf_play` and the playback device. */
+typedef struct
+{
+    sndx_sync_type_t sync; ///< Current mode
+
+    u32       channels;    ///< Playback channels
+    u32       rate;        ///< Nominal rate of both devices
+    uframes_t period_size; ///< Input frames per cycle (at most)
+
+    sndx_pi_t pi;     ///< Controller on fill level
+    f64       target; ///< Desired fill level in frames
+    f64       fill;   ///< Smoothed measured fill level in frames
+    f64       ratio;  ///< Output frames per input frame
+
+    f64    acc;  ///< Fractional frames owed (SIMPLE)
+    float* last; ///< Last input frame per channel, held on underrun of `sndx_drift_pull`
+
+    sndx_resampler_t* rs;  ///< SAMPLERATE: ratio follows the controller, glides over each block
+    area_t*           src; ///< Areas over the input of `sndx_drift_process_planar`
+    area_t*           dst; ///< Areas over the output of `sndx_drift_pull`
+
+    sndx_buffer_t* buf;       ///< Output of `sndx_drift_process`, written to playback
+    sndx_buffer_t* in;        ///< Input FIFO of `sndx_drift_pull`, filled from capture from `in_frames`
+    uframes_t      in_frames; ///< Frames queued in `in`
+
+    snd_ctl_t*            ctl;          ///< Rate shift modes: control device of the shifted pcm
+    snd_ctl_elem_value_t* shift;        ///< Its rate shift element, written on every change
+    long                  shift_min;    ///< Range of the element
+    long                  shift_max;    ///< Range of the element
+    long                  shift_value;  ///< Last written
+    u64                   shift_writes; ///< Element writes (the value moves in 10 ppm steps)
+
+    u64 frames_in;  ///< Total input frames
+    u64 frames_out; ///< Total output frames
+    u64 dropped;    ///< Output frames that did not fit in playback
+
+} sndx_drift_t;
+
+/** @brief Allocate drift stage, output buffer holds two periods, input FIFO four. */
+int sndx_drift_open(        //
+    sndx_drift_t**   driftp,
+    sndx_sync_type_t sync,
+    format_t         format,
+    u32              channels,
+    u32              rate,
+    uframes_t        period_size,
+    f64              target,
+    output_t*        output);
+
+/** @brief Free drift stage. */
+void sndx_drift_close(sndx_drift_t* dr);
+
+/** @brief Clear controller and resampler state, on start/restart. */
+void sndx_drift_reset(sndx_drift_t* dr);
+
+/** @brief Resampler quality for SAMPLERATE (not RT safe, reallocates), sinc qualities add latency. */
+int sndx_drift_set_quality(sndx_drift_t* dr, sndx_resampler_quality_t quality, output_t* output);
+
+/** @brief Rate shift modes: use the rate shift control of `pcm`, the device whose clock is shifted.
+ *
+ *  Not RT safe (opens the control device). Returns -ENOENT if `pcm` has no such control (not snd-aloop),
+ *  nullptr releases the control. The element is set back to unity on release, reset and close.
+ */
+int sndx_drift_set_rate_shift(sndx_drift_t* dr, snd_pcm_t* pcm, output_t* output);
+
+/** @brief Value of the rate shift element for the current ratio, clamped to its range when written. */
+long sndx_drift_rate_shift(sndx_drift_t* dr);
+
+/** @brief Feed measured fill level (frames), updates `ratio` (and the rate shift element). */
+void sndx_drift_update(sndx_drift_t* dr, sframes_t fill);
+
+/** @brief Convert `frames` planar float frames of `in` from `offset` into `dr->buf` (from 0).
+ *
+ *  Returns the number of output frames, around `frames * ratio`, or the error of the resampler.
+ */
+sframes_t sndx_drift_process(sndx_drift_t* dr, sndx_buffer_t* in, uframes_t offset, uframes_t frames);
+
+/** @brief Same as `sndx_drift_process`, from planar floats `src` with `stride` between channels. */
+sframes_t sndx_drift_process_planar(sndx_drift_t* dr, const float* src, uframes_t stride, uframes_t frames);
+
+/** @brief Fixed output count: produce exactly `frames` into `dst` from the input FIFO `in`.
+ *
+ *  For capture on a foreign clock, where the consumer needs a fixed count per cycle.
+ *  Consumes around `frames / ratio` queued frames, the rest stays queued for the next call.
+ *  If too few are queued, the last frame is held and the missing frames are counted in `dropped`.
+ *  Returns 0, or the error of the resampler with nothing consumed.
+ */
+int sndx_drift_pull(sndx_drift_t* dr, float* dst, uframes_t stride, uframes_t frames);
+
+/** @brief Name of sync type. */
+const char* sndx_sync_type_name(sndx_sync_type_t sync);
+
+/** @brief Dump drift stage params and stats to output. */
+void sndx_drift_dump(sndx_drift_t* dr, output_t* output);
@@ -10,8 +10,14 @@
 #pragma once
 
 #include "sndx/buffer.h"
+#include "sndx/clock.h"
+#include "sndx/drift.h"
+#include "sndx/log.h"
 #include "sndx/pollfds.h"
+#include "sndx/status.h"
 #include "sndx/timer.h"
+#include "sndx/trace.h"
+#include "sndx/xrun.h"
 
 /** @brief Analogue of `snd_pcm_t` that manages pcm handles, buffers, polling, timing.
  *
@@ -46,7 +52,7 @@ typedef struct sndx_duplex_t
     u32       rate;        ///< Aslo must match
     uframes_t period_size; ///< Must match
     u32       periods;     ///< Must match, buffer_size = period_size * periods
-    bool      linked;      ///< May not be possible based on play, capt
+    bool      linked;      ///< May not be possible based on play, capt, then `drift` keeps them in sync
 
     sndx_buffer_t* buf_play; ///< Connects float buffer to playback device area, used by write
     sndx_buffer_t* buf_capt; ///< Connects float buffer to capture device area, used by read
@@ -55,6 +61,29 @@ typedef struct sndx_duplex_t
 
     sndx_timer_t* timer; ///< Measure and report latency
 
+    sndx_drift_t* drift;    ///< Unlinked only: PI controlled resampler between buf_play and playback
+    sndx_hstats_t hs_play;  ///< Playback delay after each write
+    sndx_hstats_t hs_capt;  ///< Capture delay after each write
+    sndx_clock_t  clk_play; ///< Drift of the playback clock, fed every cycle, @see clock.h
+    sndx_clock_t  clk_capt; ///< Drift of the capture clock, fed every few cycles
+
+    sndx_status_t st_play; ///< Status of playback shared within a cycle, @see status.h
+    sndx_status_t st_capt; ///< Status of capture shared within a cycle
+    u64           cycles;  ///< Writes, one per cycle
+
+    sndx_trace_t* trace; ///< Optional per-cycle event ring, @see sndx_duplex_enable_trace
+    sndx_log_t*   log;   ///< Optional deferred logger for the RT path, @see sndx_duplex_enable_log
+
+    void* silence; ///< Whole buffer of silence for single shot writei on restart (RW access only)
+
+    sndx_xrun_t xrun_play; ///< Graded recovery limits and report for playback, @see sndx_duplex_recover
+    sndx_xrun_t xrun_capt; ///< Graded recovery limits and report for capture
+
+    u64 restart_count;       ///< Number of `sndx_duplex_restart` calls
+    u64 restart_nsecs_last;  ///< Wall clock cost of last restart
+    u64 restart_nsecs_max;   ///< Worst restart
+    u64 restart_nsecs_total; ///< Sum, for the mean
+
     output_t* out; ///< Alsa's builtin message buffer
 
 } sndx_duplex_t;
@@ -69,6 +98,10 @@ void sndx_dump_duplex_status(sndx_duplex_t* d, output_t* output);
  *
  *  NOTE: Play is blocking, Capture is nonblocking
  *
+ *  If linking fails (e.g. different cards), the pair runs unlinked:
+ *  capture drives the loop and `sndx_duplex_write` resamples into playback,
+ *  with the ratio from a PI controller on the fill level, @see drift.h
+ *
  *  Process:
  *      1. Open pcm handles
  *      2. Set HW, SW params
@@ -91,6 +124,21 @@ int sndx_duplex_open(                //
     access_t        _access,         //
     output_t*       output);
 
+/** @brief Same as `sndx_duplex_open` on handles already open (simulated devices, @see sim.h).
+ *
+ *  Takes ownership of both handles: they are closed by `sndx_duplex_close`, or here on failure.
+ */
+int sndx_duplex_open_pcm(        //
+    sndx_duplex_t** duplexp,     //
+    snd_pcm_t*      play,        //
+    snd_pcm_t*      capt,        //
+    format_t        format,      //
+    u32             rate,        //
+    uframes_t       period_size, //
+    u32             periods,     //
+    access_t        _access,     //
+    output_t*       output);
+
 /** @brief Close playback and capture handles.
  *
  *  Process:
@@ -119,6 +167,41 @@ int sndx_duplex_close(sndx_duplex_t* d);
  */
 int sndx_duplex_start(sndx_duplex_t* d);
 
+/** @brief Change how an unlinked pair is kept in sync (fails if linked).
+ *
+ *  Rate shift modes open the control of the shifted device (not RT safe), and use samplerate
+ *  instead when it has none.
+ */
+int sndx_duplex_set_sync(sndx_duplex_t* d, sndx_sync_type_t sync);
+
+/** @brief Lean restart for xrun recovery, no status dumps and no logging.
+ *
+ *  Process:
+ *      1. drop
+ *      2. prepare
+ *      3. fill whole buffer with silence in a single shot (one mmap_begin/commit or one writei)
+ *      4. pcm_start
+ *
+ *  Wall clock cost is kept in `restart_nsecs_*`, @see sndx_duplex_dump_restart.
+ *  Timer is left as is, unlike `sndx_duplex_start`.
+ *
+ *  Errors: Passed on from `snd`, caller decides what to print.
+ */
+int sndx_duplex_restart(sndx_duplex_t* d);
+
+/** @brief Graded xrun recovery of both handles, falls back to `sndx_duplex_restart` only if that fails.
+ *
+ *  Playback first, so a linked group is prepared and started through playback.
+ *  Can also be called every cycle to catch an xrun before the stream stops.
+ *  Strategy and frames lost are in `xrun_play`, `xrun_capt`, @see sndx_xrun_recovery_graded.
+ *
+ *  Returns 0 if soft recovery sufficed, 1 if it needed a full restart, else negative error.
+ */
+int sndx_duplex_recover(sndx_duplex_t* d);
+
+/** @brief Dump restart cost stats to output. */
+void sndx_duplex_dump_restart(sndx_duplex_t* d, output_t* output);
+
 /** @brief Stop playback and capture.
  *
  *  Errors: TODO
@@ -145,6 +228,8 @@ int sndx_duplex_wait(sndx_duplex_t* d, uframes_t* avail);
 int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset);
 
 /** @brief Write from float buffer to device.
+ *
+ *  Unlinked, frames go through `d->drift` first, so playback gets around `frames * ratio`.
  *
  *  Steps:
  *      1. snd_mmap_begin
@@ -154,6 +239,12 @@ int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset);
  */
 int sndx_duplex_write(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset);
 
+/** @brief One cycle after a wait: avail, read up to a period, first capture channel to every playback one, write.
+ *
+ *  `frames` gets what was moved, 0 if nothing was available. A failed read or write needs a restart.
+ */
+sndx_pollfds_error_t sndx_duplex_passthrough(sndx_duplex_t* d, uframes_t* frames);
+
 /** @brief Write initial silence when access is RW_INTERLEAVED. Usually set to `period_size * nperiods`. */
 int sndx_duplex_write_rw_initial_silence(sndx_duplex_t* d);
 
@@ -163,5 +254,19 @@ int sndx_duplex_write_mmap_initial_silence(sndx_duplex_t* d);
 /** @brief Write initial silence when access is MMAP_INTERLEAVED, but using mmap_readi/mmap_writei. Usually set to `period_size * nperiods`. */
 int sndx_duplex_write_mmap_initial_silence_direct(sndx_duplex_t* d);
 
+/** @brief Allocate trace ring and record wait, read, write, xrun events into it.
+ *
+ *  Also shared with `d->pfd`, so polling and xruns are recorded.
+ *  Freed in `sndx_duplex_close`.
+ */
+int sndx_duplex_enable_trace(sndx_duplex_t* d, u64 capacity);
+
+/** @brief Defer messages of start, stop, wait, read, write (and `d->pfd`) to a background thread.
+ *
+ *  The RT path then only queues format and arguments, nothing is formatted or written on it.
+ *  Remaining messages are flushed and the thread joined in `sndx_duplex_close`.
+ */
+int sndx_duplex_enable_log(sndx_duplex_t* d, u64 capacity);
+
 /** @brief Set linux scheduler to FIFO. Needs sudo. */
 int sndx_duplex_set_schduler(output_t* output);
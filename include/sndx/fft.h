@@ -0,0 +1,45 @@
+/** @file fft.h
+ *  @brief Radix-2 complex FFT on split real/imaginary float arrays.
+ *
+ *  Sizes are powers of two. Bit reversal and twiddles are computed at open,
+ *  so transforms allocate nothing and can run on the audio thread.
+ *  Split arrays (not interleaved complex) keep the butterflies on plain float lanes, and the
+ *  twiddles of each stage are stored one after the other, so the butterfly loop reads everything
+ *  with unit stride and the compiler vectorises it.
+ *
+ *  Conventions:
+ *      forward : X[k] = sum x[n] e^(-2 pi i k n / N)
+ *      inverse : x[n] = 1/N sum X[k] e^(+2 pi i k n / N), so inverse(forward(x)) == x
+ */
+#pragma once
+
+#include "sndx/types.h"
+
+/** @brief Plan for one size. */
+typedef struct
+{
+    u32    n;     ///< Transform size, power of two
+    u32    log2n; ///< log2(n)
+    u32*   rev;   ///< Bit reversed index of each input
+    float* cos;   ///< Stage of `half` butterflies at [half - 1, 2 half - 1): cos(pi k / half), n - 1 in all
+    float* sin;   ///< Same layout, sin(pi k / half)
+
+} sndx_fft_t;
+
+/** @brief Smallest power of two of at least `len`. */
+u32 sndx_fft_size(usize len);
+
+/** @brief Allocate plan of size `n` (not RT safe), -EINVAL if not a power of two. */
+int sndx_fft_open(sndx_fft_t** fftp, u32 n, output_t* output);
+
+/** @brief Free plan. */
+void sndx_fft_close(sndx_fft_t* fft);
+
+/** @brief In place forward transform of `n` complex values. */
+void sndx_fft_forward(sndx_fft_t* fft, float* re, float* im);
+
+/** @brief In place inverse transform of `n` complex values, scaled by 1 / n. */
+void sndx_fft_inverse(sndx_fft_t* fft, float* re, float* im);
+
+/** @brief Forward transform of `len` real samples of `in`, zero padded up to `n`, into `re`, `im`. */
+void sndx_fft_real(sndx_fft_t* fft, const float* in, usize len, float* re, float* im);
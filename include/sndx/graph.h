@@ -0,0 +1,161 @@
+/** @file graph.h
+ *  @brief Static DSP graph run by the audio callback, compiled and swapped from a control thread.
+ *
+ *  Nodes are process functions with planar float ports (one pointer per channel, like `bufdata`
+ *  of `sndx_buffer_t`). Two pseudo nodes stand for the callback buffers:
+ *      SNDX_GRAPH_CAPTURE  : outputs are the capture channels, read in place
+ *      SNDX_GRAPH_PLAYBACK : inputs are the playback channels, copied out at the end
+ *
+ *  An input takes at most one connection (mix in a node), an output feeds any number of inputs,
+ *  unconnected inputs read silence, unconnected playback channels are silent.
+ *
+ *  Control thread (allocates):
+ *      1. open, add nodes, connect ports
+ *      2. commit: topological order (cycles refused), then buffers assigned by liveness,
+ *         a buffer is reused as soon as the last node reading it ran, then published
+ *      3. edit (reset, add, connect) and commit again, any time
+ *
+ *  Audio thread (never allocates or frees):
+ *      - `sndx_graph_process` picks up the last committed plan at the start of a call,
+ *        the plan it replaced is handed back and freed by the next commit (or collect, or close)
+ *      - with a pool, the steps of a level (same longest path from capture, so independent branches)
+ *        run in parallel; buffers are reused per level, so they never share one
+ *
+ *  Node data is not owned: keep it alive until the plan using it was collected.
+ */
+#pragma once
+
+#include "sndx/buffer.h"
+#include "sndx/pool.h"
+
+#define SNDX_GRAPH_CAPTURE  0 ///< Node id of the capture channels
+#define SNDX_GRAPH_PLAYBACK 1 ///< Node id of the playback channels
+
+struct sndx_graph_step_t;
+
+/** @brief Process `frames` from `step->in` to `step->out`, RT safe. */
+typedef void (*sndx_graph_process_t)(const struct sndx_graph_step_t* step, uframes_t frames);
+
+/** @brief Node as described on the control side. */
+typedef struct
+{
+    char                 name[32]; ///< For dump and errors
+    sndx_graph_process_t process;  ///< Null for the pseudo nodes
+    void*                data;     ///< Passed in the step, not owned
+    u32                  nin;      ///< Input ports (channels)
+    u32                  nout;     ///< Output ports (channels)
+
+} sndx_graph_node_t;
+
+/** @brief Output port `src_port` of `src` into input port `dst_port` of `dst`. */
+typedef struct
+{
+    u32 src;      ///< Producing node
+    u32 src_port; ///< Its output
+    u32 dst;      ///< Consuming node
+    u32 dst_port; ///< Its input
+
+} sndx_graph_edge_t;
+
+/** @brief Node as run by the audio thread, what `process` gets. */
+typedef struct sndx_graph_step_t
+{
+    sndx_graph_process_t process; ///< Function
+    void*                data;    ///< Node data
+    const float**        in;      ///< nin channels, capture, a buffer or silence
+    float**              out;     ///< nout channels, each its own buffer
+    u32                  nin;     ///< Input ports
+    u32                  nout;    ///< Output ports
+    u32                  node;    ///< Id of the node
+
+} sndx_graph_step_t;
+
+/** @brief Capture channel to patch into an input slot when the capture buffer changes. */
+typedef struct
+{
+    const float** slot; ///< Input of a step, or a playback source
+    u32           chn;  ///< Capture channel
+
+} sndx_graph_bind_t;
+
+/** @brief Compiled graph, immutable once published except for the capture bindings. */
+typedef struct sndx_graph_plan_t
+{
+    sndx_graph_step_t* steps;   ///< In topological order, grouped by level
+    u32                nsteps;  ///< Nodes minus the pseudo nodes
+    u32*               levels;  ///< First step of each level, then nsteps
+    u32                nlevels; ///< Longest path through the graph, in nodes
+
+    const float** ins;  ///< Backing of all step inputs
+    float**       outs; ///< Backing of all step outputs
+
+    float*    pool;       ///< nbuffers of max_frames floats, buffer 0 is silence
+    u32       nbuffers;   ///< Buffers after reuse, plus silence
+    uframes_t max_frames; ///< Frames per call at most
+
+    const float**      play;   ///< Per playback channel, source or null for silence
+    sndx_graph_bind_t* binds;  ///< Slots reading capture channels
+    u32                nbinds; ///< Entries in binds
+
+    const float* bound_data;   ///< `bufdata` of the capture buffer the bindings point into
+    uframes_t    bound_frames; ///< Its channel stride
+
+} sndx_graph_plan_t;
+
+/** @brief Graph description and the plan in use. */
+typedef struct
+{
+    u32       ch_capt;    ///< Outputs of SNDX_GRAPH_CAPTURE
+    u32       ch_play;    ///< Inputs of SNDX_GRAPH_PLAYBACK
+    uframes_t max_frames; ///< Frames per call at most, usually the period size
+
+    sndx_graph_node_t* nodes;  ///< Pseudo nodes first
+    isize              nnodes; ///< Used
+    isize              cnodes; ///< Allocated
+    sndx_graph_edge_t* edges;  ///< Connections
+    isize              nedges; ///< Used
+    isize              cedges; ///< Allocated
+
+    sndx_graph_plan_t* current;   ///< Audio thread only
+    sndx_graph_plan_t* next;      ///< Committed, not picked up yet (atomic)
+    sndx_graph_plan_t* retired;   ///< Replaced, to be freed by the control thread (atomic)
+    sndx_graph_plan_t* committed; ///< Last commit, control thread only, for dump
+
+    sndx_pool_t* pool; ///< Optional, runs the steps of a level in parallel (not owned)
+
+    output_t* out; ///< Errors of the control side
+
+} sndx_graph_t;
+
+/** @brief Empty graph between `ch_capt` capture and `ch_play` playback channels. */
+int sndx_graph_open(sndx_graph_t** gp, u32 ch_capt, u32 ch_play, uframes_t max_frames, output_t* output);
+
+/** @brief Free description and plans, the audio thread has to be done with the graph. */
+void sndx_graph_close(sndx_graph_t* g);
+
+/** @brief Add a node with `nin` inputs and `nout` outputs, returns its id. */
+int sndx_graph_add(sndx_graph_t* g, const char* name, sndx_graph_process_t process, void* data, u32 nin, u32 nout);
+
+/** @brief Connect output `src_port` of `src` to input `dst_port` of `dst`, -EBUSY if the input is taken. */
+int sndx_graph_connect(sndx_graph_t* g, u32 src, u32 src_port, u32 dst, u32 dst_port);
+
+/** @brief Drop all nodes and connections, the plan in use runs on until the next commit. */
+void sndx_graph_reset(sndx_graph_t* g);
+
+/** @brief Compile the description and publish it to the audio thread, -EINVAL on a cycle. */
+int sndx_graph_commit(sndx_graph_t* g);
+
+/** @brief Run independent steps on `pool` (null: all on the audio thread), before processing starts. */
+void sndx_graph_set_pool(sndx_graph_t* g, sndx_pool_t* pool);
+
+/** @brief Free the plan the audio thread handed back, if any. */
+void sndx_graph_collect(sndx_graph_t* g);
+
+/** @brief Run the current plan from `buf_capt` to `buf_play` on the first `len` frames, RT safe.
+ *
+ *  Same shape as `sndx_duplex_copy_capt_to_play`, silence until the first commit is picked up.
+ */
+void sndx_graph_process(sndx_graph_t* g, sndx_buffer_t* buf_capt, sndx_buffer_t* buf_play, sframes_t len);
+
+/** @brief Dump the order and buffer assignment of the last committed plan to output. */
+void sndx_graph_dump(sndx_graph_t* g, output_t* output);
@@ -0,0 +1,145 @@
+/** @file log.h
+ *  @brief RT safe logging: the audio thread only queues format + args, a background thread formats.
+ *
+ *  The `a_info`, `a_error`, `SndReturn_`, ... macros in types.h call `snd_output_printf` synchronously,
+ *  which is formatting and I/O on the audio thread. The `r_*` and `*_rt` macros here have the same shape,
+ *  but push `{fmt, args}` into a lock-free queue. A background thread formats and writes to `output_t`.
+ *
+ *  Like `a_*` expects a local `output`, `r_*` expects locals `rtlog` (sndx_log_t*) and `output`.
+ *  If `rtlog` is null, they fall back to the synchronous `a_*` versions.
+ *
+ *  Restrictions on the realtime side:
+ *      1. Format string is used as the format id, so it must be a literal
+ *      2. `%s` arguments must be static strings (literals, `snd_strerror`, `snd_pcm_state_name`)
+ *      3. At most SNDX_LOG_MAX_ARGS arguments, no `*` width/precision
+ *      4. If the queue is full, the message is dropped and counted
+ */
+#pragma once
+
+#include "sndx/types.h"
+#include <pthread.h>
+
+#define SNDX_LOG_MAX_ARGS         8
+#define SNDX_LOG_DEFAULT_CAPACITY 1024
+#define SNDX_LOG_INTERVAL_USECS   10000
+#define SNDX_LOG_LINE_MAX         1024
+
+typedef enum sndx_log_level_t
+{
+    SNDX_LOG_INFO = 0,
+    SNDX_LOG_ERROR,
+    SNDX_LOG_DEBUG,
+
+} sndx_log_level_t;
+
+/** @brief Argument slot, interpreted based on the conversion in the format string. */
+typedef union {
+    i64         i;
+    f64         f;
+    const void* p;
+} sndx_log_arg_t;
+
+/** @brief Single queued message. */
+typedef struct
+{
+    u64            seq;   ///< Queue sequence (owned by queue)
+    const char*    fmt;   ///< Format id (literal)
+    u8             level; ///< sndx_log_level_t
+    u8             nargs; ///< Number of valid args
+    sndx_log_arg_t args[SNDX_LOG_MAX_ARGS];
+
+} sndx_log_record_t;
+
+/** @brief Bounded multi-producer, single-consumer queue of records, drained by a background thread. */
+typedef struct
+{
+    sndx_log_record_t* records;  ///< Backing array
+    u64                capacity; ///< Power of two
+    u64                head;     ///< Enqueue position (producers)
+    u64                tail;     ///< Dequeue position (consumer)
+
+    u64 pushed;  ///< Messages accepted
+    u64 written; ///< Messages formatted and written
+    u64 dropped; ///< Messages dropped because queue was full
+    u64 dropped_reported;
+
+    output_t* output;   ///< Destination, only touched by the background thread
+    pthread_t tid;      ///< Background thread
+    bool      running;  ///< Cleared to stop background thread
+    u32       interval; ///< Sleep between drains in usecs
+
+} sndx_log_t;
+
+/** @brief Allocate queue and start background thread writing to output. */
+int sndx_log_open(sndx_log_t** logp, u64 capacity, output_t* output);
+
+/** @brief Stop background thread, write everything still queued, free queue. */
+void sndx_log_close(sndx_log_t* log);
+
+/** @brief Queue a message. RT safe, returns false (and counts) if dropped. */
+bool sndx_log_push(sndx_log_t* log, sndx_log_level_t level, const char* fmt, const sndx_log_arg_t* args, u32 nargs);
+
+/** @brief Format and write all queued messages. Only from the consumer side (background thread or after close). */
+u64 sndx_log_drain(sndx_log_t* log);
+
+/** @brief Dump queue statistics to output. */
+void sndx_log_dump(sndx_log_t* log, output_t* output);
+
+// clang-format off
+static inline sndx_log_arg_t sndx_log_arg_i(i64 v)         { return (sndx_log_arg_t){.i = v}; }
+static inline sndx_log_arg_t sndx_log_arg_f(f64 v)         { return (sndx_log_arg_t){.f = v}; }
+static inline sndx_log_arg_t sndx_log_arg_p(const void* v) { return (sndx_log_arg_t){.p = v}; }
+
+/** @brief Pack any scalar argument into a slot. */
+#define sndx_log_arg(x) _Generic((x),                                                  \
+    float      : sndx_log_arg_f, double     : sndx_log_arg_f,                          \
+    char*      : sndx_log_arg_p, const char*: sndx_log_arg_p,                          \
+    void*      : sndx_log_arg_p, const void*: sndx_log_arg_p,                          \
+    default    : sndx_log_arg_i)(x)
+
+#define SNDX_LOG_A1(a)      sndx_log_arg(a)
+#define SNDX_LOG_A2(a, ...) sndx_log_arg(a), SNDX_LOG_A1(__VA_ARGS__)
+#define SNDX_LOG_A3(a, ...) sndx_log_arg(a), SNDX_LOG_A2(__VA_ARGS__)
+#define SNDX_LOG_A4(a, ...) sndx_log_arg(a), SNDX_LOG_A3(__VA_ARGS__)
+#define SNDX_LOG_A5(a, ...) sndx_log_arg(a), SNDX_LOG_A4(__VA_ARGS__)
+#define SNDX_LOG_A6(a, ...) sndx_log_arg(a), SNDX_LOG_A5(__VA_ARGS__)
+#define SNDX_LOG_A7(a, ...) sndx_log_arg(a), SNDX_LOG_A6(__VA_ARGS__)
+#define SNDX_LOG_A8(a, ...) sndx_log_arg(a), SNDX_LOG_A7(__VA_ARGS__)
+
+#define SNDX_LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define SNDX_LOG_NARGS(...) SNDX_LOG_NARGS_(_ __VA_OPT__(,) __VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define SNDX_LOG_CAT_(a, b) a##b
+#define SNDX_LOG_CAT(a, b)  SNDX_LOG_CAT_(a, b)
+#define SNDX_LOG_ARGS(...)  SNDX_LOG_CAT(SNDX_LOG_A, SNDX_LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+/** @brief Queue message on log, first slot is a dummy so zero args is still a valid array. */
+#define sndx_log_(log, level, fmt, ...)                                                 \
+    {                                                                                   \
+        const sndx_log_arg_t _args[] = { {.i = 0} __VA_OPT__(, SNDX_LOG_ARGS(__VA_ARGS__)) }; \
+        sndx_log_push(log, level, fmt, &_args[1], SNDX_LOG_NARGS(__VA_ARGS__));         \
+    }
+
+/* ---------------------------------------------------------------------------
+ * RT Error handling -> queued on local `rtlog`, else prints to local `output`
+ * ------------------------------------------------------------------------- */
+#define r_info( ...) { if (rtlog) sndx_log_(rtlog, SNDX_LOG_INFO,  __VA_ARGS__) else a_info( __VA_ARGS__) }
+#define r_error(...) { if (rtlog) sndx_log_(rtlog, SNDX_LOG_ERROR, __VA_ARGS__) else a_error(__VA_ARGS__) }
+
+#define r_err(err, behaviour, ...)            \
+    if (err) {                                \
+        r_error("%s:%d", __FILE__, __LINE__); \
+        r_error(__VA_ARGS__);                 \
+        behaviour;                            \
+    }
+
+#define Check_rt( err , ...)        r_err(err , ;         , __VA_ARGS__);
+#define Return_rt(err , ...)        r_err(err , return err, __VA_ARGS__);
+#define RetVal_rt(cond, val, ...)   r_err(cond, return val, __VA_ARGS__);
+#define Goto_rt(  err , label, ...) r_err(err<0, goto label, __VA_ARGS__);
+
+#define SndCheck_rt( err, ...)        r_err(err<0, ;         , __VA_ARGS__, snd_strerror(err));
+#define SndReturn_rt(err, ...)        r_err(err<0, return err, __VA_ARGS__, snd_strerror(err));
+#define SndRetVal_rt(err, val, ...)   r_err(err<0, return val, __VA_ARGS__, snd_strerror(err));
+#define SndGoto_rt(  err, label, ...) r_err(err<0, goto label, __VA_ARGS__, snd_strerror(err));
+// clang-format on
@@ -0,0 +1,133 @@
+/** @file loopback.h
+ *  @brief Many independent capture -> playback loops, grouped into threads, like alsaloop.
+ *
+ *  Each loop is a `sndx_duplex_t` (its own pair of devices, linked if possible, else kept in sync
+ *  with its drift stage) and a `sndx_router_t` from capture to playback channels (1:1 by default).
+ *  Loops are independent: one that fails is taken out of its thread, the others go on.
+ *
+ *  Threads: loops with the same `thread` share one thread and one `poll()` over the descriptors
+ *  of all of them. Capture descriptors wake the thread (capture clocks drive their loops),
+ *  playback descriptors are only watched for errors. On a wakeup, every loop with a capture
+ *  period ready moves all full periods it has.
+ *
+ *  Per loop settings (`sndx_loopback_desc_t`), as in alsaloop:
+ *      latency_req : target capture to playback latency in frames, sets the period size
+ *                    when none is given, and the fill level the drift stage keeps
+ *      sync        : how an unlinked pair is kept in sync (@see drift.h), rate shift if the device has it
+ *
+ *  Usage:
+ *      1. open, add loops (by device name, or on handles already open)
+ *      2. set routes on `loop->router` if 1:1 is not it (any time, they are swapped lock-free)
+ *      3. start: threads start their loops and run them
+ *      4. stop: threads stop their loops and are joined (start again if needed)
+ *      5. close
+ */
+#pragma once
+
+#include "sndx/duplex.h"
+#include "sndx/router.h"
+#include <pthread.h>
+
+#define SNDX_LOOPBACK_PERIODS 2 ///< Default periods per buffer
+
+/** @brief One loop as asked for. */
+typedef struct
+{
+    const char*      id;          ///< Name in dumps, "loop<index>" if null
+    const char*      play;        ///< Playback device, unused by `sndx_loopback_add_pcm`
+    const char*      capt;        ///< Capture device, unused by `sndx_loopback_add_pcm`
+    format_t         format;      ///< Of both devices
+    u32              rate;        ///< Of both devices
+    uframes_t        period_size; ///< 0: from latency_req
+    u32              periods;     ///< 0: SNDX_LOOPBACK_PERIODS
+    uframes_t        latency_req; ///< Target latency in frames, 0: one buffer
+    sndx_sync_type_t sync;        ///< When the pair cannot be linked
+    u32              thread;      ///< Loops with the same number share a thread
+
+} sndx_loopback_desc_t;
+
+/** @brief One running loop, counters written by its thread. */
+typedef struct
+{
+    char                 id[32]; ///< From desc, or generated
+    sndx_loopback_desc_t desc;   ///< As given, strings not kept (id copied above)
+
+    sndx_duplex_t* d;      ///< Devices, buffers, drift
+    sndx_router_t* router; ///< Capture to playback channels, ramped over a period
+
+    u32  pfd_first; ///< First descriptor in the poll set of its thread
+    u32  play_nfds; ///< Playback descriptors, errors only
+    u32  capt_nfds; ///< Capture descriptors, wake the thread
+    bool failed;    ///< Could not be recovered, out of the poll set
+
+    u64       cycles;      ///< Periods moved
+    u64       recoveries;  ///< Calls to `sndx_duplex_recover`
+    u64       restarts;    ///< Of which needed a full restart
+    sframes_t latency;     ///< Playback delay + capture delay at a wakeup, once per second
+    sframes_t latency_min; ///< Since start
+    sframes_t latency_max; ///< Since start
+    u64       next_probe;  ///< Cycle of the next latency measurement
+
+} sndx_loopback_loop_t;
+
+struct sndx_loopback_t;
+
+/** @brief Thread of a group of loops and its poll set. */
+typedef struct
+{
+    struct sndx_loopback_t* lb;     ///< Back pointer for the thread
+    u32                     index;  ///< Thread number of its loops
+    u32*                    loops;  ///< Indices into the loops of lb
+    u32                     nloops; ///< Entries in loops
+
+    struct pollfd* pfds;    ///< All descriptors of its loops
+    u32            nfds;    ///< Used in pfds
+    int            timeout; ///< Poll timeout in ms, 4 periods of its slowest loop
+
+    pthread_t tid;   ///< Thread
+    bool      alive; ///< Created, to be joined
+    bool      rt;    ///< Runs SCHED_FIFO
+    int       err;   ///< Why it stopped early, 0 if it did not
+
+    u64 wakeups;  ///< Polls that returned events
+    u64 timeouts; ///< Polls that returned none
+
+} sndx_loopback_thread_t;
+
+/** @brief Loops and their threads. */
+typedef struct sndx_loopback_t
+{
+    sndx_loopback_loop_t* loops;  ///< Added loops
+    u32                   nloops; ///< Used
+    u32                   cloops; ///< Allocated
+
+    sndx_loopback_thread_t* threads;  ///< One per thread number in use, after start
+    u32                     nthreads; ///< Entries in threads
+
+    int  priority; ///< SCHED_FIFO priority of the threads, 0 for the default policy
+    bool running;  ///< Cleared by stop (atomic)
+
+    output_t* out; ///< Errors and dumps
+
+} sndx_loopback_t;
+
+/** @brief Empty set of loops, threads at SCHED_FIFO `priority` once started (0: default policy). */
+int sndx_loopback_open(sndx_loopback_t** lbp, int priority, output_t* output);
+
+/** @brief Stop if running, close every loop and free. */
+void sndx_loopback_close(sndx_loopback_t* lb);
+
+/** @brief Open `desc->play` and `desc->capt` and add them as a loop, returns its index. */
+int sndx_loopback_add(sndx_loopback_t* lb, const sndx_loopback_desc_t* desc);
+
+/** @brief Same on handles already open (simulated devices, @see sim.h), takes ownership of both. */
+int sndx_loopback_add_pcm(sndx_loopback_t* lb, const sndx_loopback_desc_t* desc, snd_pcm_t* play, snd_pcm_t* capt);
+
+/** @brief Build the poll sets and start one thread per thread number, each starts its loops. */
+int sndx_loopback_start(sndx_loopback_t* lb);
+
+/** @brief Ask the threads to stop their loops and join them. */
+int sndx_loopback_stop(sndx_loopback_t* lb);
+
+/** @brief Dump loops, threads and counters to output. */
+void sndx_loopback_dump(sndx_loopback_t* lb, output_t* output);
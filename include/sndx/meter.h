@@ -0,0 +1,152 @@
+/** @file meter.h
+ *  @brief Per channel meters: block levels on the RT thread, loudness and true peak on a meter thread.
+ *
+ *  RT side, `sndx_meter_push` over the planar `bufdata` of an `sndx_buffer_t`, per channel:
+ *
+ *      levels : peak and sum of squares of the block in one pass on eight float lanes, added to
+ *               running totals and published with a sequence counter (as clock.h), so readers never
+ *               block it. A GUI can draw fast peak meters from `sndx_meter_get_levels` alone.
+ *      audio  : one copy into an `sndx_ring_t` for the meter thread, frames it has no room for
+ *               are counted as dropped (the meter thread fell behind)
+ *
+ *  That is a few float operations and a memcpy per sample, nothing else grows with the channels.
+ *
+ *  Meter thread, woken once a step (SNDX_METER_STEP_MS of audio) is queued, per channel:
+ *
+ *      RMS        : from the running sums of the RT side, over the last step
+ *      sample peak: of the last step
+ *      true peak  : 4x oversampled by a windowed sinc (BS.1770 annex 2 style), held since reset
+ *      loudness   : K-weighted (BS.1770 pre-filter and RLB highpass, for any rate), each channel
+ *                   as a mono programme (EBU R128):
+ *                       momentary  400 ms
+ *                       short-term 3 s
+ *                       integrated since reset, 400 ms blocks every step, gated at -70 LUFS and
+ *                                  then 10 LU under the loudness of those, from a histogram of
+ *                                  SNDX_METER_HIST_RES LU bins (no history kept)
+ *
+ *  Readings are published with a sequence counter as well, `sndx_meter_get` copies a consistent set.
+ *  Nothing measured yet, or silence, reads -INFINITY.
+ */
+#pragma once
+
+#include "sndx/buffer.h"
+#include "sndx/ring.h"
+#include <pthread.h>
+
+/** @brief Meter thread step, also the hop of the gating blocks. */
+#define SNDX_METER_STEP_MS 100
+
+/** @brief Steps in a momentary window (400 ms) and a short-term window (3 s). */
+#define SNDX_METER_MOMENTARY_STEPS 4
+#define SNDX_METER_SHORT_STEPS     30
+
+/** @brief Integrated loudness histogram: bins of this many LU between the absolute gate and the top. */
+#define SNDX_METER_HIST_RES 0.1
+#define SNDX_METER_HIST_MIN -70.0
+#define SNDX_METER_HIST_MAX 10.0
+
+/** @brief True peak oversampling, and taps of each of its phases. */
+#define SNDX_METER_OVERSAMPLE 4
+#define SNDX_METER_TP_TAPS    12
+
+/** @brief Levels of the RT side, per channel. */
+typedef struct
+{
+    float peak;  ///< Of the latest block, linear
+    f64   sumsq; ///< Of all samples since open
+
+} sndx_meter_level_t;
+
+/** @brief Readings of the meter thread, per channel. */
+typedef struct
+{
+    f64 rms_db;       ///< Last step, dBFS
+    f64 peak_db;      ///< Sample peak of the last step, dBFS
+    f64 true_peak_db; ///< Highest since reset, dBTP
+    f64 momentary;    ///< LUFS, 400 ms
+    f64 short_term;   ///< LUFS, 3 s
+    f64 integrated;   ///< LUFS, gated, since reset
+
+} sndx_meter_reading_t;
+
+/** @brief State of a channel, meter thread only. */
+typedef struct
+{
+    f64 s1[2]; ///< Pre-filter state (transposed direct form II)
+    f64 s2[2]; ///< RLB highpass state
+
+    f64 steps[SNDX_METER_SHORT_STEPS]; ///< Mean square of the last steps, K-weighted, circular
+
+    u32* hist;  ///< Gating blocks per loudness bin
+    f64  sumsq; ///< RT total at the last step
+    f64  tp;    ///< Highest oversampled magnitude since reset
+
+    float x[SNDX_METER_TP_TAPS - 1]; ///< Last samples of the previous step, for the oversampling filter
+
+} sndx_meter_channel_t;
+
+typedef struct
+{
+    u32       channels; ///< Metered
+    u32       rate;     ///< Rate
+    uframes_t step;     ///< Frames per step
+
+    sndx_ring_t* ring; ///< RT -> meter thread
+
+    // RT side
+    sndx_meter_level_t* levels;     ///< Owner's copy
+    sndx_meter_level_t* levels_pub; ///< Copy for readers
+    u64                 frames;     ///< Pushed, owner's copy
+    u64                 frames_pub; ///< Pushed, copy for readers
+    u32                 levels_seq; ///< Odd while `levels_pub` is written
+    u64                 dropped;    ///< Frames the ring had no room for
+
+    // Meter thread
+    pthread_t tid;     ///< Meter thread
+    bool      running; ///< Cleared to stop it
+    u32       wake;    ///< Futex word, bumped by the RT side once a step is queued
+    bool      reset;   ///< Set to start true peak and integrated loudness over
+
+    f64 pre[5]; ///< Pre-filter b0 b1 b2 a1 a2
+    f64 rlb[5]; ///< RLB highpass b0 b1 b2 a1 a2
+    f32 tp_coef[SNDX_METER_OVERSAMPLE][SNDX_METER_TP_TAPS]; ///< Phases of the interpolator, reversed
+
+    float*                scratch;   ///< A step of every channel, planar
+    area_t*               areas;     ///< Over scratch
+    float*                tp_buf;    ///< Previous samples and a step of one channel
+    sndx_meter_channel_t* state;     ///< Per channel
+    sndx_meter_level_t*   at;        ///< RT levels taken at the last step
+    u32                   hist_bins; ///< Bins of each histogram
+    u64                   nsteps;    ///< Steps since reset
+    u64                   at_frames; ///< RT frames pushed at the last step
+
+    sndx_meter_reading_t* readings;     ///< Owner's copy
+    sndx_meter_reading_t* readings_pub; ///< Copy for readers
+    u32                   readings_seq; ///< Odd while `readings_pub` is written
+    u64                   steps;        ///< Steps processed, in total
+
+} sndx_meter_t;
+
+/** @brief Allocate for `channels` at `rate`, start the meter thread. */
+int sndx_meter_open(sndx_meter_t** meterp, u32 channels, u32 rate, output_t* output);
+
+/** @brief Stop the meter thread and free. */
+void sndx_meter_close(sndx_meter_t* m);
+
+/** @brief Levels of `frames` from `offset` of the planar float buffer, queue them for the meter thread. RT safe.
+ *
+ *  Channels beyond those of `b` are not updated.
+ */
+void sndx_meter_push(sndx_meter_t* m, const sndx_buffer_t* b, uframes_t offset, uframes_t frames);
+
+/** @brief Latest RT levels of every channel into `levels`, and the frames pushed so far. Lock-free, any thread. */
+void sndx_meter_get_levels(sndx_meter_t* m, sndx_meter_level_t* levels, u64* frames);
+
+/** @brief Latest readings of every channel into `readings`, returns the steps processed. Lock-free, any thread. */
+u64 sndx_meter_get(sndx_meter_t* m, sndx_meter_reading_t* readings);
+
+/** @brief Start true peak and integrated loudness over, from the next step on. Any thread. */
+void sndx_meter_reset(sndx_meter_t* m);
+
+/** @brief Dump readings. */
+void sndx_meter_dump(sndx_meter_t* m, output_t* output);
@@ -0,0 +1,88 @@
+/** @file pitch.h
+ *  @brief Streaming pitch estimator: windowed FFT spectrum with HPS, YIN for the period.
+ *
+ *  Samples are pushed in any block size (a period of a capture, a chunk of a file) into a history
+ *  of `size` samples. Every `hop` samples the history is analysed:
+ *
+ *      1. level   : below `gate_db` there is no pitch
+ *      2. HPS     : Hann windowed FFT, harmonic product spectrum over SNDX_PITCH_HARMONICS at the
+ *                   spectral peaks, the highest one within 3 dB of the best is a coarse fundamental
+ *      3. YIN     : cumulative mean normalised difference over lags of up to size / 2, its
+ *                   autocorrelation from one FFT of both halves and one inverse. The first dip below
+ *                   `threshold` is the period. Without one, the deepest dip near the HPS estimate.
+ *      4. refine  : parabolic interpolation of the dip, so the period is not limited to whole samples
+ *
+ *  The estimate is valid when the level passes the gate and the dip is deeper than
+ *  SNDX_PITCH_MAX_APERIODICITY. Everything is allocated at open, pushing is RT safe.
+ *  The lowest pitch is rate / (size / 2), 23 Hz for 4096 at 48 kHz.
+ */
+#pragma once
+
+#include "sndx/fft.h"
+
+/** @brief Harmonics multiplied by HPS. */
+#define SNDX_PITCH_HARMONICS 4
+
+/** @brief Dips shallower than this (1 is noise) are no pitch. */
+#define SNDX_PITCH_MAX_APERIODICITY 0.5
+
+typedef struct
+{
+    bool valid;      ///< Pitched and loud enough
+    f64  freq;       ///< Hz
+    f64  confidence; ///< 1 - depth of the YIN dip, 1 for a pure tone
+    f64  level_db;   ///< RMS of the window, dBFS
+    f64  hps_freq;   ///< Coarse estimate of the spectrum, 0 if none
+    u64  frame;      ///< Samples pushed when estimated
+
+} sndx_pitch_estimate_t;
+
+typedef struct
+{
+    u32 rate; ///< Rate
+    u32 size; ///< Window, power of two
+    u32 hop;  ///< Samples between estimates
+
+    f64 fmin;      ///< Lowest pitch searched
+    f64 fmax;      ///< Highest pitch searched
+    f64 threshold; ///< YIN absolute threshold
+    f64 gate_db;   ///< Level gate, dBFS
+
+    sndx_fft_t* fft; ///< Of size
+
+    float* history; ///< Last size samples, circular
+    u32    write;   ///< Next slot in history
+    u32    since;   ///< Samples since the last estimate
+    u64    frames;  ///< Samples pushed
+
+    float* frame;  ///< History in order
+    float* window; ///< Hann
+    float* re;     ///< FFT
+    float* im;     ///< FFT
+    float* cre;    ///< Autocorrelation
+    float* cim;    ///< Autocorrelation
+    float* hps;    ///< Harmonic product spectrum (log)
+    float* cmnd;   ///< YIN difference, normalised
+    f64*   energy; ///< Prefix sums of squares
+
+    sndx_pitch_estimate_t last; ///< Latest estimate
+
+} sndx_pitch_t;
+
+/** @brief Allocate for windows of `size` (power of two), an estimate every `hop` samples (size / 4 if 0). */
+int sndx_pitch_open(sndx_pitch_t** pitchp, u32 rate, u32 size, u32 hop, output_t* output);
+
+/** @brief Free. */
+void sndx_pitch_close(sndx_pitch_t* p);
+
+/** @brief Forget the history, keeps the settings. */
+void sndx_pitch_reset(sndx_pitch_t* p);
+
+/** @brief Push `frames` samples of one channel. RT safe, true if `last` has a new estimate. */
+bool sndx_pitch_push(sndx_pitch_t* p, const float* samples, uframes_t frames);
+
+/** @brief Estimate from `size` samples. RT safe, used by push on the history. */
+void sndx_pitch_analyse(sndx_pitch_t* p, const float* frame, sndx_pitch_estimate_t* est);
+
+/** @brief Nearest equal tempered note (A4 = 440 Hz), its octave and how many cents `freq` is off. */
+const char* sndx_pitch_note(f64 freq, int* octave, f64* cents);
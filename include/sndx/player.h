@@ -0,0 +1,131 @@
+/** @file player.h
+ *  @brief Streaming disk player: a prefetch thread keeps a ring filled, the RT thread only reads the ring.
+ *
+ *  The ring holds `read_ahead` seconds and is filled before `sndx_player_open` returns, so playback
+ *  starts without waiting on the disk. The RT side pulls from it into any float areas (typically
+ *  `sndx_buffer_t.buf`), silence where the ring runs short, and wakes the prefetch thread with one
+ *  futex syscall once a chunk of room is free. Sources:
+ *
+ *      SNDX_PLAYER_MMAP    : WAV with 32 bit float samples, or headerless native float (`raw`).
+ *                            The file is mapped with MADV_SEQUENTIAL and copied straight from the
+ *                            mapping into the ring, nothing to decode. Page faults happen on the
+ *                            prefetch thread, MADV_WILLNEED asks for the chunk after the one copied.
+ *      SNDX_PLAYER_SNDFILE : anything libsndfile reads, decoded with `sf_readf_float` a chunk at a time
+ *
+ *  `SNDX_PLAYER_AUTO` maps float WAV and raw files and hands everything else to libsndfile.
+ *
+ *  Seeking can come from any thread and never blocks. The prefetch thread repositions the source and
+ *  publishes how many frames it had queued before the seek, the RT side skips those on its next pull
+ *  and plays silence until the new data comes in.
+ */
+#pragma once
+
+#include "sndx/ring.h"
+#include <pthread.h>
+#include <sndfile.h>
+
+/** @brief Frames per refill if not given. */
+#define SNDX_PLAYER_CHUNK 4096
+
+/** @brief Seconds queued ahead if not given. */
+#define SNDX_PLAYER_READ_AHEAD 2.0
+
+typedef enum
+{
+    SNDX_PLAYER_AUTO = 0,
+    SNDX_PLAYER_MMAP,
+    SNDX_PLAYER_SNDFILE,
+
+} sndx_player_source_t;
+
+/** @brief What to play and how. */
+typedef struct
+{
+    const char*          path;     ///< File
+    sndx_player_source_t source;   ///< Reader
+    bool                 raw;      ///< Headerless native float, with `channels` and `rate` (not SNDFILE)
+    u32                  channels; ///< Raw files only
+    u32                  rate;     ///< Raw files only
+    bool                 loop;     ///< Start over at the end instead of stopping
+
+    uframes_t chunk_frames; ///< Frames per refill, 0 for SNDX_PLAYER_CHUNK
+    f64       read_ahead;   ///< Seconds queued, 0 for SNDX_PLAYER_READ_AHEAD, at least 2 chunks
+
+} sndx_player_desc_t;
+
+/** @brief Player, stats are written by the RT and prefetch threads and can be read from anywhere. */
+typedef struct
+{
+    sndx_player_desc_t desc; ///< With defaults filled in
+    sndx_ring_t*       ring; ///< Prefetch -> RT
+
+    sndx_player_source_t source;   ///< MMAP or SNDFILE, as opened
+    u32                  channels; ///< Of the file
+    u32                  rate;     ///< Of the file
+    uframes_t            frames;   ///< Length of the file
+
+    SNDFILE* sf;      ///< SNDFILE source
+    float*   staging; ///< SNDFILE source, one chunk interleaved
+    int      fd;      ///< MMAP source
+    u8*      map;     ///< MMAP source, whole file
+    usize    map_len; ///< Bytes mapped
+    usize    data;    ///< Offset of the samples in the mapping
+    area_t*  areas;   ///< Interleaved, over the mapping or staging
+
+    pthread_t tid;     ///< Prefetch
+    bool      running; ///< Cleared to stop prefetch
+    u32       wake;    ///< Futex word, bumped by the RT side and by seeks
+
+    // Prefetch side
+    uframes_t pos;      ///< Next file frame to queue
+    bool      eof;      ///< Everything queued, not looping
+    u64       produced; ///< Frames queued since open
+    int       err;      ///< First read error, prefetch stops there
+
+    // Seek handshake
+    uframes_t seek_frame; ///< Requested file frame
+    u32       seek_req;   ///< Bumped by each seek
+    u32       seek_done;  ///< Request the prefetch thread acted on
+    u64       seek_mark;  ///< `produced` at that point, frames before it are stale
+    uframes_t seek_base;  ///< File frame at `seek_mark`
+
+    // RT side
+    u32       rt_seek;  ///< Request whose stale frames were skipped
+    u64       consumed; ///< Frames pulled since open, stale ones included
+    uframes_t position; ///< File frame about to play
+
+    u64 underruns;       ///< Pulls that came up short before the end
+    u64 underrun_frames; ///< Silence they played
+    u64 low_water;       ///< Fewest frames queued at a pull
+    u64 seeks;           ///< Seeks done
+
+    u64 reads;           ///< Refills
+    u64 read_last_nsecs; ///< Latest refill, page faults or decoding included
+    u64 read_max_nsecs;  ///< Slowest refill
+    u64 read_sum_nsecs;  ///< For the mean
+
+    output_t* output; ///< Prefetch errors
+
+} sndx_player_t;
+
+/** @brief Open the source, fill the ring and start the prefetch thread. */
+int sndx_player_open(sndx_player_t** playerp, const sndx_player_desc_t* desc, output_t* output);
+
+/** @brief Stop the prefetch thread and free. */
+void sndx_player_close(sndx_player_t* p);
+
+/** @brief Up to `frames` into float areas at `offset`. RT safe.
+ *
+ *  Channels beyond the file, and frames the ring does not have, are silence.
+ *  Returns frames played from the file.
+ */
+uframes_t sndx_player_pull(sndx_player_t* p, const area_t* areas, u32 channels, uframes_t offset, uframes_t frames);
+
+/** @brief Continue from file frame `frame`. Any thread, one at a time, returns right away. */
+void sndx_player_seek(sndx_player_t* p, uframes_t frame);
+
+/** @brief Whole file played, never for a looping player. RT safe. */
+bool sndx_player_done(sndx_player_t* p);
+
+/** @brief Dump stats. */
+void sndx_player_dump(sndx_player_t* p, output_t* output);
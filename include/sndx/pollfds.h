@@ -8,10 +8,16 @@
  */
 #pragma once
 
+#include "sndx/log.h"
+#include "sndx/status.h"
+#include "sndx/trace.h"
 #include "sndx/types.h"
 
 typedef struct pollfd pfd_t;
 
+/** @brief Timeouts in a row `sndx_pollfds_wait` asks to restart for, the next one is fatal. */
+#define SNDX_POLLFDS_MAX_RETRY_COUNT 5
+
 /** @brief Struct to handle polling and poll timings
  *
  *  Initialized in duplex_start
@@ -42,6 +48,14 @@ typedef struct sndx_pollfds_t
     u32 xrun_count;    ///< Number of xruns
     u32 retry_count;   ///< Number of poll(...) retries if poll_ret == 0
 
+    bool capture_only; ///< Unlinked pair: wake on capture only, playback runs on its own clock
+
+    sndx_trace_t* trace; ///< Optional, records wakeups, avails and xruns (not owned)
+    sndx_log_t*   log;   ///< Optional, RT logging instead of printing to output (not owned)
+
+    sndx_status_t* st_play; ///< Optional, avail snapshot taken by `sndx_pollfds_avail` (not owned)
+    sndx_status_t* st_capt; ///< Optional, same, and the xrun report reads from it (not owned)
+
 } sndx_pollfds_t;
 
 /** @brief Allocate memory and init stats for struct pollfds */
@@ -0,0 +1,104 @@
+/** @file pool.h
+ *  @brief RT worker pool: SCHED_FIFO threads pinned to cores, work-stealing deques, spin-then-futex waits.
+ *
+ *  The audio thread calls `sndx_pool_run` to split one period of work (channels, graph branches)
+ *  into tasks, and takes part in running them, so a pool of N threads uses N + 1 cores.
+ *
+ *  Deques (Chase-Lev, fixed capacity, nothing allocated after open):
+ *      - worker 0 is the caller of run, its deque takes the tasks of the run
+ *      - each worker pops from the bottom of its own deque, steals from the top of the others
+ *      - a task may push more tasks to the bottom of its worker's deque (`sndx_pool_push`)
+ *
+ *  Waits, both spin first for `spin` rounds (a wakeup costs more than a short period):
+ *      - idle workers sleep on `generation`, bumped by run and push
+ *      - the caller sleeps on `remaining` until the last task of the run finished
+ *
+ *  Cores: given explicitly, else the isolated cores of the kernel (isolcpus), else not pinned.
+ *  Without the rights for SCHED_FIFO the threads still run, under the default policy (`rt` is false),
+ *  on the same cores. Only a core that can not be used leaves its thread unpinned (`cpu` is -1).
+ */
+#pragma once
+
+#include "sndx/types.h"
+#include <pthread.h>
+
+#define SNDX_POOL_DEQUE_CAPACITY 256  ///< Tasks per deque, power of two, a full deque runs the task in place
+#define SNDX_POOL_SPIN           2000 ///< Default spin rounds before sleeping on a futex
+
+struct sndx_pool_t;
+
+/** @brief Task body, `worker` is the index of the running worker (0 for the caller of run). */
+typedef void (*sndx_pool_fn_t)(struct sndx_pool_t* pool, u32 worker, void* arg, u32 index);
+
+/** @brief Queued task. */
+typedef struct
+{
+    sndx_pool_fn_t fn;    ///< Body
+    void*          arg;   ///< Shared by all tasks of a run
+    u32            index; ///< Channel, branch, ...
+
+} sndx_pool_task_t;
+
+/** @brief Chase-Lev deque, the owner pushes and pops at bottom, thieves take from top. */
+typedef struct
+{
+    i64              top __attribute__((aligned(64)));    ///< Next to steal
+    i64              bottom __attribute__((aligned(64))); ///< Next free slot of the owner
+    sndx_pool_task_t tasks[SNDX_POOL_DEQUE_CAPACITY];     ///< Ring
+
+} sndx_pool_deque_t;
+
+/** @brief One worker, its deque and counters. */
+typedef struct
+{
+    sndx_pool_deque_t   deque; ///< Own tasks
+    struct sndx_pool_t* pool;  ///< Back pointer for the thread
+    pthread_t           tid;   ///< Thread, none for worker 0
+    u32                 id;    ///< Index in workers
+    int                 cpu;   ///< Pinned to, -1 for none
+    bool                rt;    ///< Runs SCHED_FIFO
+    bool                alive; ///< Thread created
+
+    u64 executed; ///< Tasks run
+    u64 stolen;   ///< Of which taken from another deque
+    u64 sleeps;   ///< Futex waits
+
+} sndx_pool_worker_t;
+
+/** @brief Pool of workers, worker 0 stands for the caller of run. */
+typedef struct sndx_pool_t
+{
+    sndx_pool_worker_t* workers;  ///< nworkers entries, 64 byte aligned
+    u32                 nworkers; ///< Threads plus the caller
+    int                 priority; ///< SCHED_FIFO priority of the threads, 0 for none
+    u32                 spin;     ///< Rounds before sleeping
+
+    u32  generation __attribute__((aligned(64))); ///< Bumped when tasks are added, idle workers sleep on it
+    u32  nsleeping;                               ///< Workers asleep on generation
+    u32  remaining __attribute__((aligned(64)));  ///< Tasks of the run not finished, the caller sleeps on it
+    u32  waiting;                                 ///< Caller asleep on remaining
+    bool running __attribute__((aligned(64)));    ///< Cleared on close
+
+    u64 runs; ///< Calls to run
+
+    output_t* out; ///< For open and dump
+
+} sndx_pool_t;
+
+/** @brief Start `nthreads` workers at SCHED_FIFO `priority` (0: default policy), pinned to `cpus` (nullable). */
+int sndx_pool_open(sndx_pool_t** poolp, u32 nthreads, const int* cpus, int priority, output_t* output);
+
+/** @brief Wake, stop and join the workers, free the pool. */
+void sndx_pool_close(sndx_pool_t* pool);
+
+/** @brief Run `fn(pool, worker, arg, i)` for i in [0, ntasks) across the pool and return when all finished.
+ *
+ *  RT safe, one caller at a time (the audio thread), the caller runs tasks too.
+ */
+void sndx_pool_run(sndx_pool_t* pool, sndx_pool_fn_t fn, void* arg, u32 ntasks);
+
+/** @brief From inside a task: add a task to the deque of `worker`, part of the current run. */
+void sndx_pool_push(sndx_pool_t* pool, u32 worker, sndx_pool_fn_t fn, void* arg, u32 index);
+
+/** @brief Dump workers, cores and counters to output, counters are approximate while a run goes on. */
+void sndx_pool_dump(sndx_pool_t* pool, output_t* output);
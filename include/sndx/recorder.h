@@ -0,0 +1,107 @@
+/** @file recorder.h
+ *  @brief Streaming disk recorder: the RT thread pushes into a ring, a writer thread drains it to disk.
+ *
+ *  The RT side only copies into an `sndx_ring_t` (no allocation, no I/O). Once a chunk is queued
+ *  it wakes the writer with one futex syscall. The writer copies the chunk out interleaved into a
+ *  page aligned buffer and writes it with one call:
+ *
+ *      SNDX_RECORDER_SNDFILE : `sf_writef_float` into any libsndfile format (W64 float by default)
+ *      SNDX_RECORDER_DIRECT  : `write` of raw interleaved native float with O_DIRECT, past the page cache.
+ *                              Filesystems without O_DIRECT (tmpfs) fall back to buffered writes.
+ *
+ *  Disk space is reserved ahead of the writes with `fallocate(FALLOC_FL_KEEP_SIZE)`, `prealloc_seconds`
+ *  at a time, and the unused reserve is released at close. Multitrack is one file with `channels`
+ *  interleaved.
+ *
+ *  Stats:
+ *      high_water : most frames queued in the ring, compare with its capacity for the margin left
+ *      dropped    : frames the ring had no room for, the writer fell behind
+ *      disk       : latency of each write call, last / max / mean, and writes slower than realtime
+ *                   (longer than the chunk lasts)
+ */
+#pragma once
+
+#include "sndx/ring.h"
+#include <pthread.h>
+#include <sndfile.h>
+#include <sys/types.h>
+
+/** @brief Frames per write if not given. */
+#define SNDX_RECORDER_CHUNK 16384
+
+/** @brief O_DIRECT transfers are multiples of this, and the chunk buffer is aligned to it. */
+#define SNDX_RECORDER_ALIGN 4096
+
+typedef enum
+{
+    SNDX_RECORDER_SNDFILE = 0,
+    SNDX_RECORDER_DIRECT,
+
+} sndx_recorder_mode_t;
+
+/** @brief What to record and how. */
+typedef struct
+{
+    const char*          path;      ///< File, created or truncated
+    sndx_recorder_mode_t mode;      ///< Writer
+    u32                  channels;  ///< Tracks
+    u32                  rate;      ///< Rate
+    int                  sf_format; ///< SNDFILE: major | subtype, 0 for SF_FORMAT_W64 | SF_FORMAT_FLOAT
+
+    uframes_t chunk_frames;     ///< Frames per write, 0 for SNDX_RECORDER_CHUNK, rounded up to 1024 frames
+    uframes_t ring_frames;      ///< Ring capacity, 0 for 8 chunks, at least 2 chunks, rounded up to power of two
+    f64       prealloc_seconds; ///< Reserved ahead with fallocate, 0 for 60, negative for none
+
+} sndx_recorder_desc_t;
+
+/** @brief Recorder, stats are written by the RT and writer threads and can be read from anywhere. */
+typedef struct
+{
+    sndx_recorder_desc_t desc; ///< With defaults filled in
+    sndx_ring_t*         ring; ///< RT -> writer
+
+    int      fd;     ///< File
+    SNDFILE* sf;     ///< SNDFILE mode
+    bool     direct; ///< O_DIRECT in use
+
+    float*  chunk; ///< Interleaved, aligned to SNDX_RECORDER_ALIGN
+    area_t* areas; ///< Over chunk
+
+    pthread_t tid;     ///< Writer
+    bool      running; ///< Cleared to stop the writer
+    u32       wake;    ///< Futex word, bumped by the RT side once a chunk is queued
+
+    off_t prealloc; ///< Bytes reserved at a time, 0 once fallocate is refused
+    off_t reserved; ///< Bytes reserved so far
+    off_t bytes;    ///< Bytes of samples written
+    int   err;      ///< First writer error, writing stops there
+
+    output_t* output; ///< Writer errors
+
+    u64 pushed;     ///< Frames queued by the RT side
+    u64 dropped;    ///< Frames the ring had no room for
+    u64 high_water; ///< Most frames queued at once
+    u64 written;    ///< Frames on disk
+
+    u64 writes;          ///< Write calls
+    u64 disk_last_nsecs; ///< Latest write call
+    u64 disk_max_nsecs;  ///< Slowest write call
+    u64 disk_sum_nsecs;  ///< For the mean
+    u64 disk_late;       ///< Write calls longer than the chunk lasts
+
+} sndx_recorder_t;
+
+/** @brief Create the file, reserve space, allocate and start the writer thread. */
+int sndx_recorder_open(sndx_recorder_t** recp, const sndx_recorder_desc_t* desc, output_t* output);
+
+/** @brief Stop the writer, write everything still queued, finalize the file and free.
+ *
+ *  Returns the first error of the writer, if any, the file holds what was written up to it.
+ */
+int sndx_recorder_close(sndx_recorder_t* rec);
+
+/** @brief Queue `frames` of float areas. RT safe, returns frames queued, the rest is counted as dropped. */
+uframes_t sndx_recorder_push(sndx_recorder_t* rec, const area_t* areas, uframes_t offset, uframes_t frames);
+
+/** @brief Dump stats. */
+void sndx_recorder_dump(sndx_recorder_t* rec, output_t* output);
@@ -0,0 +1,102 @@
+/** @file resampler.h
+ *  @brief Polyphase windowed sinc resampler on non-interleaved float areas.
+ *
+ *  Works on the float areas of `sndx_buffer_t` and `sndx_ring_t` (planar, step of one float),
+ *  for drift correction around a ratio of 1 and for plain rate conversion.
+ *
+ *  Sinc qualities follow the order of libsamplerate (@see examples/alsaloop/alsaloop.h):
+ *      BEST    : 64 taps, 256 phases, Kaiser beta 10
+ *      MEDIUM  : 32 taps, 128 phases, Kaiser beta 8
+ *      FASTEST : 16 taps,  64 phases, Kaiser beta 6
+ *      LINEAR  : 2 taps, no table, zero latency
+ *
+ *  A filter of N taps delays by N / 2 input frames, linear has no delay.
+ *  For downsampling the cutoff and the taps scale with the nominal ratio given at open.
+ *
+ *  Output frame j sits at input position t_j (with the history in front of the input),
+ *  filter rows for the two nearest phases are applied with one pass over the input (SIMD)
+ *  and interpolated by the remaining fraction, so any ratio works with a fixed table.
+ *  `sndx_resampler_set_ratio` glides to the new ratio over the next call, no steps in pitch.
+ */
+#pragma once
+
+#include "sndx/types.h"
+
+/** @brief Filter length and table size, from most expensive to cheapest. */
+typedef enum sndx_resampler_quality_t
+{
+    SNDX_RESAMPLER_BEST = 0, ///< Sinc, 64 taps
+    SNDX_RESAMPLER_MEDIUM,   ///< Sinc, 32 taps
+    SNDX_RESAMPLER_FASTEST,  ///< Sinc, 16 taps
+    SNDX_RESAMPLER_LINEAR,   ///< Linear interpolation, zero latency
+    SNDX_RESAMPLER_QUALITY_LAST = SNDX_RESAMPLER_LINEAR,
+
+} sndx_resampler_quality_t;
+
+/** @brief Resampler state for all channels. */
+typedef struct
+{
+    sndx_resampler_quality_t quality; ///< Filter in use
+
+    u32       channels;   ///< Audio channels
+    uframes_t max_frames; ///< Input frames handled per call, more are left for the next call
+    uframes_t max_out;    ///< Output frames produced per call at most
+
+    u32    ntaps;   ///< Filter length, multiple of 8 (2 for linear)
+    u32    nphases; ///< Rows in `table` minus one, the last row closes the interval
+    f64    cutoff;  ///< Relative to the input Nyquist frequency
+    float* table;   ///< (nphases + 1) rows of ntaps coefficients, 32 byte aligned
+
+    f64 step;        ///< Input frames per output frame, in use
+    f64 step_target; ///< Input frames per output frame, reached at the end of the next call
+    f64 pos;         ///< Position of the next output frame, relative to the start of the history
+
+    float* work;  ///< Per channel: ntaps - 1 frames of history, then up to max_frames of input
+    isize* index; ///< Per output frame of a call: first input frame under the filter
+    u32*   phase; ///< Per output frame of a call: table row below the fractional position
+    float* alpha; ///< Per output frame of a call: weight of the row above (linear: fractional position)
+
+} sndx_resampler_t;
+
+/** @brief Build table and buffers for `ratio` (output frames per input frame) around which it will be used. */
+int sndx_resampler_open(                 //
+    sndx_resampler_t**       rp,         //
+    sndx_resampler_quality_t quality,    //
+    u32                      channels,   //
+    f64                      ratio,      //
+    uframes_t                max_frames, //
+    output_t*                output);
+
+/** @brief Free table and buffers. */
+void sndx_resampler_close(sndx_resampler_t* r);
+
+/** @brief Clear history and position, no glide to the last ratio set. */
+void sndx_resampler_reset(sndx_resampler_t* r);
+
+/** @brief Output frames per input frame, reached smoothly over the next call. */
+void sndx_resampler_set_ratio(sndx_resampler_t* r, f64 ratio);
+
+/** @brief Resample from `in` to `out`, stops when either runs out.
+ *
+ *  On return `*in_frames` holds the frames consumed and `*out_frames` the frames produced.
+ *  Frames not consumed have to be passed again on the next call.
+ *
+ *  Returns 0, or -EINVAL if the areas are not planar floats.
+ */
+int sndx_resampler_process(       //
+    sndx_resampler_t* r,          //
+    const area_t*     in,         //
+    uframes_t         in_offset,  //
+    uframes_t*        in_frames,  //
+    const area_t*     out,        //
+    uframes_t         out_offset, //
+    uframes_t*        out_frames);
+
+/** @brief Delay in input frames. */
+f64 sndx_resampler_latency(sndx_resampler_t* r);
+
+/** @brief Name of quality. */
+const char* sndx_resampler_quality_name(sndx_resampler_quality_t quality);
+
+/** @brief Dump filter params and state to output. */
+void sndx_resampler_dump(sndx_resampler_t* r, output_t* output);
@@ -28,8 +28,9 @@ typedef struct
     sframes_t read;  ///< Read pointer
     sframes_t write; ///< Write pointer
 
-    int from_int; ///< Conversion function index: Copy int format to int32
-    int to_int;   ///< Conversion function index: Copy int32 to int format
+    int  from_int; ///< Conversion function index: Copy int format to int32
+    int  to_int;   ///< Conversion function index: Copy int32 to int format
+    bool is_float; ///< Opened with SND_PCM_FORMAT_FLOAT, areas are copied as they are
 
 } sndx_ring_t;
 
@@ -38,7 +39,7 @@ typedef struct
 /** @brief Dump debugging info. */
 void sndx_ring_dump(sndx_ring_t* rb, output_t* output);
 
-/** @brief Initialize areas and backing buffer. */
+/** @brief Initialize areas and backing buffer. Other float formats than native SND_PCM_FORMAT_FLOAT are -EINVAL. */
 int sndx_ring_open(sndx_ring_t** rbp, format_t format, u32 channels, uframes_t capacity, output_t* output);
 
 /** @brief Free areas and backing buffer. */
@@ -56,7 +57,7 @@ void sndx_ring_read_advance(sndx_ring_t* rb, uframes_t frames);
 /** @brief Advance write pointer. */
 void sndx_ring_write_advance(sndx_ring_t* rb, uframes_t frames);
 
-/** @brief Write from channel areas to ringbuffer with proper conversions. */
+/** @brief Write from channel areas to ringbuffer with proper conversions (none for float, @see is_float). */
 uframes_t sndx_ring_write_from_areas( //
     sndx_ring_t*  rb,
     const area_t* src_areas,
@@ -64,10 +65,26 @@ uframes_t sndx_ring_write_from_areas( //
     u32           channels,
     uframes_t     frames);
 
-/** @brief Read from ringbuffer to channel areas with proper conversions. */
+/** @brief Read from ringbuffer to channel areas with proper conversions (none for float, @see is_float). */
 uframes_t sndx_ring_read_to_areas( //
     sndx_ring_t*  rb,
     const area_t* dst_areas,
     uframes_t     dst_offset,
     u32           channels,
     uframes_t     frames);
+
+/** @brief Write float channel areas to ringbuffer without conversion, `memcpy` per channel if planar. */
+uframes_t sndx_ring_write_from_float_areas( //
+    sndx_ring_t*  rb,
+    const area_t* src_areas,
+    uframes_t     src_offset,
+    u32           channels,
+    uframes_t     frames);
+
+/** @brief Read from ringbuffer to float channel areas without conversion, `memcpy` per channel if planar. */
+uframes_t sndx_ring_read_to_float_areas( //
+    sndx_ring_t*  rb,
+    const area_t* dst_areas,
+    uframes_t     dst_offset,
+    u32           channels,
+    uframes_t     frames);
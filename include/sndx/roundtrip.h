@@ -0,0 +1,108 @@
+/** @file roundtrip.h
+ *  @brief True round-trip latency of a duplex, by cross-correlating a known stimulus.
+ *
+ *  `examples/latency` only sees the buffer level. Here a maximum length sequence (MLS) or an
+ *  exponential sine sweep (chirp) goes out through `sndx_duplex_write`, the capture from
+ *  `sndx_duplex_read` is recorded, and the lag of the correlation peak is the latency:
+ *
+ *      frame n written by the application comes back as frame n + latency of what it reads
+ *
+ *  so it is output latency (including the queued playback buffer) plus input latency, exactly
+ *  what a recording made alongside playback has to be shifted by. Needs a loopback cable (or
+ *  snd-aloop) from the playback channel to the capture channel.
+ *
+ *  Correlation over the whole recording is one FFT of each, a product and an inverse FFT,
+ *  the peak is refined to a fraction of a frame with a parabola through its neighbours.
+ *  Polarity is ignored (inverting paths are found as well) and reported.
+ *
+ *  Usage:
+ *      1. open, once per stimulus and maximum latency
+ *      2. `sndx_roundtrip_run` on a started duplex, or `sndx_roundtrip_process` from your own loop
+ *      3. `sndx_roundtrip_analyse`, result in `latency`
+ *      4. `sndx_roundtrip_reset` to measure again
+ */
+#pragma once
+
+#include "sndx/duplex.h"
+#include "sndx/fft.h"
+
+/** @brief Correlation peaks below this fraction of a perfect match are not trusted. */
+#define SNDX_ROUNDTRIP_MIN_PEAK 0.1
+
+/** @brief Stimulus. */
+typedef enum sndx_roundtrip_signal_t
+{
+    SNDX_ROUNDTRIP_MLS = 0, ///< Maximum length sequence, flat spectrum, sharpest peak
+    SNDX_ROUNDTRIP_CHIRP,   ///< Exponential sine sweep, robust against distortion and band limits
+    SNDX_ROUNDTRIP_SIGNAL_LAST = SNDX_ROUNDTRIP_CHIRP,
+
+} sndx_roundtrip_signal_t;
+
+/** @brief Measurement state and result. */
+typedef struct
+{
+    sndx_roundtrip_signal_t signal; ///< Stimulus kind
+    u32                     rate;   ///< For reporting in ms and the sweep range
+
+    float*    stimulus; ///< What is played, `length` frames
+    uframes_t length;   ///< Of the stimulus, 2^order - 1 for MLS
+
+    float*    record;      ///< What came back
+    uframes_t max_latency; ///< Largest lag searched
+    uframes_t capacity;    ///< length + max_latency, recorded frames needed
+    uframes_t recorded;    ///< So far
+    uframes_t played;      ///< Stimulus frames so far
+
+    sndx_fft_t* fft; ///< Size covers the linear correlation of record and stimulus
+    float*      re;  ///< Spectrum of the record, then the correlation
+    float*      im;  ///< Spectrum of the record, then the correlation
+    float*      sre; ///< Spectrum of the stimulus, kept over measurements
+    float*      sim; ///< Spectrum of the stimulus, kept over measurements
+
+    f64  latency;  ///< Round trip in frames, sub-sample
+    f64  peak;     ///< Normalized correlation at the peak, 1 is a perfect copy
+    f64  snr_db;   ///< Peak against the rms of the rest of the correlation
+    bool inverted; ///< Path inverts polarity
+
+} sndx_roundtrip_t;
+
+/** @brief Generate stimulus and allocate record and FFT (not RT safe).
+ *
+ *  `order` sets the length to 2^order - 1 frames (MLS order 10 to 20, same length for chirp),
+ *  `level` is the peak amplitude, `max_latency` the largest round trip expected in frames.
+ */
+int sndx_roundtrip_open(        //
+    sndx_roundtrip_t**      rtp,
+    sndx_roundtrip_signal_t signal,
+    u32                     order,
+    u32                     rate,
+    float                   level,
+    uframes_t               max_latency,
+    output_t*               output);
+
+/** @brief Free everything. */
+void sndx_roundtrip_close(sndx_roundtrip_t* rt);
+
+/** @brief Forget the recording and the result, the stimulus starts again. */
+void sndx_roundtrip_reset(sndx_roundtrip_t* rt);
+
+/** @brief One cycle: record `frames` of `capt`, fill `frames` of `play` with the stimulus (then silence).
+ *
+ *  RT safe. Returns true once enough has been recorded to analyse.
+ */
+bool sndx_roundtrip_process(sndx_roundtrip_t* rt, const float* capt, float* play, uframes_t frames);
+
+/** @brief Run the cycle loop of a started duplex until done, stimulus on every playback channel.
+ *
+ *  `channel` is the capture channel the loopback comes back on. Does not analyse.
+ */
+int sndx_roundtrip_run(sndx_roundtrip_t* rt, sndx_duplex_t* d, u32 channel);
+
+/** @brief Correlate and find the peak (not RT safe), -EIO if the peak is too weak to trust. */
+int sndx_roundtrip_analyse(sndx_roundtrip_t* rt, output_t* output);
+
+/** @brief Name of stimulus. */
+const char* sndx_roundtrip_signal_name(sndx_roundtrip_signal_t signal);
+
+/** @brief Dump result to output. */
+void sndx_roundtrip_dump(sndx_roundtrip_t* rt, output_t* output);
@@ -0,0 +1,93 @@
+/** @file router.h
+ *  @brief Capture to playback routing matrix, sparse and vectorized, gains ramped on every change.
+ *
+ *  Any capture channel to any playback channel with its own gain, playback channels sum their
+ *  sources. Only crosspoints with a gain are stored, grouped by playback channel, so a 64 x 64
+ *  matrix routed 1:1 costs 64 multiplies per frame, not 4096.
+ *
+ *  Control thread (allocates):
+ *      1. open, set crosspoints (or a preset), commit
+ *      2. set and commit again, any time: every crosspoint moves from the gain it has on the audio
+ *         thread to the new one over `ramp_frames`, no clicks, removed ones fade out first
+ *
+ *  Audio thread (never allocates or frees):
+ *      - `sndx_router_process` picks up the last committed plan at the start of a call,
+ *        the plan it replaced is handed back and freed by the next commit (or collect, or close)
+ *
+ *  Replaces `sndx_duplex_copy_capt_to_play`, which is the `sndx_router_preset_copy` matrix.
+ */
+#pragma once
+
+#include "sndx/buffer.h"
+
+/** @brief Crosspoint of a plan, ramp state included. */
+typedef struct
+{
+    u32 capt;   ///< Source channel
+    u32 play;   ///< Destination channel
+    f32 gain;   ///< At the start of the next call (audio thread)
+    f32 target; ///< Committed gain, 0 for a crosspoint fading out
+    f32 step;   ///< Per frame while ramping
+
+} sndx_router_point_t;
+
+/** @brief Compiled matrix, the ramp state is written by the audio thread. */
+typedef struct
+{
+    sndx_router_point_t* points;  ///< Grouped by playback channel
+    u32                  npoints; ///< Crosspoints, faded out ones included
+    u32*                 rows;    ///< First point of each playback channel, then npoints
+
+    f32*      from;      ///< ch_play x ch_capt scratch: gains of the replaced plan, on pick up
+    uframes_t ramp_left; ///< Frames to the targets (audio thread)
+    bool      settled;   ///< Picked up and ramp done (atomic), faded out points can be dropped
+
+} sndx_router_plan_t;
+
+/** @brief Matrix being edited and the plan in use. */
+typedef struct
+{
+    u32       ch_capt;     ///< Capture channels
+    u32       ch_play;     ///< Playback channels
+    uframes_t ramp_frames; ///< Length of a gain change, 0 for steps
+
+    f32* matrix; ///< ch_play x ch_capt gains, playback major (control thread)
+
+    sndx_router_plan_t* current;   ///< Audio thread only
+    sndx_router_plan_t* next;      ///< Committed, not picked up yet (atomic)
+    sndx_router_plan_t* retired;   ///< Replaced, to be freed by the control thread (atomic)
+    sndx_router_plan_t* committed; ///< Last commit, control thread only
+
+    output_t* out; ///< Errors of the control side
+
+} sndx_router_t;
+
+/** @brief All crosspoints at 0 between `ch_capt` capture and `ch_play` playback channels. */
+int sndx_router_open(sndx_router_t** rp, u32 ch_capt, u32 ch_play, uframes_t ramp_frames, output_t* output);
+
+/** @brief Free matrix and plans, the audio thread has to be done with the router. */
+void sndx_router_close(sndx_router_t* r);
+
+/** @brief Gain from capture channel `capt` to playback channel `play`, 0 removes the crosspoint. */
+int sndx_router_set(sndx_router_t* r, u32 capt, u32 play, f32 gain);
+
+/** @brief Every crosspoint to 0. */
+void sndx_router_clear(sndx_router_t* r);
+
+/** @brief What `sndx_duplex_copy_capt_to_play` does: capture k (modulo capture channels) to playback k. */
+void sndx_router_preset_copy(sndx_router_t* r, f32 gain);
+
+/** @brief Compile the matrix and publish it to the audio thread. */
+int sndx_router_commit(sndx_router_t* r);
+
+/** @brief Free the plan the audio thread handed back, if any. */
+void sndx_router_collect(sndx_router_t* r);
+
+/** @brief Mix `buf_capt` into `buf_play` on the first `len` frames, RT safe.
+ *
+ *  Same shape as `sndx_duplex_copy_capt_to_play`, silence until the first commit is picked up.
+ */
+void sndx_router_process(sndx_router_t* r, sndx_buffer_t* buf_capt, sndx_buffer_t* buf_play, sframes_t len);
+
+/** @brief Dump the crosspoints of the last committed plan to output. */
+void sndx_router_dump(sndx_router_t* r, output_t* output);
@@ -0,0 +1,156 @@
+/** @file sim.h
+ *  @brief Simulated loopback pair of PCM handles, no hardware needed.
+ *
+ *  Both handles are alsa-lib ioplug PCMs created in process, so everything taking a
+ *  `snd_pcm_t*` works on them unchanged (@see sndx_duplex_open_pcm):
+ *  hw/sw params, mmap (emulated by ioplug), readi/writei, poll, status, delay.
+ *
+ *  Clock:
+ *      - Each stream has its own timerfd, ticking once per period from start
+ *      - The hw pointer moves by a whole period per tick, like period interrupts
+ *      - `drift_ppm` scales the tick interval, so the two streams slowly drift apart
+ *      - `jitter_usecs` wakes poll late by up to that much (uniform), the hw pointer stays on time
+ *
+ *  Xruns:
+ *      - Natural: playback drained (hw pointer reaches appl), capture a buffer behind
+ *      - Injected: every `xrun_every` ticks after start, the pointer reports -EPIPE once
+ *
+ *  Faults: a schedule per stream, each fault fires on a given wakeup of poll, counted from open
+ *  so that restarts do not move it (@see sndx_sim_faults_parse for the script form):
+ *      - xrun    : stopped in xrun, poll reports POLLERR
+ *      - nval    : poll reports POLLNVAL once (disconnected descriptor), the clock keeps going
+ *      - stall   : clock and wakeups stop for `periods` of wall time, poll times out
+ *                  (survives prepare and start, like a device that stopped interrupting)
+ *      - suspend : suspended with the clock frozen, poll reports POLLERR, until resume or prepare
+ *
+ *  Data: the pair is a loopback cable, each capture frame is the playback frame playing at its
+ *  capture time (same channel, modulo playback channels), silence when nothing is playing.
+ *  Frames are matched by time on the drifted clocks, so drift repeats or drops a frame now
+ *  and then, as between two real devices.
+ *
+ *  Jitter and injection come from a seeded generator, so runs repeat exactly as far
+ *  as the schedule goes; only the wall clock of the host differs between runs.
+ *
+ *  The pair cannot be linked with `snd_pcm_link` (ioplug has no link), so duplex
+ *  runs it unlinked, with the drift stage on playback.
+ */
+#pragma once
+
+#include "sndx/types.h"
+#include <alsa/pcm_external.h>
+
+/** @brief Fault classes of the schedule. */
+typedef enum sndx_sim_fault_kind_t
+{
+    SNDX_SIM_FAULT_XRUN = 0, ///< POLLERR, state XRUN
+    SNDX_SIM_FAULT_NVAL,     ///< POLLNVAL once
+    SNDX_SIM_FAULT_STALL,    ///< No wakeups and a frozen pointer for `periods`
+    SNDX_SIM_FAULT_SUSPEND,  ///< POLLERR, state SUSPENDED
+    SNDX_SIM_FAULT_LAST = SNDX_SIM_FAULT_SUSPEND,
+
+} sndx_sim_fault_kind_t;
+
+/** @brief One entry of a fault schedule. */
+typedef struct
+{
+    u64                   wakeup;  ///< Fires on this wakeup of the stream (1 is the first after open)
+    sndx_sim_fault_kind_t kind;    ///< What happens
+    u32                   periods; ///< Stall only: length in periods of the nominal clock
+
+} sndx_sim_fault_t;
+
+/** @brief Clock and fault settings of one direction. */
+typedef struct
+{
+    u32 channels;     ///< Audio channels offered by the device
+    f64 drift_ppm;    ///< Clock error against the nominal rate, positive runs fast
+    u32 jitter_usecs; ///< Poll wakeups late by up to this much
+    u32 xrun_every;   ///< Inject an xrun every this many periods, 0 for none
+
+    const sndx_sim_fault_t* faults;  ///< Schedule sorted by wakeup, not copied, has to outlive the pair
+    u32                     nfaults; ///< Entries in faults
+
+} sndx_sim_stream_config_t;
+
+/** @brief Settings of the pair. */
+typedef struct
+{
+    sndx_sim_stream_config_t play; ///< Playback direction
+    sndx_sim_stream_config_t capt; ///< Capture direction
+    u64                      seed; ///< For jitter, 0 picks a fixed default
+
+} sndx_sim_config_t;
+
+struct sndx_sim_t;
+
+/** @brief One simulated handle, `io` has to stay first (ioplug callbacks get `&io`). */
+typedef struct
+{
+    snd_pcm_ioplug_t         io;     ///< Plugin side of the handle, `io.pcm` is the handle
+    struct sndx_sim_t*       sim;    ///< Pair this stream belongs to
+    sndx_sim_stream_config_t config; ///< Clock and faults
+
+    int  timerfd; ///< Poll descriptor, expires on each tick (plus jitter)
+    bool running; ///< Between start and stop
+    bool closed;  ///< Handle closed by its owner
+
+    f64 tick_nsecs; ///< Period at the drifted rate
+    u64 start;      ///< Monotonic time of start
+    u64 tick_next;  ///< Tick the timer is armed for
+    u64 xrun_next;  ///< Tick of the next injected xrun
+    u64 hw;         ///< Frames since prepare, whole periods
+    u64 rng;        ///< Jitter generator state
+
+    u64 lost;        ///< Nanoseconds the clock stood still since start, stalls that ended
+    u64 stall_from;  ///< Monotonic time the current stall began
+    u64 stall_until; ///< Monotonic time the current stall ends, 0 for none, UINT64_MAX while suspended
+
+    u32 fault_next;  ///< Index of the next fault in `config.faults`
+    u64 fault_nsecs; ///< Monotonic time the last fault hit (stall: when the clock comes back)
+
+    u64 ticks;                           ///< Wakeups delivered
+    u64 injected;                        ///< Injected xruns
+    u64 xruns;                           ///< Natural xruns
+    u64 faults[SNDX_SIM_FAULT_LAST + 1]; ///< Scheduled faults fired, per kind
+
+} sndx_sim_stream_t;
+
+/** @brief Simulated pair, handles in `play.io.pcm` and `capt.io.pcm`. */
+typedef struct sndx_sim_t
+{
+    sndx_sim_stream_t play; ///< Playback handle
+    sndx_sim_stream_t capt; ///< Capture handle
+
+    char*     wire;        ///< Loopback, interleaved in playback format and channels
+    uframes_t wire_frames; ///< Frames in wire, a few buffers
+    format_t  format;      ///< Of wire, set on playback hw params
+    u32       channels;    ///< Of wire, set on playback hw params
+
+    output_t* out; ///< For dump
+
+} sndx_sim_t;
+
+/** @brief Create both handles, named "sndx_sim_play" and "sndx_sim_capt", still to be configured. */
+int sndx_sim_open(sndx_sim_t** simp, const sndx_sim_config_t* config, output_t* output);
+
+/** @brief Close handles not closed yet by their owner, free the pair.
+ *
+ *  Handles handed to `sndx_duplex_open_pcm` are closed by `sndx_duplex_close`,
+ *  so close the duplex first.
+ */
+void sndx_sim_close(sndx_sim_t* sim);
+
+/** @brief Dump clocks and fault counters to output. */
+void sndx_sim_dump(sndx_sim_t* sim, output_t* output);
+
+/** @brief Name of fault kind, as used in scripts. */
+const char* sndx_sim_fault_name(sndx_sim_fault_kind_t kind);
+
+/** @brief Parse a fault script into `faults`.
+ *
+ *  Script: entries `<kind>@<wakeup>[:<periods>]` separated by commas or spaces,
+ *  in increasing wakeup order, e.g. "xrun@100, nval@200, stall@300:8, suspend@400".
+ *
+ *  Returns the number of entries, -EINVAL on a malformed script, -ENOSPC past `capacity`.
+ */
+int sndx_sim_faults_parse(const char* script, sndx_sim_fault_t* faults, u32 capacity, output_t* output);
@@ -0,0 +1,68 @@
+/** @file status.h
+ *  @brief Per-cycle status snapshot of a handle, shared by everything in the cycle that asks for it.
+ *
+ *  Each `snd_pcm_status` (and `snd_pcm_delay`) is an ioctl. Within one cycle the avail, delay, state
+ *  and timestamps of a handle are asked for by several places (drift controller, latency probes,
+ *  dumps, xrun reports), so they are taken once and kept here:
+ *
+ *      1. avail : `sndx_status_set_avail` with what `snd_pcm_avail_update` returned at the start
+ *                 of the cycle (no ioctl on mmap'ed status), delay follows from it
+ *      2. full  : first `sndx_status_get` (or a delay asked before 1.) takes one `snd_pcm_status`
+ *      3. moved : reads and writes of the cycle keep avail and delay current without asking again
+ *      4. end   : `sndx_status_invalidate` when the cycle is done, the next one starts from 1.
+ *
+ *  Delay from avail alone is `avail` for capture and `buffer_size - avail` for playback, at the hw
+ *  position of the last period interrupt. Use `sndx_status_get` when the exact position matters.
+ *
+ *  Counters: `requests` served and `ioctls` issued, the difference is what the cache saves.
+ */
+#pragma once
+
+#include "sndx/types.h"
+
+/** @brief Snapshot of one handle, valid until invalidated. */
+typedef struct
+{
+    snd_pcm_t*       pcm;         ///< Handle, not owned
+    snd_pcm_stream_t stream;      ///< Direction of delay from avail and of moved frames
+    uframes_t        buffer_size; ///< For playback delay from avail
+    status_t*        status;      ///< Last full snapshot (allocated on init)
+    tstamp_config_t  config;      ///< Audio timestamp type asked for with each full snapshot
+
+    bool      has_avail; ///< Avail (and delay) are valid this cycle
+    bool      has_full;  ///< `status` is valid this cycle
+    sframes_t avail;     ///< At the snapshot, moved frames included
+    sframes_t delay;     ///< At the snapshot, moved frames included
+
+    u64 requests; ///< Values asked for
+    u64 ioctls;   ///< Of which needed a `snd_pcm_status`
+
+} sndx_status_t;
+
+/** @brief Bind to `pcm` and allocate the status (not RT safe), reads buffer size from hw params. */
+int sndx_status_init(sndx_status_t* s, snd_pcm_t* pcm, output_t* output);
+
+/** @brief Free the status. */
+void sndx_status_free(sndx_status_t* s);
+
+/** @brief Start of a cycle: avail from `snd_pcm_avail_update`, the full snapshot is dropped. */
+void sndx_status_set_avail(sndx_status_t* s, sframes_t avail);
+
+/** @brief Application moved `frames` (written for playback, read for capture) since the snapshot. */
+void sndx_status_moved(sndx_status_t* s, uframes_t frames);
+
+/** @brief End of a cycle (or a state change), the next request asks the device again. */
+void sndx_status_invalidate(sndx_status_t* s);
+
+/** @brief Full snapshot, one `snd_pcm_status` the first time in a cycle, RT safe.
+ *
+ *  Avail and delay of the returned status are those of the device, moved frames are in `s->avail`
+ *  and `s->delay`. Returns nullptr if the ioctl failed.
+ */
+const status_t* sndx_status_get(sndx_status_t* s);
+
+/** @brief Current delay, from the avail snapshot or the full one, asks the device only if neither. */
+int sndx_status_delay(sndx_status_t* s, sframes_t* delay);
+
+/** @brief Dump requests, ioctls and what was saved per cycle over `cycles` to output. */
+void sndx_status_dump(sndx_status_t* s, u64 cycles, output_t* output);
@@ -0,0 +1,46 @@
+/** @file sys.h
+ *  @brief Monotonic time and futex wrappers shared by the library threads, not part of the API.
+ *
+ *  Threads that sleep on a counter (recorder, player, meter, pool) wait on it with
+ *  `sndx_futex_wait` while it holds the value they read before checking for work.
+ *  Whoever makes work bumps it and wakes, `sndx_futex_post`, so a wait that starts late returns at once.
+ */
+#pragma once
+
+#include "sndx/types.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/** @brief CLOCK_MONOTONIC in nanoseconds. */
+static inline u64 sndx_nsecs()
+{
+    tspec_t t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ULL + (u64)t.tv_nsec;
+}
+
+/** @brief Relative timeout of `nsecs`. */
+static inline tspec_t sndx_tspec_from_nsecs(u64 nsecs)
+{
+    return (tspec_t){.tv_sec = (time_t)(nsecs / 1000000000ULL), .tv_nsec = (long)(nsecs % 1000000000ULL)};
+}
+
+/** @brief Sleep while `*addr` is `val`, until woken or `timeout` (nullptr for none) passed. */
+static inline void sndx_futex_wait(u32* addr, u32 val, const tspec_t* timeout)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, nullptr, 0);
+}
+
+/** @brief Wake up to `n` waiters on `addr`. */
+static inline void sndx_futex_wake(u32* addr, int n)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+/** @brief Bump `*addr` and wake one waiter, for a single sleeping thread. */
+static inline void sndx_futex_post(u32* addr)
+{
+    __atomic_add_fetch(addr, 1, __ATOMIC_RELEASE);
+    sndx_futex_wake(addr, 1);
+}
@@ -110,5 +110,8 @@ int sndx_hstats_enable( //
  * */
 int sndx_hstats_update(sndx_hstats_t* t, snd_pcm_t* handle, uframes_t frames_processed, output_t* output);
 
+/** @brief Same from a status already taken (@see status.h), no ioctl. */
+void sndx_hstats_from_status(sndx_hstats_t* t, const status_t* status, uframes_t frames_processed);
+
 /** @brief Print report of current snapshot and print difference in sys and snd time */
 void sndx_dump_hstats(sndx_hstats_t* t, int adjust_factor, output_t* output);
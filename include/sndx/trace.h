@@ -0,0 +1,116 @@
+/** @file trace.h
+ *  @brief Fixed size binary ring of per-cycle events, written from the realtime path.
+ *
+ *  Writer (audio thread) only stores numbers, there is no formatting and no locking.
+ *  Reader (any other thread) takes a snapshot of the last events and exports them
+ *  as Chrome trace JSON (open with `chrome://tracing` or https://ui.perfetto.dev).
+ *
+ *  Typical use:
+ *      1. `sndx_duplex_enable_trace` (or `sndx_trace_open` and assign `pfd->trace`)
+ *      2. RT path calls `sndx_trace_push` (already done in duplex, pollfds)
+ *      3. On xrun, `sndx_pollfds_xrun` calls `sndx_trace_request_dump`
+ *      4. Non-RT thread checks `sndx_trace_dump_pending` and calls `sndx_trace_write_chrome`
+ *
+ *  @see tools/dump_trace.c
+ */
+#pragma once
+
+#include "sndx/status.h"
+#include "sndx/types.h"
+
+/** @brief Default number of events (~40 bytes each), few seconds at 128 frames per period. */
+#define SNDX_TRACE_DEFAULT_CAPACITY 16384
+
+/** @brief What happened in the cycle. */
+typedef enum sndx_trace_type_t
+{
+    SNDX_TRACE_WAKEUP = 0, ///< Returned from poll
+    SNDX_TRACE_AVAIL,      ///< Queried avail, delay from the same snapshot
+    SNDX_TRACE_READ,       ///< Frames read from capture
+    SNDX_TRACE_WRITE,      ///< Frames written to playback
+    SNDX_TRACE_XRUN,       ///< Xrun detected, frames is delay of xrun in frames if known
+    SNDX_TRACE_START,      ///< Duplex started
+    SNDX_TRACE_STOP,       ///< Duplex stopped
+    SNDX_TRACE_TIMEOUT,    ///< Poll timed out
+    SNDX_TRACE_TYPE_LAST = SNDX_TRACE_TIMEOUT,
+
+} sndx_trace_type_t;
+
+/** @brief Which handle the event belongs to. */
+typedef enum sndx_trace_stream_t
+{
+    SNDX_TRACE_DUPLEX = 0, ///< Both or neither
+    SNDX_TRACE_PLAY,       ///< Playback handle
+    SNDX_TRACE_CAPT,       ///< Capture handle
+
+} sndx_trace_stream_t;
+
+/** @brief Single record, kept small and without pointers so it can be copied around freely. */
+typedef struct
+{
+    u64       nsecs;  ///< CLOCK_MONOTONIC in nanoseconds
+    u16       type;   ///< sndx_trace_type_t
+    u16       stream; ///< sndx_trace_stream_t
+    u32       cycle;  ///< Wakeup counter at the time of the event
+    sframes_t avail;  ///< Avail frames (0 if unknown)
+    sframes_t delay;  ///< Delay frames (0 if unknown)
+    uframes_t frames; ///< Frames processed (meaning depends on type)
+
+} sndx_trace_event_t;
+
+/** @brief Single writer, multiple reader ring of trace events.
+ *
+ *  Nothing is ever blocked: the writer overwrites the oldest events,
+ *  readers detect and discard records that were overwritten while copying.
+ */
+typedef struct
+{
+    sndx_trace_event_t* events;   ///< Backing array
+    u64                 capacity; ///< Power of two
+    u64                 write;    ///< Total events written (monotonic, masked on access)
+    u32                 cycle;    ///< Incremented on every SNDX_TRACE_WAKEUP
+    u32                 dumps;    ///< Pending dump requests (set on xrun or on demand)
+
+} sndx_trace_t;
+
+/** @brief Allocate trace ring, capacity is rounded up to a power of two. */
+int sndx_trace_open(sndx_trace_t** tp, u64 capacity, output_t* output);
+
+/** @brief Free trace ring. */
+void sndx_trace_close(sndx_trace_t* t);
+
+/** @brief Record an event. RT safe, does nothing if `t` is null. */
+void sndx_trace_push( //
+    sndx_trace_t*       t,
+    sndx_trace_type_t   type,
+    sndx_trace_stream_t stream,
+    sframes_t           avail,
+    sframes_t           delay,
+    uframes_t           frames);
+
+/** @brief Delay of `s` for a record, 0 if `t` or `s` is null or the device fails.
+ *
+ *  Served from the cycle's snapshot, the device is asked only while tracing and before the cycle has one.
+ */
+sframes_t sndx_trace_delay(sndx_trace_t* t, sndx_status_t* s);
+
+/** @brief Ask the reader to dump. RT and async-signal safe, does nothing if `t` is null. */
+void sndx_trace_request_dump(sndx_trace_t* t);
+
+/** @brief Consume pending dump requests. Returns true if there was at least one. */
+bool sndx_trace_dump_pending(sndx_trace_t* t);
+
+/** @brief Copy up to `max` of the latest events (oldest first) into `dst`. Returns number of valid events. */
+u64 sndx_trace_snapshot(sndx_trace_t* t, sndx_trace_event_t* dst, u64 max);
+
+/** @brief Name of event type, used for the JSON export. */
+const char* sndx_trace_type_name(sndx_trace_type_t type);
+
+/** @brief Write the events of the last `last_nsecs` (0 for everything) as Chrome trace JSON.
+ *
+ *  Allocates, so not to be called from the RT thread.
+ */
+int sndx_trace_write_chrome(sndx_trace_t* t, FILE* file, u64 last_nsecs, output_t* output);
+
+/** @brief Dump trace ring params to output. */
+void sndx_trace_dump(sndx_trace_t* t, output_t* output);
@@ -0,0 +1,96 @@
+/** @file tune.h
+ *  @brief Period size / periods auto-tuner, lowest latency that stays within an xrun budget.
+ *
+ *  Candidates are every combination of the given period sizes and periods, tried from the
+ *  smallest buffer up (fewer periods first for the same buffer). Each one opens a duplex,
+ *  runs silence through it for `seconds` and records:
+ *
+ *      xruns    : failed waits, reads and writes, each one recovered with `sndx_duplex_recover`
+ *      lateness : capture frames beyond one period at wakeup (from the avail snapshot of the cycle),
+ *                 in a log2 histogram of microseconds, as a share of the headroom (periods - 1)
+ *
+ *  A candidate is stable when its xrun rate per hour is within `max_xrun_rate`, the recommendation
+ *  is the first stable one. Runs stop there unless `sweep_all` asks for the whole table.
+ *
+ *  Devices are opened by name with `sndx_duplex_open`, or by `open` (simulated devices, a fixed
+ *  hw setup) which gets the candidate and has to return a duplex configured for it.
+ */
+#pragma once
+
+#include "sndx/duplex.h"
+
+/** @brief Lateness histogram: bin 0 on time, bin b in [2^(b-1), 2^b) us, the last one open ended. */
+#define SNDX_TUNE_HIST_BINS 16
+
+/** @brief Candidates tried at most. */
+#define SNDX_TUNE_MAX_CANDIDATES 64
+
+/** @brief Opener for devices that cannot be opened by name. */
+typedef int (*sndx_tune_open_t)( //
+    sndx_duplex_t** duplexp,
+    uframes_t       period_size,
+    u32             periods,
+    void*           data,
+    output_t*       output);
+
+/** @brief What to try and what counts as stable. */
+typedef struct
+{
+    const char* play;   ///< Playback device (unless `open`)
+    const char* capt;   ///< Capture device (unless `open`)
+    format_t    format; ///< Sample format
+    u32         rate;   ///< Rate (unless `open`)
+    access_t    access; ///< Access
+
+    const uframes_t* period_sizes;  ///< Candidates, nullptr for 16 to 1024 in powers of two
+    u32              nperiod_sizes; ///< Entries in period_sizes
+    const u32*       periods;       ///< Candidates, nullptr for 2, 3, 4
+    u32              nperiods;      ///< Entries in periods
+
+    f64  seconds;       ///< Run per candidate (10 if 0)
+    f64  max_xrun_rate; ///< Xruns per hour a stable candidate may have
+    int  priority;      ///< SCHED_FIFO priority while running, 0 to leave the policy alone
+    bool sweep_all;     ///< Run every candidate instead of stopping at the first stable one
+
+    sndx_tune_open_t open; ///< Optional opener
+    void*            data; ///< For `open`
+
+} sndx_tune_desc_t;
+
+/** @brief Outcome of one candidate. */
+typedef struct
+{
+    uframes_t period_size; ///< Candidate
+    u32       periods;     ///< Candidate
+    bool      ran;         ///< Opened and started
+    bool      stable;      ///< Within the xrun budget
+
+    f64 seconds;   ///< Wall time it ran
+    u64 cycles;    ///< Periods processed
+    u64 xruns;     ///< Failures recovered
+    f64 xrun_rate; ///< Per hour
+
+    u64 hist[SNDX_TUNE_HIST_BINS]; ///< Wakeup lateness
+    f64 late_max_us;               ///< Worst lateness
+    f64 late_p99_us;               ///< 99th percentile, upper edge of its bin
+    f64 headroom_us;               ///< (periods - 1) periods, lateness past it is an xrun
+
+} sndx_tune_result_t;
+
+/** @brief Sweep candidates, `results` gets one entry per candidate run (at most `capacity`).
+ *
+ *  Not RT itself, but runs the candidates on the calling thread (with `priority` if given).
+ *  Returns the index of the recommended result, -ENOENT if none is stable.
+ */
+int sndx_tune_run(                 //
+    const sndx_tune_desc_t* desc,
+    sndx_tune_result_t*     results,
+    u32                     capacity,
+    u32*                    nresults,
+    output_t*               output);
+
+/** @brief Latency of a result in frames (whole buffer). */
+uframes_t sndx_tune_latency(const sndx_tune_result_t* r);
+
+/** @brief Dump results as a table, marking `best` (negative for none). */
+void sndx_tune_dump(const sndx_tune_result_t* results, u32 nresults, int best, u32 rate, output_t* output);
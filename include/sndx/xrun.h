@@ -6,3 +6,68 @@
 #include "sndx/types.h" // IWYU pragma: keep
 
 int sndx_xrun_recovery_alsalib(snd_pcm_t* pcm, int err, output_t* output);
+
+/** @brief Strategies of `sndx_xrun_recovery_graded`, from cheapest to most expensive. */
+typedef enum sndx_xrun_strategy_t
+{
+    SNDX_XRUN_NONE = 0, ///< Within limits, nothing done
+    SNDX_XRUN_FORWARD,  ///< Capture about to overrun, oldest frames skipped with snd_pcm_forward, kept running
+    SNDX_XRUN_TOPUP,    ///< Playback about to underrun, topped up with silence, kept running
+    SNDX_XRUN_REWIND,   ///< Playback queued too much, trimmed with snd_pcm_rewind, kept running
+    SNDX_XRUN_RESUME,   ///< Suspended, resumed
+    SNDX_XRUN_PREPARE,  ///< Stopped in xrun, prepared (playback refilled) and started again
+    SNDX_XRUN_FAILED,   ///< Nothing worked, caller needs a full restart
+    SNDX_XRUN_STRATEGY_LAST = SNDX_XRUN_FAILED,
+
+} sndx_xrun_strategy_t;
+
+/** @brief Limits and report of graded recovery for a single handle. */
+typedef struct
+{
+    snd_pcm_stream_t stream;      ///< Playback or capture, decides soft strategies
+    access_t         access;      ///< Silence through mmap, or writei for RW interleaved
+    format_t         format;      ///< For silence
+    u32              channels;    ///< For silence
+    u32              rate;        ///< For converting xrun duration into frames
+    uframes_t        period_size; ///< Headroom below which soft recovery kicks in
+    uframes_t        buffer_size; ///< Ring size of the device
+
+    uframes_t target; ///< Capture: frames left unread after forward, Playback: frames queued after topup/rewind
+
+    sndx_xrun_strategy_t strategy;   ///< Strategy that fired in the last call
+    sframes_t            lost;       ///< Frames lost in the last call (skipped, silence inserted or rewound)
+    u64                  lost_total; ///< Sum of lost
+    u64                  count[SNDX_XRUN_STRATEGY_LAST + 1]; ///< How often each strategy fired
+
+} sndx_xrun_t;
+
+/** @brief Read limits from current hw params of pcm (not RT safe), default targets to one period of latency. */
+int sndx_xrun_init(sndx_xrun_t* x, snd_pcm_t* pcm, output_t* output);
+
+/** @brief Graded recovery, cheapest first, without dropping the stream if it is still running.
+ *
+ *  Call with `err` from the failing read/write/avail (-EPIPE, -ESTRPIPE),
+ *  or with 0 every cycle to catch an xrun before the stream stops.
+ *
+ *  Grades:
+ *      1. Running, capture has less than a period of headroom  -> forward to `target`
+ *      2. Running, playback has less than a period queued      -> silence up to `target`
+ *      3. Running, playback has a period more than `target`    -> rewind to `target`
+ *      4. Suspended                                            -> resume, else prepare as 5.
+ *      5. Stopped in xrun (or only prepared)                   -> prepare, refill playback, start
+ *
+ *  Silence goes through mmap, or `snd_pcm_writei` with RW interleaved access. With any other access
+ *  2. and the refill of 5. fail, and the caller falls back to a restart.
+ *
+ *  For linked handles, 5. prepares and starts the whole group, so only call it on playback.
+ *  Does not print, the result is in `x->strategy` and `x->lost`.
+ *
+ *  Returns the strategy that fired, or negative error (with `x->strategy = SNDX_XRUN_FAILED`).
+ */
+int sndx_xrun_recovery_graded(snd_pcm_t* pcm, int err, sndx_xrun_t* x);
+
+/** @brief Name of strategy. */
+const char* sndx_xrun_strategy_name(sndx_xrun_strategy_t strategy);
+
+/** @brief Dump counts per strategy and frames lost to output. */
+void sndx_xrun_dump(sndx_xrun_t* x, output_t* output);
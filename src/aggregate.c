@@ -0,0 +1,596 @@
+/** @file aggregate.c
+ *  @brief Several capture and playback handles driven as one device from a single thread.
+ */
+#include "sndx/aggregate.h"
+#include "sndx/params.h"
+
+void sndx_dump_aggregate(sndx_aggregate_t* a, output_t* output)
+{
+    a_title("aggregate:");
+    a_info("  devices    : %d", a->ndevs);
+    a_info("  master     : %s", a->devs[a->master].name);
+    a_info("  ch_capt    : %d", a->ch_capt);
+    a_info("  ch_play    : %d", a->ch_play);
+    a_info("  format     : %s", snd_pcm_format_name(a->format));
+    a_info("  rate       : %d", a->rate);
+    a_info("  period_size: %ld", a->period_size);
+    a_info("  nperiods   : %d", a->periods);
+    a_info("  nfds       : %d", a->nfds);
+
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        a_info("  %-8s %-16s channels %2d -> %2d..%-2d %s", //
+               dev->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback", dev->name, dev->channels,
+               dev->first, dev->first + dev->channels - 1, dev->linked ? "linked" : "drift");
+
+        if (dev->drift) sndx_drift_dump(dev->drift, output);
+        else a_info("    missed : %ld", dev->missed);
+    }
+}
+
+sndx_aggregate_dev_t* sndx_aggregate_channel(sndx_aggregate_t* a, snd_pcm_stream_t stream, u32 chn, u32* dev_chn)
+{
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        if (dev->stream != stream || chn < dev->first || chn >= dev->first + dev->channels) continue;
+
+        *dev_chn = chn - dev->first;
+        return dev;
+    }
+
+    return nullptr;
+}
+
+/** @brief Open a single device with the common params, channels may fall back to the device minimum. */
+static int aggregate_open_dev(sndx_aggregate_t* a, sndx_aggregate_dev_t* dev, const sndx_aggregate_desc_t* desc)
+{
+    int       err;
+    output_t* output = a->out;
+
+    dev->name   = desc->name;
+    dev->stream = desc->stream;
+
+    err = snd_pcm_open(&dev->pcm, desc->name, desc->stream, 0);
+    SndReturn_(err, "Failed: snd_pcm_open (%s): %s", desc->name);
+
+    u32       channels    = desc->channels;
+    format_t  format      = a->format;
+    u32       rate        = a->rate;
+    uframes_t period_size = a->period_size;
+    u32       periods     = a->periods;
+
+    err = sndx_set_params(               //
+        dev->pcm,                        //
+        &channels,                       //
+        &format,                         //
+        &rate,                           //
+        &period_size,                    //
+        &periods,                        //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        false,                           //
+        output);                         //
+    SndReturn_(err, "Failed: sndx_set_params (%s): %s", desc->name);
+
+    err = -!((format == a->format) && (rate == a->rate) && (periods == a->periods) &&
+             (period_size == a->period_size));
+    Return_(err, "Failed: params check (%s)", desc->name);
+
+    dev->channels = channels;
+
+    return 0;
+}
+
+/** @brief Linked devices convert straight into the unified buffer, so point their buf areas there. */
+static int aggregate_map_dev(sndx_aggregate_t* a, sndx_aggregate_dev_t* dev)
+{
+    int       err;
+    output_t* output = a->out;
+
+    float* unified = dev->stream == SND_PCM_STREAM_CAPTURE ? a->capt : a->play;
+
+    err = sndx_buffer_open(&dev->buf, a->format, dev->channels, a->period_size, output);
+    SndReturn_(err, "Failed: sndx_buffer_open: %s");
+
+    RANGE(chn, dev->channels)
+    {
+        dev->buf->buf[chn].addr  = unified;
+        dev->buf->buf[chn].first = (dev->first + chn) * a->period_size * sizeof(float) * 8;
+        dev->buf->buf[chn].step  = sizeof(float) * 8;
+    }
+
+    return 0;
+}
+
+int sndx_aggregate_open(                      //
+    sndx_aggregate_t**           aggp,        //
+    const sndx_aggregate_desc_t* desc,        //
+    u32                          ndevs,       //
+    u32                          master,      //
+    format_t                     format,      //
+    u32                          rate,        //
+    uframes_t                    period_size, //
+    u32                          periods,     //
+    output_t*                    output)
+{
+    int err;
+
+    RetVal_(master >= ndevs, -EINVAL, "Failed: master %d out of %d devices", master, ndevs);
+
+    sndx_aggregate_t* a;
+    a = calloc(1, sizeof(*a));
+    RetVal_(!a, -ENOMEM, "Failed calloc sndx_aggregate_t* a");
+
+    a->out         = output;
+    a->master      = master;
+    a->format      = format;
+    a->rate        = rate;
+    a->period_size = period_size;
+    a->periods     = periods;
+
+    a->devs = calloc(ndevs, sizeof(sndx_aggregate_dev_t));
+    err     = -(!a->devs);
+    Goto_(err, __close, "Failed calloc sndx_aggregate_dev_t* a->devs");
+
+    a->ndevs = ndevs;
+
+    // Open all, channels are appended to the map of their direction
+    RANGE(i, ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        err = aggregate_open_dev(a, dev, &desc[i]);
+        SndGoto_(err, __close, "Failed: aggregate_open_dev: %s");
+
+        u32* ch    = dev->stream == SND_PCM_STREAM_CAPTURE ? &a->ch_capt : &a->ch_play;
+        dev->first = *ch;
+        *ch       += dev->channels;
+
+        int count = snd_pcm_poll_descriptors_count(dev->pcm);
+        SndGoto_(count, __close, "Failed: snd_pcm_poll_descriptors_count: %s");
+
+        dev->pfd_first = a->nfds;
+        dev->nfds      = count;
+        a->nfds       += count;
+    }
+
+    a->capt = calloc(a->ch_capt * period_size, sizeof(float));
+    err     = -(!a->capt && a->ch_capt);
+    Goto_(err, __close, "Failed calloc float* a->capt");
+
+    a->play = calloc(a->ch_play * period_size, sizeof(float));
+    err     = -(!a->play && a->ch_play);
+    Goto_(err, __close, "Failed calloc float* a->play");
+
+    a->pfds = calloc(a->nfds, sizeof(struct pollfd));
+    err     = -(!a->pfds);
+    Goto_(err, __close, "Failed calloc struct pollfd* a->pfds");
+
+    uframes_t buffer_size = period_size * periods;
+
+    RANGE(i, ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        // Devices on other cards cannot be linked, they then run on their own clocks (@see drift.h)
+        if (i == master)
+        {
+            dev->linked = true;
+        }
+        else
+        {
+            err         = snd_pcm_link(a->devs[master].pcm, dev->pcm);
+            dev->linked = err == 0;
+        }
+
+        if (dev->linked)
+        {
+            err = aggregate_map_dev(a, dev);
+            SndGoto_(err, __close, "Failed: aggregate_map_dev: %s");
+        }
+        else
+        {
+            // Capture: a period queued on top of the period pulled per cycle
+            // Playback: right after a write, less half a period of wakeup jitter
+            f64 target = dev->stream == SND_PCM_STREAM_CAPTURE ? 2 * period_size : buffer_size - period_size / 2;
+
+            err = sndx_drift_open(&dev->drift, SNDX_SYNC_SAMPLERATE, format, dev->channels, rate, period_size,
+                                  target, output);
+            SndGoto_(err, __close, "Failed: sndx_drift_open: %s");
+        }
+
+        err = snd_pcm_poll_descriptors(dev->pcm, &a->pfds[dev->pfd_first], dev->nfds);
+        SndGoto_(err, __close, "Failed: snd_pcm_poll_descriptors: %s");
+
+        // Only the master wakes the loop, everyone else still reports POLLERR
+        if (i != master)
+        {
+            RANGE(j, dev->nfds) { a->pfds[dev->pfd_first + j].events = 0; }
+        }
+    }
+
+    a->poll_timeout = (int)(4 * buffer_size * 1000 / rate) + 1;
+
+    *aggp = a;
+
+    return 0;
+
+__close:
+    sndx_aggregate_close(a);
+    *aggp = nullptr;
+
+    return err;
+}
+
+int sndx_aggregate_close(sndx_aggregate_t* a)
+{
+    if (!a) return 0;
+
+    int       err;
+    output_t* output = a->out;
+
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        if (dev->pcm)
+        {
+            err = snd_pcm_close(dev->pcm);
+            SndCheck_(err, "Failed: snd_pcm_close (%s): %s", dev->name);
+        }
+
+        sndx_buffer_close(dev->buf);
+        sndx_drift_close(dev->drift);
+    }
+
+    Free(a->devs);
+    Free(a->capt);
+    Free(a->play);
+    Free(a->pfds);
+    Free(a);
+
+    return 0;
+}
+
+/** @brief Fill the whole playback buffer of a device with silence. */
+static int aggregate_fill_silence(sndx_aggregate_t* a, sndx_aggregate_dev_t* dev)
+{
+    int err;
+
+    uframes_t nleft = a->period_size * a->periods;
+
+    const area_t* areas;
+    uframes_t     offset = 0;
+    uframes_t     frames = 0;
+
+    while (nleft)
+    {
+        frames = nleft;
+
+        err = snd_pcm_mmap_begin(dev->pcm, &areas, &offset, &frames);
+        if (err < 0) return err;
+        if (!frames) return -EPIPE;
+
+        err = snd_pcm_areas_silence(areas, offset, dev->channels, frames, a->format);
+        if (err < 0) return err;
+
+        err = snd_pcm_mmap_commit(dev->pcm, offset, frames);
+        if (err < 0) return err;
+
+        nleft -= frames;
+    }
+
+    return 0;
+}
+
+/** @brief Prepare, fill and start, the master start also starts everything linked to it.
+ *
+ *  Prepare acts on the whole link group, so it goes once to the master and once to every
+ *  unlinked device, all before any playback is filled: a later prepare would drop the silence.
+ */
+static int aggregate_prepare_start(sndx_aggregate_t* a)
+{
+    int err;
+
+    err = snd_pcm_prepare(a->devs[a->master].pcm);
+    if (err < 0) return err;
+
+    RANGE(i, a->ndevs)
+    {
+        if (a->devs[i].linked) continue;
+
+        err = snd_pcm_prepare(a->devs[i].pcm);
+        if (err < 0) return err;
+    }
+
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        if (dev->stream == SND_PCM_STREAM_PLAYBACK)
+        {
+            err = aggregate_fill_silence(a, dev);
+            if (err < 0) return err;
+        }
+
+        if (dev->drift) sndx_drift_reset(dev->drift);
+    }
+
+    err = snd_pcm_start(a->devs[a->master].pcm);
+    if (err < 0) return err;
+
+    RANGE(i, a->ndevs)
+    {
+        if (a->devs[i].linked) continue;
+
+        err = snd_pcm_start(a->devs[i].pcm);
+        if (err < 0) return err;
+    }
+
+    return 0;
+}
+
+int sndx_aggregate_start(sndx_aggregate_t* a)
+{
+    int       err;
+    output_t* output = a->out;
+
+    err = aggregate_prepare_start(a);
+    SndReturn_(err, "Failed: aggregate_prepare_start: %s");
+
+    return 0;
+}
+
+/** @brief Drop the master group and every unlinked device. */
+static int aggregate_drop(sndx_aggregate_t* a)
+{
+    int err;
+
+    err = snd_pcm_drop(a->devs[a->master].pcm);
+    if (err < 0) return err;
+
+    RANGE(i, a->ndevs)
+    {
+        if (a->devs[i].linked) continue;
+
+        err = snd_pcm_drop(a->devs[i].pcm);
+        if (err < 0) return err;
+    }
+
+    return 0;
+}
+
+int sndx_aggregate_stop(sndx_aggregate_t* a)
+{
+    int       err;
+    output_t* output = a->out;
+
+    err = aggregate_drop(a);
+    SndReturn_(err, "Failed: aggregate_drop: %s");
+
+    return 0;
+}
+
+int sndx_aggregate_restart(sndx_aggregate_t* a)
+{
+    int err;
+
+    err = aggregate_drop(a);
+    if (err < 0) return err;
+
+    return aggregate_prepare_start(a);
+}
+
+int sndx_aggregate_wait(sndx_aggregate_t* a)
+{
+    int err;
+
+    snd_pcm_t* master = a->devs[a->master].pcm;
+
+    while (true)
+    {
+        err = poll(a->pfds, a->nfds, a->poll_timeout);
+        if (err < 0 && errno == EINTR) continue;
+        if (err < 0) return -errno;
+        if (err == 0) return -ETIMEDOUT;
+
+        // Slaves only have POLLERR, POLLHUP and POLLNVAL to report
+        RANGE(i, a->nfds)
+        {
+            if (a->pfds[i].events == 0 && a->pfds[i].revents) return -EPIPE;
+        }
+
+        sndx_aggregate_dev_t* dev = &a->devs[a->master];
+
+        unsigned short revents = 0;
+
+        err = snd_pcm_poll_descriptors_revents(master, &a->pfds[dev->pfd_first], dev->nfds, &revents);
+        if (err < 0) return err;
+        if (revents & (POLLERR | POLLNVAL)) return -EPIPE;
+        if (!(revents & (POLLIN | POLLOUT))) continue;
+
+        sframes_t avail = snd_pcm_avail_update(master);
+        if (avail < 0) return avail;
+        if ((uframes_t)avail >= a->period_size) return 0;
+    }
+}
+
+/** @brief Convert and copy up to `frames` from capture into `b` from `buf_offset`, returns frames read. */
+static sframes_t aggregate_read_buffer(snd_pcm_t* pcm, sndx_buffer_t* b, uframes_t frames, uframes_t buf_offset)
+{
+    int err;
+
+    uframes_t dev_offset = 0;
+    uframes_t contiguous = 0;
+    sframes_t nread      = 0;
+
+    const area_t* areas = b->dev;
+
+    while (frames)
+    {
+        contiguous = frames;
+
+        err = snd_pcm_mmap_begin(pcm, &areas, &dev_offset, &contiguous);
+        if (err < 0) return err;
+        if (!contiguous) break;
+
+        sndx_buffer_mmap_dev_areas(b, areas);
+        sndx_buffer_dev_to_buf_skew(b, contiguous, dev_offset, buf_offset);
+
+        err = snd_pcm_mmap_commit(pcm, dev_offset, contiguous);
+        if (err < 0) return err;
+
+        frames     -= contiguous;
+        buf_offset += contiguous;
+        nread      += contiguous;
+    }
+
+    return nread;
+}
+
+/** @brief Convert and copy `frames` of `b` from `buf_offset` to playback, returns frames written. */
+static sframes_t aggregate_write_buffer(snd_pcm_t* pcm, sndx_buffer_t* b, uframes_t frames, uframes_t buf_offset)
+{
+    int err;
+
+    uframes_t dev_offset = 0;
+    uframes_t contiguous = 0;
+    sframes_t nwritten   = 0;
+
+    const area_t* areas = b->dev;
+
+    while (frames)
+    {
+        contiguous = frames;
+
+        err = snd_pcm_mmap_begin(pcm, &areas, &dev_offset, &contiguous);
+        if (err < 0) return err;
+        if (!contiguous) break;
+
+        sndx_buffer_mmap_dev_areas(b, areas);
+        sndx_buffer_buf_to_dev_skew(b, contiguous, buf_offset, dev_offset);
+
+        err = snd_pcm_mmap_commit(pcm, dev_offset, contiguous);
+        if (err < 0) return err;
+
+        frames     -= contiguous;
+        buf_offset += contiguous;
+        nwritten   += contiguous;
+    }
+
+    return nwritten;
+}
+
+/** @brief Unlinked capture: queue whatever arrived, pull exactly a period at the master rate. */
+static int aggregate_read_drift(sndx_aggregate_t* a, sndx_aggregate_dev_t* dev, uframes_t avail)
+{
+    sndx_drift_t* dr   = dev->drift;
+    uframes_t     room = dr->in->frames - dr->in_frames;
+
+    sframes_t nread = aggregate_read_buffer(dev->pcm, dr->in, avail < room ? avail : room, dr->in_frames);
+    if (nread < 0) return nread;
+
+    dr->in_frames += nread;
+
+    // Whatever did not fit counts as fill too, the controller drains it
+    sndx_drift_update(dr, dr->in_frames + (avail - nread));
+
+    return sndx_drift_pull(dr, &a->capt[dev->first * a->period_size], a->period_size, a->period_size);
+}
+
+int sndx_aggregate_read(sndx_aggregate_t* a)
+{
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        if (dev->stream != SND_PCM_STREAM_CAPTURE) continue;
+
+        sframes_t avail = snd_pcm_avail_update(dev->pcm);
+        if (avail < 0) return avail;
+
+        if (!dev->linked)
+        {
+            int err = aggregate_read_drift(a, dev, avail);
+            if (err < 0) return err;
+            continue;
+        }
+
+        sframes_t nread = aggregate_read_buffer(dev->pcm, dev->buf, a->period_size, 0);
+        if (nread < 0) return nread;
+
+        // Same clock, so only late by a few frames, never fall behind the master
+        if ((uframes_t)nread < a->period_size)
+        {
+            RANGE(chn, dev->channels)
+            {
+                float* d = &a->capt[(dev->first + chn) * a->period_size];
+                memset(&d[nread], 0, (a->period_size - nread) * sizeof(float));
+            }
+            dev->missed += a->period_size - nread;
+        }
+    }
+
+    a->cycles++;
+
+    return 0;
+}
+
+/** @brief Unlinked playback: resample a period by the ratio, write, measure the fill level. */
+static int aggregate_write_drift(sndx_aggregate_t* a, sndx_aggregate_dev_t* dev)
+{
+    int err;
+
+    sndx_drift_t* dr = dev->drift;
+
+    sframes_t out = sndx_drift_process_planar(dr, &a->play[dev->first * a->period_size], a->period_size,
+                                              a->period_size);
+    if (out < 0) return out;
+
+    sframes_t nwritten = aggregate_write_buffer(dev->pcm, dr->buf, out, 0);
+    if (nwritten < 0) return nwritten;
+
+    // Playback full, the controller brings the fill level back down
+    dr->dropped += out - nwritten;
+
+    sframes_t delay = 0;
+
+    err = snd_pcm_delay(dev->pcm, &delay);
+    if (err < 0) return err;
+
+    sndx_drift_update(dr, delay);
+
+    return 0;
+}
+
+int sndx_aggregate_write(sndx_aggregate_t* a)
+{
+    int err;
+
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+
+        if (dev->stream != SND_PCM_STREAM_PLAYBACK) continue;
+
+        err = snd_pcm_avail_update(dev->pcm);
+        if (err < 0) return err;
+
+        if (!dev->linked)
+        {
+            err = aggregate_write_drift(a, dev);
+            if (err < 0) return err;
+            continue;
+        }
+
+        sframes_t nwritten = aggregate_write_buffer(dev->pcm, dev->buf, a->period_size, 0);
+        if (nwritten < 0) return nwritten;
+
+        dev->missed += a->period_size - nwritten;
+    }
+
+    return 0;
+}
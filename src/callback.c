@@ -22,3 +22,16 @@ void sndx_duplex_copy_capt_to_play( //
         RANGE(i, len) { buf_play->bufdata[i + (buf_size * chn)] = buf_capt->bufdata[i + (buf_size * chn)] * (*gain); }
     }
 }
+
+void sndx_graph_gain(const sndx_graph_step_t* step, uframes_t frames)
+{
+    float gain = *(const float*)step->data;
+
+    RANGE(chn, step->nout)
+    {
+        const float* in  = step->in[chn % step->nin];
+        float*       out = step->out[chn];
+
+        RANGE(i, (isize)frames) { out[i] = in[i] * gain; }
+    }
+}
@@ -0,0 +1,166 @@
+/** @file clock.c
+ *  @brief Audio clock vs system clock drift estimator, @see clock.h
+ */
+#include "sndx/clock.h"
+
+/** @brief Smoothing of the squared residual, weight of the newest one. */
+#define CLOCK_VAR_ALPHA 0.05
+
+void sndx_clock_init(sndx_clock_t* c, u32 rate, uframes_t period_size, f64 window)
+{
+    memset(c, 0, sizeof(*c));
+
+    // Effective number of snapshots in the window is 1 / (1 - lambda)
+    f64 n = window * (f64)rate / (f64)period_size;
+
+    c->lambda = n > 2.0 ? 1.0 - 1.0 / n : 0.5;
+    c->reject = SNDX_CLOCK_REJECT;
+    c->floor  = SNDX_CLOCK_FLOOR_NS * 1e-9;
+}
+
+/** @brief Owner's estimate out to readers. */
+static void clock_publish(sndx_clock_t* c)
+{
+    u32 seq = c->seq;
+
+    __atomic_store_n(&c->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    c->pub = c->est;
+
+    __atomic_store_n(&c->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/** @brief Forget the fit, keep the totals. */
+static void clock_start_over(sndx_clock_t* c)
+{
+    c->first = 0.0;
+    c->w     = 0.0;
+    c->mx    = 0.0;
+    c->my    = 0.0;
+    c->cxx   = 0.0;
+    c->cxy   = 0.0;
+    c->var   = 0.0;
+    c->run   = 0;
+
+    c->est.valid     = false;
+    c->est.ppm       = 0.0;
+    c->est.offset_us = 0.0;
+    c->est.jitter_us = 0.0;
+    c->est.span_s    = 0.0;
+    c->est.samples   = 0;
+}
+
+void sndx_clock_reset(sndx_clock_t* c)
+{
+    clock_start_over(c);
+    c->trigger = (htstamp_t){};
+
+    clock_publish(c);
+}
+
+bool sndx_clock_update_ns(sndx_clock_t* c, i64 sys_ns, i64 audio_ns)
+{
+    sndx_clock_estimate_t* est = &c->est;
+
+    if (!est->samples) c->first = (f64)sys_ns * 1e-9;
+
+    // Relative to the first snapshot, the fit is on the difference so drift is not lost next to 1
+    f64 x     = (f64)sys_ns * 1e-9 - c->first;
+    f64 y     = (f64)(audio_ns - sys_ns) * 1e-9;
+    f64 slope = c->cxx > 0.0 ? c->cxy / c->cxx : 0.0;
+    f64 r     = est->samples ? y - (c->my + slope * (x - c->mx)) : 0.0;
+
+    if (est->samples >= SNDX_CLOCK_WARMUP)
+    {
+        f64 limit = c->reject * sqrt(c->var);
+        if (limit < c->floor) limit = c->floor;
+
+        if (fabs(r) > limit)
+        {
+            est->rejected++;
+
+            if (++c->run < SNDX_CLOCK_RESET_RUN)
+            {
+                clock_publish(c);
+                return false;
+            }
+
+            // Not outliers but a step, this snapshot is the first of a new fit
+            est->resets++;
+            clock_start_over(c);
+
+            c->first = (f64)sys_ns * 1e-9;
+            x        = 0.0;
+            r        = 0.0;
+        }
+    }
+
+    c->run = 0;
+
+    if (est->samples >= 2) c->var += CLOCK_VAR_ALPHA * (r * r - c->var);
+
+    // Exponentially forgotten means and co-moments
+    c->w = c->lambda * c->w + 1.0;
+
+    f64 dx  = x - c->mx;
+    c->mx  += dx / c->w;
+    c->my  += (y - c->my) / c->w;
+    c->cxx  = c->lambda * c->cxx + dx * (x - c->mx);
+    c->cxy  = c->lambda * c->cxy + dx * (y - c->my);
+
+    slope = c->cxx > 0.0 ? c->cxy / c->cxx : 0.0;
+
+    est->samples++;
+    est->valid     = est->samples >= SNDX_CLOCK_WARMUP;
+    est->ppm       = slope * 1e6;
+    est->offset_us = (c->my - slope * (c->mx + c->first)) * 1e6;
+    est->jitter_us = sqrt(c->var) * 1e6;
+    est->span_s    = x;
+
+    clock_publish(c);
+
+    return true;
+}
+
+bool sndx_clock_update(sndx_clock_t* c, const sndx_hstats_t* t)
+{
+    if (!t->audio.tv_sec && !t->audio.tv_nsec) return false;
+
+    if (t->trigger.tv_sec != c->trigger.tv_sec || t->trigger.tv_nsec != c->trigger.tv_nsec)
+    {
+        if (c->est.samples) c->est.resets++;
+
+        clock_start_over(c);
+        c->trigger = t->trigger;
+    }
+
+    return sndx_clock_update_ns(c, htstamp_diff_nsecs(t->tstamp, t->trigger), htimestamp_nsecs(t->audio));
+}
+
+void sndx_clock_get(sndx_clock_t* c, sndx_clock_estimate_t* est)
+{
+    u32 seq;
+
+    do
+    {
+        seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+
+        *est = c->pub;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    } while ((seq & 1) || seq != __atomic_load_n(&c->seq, __ATOMIC_RELAXED));
+}
+
+void sndx_clock_dump(sndx_clock_t* c, const char* name, output_t* output)
+{
+    sndx_clock_estimate_t est;
+    sndx_clock_get(c, &est);
+
+    a_info("  %-8s clock: %+.3f ppm, offset %.1f us, jitter %.1f us over %.1f s "
+           "(%ld samples, %ld rejected, %ld resets)%s",
+           name, est.ppm, est.offset_us, est.jitter_us, est.span_s, est.samples, est.rejected, est.resets,
+           est.valid ? "" : " (warming up)");
+}
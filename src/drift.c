@@ -0,0 +1,471 @@
+/** @file drift.c
+ *  @brief Drift compensation for playback and capture running on independent clocks.
+ */
+#include "sndx/drift.h"
+#include <math.h>
+
+static const char* sync_type_names[] = {
+    [SNDX_SYNC_NONE]          = "none",       //
+    [SNDX_SYNC_SIMPLE]        = "simple",     //
+    [SNDX_SYNC_SAMPLERATE]    = "samplerate", //
+    [SNDX_SYNC_PLAYRATESHIFT] = "playshift",  //
+    [SNDX_SYNC_CAPTRATESHIFT] = "captshift",
+};
+
+const char* sndx_sync_type_name(sndx_sync_type_t sync)
+{
+    if (sync > SNDX_SYNC_LAST) return "unknown";
+    return sync_type_names[sync];
+}
+
+void sndx_pi_init(sndx_pi_t* pi, f64 kp, f64 ki, f64 max_ppm)
+{
+    pi->kp       = kp;
+    pi->ki       = ki;
+    pi->max      = max_ppm * 1e-6;
+    pi->integral = 0;
+}
+
+f64 sndx_pi_step(sndx_pi_t* pi, f64 error)
+{
+    pi->integral += error;
+
+    // Anti windup: integral term alone never exceeds the clamp
+    if (pi->ki > 0)
+    {
+        f64 limit    = pi->max / pi->ki;
+        pi->integral = pi->integral > limit ? limit : pi->integral < -limit ? -limit : pi->integral;
+    }
+
+    f64 out = pi->kp * error + pi->ki * pi->integral;
+    out     = out > pi->max ? pi->max : out < -pi->max ? -pi->max : out;
+
+    return 1.0 + out;
+}
+
+void sndx_drift_dump(sndx_drift_t* dr, output_t* output)
+{
+    a_info("Drift:");
+    a_info("  sync      : %s", sndx_sync_type_name(dr->sync));
+    a_info("  target    : %.1f frames", dr->target);
+    a_info("  fill      : %.1f frames", dr->fill);
+    a_info("  ratio     : %.9f (%+.2f ppm)", dr->ratio, (dr->ratio - 1.0) * 1e6);
+    a_info("  frames in : %ld", dr->frames_in);
+    a_info("  frames out: %ld", dr->frames_out);
+    a_info("  dropped   : %ld", dr->dropped);
+
+    if (dr->ctl) a_info("  rate shift: %ld (%ld writes)", dr->shift_value, dr->shift_writes);
+
+    if (dr->sync == SNDX_SYNC_SAMPLERATE) sndx_resampler_dump(dr->rs, output);
+}
+
+int sndx_drift_open(        //
+    sndx_drift_t**   driftp,
+    sndx_sync_type_t sync,
+    format_t         format,
+    u32              channels,
+    u32              rate,
+    uframes_t        period_size,
+    f64              target,
+    output_t*        output)
+{
+    int err;
+
+    sndx_drift_t* dr;
+    dr = calloc(1, sizeof(*dr));
+    RetVal_(!dr, -ENOMEM, "Failed calloc sndx_drift_t* dr");
+
+    dr->sync        = sync;
+    dr->channels    = channels;
+    dr->rate        = rate;
+    dr->period_size = period_size;
+    dr->target      = target;
+
+    dr->last = calloc(channels, sizeof(float));
+    err      = -(!dr->last);
+    Goto_(err, __close, "Failed calloc float* dr->last");
+
+    // At most period_size * (1 + max) + 1 frames out of a period
+    err = sndx_buffer_open(&dr->buf, format, channels, 2 * period_size, output);
+    SndGoto_(err, __close, "Failed: sndx_buffer_open: %s");
+
+    // Capture side may deliver up to a period early or late on top of a queued period
+    err = sndx_buffer_open(&dr->in, format, channels, 4 * period_size, output);
+    SndGoto_(err, __close, "Failed: sndx_buffer_open: %s");
+
+    dr->src = calloc(channels, sizeof(area_t));
+    err     = -(!dr->src);
+    Goto_(err, __close, "Failed calloc area_t* dr->src");
+
+    dr->dst = calloc(channels, sizeof(area_t));
+    err     = -(!dr->dst);
+    Goto_(err, __close, "Failed calloc area_t* dr->dst");
+
+    // Zero latency, like the loop had without compensation
+    err = sndx_resampler_open(&dr->rs, SNDX_RESAMPLER_LINEAR, channels, 1.0, 4 * period_size, output);
+    SndGoto_(err, __close, "Failed: sndx_resampler_open: %s");
+
+    sndx_pi_init(&dr->pi, SNDX_DRIFT_KP, SNDX_DRIFT_KI, SNDX_DRIFT_MAX_PPM);
+    sndx_drift_reset(dr);
+
+    *driftp = dr;
+
+    return 0;
+
+__close:
+    sndx_drift_close(dr);
+    *driftp = nullptr;
+
+    return err;
+}
+
+void sndx_drift_close(sndx_drift_t* dr)
+{
+    if (!dr) return;
+
+    sndx_drift_set_rate_shift(dr, nullptr, nullptr);
+
+    sndx_buffer_close(dr->buf);
+    sndx_buffer_close(dr->in);
+    sndx_resampler_close(dr->rs);
+    Free(dr->src);
+    Free(dr->dst);
+    Free(dr->last);
+    Free(dr);
+}
+
+/** @brief Write the rate shift element, only when the value changes (an ioctl each). */
+static void drift_shift_write(sndx_drift_t* dr, long value)
+{
+    value = value < dr->shift_min ? dr->shift_min : value > dr->shift_max ? dr->shift_max : value;
+    if (value == dr->shift_value) return;
+
+    snd_ctl_elem_value_set_integer(dr->shift, 0, value);
+    if (snd_ctl_elem_write(dr->ctl, dr->shift) < 0) return;
+
+    dr->shift_value = value;
+    dr->shift_writes++;
+}
+
+int sndx_drift_set_rate_shift(sndx_drift_t* dr, snd_pcm_t* pcm, output_t* output)
+{
+    int err;
+
+    if (dr->ctl)
+    {
+        drift_shift_write(dr, SNDX_DRIFT_RATE_SHIFT_UNITY);
+        snd_ctl_close(dr->ctl);
+        snd_ctl_elem_value_free(dr->shift);
+        dr->ctl   = nullptr;
+        dr->shift = nullptr;
+    }
+
+    if (!pcm) return 0;
+
+    snd_pcm_info_t*      info;
+    snd_ctl_elem_id_t*   id;
+    snd_ctl_elem_info_t* einfo;
+    snd_pcm_info_alloca(&info);
+    snd_ctl_elem_id_alloca(&id);
+    snd_ctl_elem_info_alloca(&einfo);
+
+    // Plugins and simulated devices have no card, so no control either
+    err = snd_pcm_info(pcm, info);
+    if (err < 0 || snd_pcm_info_get_card(info) < 0) return -ENOENT;
+
+    char name[16];
+    snprintf(name, sizeof(name), "hw:%d", snd_pcm_info_get_card(info));
+
+    snd_ctl_t* ctl;
+    err = snd_ctl_open(&ctl, name, SND_CTL_NONBLOCK);
+    SndReturn_(err, "Failed snd_ctl_open %s: %s", name);
+
+    snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_PCM);
+    snd_ctl_elem_id_set_name(id, SNDX_DRIFT_RATE_SHIFT_NAME);
+    snd_ctl_elem_id_set_device(id, snd_pcm_info_get_device(info));
+    snd_ctl_elem_id_set_subdevice(id, snd_pcm_info_get_subdevice(info));
+    snd_ctl_elem_info_set_id(einfo, id);
+
+    err = snd_ctl_elem_info(ctl, einfo);
+    if (err < 0)
+    {
+        snd_ctl_close(ctl);
+        return -ENOENT;
+    }
+
+    // Allocated once, the RT path only sets the value
+    err = snd_ctl_elem_value_malloc(&dr->shift);
+    if (err < 0) snd_ctl_close(ctl);
+    SndReturn_(err, "Failed snd_ctl_elem_value_malloc: %s");
+
+    snd_ctl_elem_value_set_id(dr->shift, id);
+
+    dr->ctl          = ctl;
+    dr->shift_min    = snd_ctl_elem_info_get_min(einfo);
+    dr->shift_max    = snd_ctl_elem_info_get_max(einfo);
+    dr->shift_value  = 0;
+    dr->shift_writes = 0;
+
+    drift_shift_write(dr, SNDX_DRIFT_RATE_SHIFT_UNITY);
+
+    return 0;
+}
+
+long sndx_drift_rate_shift(sndx_drift_t* dr)
+{
+    // Fill low (ratio > 1): playback slower or capture faster, fill high the other way round
+    f64 shift = dr->sync == SNDX_SYNC_PLAYRATESHIFT ? 1.0 / dr->ratio : dr->ratio;
+
+    return lround(shift * SNDX_DRIFT_RATE_SHIFT_UNITY);
+}
+
+void sndx_drift_reset(sndx_drift_t* dr)
+{
+    dr->pi.integral = 0;
+    dr->fill        = dr->target;
+    dr->ratio       = 1.0;
+    dr->acc         = 0;
+    dr->in_frames   = 0;
+
+    RANGE(chn, dr->channels) { dr->last[chn] = 0; }
+
+    sndx_resampler_set_ratio(dr->rs, 1.0);
+    sndx_resampler_reset(dr->rs);
+
+    if (dr->ctl) drift_shift_write(dr, SNDX_DRIFT_RATE_SHIFT_UNITY);
+}
+
+int sndx_drift_set_quality(sndx_drift_t* dr, sndx_resampler_quality_t quality, output_t* output)
+{
+    int err;
+
+    sndx_resampler_t* rs;
+    err = sndx_resampler_open(&rs, quality, dr->channels, 1.0, 4 * dr->period_size, output);
+    SndReturn_(err, "Failed: sndx_resampler_open: %s");
+
+    sndx_resampler_close(dr->rs);
+    dr->rs = rs;
+
+    sndx_drift_reset(dr);
+
+    return 0;
+}
+
+/** @brief Point planar areas at `data`, `stride` frames between channels. */
+static void drift_set_areas(area_t* areas, u32 channels, float* data, uframes_t stride)
+{
+    RANGE(chn, channels)
+    {
+        areas[chn].addr  = data;
+        areas[chn].first = chn * stride * sizeof(float) * 8;
+        areas[chn].step  = sizeof(float) * 8;
+    }
+}
+
+void sndx_drift_update(sndx_drift_t* dr, sframes_t fill)
+{
+    dr->fill  = dr->fill + SNDX_DRIFT_FILL_ALPHA * ((f64)fill - dr->fill);
+    dr->ratio = sndx_pi_step(&dr->pi, dr->target - dr->fill);
+
+    if (dr->ctl) drift_shift_write(dr, sndx_drift_rate_shift(dr));
+}
+
+/** @brief Copy and add/drop one frame at the end when a whole frame is owed. */
+static uframes_t drift_simple(sndx_drift_t* dr, const float* src, uframes_t src_stride, uframes_t frames)
+{
+    float* dst = dr->buf->bufdata;
+
+    uframes_t out = frames;
+
+    dr->acc += (dr->ratio - 1.0) * frames;
+    if (dr->acc >= 1.0 && frames)
+    {
+        out++;
+        dr->acc -= 1.0;
+    }
+    else if (dr->acc <= -1.0 && frames > 1)
+    {
+        out--;
+        dr->acc += 1.0;
+    }
+
+    RANGE(chn, dr->channels)
+    {
+        const float* s = &src[chn * src_stride];
+        float*       d = &dst[chn * dr->buf->frames];
+
+        uframes_t n = out < frames ? out : frames;
+        memcpy(d, s, n * sizeof(float));
+
+        // Repeat last frame
+        if (out > frames) d[frames] = s[frames - 1];
+    }
+
+    return out;
+}
+
+/** @brief Resample the block at the current ratio, all of it is consumed. */
+static sframes_t drift_samplerate(sndx_drift_t* dr, const float* src, uframes_t src_stride, uframes_t frames)
+{
+    int err;
+
+    uframes_t n = frames;
+    uframes_t m = dr->buf->frames;
+
+    drift_set_areas(dr->src, dr->channels, (float*)src, src_stride);
+
+    sndx_resampler_set_ratio(dr->rs, dr->ratio);
+
+    err = sndx_resampler_process(dr->rs, dr->src, 0, &n, dr->buf->buf, 0, &m);
+    if (err < 0) return err;
+
+    return (sframes_t)m;
+}
+
+sframes_t sndx_drift_process_planar(sndx_drift_t* dr, const float* src, uframes_t stride, uframes_t frames)
+{
+    sframes_t out = 0;
+
+    if (!frames) return 0;
+
+    switch (dr->sync)
+    {
+    case SNDX_SYNC_SIMPLE: out = (sframes_t)drift_simple(dr, src, stride, frames); break;
+    case SNDX_SYNC_SAMPLERATE:
+        out = drift_samplerate(dr, src, stride, frames);
+        if (out < 0) return out;
+        break;
+    default:
+        RANGE(chn, dr->channels)
+        {
+            memcpy(&dr->buf->bufdata[chn * dr->buf->frames], &src[chn * stride], frames * sizeof(float));
+        }
+        out = (sframes_t)frames;
+        break;
+    }
+
+    dr->frames_in  += frames;
+    dr->frames_out += out;
+
+    return out;
+}
+
+sframes_t sndx_drift_process(sndx_drift_t* dr, sndx_buffer_t* in, uframes_t offset, uframes_t frames)
+{
+    return sndx_drift_process_planar(dr, &in->bufdata[offset], in->frames, frames);
+}
+
+/** @brief SIMPLE: one frame more or less consumed whenever a whole frame is owed at `ratio`. */
+static uframes_t drift_pull_simple(sndx_drift_t* dr, float* dst, uframes_t stride, uframes_t frames, f64 ratio)
+{
+    float*    fifo  = dr->in->bufdata;
+    uframes_t cap   = dr->in->frames;
+    uframes_t avail = dr->in_frames;
+    uframes_t count = frames;
+
+    // Owe a frame: consume one less (repeat), ahead by a frame: consume one more (drop)
+    dr->acc += (ratio - 1.0) * frames;
+    if (dr->acc >= 1.0 && frames > 1)
+    {
+        count--;
+        dr->acc -= 1.0;
+    }
+    else if (dr->acc <= -1.0)
+    {
+        count++;
+        dr->acc += 1.0;
+    }
+
+    RANGE(chn, dr->channels)
+    {
+        const float* s = &fifo[chn * cap];
+        float*       d = &dst[chn * stride];
+
+        RANGE(j, frames)
+        {
+            isize i = j < (isize)count ? j : (isize)count - 1;
+            d[j]    = (uframes_t)i < avail ? s[i] : avail ? s[avail - 1] : dr->last[chn];
+        }
+    }
+
+    return count < avail ? count : avail;
+}
+
+/** @brief SAMPLERATE: the resampler stops after `frames` out, or short if the FIFO runs dry. */
+static sframes_t drift_pull_samplerate(sndx_drift_t* dr, float* dst, uframes_t stride, uframes_t frames)
+{
+    int err;
+
+    uframes_t n = dr->in_frames;
+    uframes_t m = frames;
+
+    drift_set_areas(dr->dst, dr->channels, dst, stride);
+
+    sndx_resampler_set_ratio(dr->rs, dr->ratio);
+
+    err = sndx_resampler_process(dr->rs, dr->in->buf, 0, &n, dr->dst, 0, &m);
+    if (err < 0) return err;
+
+    // Underrun: hold the last frame produced
+    RANGE(chn, dr->channels)
+    {
+        float* d = &dst[chn * stride];
+        float  h = m ? d[m - 1] : dr->last[chn];
+
+        RANGE(j, (isize)m, (isize)frames) { d[j] = h; }
+    }
+
+    dr->dropped += frames - m;
+
+    return (sframes_t)n;
+}
+
+int sndx_drift_pull(sndx_drift_t* dr, float* dst, uframes_t stride, uframes_t frames)
+{
+    float*    fifo     = dr->in->bufdata;
+    uframes_t cap      = dr->in->frames;
+    uframes_t avail    = dr->in_frames;
+    uframes_t consumed = 0;
+
+    // Nothing to produce, and no last frame to keep
+    if (!frames) return 0;
+
+    switch (dr->sync)
+    {
+    case SNDX_SYNC_SIMPLE: consumed = drift_pull_simple(dr, dst, stride, frames, dr->ratio); break;
+    case SNDX_SYNC_SAMPLERATE:
+    {
+        sframes_t n = drift_pull_samplerate(dr, dst, stride, frames);
+        if (n < 0) return (int)n;
+        consumed = (uframes_t)n;
+        break;
+    }
+    case SNDX_SYNC_PLAYRATESHIFT:
+    case SNDX_SYNC_CAPTRATESHIFT:
+        // The device clock moves instead, frames pass as they are and the ratio stays for the control
+        consumed = drift_pull_simple(dr, dst, stride, frames, 1.0);
+        break;
+    default:
+        dr->ratio = 1.0;
+        consumed  = drift_pull_simple(dr, dst, stride, frames, dr->ratio);
+        break;
+    }
+
+    if (dr->sync != SNDX_SYNC_SAMPLERATE && frames > avail) dr->dropped += frames - avail;
+
+    // Keep the rest queued at the front
+    RANGE(chn, dr->channels)
+    {
+        float* s = &fifo[chn * cap];
+        float* d = &dst[chn * stride];
+
+        dr->last[chn] = d[frames - 1];
+        memmove(s, &s[consumed], (avail - consumed) * sizeof(float));
+    }
+
+    dr->in_frames   = avail - consumed;
+    dr->frames_in  += consumed;
+    dr->frames_out += frames;
+
+    return 0;
+}
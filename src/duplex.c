@@ -4,6 +4,9 @@
 #include "sndx/types.h"
 #include <sched.h>
 
+/** @brief Capture clock is fed once per this many cycles, its full status is the only extra ioctl. */
+#define DUPLEX_CLOCK_CAPT_EVERY 8
+
 static sndx_params_t default_params = {
     .channels    = 2,
     .format      = SND_PCM_FORMAT_S16,
@@ -24,6 +27,7 @@ void sndx_dump_duplex(sndx_duplex_t* d, output_t* output)
     a_info("  buffer_size: %ld", d->period_size * d->periods);
     a_info("  nperiods   : %d", d->periods);
     a_info("  linked     : %d", d->linked);
+    if (d->drift) a_info("  sync       : %s", sndx_sync_type_name(d->drift->sync));
 
     a_title("Play:");
     snd_pcm_dump(d->play, d->out);
@@ -42,18 +46,26 @@ void sndx_dump_duplex_status(sndx_duplex_t* d, output_t* output)
 {
     int err;
 
-    snd_pcm_status_t* status;
-    snd_pcm_status_alloca(&status);
+    // Same snapshot as the rest of the cycle if called within one
+    const status_t* status;
 
     a_info("Capture status:");
-    err = snd_pcm_status(d->capt, status);
-    SndFatal(err, "Stream status error: %s");
-    snd_pcm_status_dump(status, output);
+    status = sndx_status_get(&d->st_capt);
+    err    = -(!status);
+    Fatal_(err, "Stream status error (capt)");
+    snd_pcm_status_dump((status_t*)status, output);
 
     a_info("Playback status:");
-    err = snd_pcm_status(d->play, status);
-    SndFatal(err, "Stream status error: %s");
-    snd_pcm_status_dump(status, output);
+    status = sndx_status_get(&d->st_play);
+    err    = -(!status);
+    Fatal_(err, "Stream status error (play)");
+    snd_pcm_status_dump((status_t*)status, output);
+
+    sndx_status_dump(&d->st_capt, d->cycles, output);
+    sndx_status_dump(&d->st_play, d->cycles, output);
+
+    sndx_clock_dump(&d->clk_capt, "capture", output);
+    sndx_clock_dump(&d->clk_play, "playback", output);
 }
 
 int sndx_duplex_open(                //
@@ -69,18 +81,50 @@ int sndx_duplex_open(                //
 {
     int err;
 
+    snd_pcm_t* play = nullptr;
+    snd_pcm_t* capt = nullptr;
+
+    err = snd_pcm_open(&play, playback_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+    SndGoto_(err, __close, "Failed: snd_pcm_open: %s");
+
+    err = snd_pcm_open(&capt, capture_device, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
+    SndGoto_(err, __close, "Failed: snd_pcm_open: %s");
+
+    return sndx_duplex_open_pcm(duplexp, play, capt, format, rate, period_size, periods, _access, output);
+
+__close:
+    if (play) snd_pcm_close(play);
+    *duplexp = nullptr;
+
+    return err;
+}
+
+int sndx_duplex_open_pcm(        //
+    sndx_duplex_t** duplexp,     //
+    snd_pcm_t*      play,        //
+    snd_pcm_t*      capt,        //
+    format_t        format,      //
+    u32             rate,        //
+    uframes_t       period_size, //
+    u32             periods,     //
+    access_t        _access,     //
+    output_t*       output)
+{
+    int err;
+
     sndx_duplex_t* d;
 
     d = calloc(1, sizeof(*d));
+    if (!d)
+    {
+        snd_pcm_close(play);
+        snd_pcm_close(capt);
+    }
     RetVal_(!d, -ENOMEM, "Failed calloc duplex_t* b");
 
-    d->out = output;
-
-    err = snd_pcm_open(&d->play, playback_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
-    SndGoto_(err, __close, "Failed: snd_pcm_open: %s");
-
-    err = snd_pcm_open(&d->capt, capture_device, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
-    SndGoto_(err, __close, "Failed: snd_pcm_open: %s");
+    d->out  = output;
+    d->play = play;
+    d->capt = capt;
 
     sndx_params_t play_params = default_params;
     sndx_params_t capt_params = default_params;
@@ -102,16 +146,16 @@ int sndx_duplex_open(                //
         d->out);                  //
     SndGoto_(err, __close, "Failed: sndx_set_params: %s");
 
-    err = !((rate == play_params.rate) &&       //
-            (periods == play_params.periods) && //
-            (period_size == play_params.period_size));
+    err = -!((rate == play_params.rate) &&       //
+             (periods == play_params.periods) && //
+             (period_size == play_params.period_size));
     Goto_(err, __close, "Failed: params check");
 
     err = snd_pcm_nonblock(d->play, 0);
-    SndReturn_(err, "Failed: snd_pcm_nonblock (play): %s");
+    SndGoto_(err, __close, "Failed: snd_pcm_nonblock (play): %s");
 
     err = snd_pcm_nonblock(d->capt, 0);
-    SndReturn_(err, "Failed: snd_pcm_nonblock (capt): %s");
+    SndGoto_(err, __close, "Failed: snd_pcm_nonblock (capt): %s");
 
     err = sndx_set_params(        //
         d->capt,                  //
@@ -125,13 +169,13 @@ int sndx_duplex_open(                //
         d->out);                  //
     SndGoto_(err, __close, "Failed: sndx_set_params: %s");
 
-    err = !((rate == capt_params.rate) &&       //
-            (periods == capt_params.periods) && //
-            (period_size == capt_params.period_size));
-    Return_(err, "Could not set params");
+    err = -!((rate == capt_params.rate) &&       //
+             (periods == capt_params.periods) && //
+             (period_size == capt_params.period_size));
+    Goto_(err, __close, "Could not set params");
 
-    err = play_params.format != capt_params.format;
-    Return_(err, "play_params.format != capt_params.format");
+    err = -(play_params.format != capt_params.format);
+    Goto_(err, __close, "play_params.format != capt_params.format");
 
     err = snd_pcm_nonblock(d->capt, SND_PCM_NONBLOCK);
     SndGoto_(err, __close, "Failed: snd_pcm_nonblock: %s");
@@ -145,10 +189,10 @@ int sndx_duplex_open(                //
     d->ch_play = play_params.channels;
     d->ch_capt = capt_params.channels;
 
-    err = snd_pcm_link(d->play, d->capt);
-    SndGoto_(err, __close, "Failed: snd_pcm_link: %s");
-
-    d->linked = true;
+    // Different cards cannot be linked, they then run on their own clocks (@see drift.h)
+    err       = snd_pcm_link(d->play, d->capt);
+    d->linked = err == 0;
+    if (!d->linked) a_info("Could not link (%s), running unlinked with drift compensation", snd_strerror(err));
 
     // Allocate buffers
     uframes_t buffer_size = period_size * periods;
@@ -166,6 +210,57 @@ int sndx_duplex_open(                //
     err = sndx_pollfds_open(&d->pfd, d->play, d->capt, d->rate, d->period_size, d->out);
     SndGoto_(err, __close, "Failed sndx_pollfds_open: %s");
 
+    if (!d->linked)
+    {
+        // Playback right after a write, plus what capture has not handed over yet
+        err = sndx_drift_open(&d->drift, SNDX_SYNC_SAMPLERATE, d->format, d->ch_play, d->rate, d->period_size,
+                              buffer_size - d->period_size / 2, output);
+        SndGoto_(err, __close, "Failed: sndx_drift_open: %s");
+
+        // Capture clock drives the loop
+        d->pfd->capture_only = true;
+    }
+
+    // Linked or not, both clocks are estimated against the system clock
+    err = sndx_hstats_enable(&d->hs_play, d->play, d->rate, SND_PCM_AUDIO_TSTAMP_TYPE_DEFAULT, true, output);
+    SndGoto_(err, __close, "Failed: sndx_hstats_enable (play): %s");
+
+    err = sndx_hstats_enable(&d->hs_capt, d->capt, d->rate, SND_PCM_AUDIO_TSTAMP_TYPE_DEFAULT, true, output);
+    SndGoto_(err, __close, "Failed: sndx_hstats_enable (capt): %s");
+
+    sndx_clock_init(&d->clk_play, d->rate, d->period_size, SNDX_CLOCK_WINDOW);
+    sndx_clock_init(&d->clk_capt, d->rate, d->period_size * DUPLEX_CLOCK_CAPT_EVERY, SNDX_CLOCK_WINDOW);
+
+    err = sndx_xrun_init(&d->xrun_play, d->play, output);
+    SndGoto_(err, __close, "Failed sndx_xrun_init (play): %s");
+
+    err = sndx_xrun_init(&d->xrun_capt, d->capt, output);
+    SndGoto_(err, __close, "Failed sndx_xrun_init (capt): %s");
+
+    err = sndx_status_init(&d->st_play, d->play, output);
+    SndGoto_(err, __close, "Failed sndx_status_init (play): %s");
+
+    err = sndx_status_init(&d->st_capt, d->capt, output);
+    SndGoto_(err, __close, "Failed sndx_status_init (capt): %s");
+
+    // Full snapshots carry the audio timestamps hstats asks for
+    d->st_play.config = d->hs_play.config;
+    d->st_capt.config = d->hs_capt.config;
+
+    d->pfd->st_play = &d->st_play;
+    d->pfd->st_capt = &d->st_capt;
+
+    // Restart must not allocate, so keep a buffer of silence around for writei
+    if (d->access == SND_PCM_ACCESS_RW_INTERLEAVED)
+    {
+        d->silence = malloc(snd_pcm_frames_to_bytes(d->play, buffer_size));
+        err        = -(!d->silence);
+        Goto_(err, __close, "Failed: malloc(silence)");
+
+        err = snd_pcm_format_set_silence(d->format, d->silence, buffer_size * d->ch_play);
+        SndGoto_(err, __close, "Failed: snd_pcm_format_set_silence: %s");
+    }
+
     *duplexp = d;
 
     return 0;
@@ -184,6 +279,11 @@ int sndx_duplex_close(sndx_duplex_t* d)
     int       err;
     output_t* output = d->out;
 
+    // Flush whatever the RT side queued while output is still valid
+    sndx_log_close(d->log);
+    d->log = nullptr;
+    if (d->pfd) d->pfd->log = nullptr;
+
     if (d->capt)
     {
         err = snd_pcm_close(d->capt);
@@ -197,9 +297,14 @@ int sndx_duplex_close(sndx_duplex_t* d)
     }
 
     sndx_pollfds_close(d->pfd);
+    sndx_trace_close(d->trace);
     sndx_buffer_close(d->buf_capt);
     sndx_buffer_close(d->buf_play);
+    sndx_drift_close(d->drift);
+    sndx_status_free(&d->st_play);
+    sndx_status_free(&d->st_capt);
 
+    Free(d->silence);
     Free(d->timer);
     Free(d);
 
@@ -208,18 +313,19 @@ int sndx_duplex_close(sndx_duplex_t* d)
 
 int sndx_duplex_write_rw_initial_silence(sndx_duplex_t* d)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     char* buf[4096];
 
     err = snd_pcm_format_set_silence(d->format, buf, d->period_size);
-    SndGoto_(err, __error, "Failed: snd_pcm_format_set_silence: %s");
+    SndGoto_rt(err, __error, "Failed: snd_pcm_format_set_silence: %s");
 
     RANGE(i, d->periods)
     {
         err = snd_pcm_writei(d->play, buf, d->period_size);
-        SndGoto_(err, __error, "Failed: snd_pcm_writei: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_writei: %s");
     }
 
     // a_info("Wrote silence: %ld frames (period_size=%ld, periods=%d)", //
@@ -228,19 +334,20 @@ int sndx_duplex_write_rw_initial_silence(sndx_duplex_t* d)
     return 0;
 
 __error:
-    sndx_dump_duplex_status(d, d->out);
+    if (!rtlog) sndx_dump_duplex_status(d, d->out);
     return err;
 }
 
 int sndx_duplex_write_mmap_initial_silence_direct(sndx_duplex_t* d)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     char* buf[4096];
 
     err = snd_pcm_format_set_silence(d->format, buf, d->period_size);
-    SndGoto_(err, __error, "Failed: snd_pcm_format_set_silence: %s");
+    SndGoto_rt(err, __error, "Failed: snd_pcm_format_set_silence: %s");
 
     sframes_t nleft    = d->period_size * d->periods;
     sframes_t nwritten = 0;
@@ -255,24 +362,25 @@ int sndx_duplex_write_mmap_initial_silence_direct(sndx_duplex_t* d)
         avail = avail > d->period_size ? d->period_size : avail;
 
         err = snd_pcm_mmap_writei(d->play, buf, avail);
-        SndGoto_(err, __error, "Failed: snd_pcm_mmap_begin: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_mmap_begin: %s");
 
         nleft    -= avail;
         nwritten += avail;
     }
-    a_info("Wrote silence: %ld frames (period_size=%ld, periods=%d)", nwritten, d->period_size, d->periods);
+    r_info("Wrote silence: %ld frames (period_size=%ld, periods=%d)", nwritten, d->period_size, d->periods);
 
     return 0;
 
 __error:
-    sndx_dump_duplex_status(d, d->out);
+    if (!rtlog) sndx_dump_duplex_status(d, d->out);
     return err;
 }
 
 int sndx_duplex_write_mmap_initial_silence(sndx_duplex_t* d)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     // Prepare the device area
     const area_t* areas;
@@ -285,7 +393,7 @@ int sndx_duplex_write_mmap_initial_silence(sndx_duplex_t* d)
     while (nleft)
     {
         err = snd_pcm_avail_update(d->play);
-        SndGoto_(err, __error, "Failed: snd_pcm_avail_update: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_avail_update: %s");
 
         // Restrict to nleft
         avail = err > nleft ? nleft : err;
@@ -294,45 +402,46 @@ int sndx_duplex_write_mmap_initial_silence(sndx_duplex_t* d)
         avail = avail > d->period_size ? d->period_size : avail;
 
         err = snd_pcm_mmap_begin(d->play, &areas, &offset, &avail);
-        SndGoto_(err, __error, "Failed: snd_pcm_mmap_begin: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_mmap_begin: %s");
 
         err = snd_pcm_areas_silence(areas, offset, d->ch_play, avail, d->format);
-        SndGoto_(err, __error, "Failed: snd_pcm_area_silence: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_area_silence: %s");
 
         err = snd_pcm_mmap_commit(d->play, offset, avail);
-        SndGoto_(err, __error, "Failed: snd_pcm_mmap_commit: %s");
+        SndGoto_rt(err, __error, "Failed: snd_pcm_mmap_commit: %s");
 
         nleft    -= avail;
         nwritten += avail;
     }
-    a_info("Wrote silence: %ld frames (period_size=%ld, periods=%d)", nwritten, d->period_size, d->periods);
+    r_info("Wrote silence: %ld frames (period_size=%ld, periods=%d)", nwritten, d->period_size, d->periods);
 
     return 0;
 
 __error:
-    sndx_dump_duplex_status(d, d->out);
+    if (!rtlog) sndx_dump_duplex_status(d, d->out);
     return err;
 }
 
 int sndx_duplex_start(sndx_duplex_t* d)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     switch (d->access)
     {
     case SND_PCM_ACCESS_MMAP_INTERLEAVED:
         err = sndx_duplex_write_mmap_initial_silence(d);
-        SndCheck_(err, "Failed sndx_duplex_write_mmap_initial_silence: %s");
+        SndCheck_rt(err, "Failed sndx_duplex_write_mmap_initial_silence: %s");
 
         // Apparently, we start manually only in this case
         err = snd_pcm_start(d->play);
-        SndReturn_(err, "Failed snd_pcm_start play: %s");
+        SndReturn_rt(err, "Failed snd_pcm_start play: %s");
 
         break;
     case SND_PCM_ACCESS_RW_INTERLEAVED:
         err = sndx_duplex_write_rw_initial_silence(d);
-        SndCheck_(err, "Failed sndx_duplex_write_rw_initial_silence: %s");
+        SndCheck_rt(err, "Failed sndx_duplex_write_rw_initial_silence: %s");
         break;
 
     default: RetVal(-1, -1, "Unknown access: %s", snd_pcm_access_name(d->access));
@@ -341,32 +450,211 @@ int sndx_duplex_start(sndx_duplex_t* d)
     if (!d->linked)
     {
         err = snd_pcm_start(d->capt);
-        SndCheck_(err, "Failed snd_pcm_start capt: %s");
+        SndCheck_rt(err, "Failed snd_pcm_start capt: %s");
     }
 
-    // RUNNING
-    sndx_dump_duplex_status(d, output);
+    if (d->drift) sndx_drift_reset(d->drift);
+
+    sndx_clock_reset(&d->clk_play);
+    sndx_clock_reset(&d->clk_capt);
+
+    sndx_trace_push(d->trace, SNDX_TRACE_START, SNDX_TRACE_DUPLEX, 0, sndx_trace_delay(d->trace, &d->st_play),
+                    d->period_size * d->periods);
+
+    // RUNNING, full status dump formats on this thread, so only the states when logging is deferred
+    if (rtlog)
+    {
+        r_info("Started: play %s, capt %s", snd_pcm_state_name(snd_pcm_state(d->play)),
+               snd_pcm_state_name(snd_pcm_state(d->capt)));
+    }
+    else
+    {
+        sndx_dump_duplex_status(d, output);
+    }
 
     // Start the timer (TODO: provide option to check if in xrun)
     sndx_timer_start(d->timer, d->rate, d->play, d->capt);
 
+    // Snapshots of the dump are from before the first cycle
+    sndx_status_invalidate(&d->st_play);
+    sndx_status_invalidate(&d->st_capt);
+
     return 0;
 }
 
+/** @brief Fill the whole playback buffer with silence, one chunk unless the mmap area wraps. */
+static int duplex_fill_silence(sndx_duplex_t* d)
+{
+    int err;
+
+    uframes_t nleft = d->period_size * d->periods;
+
+    if (d->access == SND_PCM_ACCESS_RW_INTERLEAVED)
+    {
+        err = snd_pcm_writei(d->play, d->silence, nleft);
+        return err < 0 ? err : 0;
+    }
+
+    const area_t* areas;
+    uframes_t     offset = 0;
+    uframes_t     frames = 0;
+
+    // Right after prepare the hw pointer is known, so no avail_update is needed
+    while (nleft)
+    {
+        frames = nleft;
+
+        err = snd_pcm_mmap_begin(d->play, &areas, &offset, &frames);
+        if (err < 0) return err;
+        if (!frames) return -EPIPE;
+
+        err = snd_pcm_areas_silence(areas, offset, d->ch_play, frames, d->format);
+        if (err < 0) return err;
+
+        err = snd_pcm_mmap_commit(d->play, offset, frames);
+        if (err < 0) return err;
+
+        nleft -= frames;
+    }
+
+    return 0;
+}
+
+int sndx_duplex_restart(sndx_duplex_t* d)
+{
+    int err;
+
+    tspec_t t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    err = snd_pcm_drop(d->play);
+    if (err < 0) return err;
+
+    if (!d->linked)
+    {
+        err = snd_pcm_drop(d->capt);
+        if (err < 0) return err;
+    }
+
+    // If linked, capture is prepared along with playback
+    err = snd_pcm_prepare(d->play);
+    if (err < 0) return err;
+
+    if (!d->linked)
+    {
+        err = snd_pcm_prepare(d->capt);
+        if (err < 0) return err;
+    }
+
+    err = duplex_fill_silence(d);
+    if (err < 0) return err;
+
+    // RW starts on its own once the buffer is full (start_threshold)
+    if (d->access == SND_PCM_ACCESS_MMAP_INTERLEAVED)
+    {
+        err = snd_pcm_start(d->play);
+        if (err < 0) return err;
+    }
+
+    if (!d->linked)
+    {
+        err = snd_pcm_start(d->capt);
+        if (err < 0) return err;
+    }
+
+    d->pfd->poll_last   = 0;
+    d->pfd->poll_next   = 0;
+    d->pfd->retry_count = 0;
+
+    sndx_status_invalidate(&d->st_play);
+    sndx_status_invalidate(&d->st_capt);
+
+    if (d->drift) sndx_drift_reset(d->drift);
+
+    sndx_clock_reset(&d->clk_play);
+    sndx_clock_reset(&d->clk_capt);
+
+    sndx_trace_push(d->trace, SNDX_TRACE_START, SNDX_TRACE_DUPLEX, 0, sndx_trace_delay(d->trace, &d->st_play),
+                    d->period_size * d->periods);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    u64 nsecs = (u64)((t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec));
+
+    d->restart_count++;
+    d->restart_nsecs_last   = nsecs;
+    d->restart_nsecs_total += nsecs;
+    if (nsecs > d->restart_nsecs_max) d->restart_nsecs_max = nsecs;
+
+    return 0;
+}
+
+int sndx_duplex_recover(sndx_duplex_t* d)
+{
+    int err;
+
+    err = sndx_xrun_recovery_graded(d->play, 0, &d->xrun_play);
+    if (err >= 0) err = sndx_xrun_recovery_graded(d->capt, 0, &d->xrun_capt);
+
+    if (err < 0)
+    {
+        err = sndx_duplex_restart(d);
+        return err < 0 ? err : 1;
+    }
+
+    // Recovered state, the snapshots of the cycle are stale
+    sndx_status_invalidate(&d->st_play);
+    sndx_status_invalidate(&d->st_capt);
+
+    if (d->xrun_play.strategy != SNDX_XRUN_NONE)
+        sndx_trace_push(d->trace, SNDX_TRACE_XRUN, SNDX_TRACE_PLAY, 0, sndx_trace_delay(d->trace, &d->st_play),
+                        d->xrun_play.lost);
+
+    if (d->xrun_capt.strategy != SNDX_XRUN_NONE)
+        sndx_trace_push(d->trace, SNDX_TRACE_XRUN, SNDX_TRACE_CAPT, 0, sndx_trace_delay(d->trace, &d->st_capt),
+                        d->xrun_capt.lost);
+
+    if (d->xrun_play.strategy == SNDX_XRUN_PREPARE || d->xrun_capt.strategy == SNDX_XRUN_PREPARE)
+    {
+        d->pfd->poll_last   = 0;
+        d->pfd->poll_next   = 0;
+        d->pfd->retry_count = 0;
+    }
+
+    return 0;
+}
+
+void sndx_duplex_dump_restart(sndx_duplex_t* d, output_t* output)
+{
+    a_info("Restart:");
+    a_info("  count: %ld", d->restart_count);
+    if (!d->restart_count) return;
+
+    a_info("  last : %.3f usecs", d->restart_nsecs_last / 1000.0);
+    a_info("  mean : %.3f usecs", d->restart_nsecs_total / 1000.0 / d->restart_count);
+    a_info("  max  : %.3f usecs", d->restart_nsecs_max / 1000.0);
+
+    sndx_xrun_dump(&d->xrun_play, output);
+    sndx_xrun_dump(&d->xrun_capt, output);
+}
+
 int sndx_duplex_stop(sndx_duplex_t* d)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     err = snd_pcm_drop(d->play);
-    SndCheck_(err, "Failed snd_pcm_drop play: %s");
+    SndCheck_rt(err, "Failed snd_pcm_drop play: %s");
 
     if (!d->linked)
     {
         err = snd_pcm_drop(d->capt);
-        SndCheck_(err, "Failed snd_pcm_drop capt: %s");
+        SndCheck_rt(err, "Failed snd_pcm_drop capt: %s");
     }
 
+    sndx_trace_push(d->trace, SNDX_TRACE_STOP, SNDX_TRACE_DUPLEX, 0, 0, 0);
+
     // Stop the timer (TODO: provide option to check if in xrun)
     sndx_timer_stop(d->timer, d->play, d->capt);
 
@@ -377,11 +665,12 @@ int sndx_duplex_stop(sndx_duplex_t* d)
 
 int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
 {
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     err = -(*frames > d->period_size);
-    Return_(err, "Failed: sndx_duplex_read: frames > period_size : %ld > %ld", *frames, d->period_size);
+    Return_rt(err, "Failed: sndx_duplex_read: frames > period_size : %ld > %ld", *frames, d->period_size);
 
     uframes_t dev_offset = 0;
     uframes_t dev_frames = *frames;
@@ -400,7 +689,7 @@ int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
 
         // Get address from alsa
         err = snd_pcm_mmap_begin(d->capt, &areas, &dev_offset, &contiguous);
-        SndReturn_(err, "Failed: snd_pcm_mmap_begin %s");
+        SndReturn_rt(err, "Failed: snd_pcm_mmap_begin %s");
 
         // Map to device areas
         sndx_buffer_mmap_dev_areas(d->buf_capt, areas);
@@ -411,7 +700,7 @@ int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
 
         // Commit to move to next batch
         err = snd_pcm_mmap_commit(d->capt, dev_offset, contiguous);
-        SndReturn_(err, "Failed: snd_pcm_mmap_commit %s");
+        SndReturn_rt(err, "Failed: snd_pcm_mmap_commit %s");
 
         dev_frames -= contiguous;
         buf_offset += contiguous;
@@ -420,57 +709,249 @@ int sndx_duplex_read(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
 
     *frames = nread;
 
+    sndx_status_moved(&d->st_capt, nread);
+    sndx_trace_push(d->trace, SNDX_TRACE_READ, SNDX_TRACE_CAPT, 0, sndx_trace_delay(d->trace, &d->st_capt), nread);
+
     err = -(nread != orig_nframes);
-    Return_(err, "Failed: sndx_duplex_read: nread != orig_nframes : %ld != %ld", nread, orig_nframes);
+    Return_rt(err, "Failed: sndx_duplex_read: nread != orig_nframes : %ld != %ld", nread, orig_nframes);
 
     return 0;
 }
 
-int sndx_duplex_write(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
+/** @brief Convert and copy `frames` of `b` from `buf_offset` to playback, returns frames written.
+ *
+ *  Stops early (short count) if playback has no room left.
+ */
+static sframes_t duplex_write_buffer(sndx_duplex_t* d, sndx_buffer_t* b, uframes_t frames, uframes_t buf_offset)
 {
-    int       err;
-    output_t* output = d->out;
-
-    err = *frames > d->period_size;
-    Return_(err, "Failed: sndx_duplex_write: nframes > period_size : %ld > %ld", *frames, d->period_size);
+    int err;
 
     uframes_t dev_offset = 0;
-    uframes_t dev_frames = *frames;
+    uframes_t contiguous = 0;
+    sframes_t nwritten   = 0;
 
-    uframes_t buf_offset = *offset;
-
-    uframes_t contiguous   = 0;
-    sframes_t nwritten     = 0;
-    sframes_t orig_nframes = *frames;
+    const area_t* areas = b->dev;
 
-    const area_t* areas = d->buf_play->dev;
-
-    while (dev_frames)
+    while (frames)
     {
-        contiguous = dev_frames;
+        contiguous = frames;
 
         // Get address from alsa
         err = snd_pcm_mmap_begin(d->play, &areas, &dev_offset, &contiguous);
-        SndReturn_(err, "Failed: snd_pcm_mmap_begin %s");
+        if (err < 0) return err;
+        if (!contiguous) break;
 
         // Map to device areas
-        sndx_buffer_mmap_dev_areas(d->buf_play, areas);
+        sndx_buffer_mmap_dev_areas(b, areas);
 
         // Copy from float buffer to device areas
-        sndx_buffer_buf_to_dev_skew(d->buf_play, contiguous, buf_offset, dev_offset);
+        sndx_buffer_buf_to_dev_skew(b, contiguous, buf_offset, dev_offset);
 
         // TODO: silence untouched - should be automatic with soft buffer
 
         // Commit to move to next batch
         err = snd_pcm_mmap_commit(d->play, dev_offset, contiguous);
-        SndReturn_(err, "Failed: snd_pcm_mmap_commit %s");
+        if (err < 0) return err;
 
-        dev_frames -= contiguous;
+        frames     -= contiguous;
+        buf_offset += contiguous;
         nwritten   += contiguous;
     }
 
+    return nwritten;
+}
+
+/** @brief After a write of `nwritten`: playback clock every cycle, capture clock every few, from the status cache. */
+static int duplex_clock_update(sndx_duplex_t* d, uframes_t nwritten)
+{
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
+
+    sndx_status_moved(&d->st_play, nwritten);
+
+    // Exact playback position right after the write, the one status ioctl of the cycle
+    const status_t* status = sndx_status_get(&d->st_play);
+    err                    = -(!status);
+    Return_rt(err, "Failed: sndx_status_get (play)");
+
+    sndx_hstats_from_status(&d->hs_play, status, nwritten);
+    sndx_clock_update(&d->clk_play, &d->hs_play);
+
+    // Capture clock only now and then, the exact delay of that cycle comes with it
+    if (d->cycles % DUPLEX_CLOCK_CAPT_EVERY == 0)
+    {
+        status = sndx_status_get(&d->st_capt);
+        err    = -(!status);
+        Return_rt(err, "Failed: sndx_status_get (capt)");
+
+        sndx_hstats_from_status(&d->hs_capt, status, 0);
+        sndx_clock_update(&d->clk_capt, &d->hs_capt);
+    }
+
+    return 0;
+}
+
+/** @brief Unlinked: measure fill level, drive controller, write resampled frames. */
+static int duplex_write_drift(sndx_duplex_t* d, uframes_t frames, uframes_t offset)
+{
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
+
+    sframes_t out = sndx_drift_process(d->drift, d->buf_play, offset, frames);
+    SndReturn_rt(out, "Failed: sndx_drift_process %s");
+
+    sframes_t nwritten = duplex_write_buffer(d, d->drift->buf, out, 0);
+    SndReturn_rt(nwritten, "Failed: duplex_write_buffer %s");
+
+    // Playback full, the controller brings the fill level back down
+    d->drift->dropped += out - nwritten;
+
+    err = duplex_clock_update(d, nwritten);
+    if (err < 0) return err;
+
+    sndx_trace_push(d->trace, SNDX_TRACE_WRITE, SNDX_TRACE_PLAY, 0, d->hs_play.delay, nwritten);
+
+    // Capture delay is what it had at wakeup minus what was read, no need to ask the device
+    err = sndx_status_delay(&d->st_capt, &d->hs_capt.delay);
+    Return_rt(err, "Failed: sndx_status_delay (capt)");
+
+    sndx_drift_update(d->drift, d->hs_play.delay + d->hs_capt.delay);
+
+    return 0;
+}
+
+/** @brief Cycle done, the next one asks the devices again. */
+static void duplex_cycle_done(sndx_duplex_t* d)
+{
+    sndx_status_invalidate(&d->st_play);
+    sndx_status_invalidate(&d->st_capt);
+    d->cycles++;
+}
+
+int sndx_duplex_write(sndx_duplex_t* d, uframes_t* frames, uframes_t* offset)
+{
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
+
+    err = *frames > d->period_size;
+    Return_rt(err, "Failed: sndx_duplex_write: nframes > period_size : %ld > %ld", *frames, d->period_size);
+
+    // Frames consumed from buf_play stay *frames, playback gets around *frames * ratio
+    if (d->drift)
+    {
+        err = duplex_write_drift(d, *frames, *offset);
+        duplex_cycle_done(d);
+        return err;
+    }
+
+    sframes_t orig_nframes = *frames;
+    sframes_t nwritten     = duplex_write_buffer(d, d->buf_play, *frames, *offset);
+
+    // Clocks from this cycle's status, before it is dropped
+    err = nwritten < 0 ? 0 : duplex_clock_update(d, nwritten);
+    duplex_cycle_done(d);
+    SndReturn_rt(nwritten, "Failed: duplex_write_buffer %s");
+    if (err < 0) return err;
+
+    sndx_trace_push(d->trace, SNDX_TRACE_WRITE, SNDX_TRACE_PLAY, 0, d->hs_play.delay, nwritten);
+
     err = -(nwritten != orig_nframes);
-    Return_(err, "Failed: sndx_duplex_write: nwritten != orig_nframes : %ld != %ld", nwritten, orig_nframes);
+    Return_rt(err, "Failed: sndx_duplex_write: nwritten != orig_nframes : %ld != %ld", nwritten, orig_nframes);
+
+    return 0;
+}
+
+sndx_pollfds_error_t sndx_duplex_passthrough(sndx_duplex_t* d, uframes_t* frames)
+{
+    int       err;
+    sframes_t avail = 0;
+
+    *frames = 0;
+
+    sndx_pollfds_error_t perr = sndx_pollfds_avail(d->pfd, d->play, d->capt, &avail, d->out);
+    if (perr != POLLFD_SUCCESS) return perr;
+
+    // Keep within a single period, the rest is picked up next cycle
+    uframes_t n      = avail > (sframes_t)d->period_size ? d->period_size : (uframes_t)avail;
+    uframes_t offset = 0;
+    if (!n) return POLLFD_SUCCESS;
+
+    err = sndx_duplex_read(d, &n, &offset);
+    if (err < 0) return POLLFD_NEEDS_RESTART;
+
+    RANGE(chn, d->ch_play)
+    {
+        memcpy(&d->buf_play->bufdata[chn * d->buf_play->frames + offset], &d->buf_capt->bufdata[offset],
+               n * sizeof(float));
+    }
+
+    err = sndx_duplex_write(d, &n, &offset);
+    if (err < 0) return POLLFD_NEEDS_RESTART;
+
+    *frames = n;
+
+    return POLLFD_SUCCESS;
+}
+
+int sndx_duplex_enable_trace(sndx_duplex_t* d, u64 capacity)
+{
+    int       err;
+    output_t* output = d->out;
+
+    if (d->trace) return 0;
+
+    err = sndx_trace_open(&d->trace, capacity, output);
+    SndReturn_(err, "Failed: sndx_trace_open: %s");
+
+    d->pfd->trace = d->trace;
+
+    return 0;
+}
+
+int sndx_duplex_set_sync(sndx_duplex_t* d, sndx_sync_type_t sync)
+{
+    int       err;
+    output_t* output = d->out;
+
+    err = -(!d->drift);
+    Return_(err, "Failed: sndx_duplex_set_sync: duplex is linked, nothing to sync");
+
+    // Rate shift needs the control of the shifted device, resampling works everywhere
+    snd_pcm_t* shifted = nullptr;
+    if (sync == SNDX_SYNC_PLAYRATESHIFT) shifted = d->play;
+    if (sync == SNDX_SYNC_CAPTRATESHIFT) shifted = d->capt;
+
+    err = sndx_drift_set_rate_shift(d->drift, shifted, output);
+    if (err == -ENOENT)
+    {
+        a_info("%s has no %s control, using samplerate sync", snd_pcm_name(shifted), SNDX_DRIFT_RATE_SHIFT_NAME);
+        sync = SNDX_SYNC_SAMPLERATE;
+    }
+    else
+    {
+        SndReturn_(err, "Failed: sndx_drift_set_rate_shift: %s");
+    }
+
+    d->drift->sync = sync;
+    sndx_drift_reset(d->drift);
+
+    return 0;
+}
+
+int sndx_duplex_enable_log(sndx_duplex_t* d, u64 capacity)
+{
+    int       err;
+    output_t* output = d->out;
+
+    if (d->log) return 0;
+
+    err = sndx_log_open(&d->log, capacity, output);
+    SndReturn_(err, "Failed: sndx_log_open: %s");
+
+    d->pfd->log = d->log;
 
     return 0;
 }
@@ -502,30 +983,42 @@ int sndx_duplex_set_schduler(output_t* output)
 int sndx_duplex_wait(sndx_duplex_t* d, uframes_t* avail)
 {
 
-    int       err;
-    output_t* output = d->out;
+    int         err;
+    output_t*   output = d->out;
+    sndx_log_t* rtlog  = d->log;
 
     // Wait -> TODO: error checking
     err = snd_pcm_wait(d->capt, 1000);
-    SndReturn_(err, "Failed: snd_pcm_wait (capt) (err=%d): %s ", err);
+    SndReturn_rt(err, "Failed: snd_pcm_wait (capt) (err=%d): %s ", err);
 
     // NOTE: No longer copying twice
     sframes_t capt_avail = snd_pcm_avail_update(d->capt);
-    SndReturn_(capt_avail, "Failed: snd_pcm_avail_update (capt) (capt_avail=%ld): %s ", capt_avail);
+    SndReturn_rt(capt_avail, "Failed: snd_pcm_avail_update (capt) (capt_avail=%ld): %s ", capt_avail);
 
     sframes_t play_avail = snd_pcm_avail_update(d->play);
-    SndReturn_(play_avail, "Failed: snd_pcm_avail_update (play): %s");
+    SndReturn_rt(play_avail, "Failed: snd_pcm_avail_update (play): %s");
+
+    sndx_status_set_avail(&d->st_capt, capt_avail);
+    sndx_status_set_avail(&d->st_play, play_avail);
+
+    sframes_t capt_delay = sndx_trace_delay(d->trace, &d->st_capt);
+    sframes_t play_delay = sndx_trace_delay(d->trace, &d->st_play);
+
+    sndx_trace_push(d->trace, SNDX_TRACE_AVAIL, SNDX_TRACE_CAPT, capt_avail, capt_delay, 0);
+    sndx_trace_push(d->trace, SNDX_TRACE_AVAIL, SNDX_TRACE_PLAY, play_avail, play_delay, 0);
 
-    err = -(play_avail < (i64)d->period_size);
-    Return_(err, "Failed: play_avail < d->period_size: %ld < %ld", play_avail, d->period_size);
+    // Unlinked playback runs on its own clock, the drift stage keeps it fed
+    err = -(d->linked && play_avail < (i64)d->period_size);
+    Return_rt(err, "Failed: play_avail < d->period_size: %ld < %ld", play_avail, d->period_size);
 
     err = -(capt_avail < (i64)d->period_size);
-    Return_(err, "Failed: capt_avail < d->period_size: %ld < %ld", capt_avail, d->period_size);
+    Return_rt(err, "Failed: capt_avail < d->period_size: %ld < %ld", capt_avail, d->period_size);
 
     sframes_t nframes = d->period_size;
 
     *avail = capt_avail < play_avail ? capt_avail : play_avail;
     *avail = nframes < play_avail ? nframes : play_avail;
+    if (!d->linked) *avail = nframes < capt_avail ? nframes : capt_avail;
 
     return 0;
 }
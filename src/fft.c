@@ -0,0 +1,157 @@
+/** @file fft.c
+ *  @brief Radix-2 complex FFT, @see fft.h
+ */
+#include "sndx/fft.h"
+
+u32 sndx_fft_size(usize len)
+{
+    u32 n = 1;
+    while (n < len) n <<= 1;
+
+    return n;
+}
+
+int sndx_fft_open(sndx_fft_t** fftp, u32 n, output_t* output)
+{
+    int err;
+
+    RetVal_(n < 2 || (n & (n - 1)), -EINVAL, "Failed: fft size %d is not a power of two", n);
+
+    sndx_fft_t* fft;
+    fft = calloc(1, sizeof(*fft));
+    RetVal_(!fft, -ENOMEM, "Failed calloc sndx_fft_t* fft");
+
+    fft->n = n;
+    while ((1u << fft->log2n) < n) fft->log2n++;
+
+    fft->rev = calloc(n, sizeof(u32));
+    err      = -(!fft->rev);
+    Goto_(err, __close, "Failed calloc u32* fft->rev");
+
+    fft->cos = calloc(n, sizeof(float));
+    err      = -(!fft->cos);
+    Goto_(err, __close, "Failed calloc float* fft->cos");
+
+    fft->sin = calloc(n, sizeof(float));
+    err      = -(!fft->sin);
+    Goto_(err, __close, "Failed calloc float* fft->sin");
+
+    RANGE(i, n)
+    {
+        u32 r = 0;
+        RANGE(b, fft->log2n) { r |= ((i >> b) & 1) << (fft->log2n - 1 - b); }
+        fft->rev[i] = r;
+    }
+
+    // Twiddles in double, a float recurrence would drift over large sizes
+    for (u32 half = 1; half < n; half <<= 1)
+    {
+        RANGE(k, half)
+        {
+            fft->cos[half - 1 + k] = (float)cos(M_PI * k / half);
+            fft->sin[half - 1 + k] = (float)sin(M_PI * k / half);
+        }
+    }
+
+    *fftp = fft;
+
+    return 0;
+
+__close:
+    sndx_fft_close(fft);
+    *fftp = nullptr;
+
+    return err;
+}
+
+void sndx_fft_close(sndx_fft_t* fft)
+{
+    if (!fft) return;
+
+    Free(fft->rev);
+    Free(fft->cos);
+    Free(fft->sin);
+    Free(fft);
+}
+
+/** @brief `half` butterflies between a and b, unit stride everywhere so it vectorises. */
+static void fft_butterflies( //
+    float* restrict       ar,
+    float* restrict       ai,
+    float* restrict       br,
+    float* restrict       bi,
+    const float* restrict wc,
+    const float* restrict ws,
+    u32                   half,
+    float                 sign)
+{
+    RANGE(k, half)
+    {
+        float wr = wc[k];
+        float wi = sign * ws[k];
+
+        float tr = br[k] * wr - bi[k] * wi;
+        float ti = br[k] * wi + bi[k] * wr;
+
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] = ar[k] + tr;
+        ai[k] = ai[k] + ti;
+    }
+}
+
+/** @brief Iterative decimation in time, `sign` -1 forward, +1 inverse (unscaled). */
+static void fft_transform(sndx_fft_t* fft, float* re, float* im, float sign)
+{
+    u32 n = fft->n;
+
+    RANGE(i, n)
+    {
+        u32 j = fft->rev[i];
+        if (j <= i) continue;
+
+        float t = re[i];
+        re[i]   = re[j];
+        re[j]   = t;
+
+        t     = im[i];
+        im[i] = im[j];
+        im[j] = t;
+    }
+
+    for (u32 half = 1; half < n; half <<= 1)
+    {
+        const float* wc = fft->cos + half - 1;
+        const float* ws = fft->sin + half - 1;
+
+        for (u32 start = 0; start < n; start += 2 * half)
+        {
+            fft_butterflies(re + start, im + start, re + start + half, im + start + half, wc, ws, half, sign);
+        }
+    }
+}
+
+void sndx_fft_forward(sndx_fft_t* fft, float* re, float* im) { fft_transform(fft, re, im, -1.0f); }
+
+void sndx_fft_inverse(sndx_fft_t* fft, float* re, float* im)
+{
+    fft_transform(fft, re, im, 1.0f);
+
+    float scale = 1.0f / (float)fft->n;
+    RANGE(i, fft->n)
+    {
+        re[i] *= scale;
+        im[i] *= scale;
+    }
+}
+
+void sndx_fft_real(sndx_fft_t* fft, const float* in, usize len, float* re, float* im)
+{
+    if (len > fft->n) len = fft->n;
+
+    memcpy(re, in, len * sizeof(float));
+    memset(re + len, 0, (fft->n - len) * sizeof(float));
+    memset(im, 0, fft->n * sizeof(float));
+
+    sndx_fft_forward(fft, re, im);
+}
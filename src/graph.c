@@ -0,0 +1,537 @@
+/** @file graph.c
+ *  @brief Static DSP graph, @see graph.h
+ */
+#include "sndx/graph.h"
+
+/** @brief Where a port reads from while compiling: a capture channel or a pool buffer. */
+typedef struct
+{
+    bool capt;  ///< Capture channel, else pool buffer
+    u32  index; ///< Channel or buffer
+
+} graph_source_t;
+
+static void graph_plan_free(sndx_graph_plan_t* p)
+{
+    if (!p) return;
+
+    Free(p->steps);
+    Free(p->levels);
+    Free(p->ins);
+    Free(p->outs);
+    Free(p->pool);
+    Free(p->play);
+    Free(p->binds);
+    Free(p);
+}
+
+int sndx_graph_open(sndx_graph_t** gp, u32 ch_capt, u32 ch_play, uframes_t max_frames, output_t* output)
+{
+    int err;
+
+    sndx_graph_t* g;
+    g = calloc(1, sizeof(*g));
+    RetVal_(!g, -ENOMEM, "Failed calloc sndx_graph_t* g");
+
+    g->ch_capt    = ch_capt;
+    g->ch_play    = ch_play;
+    g->max_frames = max_frames;
+    g->out        = output;
+
+    err = sndx_graph_add(g, "capture", nullptr, nullptr, 0, ch_capt);
+    Goto_(err, __close, "Failed sndx_graph_add (capture)");
+
+    err = sndx_graph_add(g, "playback", nullptr, nullptr, ch_play, 0);
+    Goto_(err, __close, "Failed sndx_graph_add (playback)");
+
+    *gp = g;
+
+    return 0;
+
+__close:
+    sndx_graph_close(g);
+    *gp = nullptr;
+
+    return err;
+}
+
+void sndx_graph_close(sndx_graph_t* g)
+{
+    if (!g) return;
+
+    graph_plan_free(g->next);
+    graph_plan_free(g->current);
+    graph_plan_free(g->retired);
+
+    Free(g->nodes);
+    Free(g->edges);
+    Free(g);
+}
+
+int sndx_graph_add(sndx_graph_t* g, const char* name, sndx_graph_process_t process, void* data, u32 nin, u32 nout)
+{
+    output_t* output = g->out;
+
+    if (g->nnodes == g->cnodes)
+    {
+        isize              cnodes = g->cnodes ? 2 * g->cnodes : 16;
+        sndx_graph_node_t* nodes  = realloc(g->nodes, cnodes * sizeof(sndx_graph_node_t));
+        RetVal_(!nodes, -ENOMEM, "Failed realloc sndx_graph_node_t* nodes");
+
+        g->nodes  = nodes;
+        g->cnodes = cnodes;
+    }
+
+    sndx_graph_node_t* n = &g->nodes[g->nnodes];
+
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    n->process = process;
+    n->data    = data;
+    n->nin     = nin;
+    n->nout    = nout;
+
+    return (int)g->nnodes++;
+}
+
+int sndx_graph_connect(sndx_graph_t* g, u32 src, u32 src_port, u32 dst, u32 dst_port)
+{
+    output_t* output = g->out;
+
+    RetVal_(src >= g->nnodes || dst >= g->nnodes, -EINVAL, "No such node: %d -> %d", src, dst);
+    RetVal_(src_port >= g->nodes[src].nout, -EINVAL, "%s has no output %d", g->nodes[src].name, src_port);
+    RetVal_(dst_port >= g->nodes[dst].nin, -EINVAL, "%s has no input %d", g->nodes[dst].name, dst_port);
+
+    RANGE(i, g->nedges)
+    {
+        sndx_graph_edge_t* e = &g->edges[i];
+        RetVal_(e->dst == dst && e->dst_port == dst_port, -EBUSY, "Input %d of %s already connected", dst_port,
+                g->nodes[dst].name);
+    }
+
+    if (g->nedges == g->cedges)
+    {
+        isize              cedges = g->cedges ? 2 * g->cedges : 32;
+        sndx_graph_edge_t* edges  = realloc(g->edges, cedges * sizeof(sndx_graph_edge_t));
+        RetVal_(!edges, -ENOMEM, "Failed realloc sndx_graph_edge_t* edges");
+
+        g->edges  = edges;
+        g->cedges = cedges;
+    }
+
+    g->edges[g->nedges++] = (sndx_graph_edge_t){.src = src, .src_port = src_port, .dst = dst, .dst_port = dst_port};
+
+    return 0;
+}
+
+void sndx_graph_reset(sndx_graph_t* g)
+{
+    g->nnodes = 2;
+    g->nedges = 0;
+}
+
+/** @brief Kahn's algorithm over the real nodes, then grouped by level (longest path from capture).
+ *
+ *  Nodes of one level do not depend on each other, so a pool may run them at the same time.
+ *  Within a level, order of addition. Returns the number of levels, -EINVAL on a cycle.
+ */
+static int graph_sort(sndx_graph_t* g, u32* order, u32* level)
+{
+    output_t* output = g->out;
+    isize     n      = g->nnodes;
+
+    u32* indegree = calloc(n, sizeof(u32));
+    RetVal_(!indegree, -ENOMEM, "Failed calloc u32* indegree");
+
+    // Edges from capture and into playback do not order anything
+    RANGE(i, g->nedges)
+    {
+        sndx_graph_edge_t* e = &g->edges[i];
+        if (e->src != SNDX_GRAPH_CAPTURE && e->dst != SNDX_GRAPH_PLAYBACK) indegree[e->dst]++;
+    }
+
+    u32 nsorted = 0;
+    u32 head    = 0;
+
+    RANGE(v, 2, n)
+    {
+        if (!indegree[v]) order[nsorted++] = v;
+    }
+
+    while (head < nsorted)
+    {
+        u32 v = order[head++];
+
+        RANGE(i, g->nedges)
+        {
+            sndx_graph_edge_t* e = &g->edges[i];
+            if (e->src != v || e->dst == SNDX_GRAPH_PLAYBACK) continue;
+            if (--indegree[e->dst] == 0) order[nsorted++] = e->dst;
+        }
+    }
+
+    if (nsorted != n - 2) Free(indegree);
+    RetVal_(nsorted != n - 2, -EINVAL, "Graph has a cycle, %d of %ld nodes ordered", nsorted, n - 2);
+
+    // Levels along the topological order
+    u32 nlevels = 0;
+
+    RANGE(v, n) { level[v] = 0; }
+    RANGE(i, nsorted)
+    {
+        u32 v = order[i];
+        if (level[v] + 1 > nlevels) nlevels = level[v] + 1;
+
+        RANGE(j, g->nedges)
+        {
+            sndx_graph_edge_t* e = &g->edges[j];
+            if (e->src != v || e->dst == SNDX_GRAPH_PLAYBACK) continue;
+            if (level[e->dst] < level[v] + 1) level[e->dst] = level[v] + 1;
+        }
+    }
+
+    // Stable by level, indegree is free again
+    u32* sorted = indegree;
+    u32  k      = 0;
+
+    RANGE(l, nlevels)
+    RANGE(v, 2, n)
+    {
+        if (level[v] == (u32)l) sorted[k++] = v;
+    }
+
+    memcpy(order, sorted, nsorted * sizeof(u32));
+    Free(indegree);
+
+    level[SNDX_GRAPH_CAPTURE]  = 0;
+    level[SNDX_GRAPH_PLAYBACK] = nlevels;
+
+    return (int)nlevels;
+}
+
+/** @brief Order, liveness and buffer assignment, everything the audio thread needs in one plan. */
+static int graph_compile(sndx_graph_t* g, sndx_graph_plan_t** planp)
+{
+    int       err;
+    output_t* output = g->out;
+
+    isize n      = g->nnodes;
+    u32   nsteps = (u32)(n - 2);
+
+    sndx_graph_plan_t* p = calloc(1, sizeof(*p));
+    RetVal_(!p, -ENOMEM, "Failed calloc sndx_graph_plan_t* p");
+
+    // Flat port numbering: first input and first output of each node
+    u32* in_base  = calloc(n + 1, sizeof(u32));
+    u32* out_base = calloc(n + 1, sizeof(u32));
+    u32* order    = calloc(n, sizeof(u32));
+    u32* level    = calloc(n, sizeof(u32));
+
+    i32*            feed   = nullptr; ///< Per input: feeding edge
+    u32*            last   = nullptr; ///< Per output: level after which it is dead (nlevels: read by playback)
+    graph_source_t* source = nullptr; ///< Per output: capture channel or buffer
+    u32*            stack  = nullptr; ///< Free buffers
+
+    err = -(!in_base || !out_base || !order || !level);
+    Goto_(err, __free, "Failed calloc compile tables");
+
+    RANGE(v, n)
+    {
+        in_base[v + 1]  = in_base[v] + g->nodes[v].nin;
+        out_base[v + 1] = out_base[v] + g->nodes[v].nout;
+    }
+
+    u32 nins  = in_base[n];
+    u32 nouts = out_base[n];
+
+    err = graph_sort(g, order, level);
+    if (err < 0) goto __free;
+
+    u32 nlevels = (u32)err;
+
+    feed   = malloc((nins + 1) * sizeof(i32));
+    last   = calloc(nouts + 1, sizeof(u32));
+    source = calloc(nouts + 1, sizeof(graph_source_t));
+    stack  = malloc((nouts + 1) * sizeof(u32));
+
+    err = -(!feed || !last || !source || !stack);
+    Goto_(err, __free, "Failed alloc liveness tables");
+
+    RANGE(i, nins) { feed[i] = -1; }
+
+    // Outputs nobody reads die right after their own level
+    RANGE(v, 2, n)
+    RANGE(k, g->nodes[v].nout) { last[out_base[v] + k] = level[v]; }
+
+    RANGE(i, g->nedges)
+    {
+        sndx_graph_edge_t* e    = &g->edges[i];
+        u32                port = out_base[e->src] + e->src_port;
+
+        feed[in_base[e->dst] + e->dst_port] = (i32)i;
+        if (level[e->dst] > last[port]) last[port] = level[e->dst];
+    }
+
+    RANGE(k, g->ch_capt) { source[out_base[SNDX_GRAPH_CAPTURE] + k] = (graph_source_t){.capt = true, .index = k}; }
+
+    // Linear scan by level: outputs take free buffers, buffers return after the level of their last reader,
+    // so steps of one level never share a buffer and can run at the same time
+    u32 nfree    = 0;
+    u32 nbuffers = 1;
+
+    RANGE(l, nlevels)
+    {
+        RANGE(s, nsteps)
+        {
+            u32 v = order[s];
+            if (level[v] != (u32)l) continue;
+
+            RANGE(k, g->nodes[v].nout)
+            {
+                u32 b = nfree ? stack[--nfree] : nbuffers++;
+
+                source[out_base[v] + k] = (graph_source_t){.capt = false, .index = b};
+            }
+        }
+
+        // Inputs read for the last time in this level, and outputs nobody reads
+        RANGE(w, 2, n)
+        RANGE(k, g->nodes[w].nout)
+        {
+            u32 port = out_base[w] + k;
+            if (level[w] <= (u32)l && last[port] == (u32)l) stack[nfree++] = source[port].index;
+        }
+    }
+
+    // Plan
+    p->nsteps     = nsteps;
+    p->nlevels    = nlevels;
+    p->nbuffers   = nbuffers;
+    p->max_frames = g->max_frames;
+
+    p->steps  = calloc(nsteps ? nsteps : 1, sizeof(sndx_graph_step_t));
+    p->levels = calloc(nlevels + 1, sizeof(u32));
+    p->ins   = calloc(nins ? nins : 1, sizeof(const float*));
+    p->outs  = calloc(nouts ? nouts : 1, sizeof(float*));
+    p->play  = calloc(g->ch_play ? g->ch_play : 1, sizeof(const float*));
+    p->binds = calloc(nins ? nins : 1, sizeof(sndx_graph_bind_t));
+
+    usize bytes = (nbuffers * g->max_frames * sizeof(float) + 63) & ~(usize)63;
+    p->pool     = aligned_alloc(64, bytes);
+
+    err = -(!p->steps || !p->levels || !p->ins || !p->outs || !p->play || !p->binds || !p->pool);
+    Goto_(err, __free, "Failed alloc plan");
+
+    memset(p->pool, 0, bytes);
+
+    RANGE(s, nsteps)
+    {
+        u32                v    = order[s];
+        sndx_graph_node_t* node = &g->nodes[v];
+        sndx_graph_step_t* step = &p->steps[s];
+
+        step->process = node->process;
+        step->data    = node->data;
+        step->nin     = node->nin;
+        step->nout    = node->nout;
+        step->node    = v;
+        step->in      = &p->ins[in_base[v]];
+        step->out     = &p->outs[out_base[v]];
+
+        RANGE(k, node->nout) { step->out[k] = p->pool + source[out_base[v] + k].index * g->max_frames; }
+
+        p->levels[level[v] + 1] = (u32)s + 1;
+    }
+
+    // Inputs of steps, then playback channels, pointers into the pool or bound to capture
+    RANGE(v, SNDX_GRAPH_PLAYBACK, n)
+    RANGE(k, g->nodes[v].nin)
+    {
+        const float** slot = v == SNDX_GRAPH_PLAYBACK ? &p->play[k] : &p->ins[in_base[v] + k];
+        i32           e    = feed[in_base[v] + k];
+
+        if (e < 0)
+        {
+            *slot = v == SNDX_GRAPH_PLAYBACK ? nullptr : p->pool;
+            continue;
+        }
+
+        graph_source_t src = source[out_base[g->edges[e].src] + g->edges[e].src_port];
+
+        if (src.capt)
+            p->binds[p->nbinds++] = (sndx_graph_bind_t){.slot = slot, .chn = src.index};
+        else
+            *slot = p->pool + src.index * g->max_frames;
+    }
+
+    *planp = p;
+    p      = nullptr;
+
+__free:
+    Free(feed);
+    Free(last);
+    Free(source);
+    Free(stack);
+    Free(in_base);
+    Free(out_base);
+    Free(order);
+    Free(level);
+    graph_plan_free(p);
+
+    return err;
+}
+
+void sndx_graph_collect(sndx_graph_t* g)
+{
+    sndx_graph_plan_t* retired = __atomic_exchange_n(&g->retired, nullptr, __ATOMIC_ACQ_REL);
+    graph_plan_free(retired);
+}
+
+int sndx_graph_commit(sndx_graph_t* g)
+{
+    int err;
+
+    sndx_graph_plan_t* p;
+    err = graph_compile(g, &p);
+    if (err < 0) return err;
+
+    // A plan committed earlier and never picked up is ours again
+    sndx_graph_plan_t* stale = __atomic_exchange_n(&g->next, p, __ATOMIC_ACQ_REL);
+    graph_plan_free(stale);
+
+    g->committed = p;
+
+    sndx_graph_collect(g);
+
+    return 0;
+}
+
+void sndx_graph_set_pool(sndx_graph_t* g, sndx_pool_t* pool)
+{
+    __atomic_store_n(&g->pool, pool, __ATOMIC_RELEASE);
+}
+
+/** @brief Steps of one level, shared by the tasks of a pool run. */
+typedef struct
+{
+    sndx_graph_step_t* steps;  ///< First step of the level
+    uframes_t          frames; ///< Of this call
+
+} graph_level_t;
+
+static void graph_task(sndx_pool_t* pool [[maybe_unused]], u32 worker [[maybe_unused]], void* arg, u32 index)
+{
+    graph_level_t*     lvl  = arg;
+    sndx_graph_step_t* step = &lvl->steps[index];
+
+    step->process(step, lvl->frames);
+}
+
+/** @brief Point the capture bindings at `b`, only when it changed. */
+static void graph_bind(sndx_graph_plan_t* p, sndx_buffer_t* b)
+{
+    if (p->bound_data == b->bufdata && p->bound_frames == b->frames) return;
+
+    RANGE(i, p->nbinds)
+    {
+        sndx_graph_bind_t* bind = &p->binds[i];
+        *bind->slot             = b->bufdata + (bind->chn % b->channels) * b->frames;
+    }
+
+    p->bound_data   = b->bufdata;
+    p->bound_frames = b->frames;
+}
+
+void sndx_graph_process(sndx_graph_t* g, sndx_buffer_t* buf_capt, sndx_buffer_t* buf_play, sframes_t len)
+{
+    AssertMsg(len >= 0, "Received negative len: %ld", len);
+
+    // New plan only once the one replaced before was collected, the audio thread never frees
+    if (!__atomic_load_n(&g->retired, __ATOMIC_ACQUIRE))
+    {
+        sndx_graph_plan_t* next = __atomic_exchange_n(&g->next, nullptr, __ATOMIC_ACQ_REL);
+        if (next)
+        {
+            __atomic_store_n(&g->retired, g->current, __ATOMIC_RELEASE);
+            g->current = next;
+        }
+    }
+
+    sndx_graph_plan_t* p = g->current;
+    isize              n = buf_play->frames;
+
+    if (!p)
+    {
+        RANGE(chn, buf_play->channels) { memset(buf_play->bufdata + chn * n, 0, len * sizeof(float)); }
+        return;
+    }
+
+    AssertMsg((uframes_t)len <= p->max_frames, "len > max_frames: %ld > %ld", len, p->max_frames);
+
+    graph_bind(p, buf_capt);
+
+    sndx_pool_t* pool = __atomic_load_n(&g->pool, __ATOMIC_ACQUIRE);
+
+    RANGE(l, p->nlevels)
+    {
+        u32 first = p->levels[l];
+        u32 count = p->levels[l + 1] - first;
+
+        if (pool && count > 1)
+        {
+            graph_level_t lvl = {.steps = &p->steps[first], .frames = (uframes_t)len};
+            sndx_pool_run(pool, graph_task, &lvl, count);
+            continue;
+        }
+
+        RANGE(s, first, first + count)
+        {
+            sndx_graph_step_t* step = &p->steps[s];
+            step->process(step, (uframes_t)len);
+        }
+    }
+
+    RANGE(chn, buf_play->channels)
+    {
+        const float* src = (u32)chn < g->ch_play ? p->play[chn] : nullptr;
+
+        if (src)
+            memcpy(buf_play->bufdata + chn * n, src, len * sizeof(float));
+        else
+            memset(buf_play->bufdata + chn * n, 0, len * sizeof(float));
+    }
+}
+
+void sndx_graph_dump(sndx_graph_t* g, output_t* output)
+{
+    sndx_graph_plan_t* p = g->committed;
+
+    a_info("Graph: %ld nodes, %ld connections", g->nnodes - 2, g->nedges);
+    if (!p) return;
+
+    u32 nports = 0;
+    RANGE(s, p->nsteps) { nports += p->steps[s].nout; }
+
+    a_info("  buffers : %d for %d outputs (plus silence), %ld bytes", p->nbuffers - 1, nports,
+           p->nbuffers * p->max_frames * sizeof(float));
+    a_info("  levels  : %d, %s", p->nlevels, g->pool ? "parallel on the pool" : "serial");
+
+    u32 l = 0;
+
+    RANGE(s, p->nsteps)
+    {
+        sndx_graph_step_t* step = &p->steps[s];
+        while (p->levels[l + 1] <= (u32)s) l++;
+
+        char  line[256];
+        isize len = 0;
+
+        RANGE(k, step->nout)
+        {
+            isize b  = (step->out[k] - p->pool) / p->max_frames;
+            len     += snprintf(line + len, sizeof(line) - len, " %ld", b);
+            if (len >= (isize)sizeof(line)) break;
+        }
+
+        a_info("  %3ld L%-3d %-24s -> buffers%s", s, l, g->nodes[step->node].name, step->nout ? line : " none");
+    }
+}
@@ -0,0 +1,258 @@
+/** @file log.c
+ *  @brief RT safe logging: the audio thread only queues format + args, a background thread formats.
+ *
+ *  Queue is the bounded MPMC queue of Dmitry Vyukov, reduced to a single consumer.
+ */
+#include "sndx/log.h"
+
+void sndx_log_dump(sndx_log_t* log, output_t* output)
+{
+    a_info("Log:");
+    a_info("  capacity: %ld", log->capacity);
+    a_info("  pushed  : %ld", __atomic_load_n(&log->pushed, __ATOMIC_RELAXED));
+    a_info("  written : %ld", log->written);
+    a_info("  dropped : %ld", __atomic_load_n(&log->dropped, __ATOMIC_RELAXED));
+}
+
+static void* job_log(void* data)
+{
+    sndx_log_t* log = data;
+
+    while (__atomic_load_n(&log->running, __ATOMIC_ACQUIRE))
+    {
+        sndx_log_drain(log);
+        usleep(log->interval);
+    }
+
+    return nullptr;
+}
+
+int sndx_log_open(sndx_log_t** logp, u64 capacity, output_t* output)
+{
+    int err;
+
+    sndx_log_t* log;
+    log = calloc(1, sizeof(*log));
+    RetVal_(!log, -ENOMEM, "Failed calloc sndx_log_t* log");
+
+    log->output   = output;
+    log->interval = SNDX_LOG_INTERVAL_USECS;
+
+    // Round up to power of two for masking
+    log->capacity = 1;
+    while (log->capacity < capacity) log->capacity <<= 1;
+
+    log->records = calloc(log->capacity, sizeof(sndx_log_record_t));
+    err          = -(!log->records);
+    Goto_(err, __close, "Failed calloc sndx_log_record_t* log->records");
+
+    RANGE(i, log->capacity) { log->records[i].seq = i; }
+
+    log->running = true;
+
+    err = -pthread_create(&log->tid, nullptr, job_log, log);
+    if (err < 0) log->running = false;
+    Goto_(err, __close, "Failed: pthread_create: job_log: %s", strerror(-err));
+
+    *logp = log;
+
+    return 0;
+
+__close:
+    sndx_log_close(log);
+    *logp = nullptr;
+
+    return err;
+}
+
+void sndx_log_close(sndx_log_t* log)
+{
+    if (!log) return;
+
+    if (log->running)
+    {
+        __atomic_store_n(&log->running, false, __ATOMIC_RELEASE);
+        pthread_join(log->tid, nullptr);
+    }
+
+    // Whatever came in after the last drain
+    if (log->records) sndx_log_drain(log);
+
+    Free(log->records);
+    Free(log);
+}
+
+bool sndx_log_push(sndx_log_t* log, sndx_log_level_t level, const char* fmt, const sndx_log_arg_t* args, u32 nargs)
+{
+    if (!log) return false;
+
+    sndx_log_record_t* r;
+
+    u64 pos = __atomic_load_n(&log->head, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        r       = &log->records[pos & (log->capacity - 1)];
+        u64 seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+        i64 dif = (i64)seq - (i64)pos;
+
+        if (dif == 0)
+        {
+            // Slot is free, try to claim it
+            if (__atomic_compare_exchange_n(&log->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (dif < 0)
+        {
+            // Full: never wait on the realtime side
+            __atomic_add_fetch(&log->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&log->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    nargs = nargs > SNDX_LOG_MAX_ARGS ? SNDX_LOG_MAX_ARGS : nargs;
+
+    r->fmt   = fmt;
+    r->level = level;
+    r->nargs = nargs;
+    RANGE(i, nargs) { r->args[i] = args[i]; }
+
+    // Publish to consumer
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&log->pushed, 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+/** @brief Format a single conversion `spec` (e.g. "%-5ld") with arg into dst, returns chars written. */
+static int log_format_spec(char* dst, usize len, const char* spec, char conv, bool wide, sndx_log_arg_t arg)
+{
+    switch (conv)
+    {
+    case 'd':
+    case 'i': return wide ? snprintf(dst, len, spec, (long)arg.i) : snprintf(dst, len, spec, (int)arg.i);
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        return wide ? snprintf(dst, len, spec, (unsigned long)arg.i) : snprintf(dst, len, spec, (unsigned)arg.i);
+    case 'c': return snprintf(dst, len, spec, (int)arg.i);
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': return snprintf(dst, len, spec, arg.f);
+    case 's': return snprintf(dst, len, spec, arg.p ? (const char*)arg.p : "(null)");
+    case 'p': return snprintf(dst, len, spec, arg.p);
+    default: return 0;
+    }
+}
+
+/** @brief printf subset, with arguments taken from slots in order. */
+static void log_format(char* line, usize len, const sndx_log_record_t* r)
+{
+    const char* f    = r->fmt;
+    usize       pos  = 0;
+    u32         narg = 0;
+
+    while (*f && pos + 1 < len)
+    {
+        if (*f != '%')
+        {
+            line[pos++] = *f++;
+            continue;
+        }
+
+        if (f[1] == '%')
+        {
+            line[pos++]  = '%';
+            f           += 2;
+            continue;
+        }
+
+        // Copy spec up to and including conversion character
+        char  spec[32];
+        usize n    = 0;
+        bool  wide = false;
+        char  conv = 0;
+
+        spec[n++] = *f++;
+        while (*f && n < sizeof(spec) - 1)
+        {
+            char c    = *f++;
+            spec[n++] = c;
+            if (c == 'l' || c == 'z' || c == 'j' || c == 't') wide = true;
+            if (strchr("diouxXcsfFeEgGaAp", c))
+            {
+                conv = c;
+                break;
+            }
+        }
+        spec[n] = '\0';
+
+        if (!conv || narg >= r->nargs)
+        {
+            // Malformed or missing argument: print spec as is
+            int w = snprintf(&line[pos], len - pos, "%s", spec);
+            if (w > 0) pos = pos + w < len ? pos + w : len - 1;
+            continue;
+        }
+
+        // snprintf reports the untruncated length, so clamp
+        int w = log_format_spec(&line[pos], len - pos, spec, conv, wide, r->args[narg++]);
+        if (w > 0) pos = pos + w < len ? pos + w : len - 1;
+    }
+
+    pos       = pos < len ? pos : len - 1;
+    line[pos] = '\0';
+}
+
+u64 sndx_log_drain(sndx_log_t* log)
+{
+    output_t* output = log->output;
+
+    char line[SNDX_LOG_LINE_MAX];
+    u64  count = 0;
+
+    for (;;)
+    {
+        sndx_log_record_t* r   = &log->records[log->tail & (log->capacity - 1)];
+        u64                seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+
+        // Producer has not published this slot yet
+        if ((i64)seq - (i64)(log->tail + 1) < 0) break;
+
+        log_format(line, sizeof(line), r);
+        sndx_log_level_t level = r->level;
+
+        // Release slot for the next lap
+        __atomic_store_n(&r->seq, log->tail + log->capacity, __ATOMIC_RELEASE);
+        log->tail++;
+
+        switch (level)
+        {
+        case SNDX_LOG_ERROR: a_error("%s", line); break;
+        case SNDX_LOG_DEBUG: a_debug("%s", line); break;
+        default: a_info("%s", line); break;
+        }
+
+        count++;
+    }
+
+    u64 dropped = __atomic_load_n(&log->dropped, __ATOMIC_RELAXED);
+    if (dropped != log->dropped_reported)
+    {
+        a_error("Log: dropped %ld messages (total %ld)", dropped - log->dropped_reported, dropped);
+        log->dropped_reported = dropped;
+    }
+
+    log->written += count;
+
+    return count;
+}
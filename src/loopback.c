@@ -0,0 +1,499 @@
+/** @file loopback.c
+ *  @brief Loops grouped into threads, @see loopback.h
+ */
+#include "sndx/loopback.h"
+#include "sndx/sys.h"
+#include <sched.h>
+
+#define LOOPBACK_STALL_PERIODS 4 ///< A loop without a cycle for this long is restarted
+
+static u64 loopback_stall_nsecs(sndx_loopback_loop_t* loop)
+{
+    return LOOPBACK_STALL_PERIODS * loop->d->period_size * 1000000000ULL / loop->d->rate;
+}
+
+int sndx_loopback_open(sndx_loopback_t** lbp, int priority, output_t* output)
+{
+    sndx_loopback_t* lb;
+    lb = calloc(1, sizeof(*lb));
+    RetVal_(!lb, -ENOMEM, "Failed calloc sndx_loopback_t* lb");
+
+    lb->priority = priority;
+    lb->out      = output;
+
+    *lbp = lb;
+
+    return 0;
+}
+
+void sndx_loopback_close(sndx_loopback_t* lb)
+{
+    if (!lb) return;
+
+    sndx_loopback_stop(lb);
+
+    RANGE(i, lb->nloops)
+    {
+        sndx_router_close(lb->loops[i].router);
+        sndx_duplex_close(lb->loops[i].d);
+    }
+
+    Free(lb->loops);
+    Free(lb);
+}
+
+/** @brief Period size from the latency target when none is given, one buffer of latency. */
+static uframes_t loopback_period_size(const sndx_loopback_desc_t* desc, u32 periods)
+{
+    if (desc->period_size) return desc->period_size;
+    return desc->latency_req / periods;
+}
+
+/** @brief Take `d` in as the next loop: sync, latency target, router. */
+static int loopback_attach(sndx_loopback_t* lb, const sndx_loopback_desc_t* desc, sndx_duplex_t* d)
+{
+    int       err;
+    output_t* output = lb->out;
+
+    if (lb->nloops == lb->cloops)
+    {
+        u32                   cloops = lb->cloops ? 2 * lb->cloops : 8;
+        sndx_loopback_loop_t* loops  = realloc(lb->loops, cloops * sizeof(sndx_loopback_loop_t));
+        err                          = -(!loops);
+        Goto_(err, __close, "Failed realloc sndx_loopback_loop_t* loops");
+
+        lb->loops  = loops;
+        lb->cloops = cloops;
+    }
+
+    sndx_loopback_loop_t* loop = &lb->loops[lb->nloops];
+    memset(loop, 0, sizeof(*loop));
+
+    loop->d    = d;
+    loop->desc = *desc;
+
+    if (desc->id)
+        snprintf(loop->id, sizeof(loop->id), "%s", desc->id);
+    else
+        snprintf(loop->id, sizeof(loop->id), "loop%d", lb->nloops);
+
+    loop->desc.id   = nullptr;
+    loop->desc.play = nullptr;
+    loop->desc.capt = nullptr;
+
+    if (!d->linked)
+    {
+        err = sndx_duplex_set_sync(d, desc->sync);
+        Goto_(err, __close, "%s: failed sndx_duplex_set_sync", loop->id);
+
+        // Fill level the drift stage keeps is the latency, within what the buffer allows
+        if (desc->latency_req)
+        {
+            f64 lo = (f64)d->period_size;
+            f64 hi = (f64)(d->period_size * d->periods);
+            f64 l  = (f64)desc->latency_req;
+
+            d->drift->target = l < lo ? lo : l > hi ? hi : l;
+        }
+    }
+
+    err = sndx_router_open(&loop->router, d->ch_capt, d->ch_play, d->period_size, output);
+    SndGoto_(err, __close, "%s: failed sndx_router_open: %s", loop->id);
+
+    sndx_router_preset_copy(loop->router, 1.0f);
+
+    err = sndx_router_commit(loop->router);
+    Goto_(err, __close, "%s: failed sndx_router_commit", loop->id);
+
+    return (int)lb->nloops++;
+
+__close:
+    if (lb->nloops < lb->cloops) sndx_router_close(lb->loops[lb->nloops].router);
+    sndx_duplex_close(d);
+
+    return err;
+}
+
+int sndx_loopback_add(sndx_loopback_t* lb, const sndx_loopback_desc_t* desc)
+{
+    int       err;
+    output_t* output = lb->out;
+
+    RetVal_(__atomic_load_n(&lb->running, __ATOMIC_ACQUIRE), -EBUSY, "Cannot add loops while running");
+
+    u32       periods     = desc->periods ? desc->periods : SNDX_LOOPBACK_PERIODS;
+    uframes_t period_size = loopback_period_size(desc, periods);
+    RetVal_(!period_size, -EINVAL, "Loop %s -> %s: no period size and no latency", desc->capt, desc->play);
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(                                                                      //
+        &d, desc->play, desc->capt, desc->format, desc->rate, period_size, periods,              //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, output);
+    SndReturn_(err, "Failed sndx_duplex_open: %s");
+
+    return loopback_attach(lb, desc, d);
+}
+
+int sndx_loopback_add_pcm(sndx_loopback_t* lb, const sndx_loopback_desc_t* desc, snd_pcm_t* play, snd_pcm_t* capt)
+{
+    int       err;
+    output_t* output = lb->out;
+
+    u32       periods     = desc->periods ? desc->periods : SNDX_LOOPBACK_PERIODS;
+    uframes_t period_size = loopback_period_size(desc, periods);
+
+    err = __atomic_load_n(&lb->running, __ATOMIC_ACQUIRE) ? -EBUSY : !period_size ? -EINVAL : 0;
+    if (err < 0)
+    {
+        snd_pcm_close(play);
+        snd_pcm_close(capt);
+    }
+    RetVal_(err < 0, err, "Cannot add loop: %s", err == -EBUSY ? "running" : "no period size and no latency");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open_pcm(                                                       //
+        &d, play, capt, desc->format, desc->rate, period_size, periods,               //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, output);
+    SndReturn_(err, "Failed sndx_duplex_open_pcm: %s");
+
+    return loopback_attach(lb, desc, d);
+}
+
+/** @brief Descriptors of the live loops of `t`, playback ones for errors only. */
+static void loopback_pollset(sndx_loopback_thread_t* t)
+{
+    u32 nfds = 0;
+
+    RANGE(k, t->nloops)
+    {
+        sndx_loopback_loop_t* loop = &t->lb->loops[t->loops[k]];
+        if (loop->failed) continue;
+
+        loop->pfd_first = nfds;
+
+        snd_pcm_poll_descriptors(loop->d->play, &t->pfds[nfds], loop->play_nfds);
+        RANGE(i, loop->play_nfds) { t->pfds[nfds + i].events = 0; }
+        nfds += loop->play_nfds;
+
+        snd_pcm_poll_descriptors(loop->d->capt, &t->pfds[nfds], loop->capt_nfds);
+        nfds += loop->capt_nfds;
+    }
+
+    t->nfds = nfds;
+}
+
+/** @brief Latency as the delay of both devices at wakeup, from the snapshots of the cycle (no ioctl). */
+static void loopback_probe(sndx_loopback_loop_t* loop)
+{
+    sndx_duplex_t* d    = loop->d;
+    sframes_t      play = 0;
+    sframes_t      capt = 0;
+
+    if (sndx_status_delay(&d->st_play, &play) < 0 || sndx_status_delay(&d->st_capt, &capt) < 0) return;
+
+    sframes_t latency = play + capt;
+
+    loop->latency = latency;
+    if (!loop->latency_min || latency < loop->latency_min) loop->latency_min = latency;
+    if (latency > loop->latency_max) loop->latency_max = latency;
+
+    loop->next_probe = loop->cycles + d->rate / d->period_size;
+}
+
+/** @brief Move every full period capture has: read, route, write. */
+static int loopback_cycle(sndx_loopback_loop_t* loop)
+{
+    int            err;
+    sndx_duplex_t* d     = loop->d;
+    sframes_t      avail = 0;
+
+    sndx_pollfds_error_t perr = sndx_pollfds_avail(d->pfd, d->play, d->capt, &avail, d->out);
+    if (perr != POLLFD_SUCCESS) return -EPIPE;
+
+    if (loop->cycles >= loop->next_probe) loopback_probe(loop);
+
+    while (avail >= (sframes_t)d->period_size)
+    {
+        uframes_t frames = d->period_size;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        if (err < 0) return err;
+
+        sndx_router_process(loop->router, d->buf_capt, d->buf_play, (sframes_t)frames);
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        if (err < 0) return err;
+
+        avail -= (sframes_t)d->period_size;
+        loop->cycles++;
+    }
+
+    return 0;
+}
+
+/** @brief Graded recovery on errors, full restart when stalled, out of the poll set if both fail. */
+static void loopback_recover(sndx_loopback_loop_t* loop, bool stalled)
+{
+    int err;
+
+    loop->recoveries++;
+
+    err = stalled ? sndx_duplex_restart(loop->d) : sndx_duplex_recover(loop->d);
+    if (err > 0 || stalled) loop->restarts++;
+
+    loop->failed = err < 0;
+}
+
+static void* job_loopback(void* data)
+{
+    int                     err;
+    sndx_loopback_thread_t* t      = data;
+    sndx_loopback_t*        lb     = t->lb;
+    output_t*               output = lb->out;
+
+    if (lb->priority > 0)
+    {
+        struct sched_param param = {.sched_priority = lb->priority};
+        t->rt                    = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+
+    u64  now     = sndx_nsecs();
+    u64* last    = calloc(t->nloops, sizeof(u64));
+    bool rebuild = false;
+
+    t->err = -(!last);
+    Goto_(t->err, __done, "Thread %d: failed calloc u64* last", t->index);
+
+    RANGE(k, t->nloops)
+    {
+        sndx_loopback_loop_t* loop = &lb->loops[t->loops[k]];
+
+        err          = sndx_duplex_start(loop->d);
+        loop->failed = err < 0;
+        last[k]      = now;
+
+        if (loop->failed) a_error("%s: failed sndx_duplex_start: %s", loop->id, snd_strerror(err));
+    }
+
+    loopback_pollset(t);
+
+    while (__atomic_load_n(&lb->running, __ATOMIC_ACQUIRE))
+    {
+        int n = poll(t->pfds, t->nfds, t->timeout);
+        if (n < 0 && errno != EINTR)
+        {
+            t->err = -errno;
+            a_error("Thread %d: poll failed: %s", t->index, strerror(errno));
+            break;
+        }
+
+        if (n > 0)
+            t->wakeups++;
+        else
+            t->timeouts++;
+
+        now = sndx_nsecs();
+
+        RANGE(k, t->nloops)
+        {
+            sndx_loopback_loop_t* loop = &lb->loops[t->loops[k]];
+            if (loop->failed) continue;
+
+            unsigned short play_revents = 0;
+            unsigned short capt_revents = 0;
+
+            if (n > 0)
+            {
+                struct pollfd* pfds = &t->pfds[loop->pfd_first];
+                snd_pcm_poll_descriptors_revents(loop->d->play, pfds, loop->play_nfds, &play_revents);
+                snd_pcm_poll_descriptors_revents(loop->d->capt, pfds + loop->play_nfds, loop->capt_nfds,
+                                                 &capt_revents);
+            }
+
+            if ((play_revents | capt_revents) & (POLLERR | POLLNVAL))
+            {
+                loopback_recover(loop, false);
+                last[k] = now;
+            }
+            else if (capt_revents & POLLIN)
+            {
+                if (loopback_cycle(loop) < 0) loopback_recover(loop, false);
+                last[k] = now;
+            }
+            else if (now - last[k] > loopback_stall_nsecs(loop))
+            {
+                loopback_recover(loop, true);
+                last[k] = now;
+            }
+
+            if (loop->failed)
+            {
+                a_error("%s: could not recover, loop stopped", loop->id);
+                rebuild = true;
+            }
+        }
+
+        if (rebuild) loopback_pollset(t);
+        rebuild = false;
+    }
+
+    RANGE(k, t->nloops)
+    {
+        sndx_loopback_loop_t* loop = &lb->loops[t->loops[k]];
+        if (!loop->failed) sndx_duplex_stop(loop->d);
+    }
+
+__done:
+    Free(last);
+
+    return nullptr;
+}
+
+int sndx_loopback_start(sndx_loopback_t* lb)
+{
+    int       err;
+    output_t* output = lb->out;
+
+    RetVal_(lb->threads, -EBUSY, "Already started");
+    RetVal_(!lb->nloops, -EINVAL, "No loops to start");
+
+    // Thread numbers in use, in order of first appearance
+    u32* numbers = calloc(lb->nloops, sizeof(u32));
+    RetVal_(!numbers, -ENOMEM, "Failed calloc u32* numbers");
+
+    u32 nthreads = 0;
+
+    RANGE(i, lb->nloops)
+    {
+        u32 number = lb->loops[i].desc.thread;
+        u32 k      = 0;
+
+        while (k < nthreads && numbers[k] != number) k++;
+        if (k == nthreads) numbers[nthreads++] = number;
+    }
+
+    // Set only once the threads exist, stop and dump walk them by it
+    lb->threads = calloc(nthreads, sizeof(sndx_loopback_thread_t));
+    err         = -(!lb->threads);
+    Goto_(err, __close, "Failed calloc sndx_loopback_thread_t* lb->threads");
+
+    lb->nthreads = nthreads;
+
+    RANGE(k, lb->nthreads)
+    {
+        sndx_loopback_thread_t* t = &lb->threads[k];
+
+        t->lb      = lb;
+        t->index   = numbers[k];
+        t->loops   = calloc(lb->nloops, sizeof(u32));
+        t->timeout = 1000;
+
+        err = -(!t->loops);
+        Goto_(err, __close, "Failed calloc u32* t->loops");
+
+        u32 nfds = 0;
+
+        RANGE(i, lb->nloops)
+        {
+            sndx_loopback_loop_t* loop = &lb->loops[i];
+            if (loop->desc.thread != t->index) continue;
+
+            t->loops[t->nloops++] = (u32)i;
+
+            loop->play_nfds    = (u32)snd_pcm_poll_descriptors_count(loop->d->play);
+            loop->capt_nfds    = (u32)snd_pcm_poll_descriptors_count(loop->d->capt);
+            loop->failed       = false;
+            nfds              += loop->play_nfds + loop->capt_nfds;
+
+            // Wake in time to catch a stalled loop
+            int stall_ms = (int)(loopback_stall_nsecs(loop) / 1000000) + 1;
+            if (stall_ms < t->timeout) t->timeout = stall_ms;
+        }
+
+        t->pfds = calloc(nfds ? nfds : 1, sizeof(struct pollfd));
+        err     = -(!t->pfds);
+        Goto_(err, __close, "Failed calloc struct pollfd* t->pfds");
+    }
+
+    __atomic_store_n(&lb->running, true, __ATOMIC_RELEASE);
+
+    RANGE(k, lb->nthreads)
+    {
+        sndx_loopback_thread_t* t = &lb->threads[k];
+
+        err      = -pthread_create(&t->tid, nullptr, job_loopback, t);
+        t->alive = !err;
+        Goto_(err, __close, "Failed pthread_create: thread %d: %s", t->index, strerror(-err));
+    }
+
+    Free(numbers);
+
+    return 0;
+
+__close:
+    Free(numbers);
+    sndx_loopback_stop(lb);
+
+    return err;
+}
+
+int sndx_loopback_stop(sndx_loopback_t* lb)
+{
+    if (!lb->threads) return 0;
+
+    __atomic_store_n(&lb->running, false, __ATOMIC_RELEASE);
+
+    int err = 0;
+
+    RANGE(k, lb->nthreads)
+    {
+        sndx_loopback_thread_t* t = &lb->threads[k];
+
+        if (t->alive) pthread_join(t->tid, nullptr);
+        if (t->err < 0) err = t->err;
+
+        Free(t->loops);
+        Free(t->pfds);
+    }
+
+    Free(lb->threads);
+    lb->nthreads = 0;
+
+    return err;
+}
+
+void sndx_loopback_dump(sndx_loopback_t* lb, output_t* output)
+{
+    a_info("Loopback: %d loops, %d threads, priority %d", lb->nloops, lb->nthreads, lb->priority);
+
+    RANGE(k, lb->nthreads)
+    {
+        sndx_loopback_thread_t* t = &lb->threads[k];
+
+        a_info("  thread %-3d: %d loops, %d fds, %-5s timeout %d ms, wakeups %ld, timeouts %ld", t->index, t->nloops,
+               t->nfds, t->rt ? "fifo" : "other", t->timeout, t->wakeups, t->timeouts);
+    }
+
+    RANGE(i, lb->nloops)
+    {
+        sndx_loopback_loop_t* loop = &lb->loops[i];
+        sndx_duplex_t*        d    = loop->d;
+
+        a_info("  %-12s: %s -> %s, thread %d, %ld x %d frames, %s", loop->id, snd_pcm_name(d->capt),
+               snd_pcm_name(d->play), loop->desc.thread, d->period_size, d->periods,
+               d->linked ? "linked" : sndx_sync_type_name(d->drift->sync));
+        a_info("  %-12s  latency %ld (req %ld, min %ld, max %ld), cycles %ld, recoveries %ld, restarts %ld%s", "",
+               loop->latency, loop->desc.latency_req, loop->latency_min, loop->latency_max, loop->cycles,
+               loop->recoveries, loop->restarts, loop->failed ? ", FAILED" : "");
+
+        // Taken while the loop thread runs, the estimates are published for that
+        sndx_clock_estimate_t capt;
+        sndx_clock_estimate_t play;
+        sndx_clock_get(&d->clk_capt, &capt);
+        sndx_clock_get(&d->clk_play, &play);
+
+        a_info("  %-12s  clocks capture %+.2f ppm, playback %+.2f ppm%s", "", capt.ppm, play.ppm,
+               capt.valid && play.valid ? "" : " (warming up)");
+    }
+}
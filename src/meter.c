@@ -0,0 +1,536 @@
+/** @file meter.c
+ *  @brief Per channel meters, @see meter.h
+ */
+#include "sndx/meter.h"
+#include "sndx/sys.h"
+#include <math.h>
+
+/** @brief Eight floats, maps to one AVX or two SSE/NEON registers. */
+typedef float v8f __attribute__((vector_size(32)));
+
+/** @brief Same, for loads at any frame (aligned to a float only). */
+typedef float v8f_u __attribute__((vector_size(32), aligned(4), may_alias));
+
+/** @brief Masks and sign bits of v8f. */
+typedef i32 v8i __attribute__((vector_size(32)));
+
+static f64 meter_db(f64 power) { return 10.0 * log10(power); }
+
+/** @brief BS.1770 loudness of a mean square, -INFINITY for silence. */
+static f64 meter_lufs(f64 power) { return -0.691 + 10.0 * log10(power); }
+
+/** @brief Mean square of a loudness, for the centre of histogram bin `b`. */
+static f64 meter_bin_power(u32 b)
+{
+    return pow(10.0, (SNDX_METER_HIST_MIN + (b + 0.5) * SNDX_METER_HIST_RES + 0.691) / 10.0);
+}
+
+/** @brief Peak and sum of squares of `n` samples, eight lanes at a time. */
+static void meter_block(const float* x, isize n, float* peak, f64* sumsq)
+{
+    isize i = 0;
+    v8f   p = {};
+    v8f   s = {};
+
+    for (; i + 8 <= n; i += 8)
+    {
+        v8f v  = *(const v8f_u*)&x[i];
+        v8f a  = (v8f)((v8i)v & 0x7FFFFFFF);
+        v8i gt = a > p;
+
+        p  = (v8f)((gt & (v8i)a) | (~gt & (v8i)p));
+        s += v * v;
+    }
+
+    float pk = 0.0f;
+    float sq = 0.0f;
+
+    RANGE(k, 8)
+    {
+        pk  = p[k] > pk ? p[k] : pk;
+        sq += s[k];
+    }
+
+    for (; i < n; i++)
+    {
+        float a = fabsf(x[i]);
+
+        pk  = a > pk ? a : pk;
+        sq += x[i] * x[i];
+    }
+
+    *peak   = pk;
+    *sumsq += sq;
+}
+
+/** @brief Owner's levels out to readers. */
+static void meter_publish_levels(sndx_meter_t* m)
+{
+    u32 seq = m->levels_seq;
+
+    __atomic_store_n(&m->levels_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(m->levels_pub, m->levels, m->channels * sizeof(sndx_meter_level_t));
+    m->frames_pub = m->frames;
+
+    __atomic_store_n(&m->levels_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void sndx_meter_push(sndx_meter_t* m, const sndx_buffer_t* b, uframes_t offset, uframes_t frames)
+{
+    u32 channels = b->channels < m->channels ? b->channels : m->channels;
+
+    RANGE(chn, channels)
+    {
+        sndx_meter_level_t* l = &m->levels[chn];
+        meter_block(b->bufdata + chn * b->frames + offset, (isize)frames, &l->peak, &l->sumsq);
+    }
+
+    m->frames += frames;
+    meter_publish_levels(m);
+
+    uframes_t before = sndx_ring_read_avail(m->ring);
+    uframes_t queued = sndx_ring_write_from_float_areas(m->ring, b->buf, offset, channels, frames);
+    uframes_t after  = sndx_ring_read_avail(m->ring);
+
+    if (queued < frames) __atomic_add_fetch(&m->dropped, frames - queued, __ATOMIC_RELAXED);
+
+    // Loudness moves a step at a time, a period that completes one is the only one that posts
+    if (before < m->step && after >= m->step) sndx_futex_post(&m->wake);
+}
+
+void sndx_meter_get_levels(sndx_meter_t* m, sndx_meter_level_t* levels, u64* frames)
+{
+    u32 seq;
+
+    do
+    {
+        seq = __atomic_load_n(&m->levels_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+
+        memcpy(levels, m->levels_pub, m->channels * sizeof(sndx_meter_level_t));
+        *frames = m->frames_pub;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    } while ((seq & 1) || seq != __atomic_load_n(&m->levels_seq, __ATOMIC_RELAXED));
+}
+
+u64 sndx_meter_get(sndx_meter_t* m, sndx_meter_reading_t* readings)
+{
+    u32 seq;
+    u64 steps;
+
+    do
+    {
+        seq = __atomic_load_n(&m->readings_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+
+        memcpy(readings, m->readings_pub, m->channels * sizeof(sndx_meter_reading_t));
+        steps = m->steps;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    } while ((seq & 1) || seq != __atomic_load_n(&m->readings_seq, __ATOMIC_RELAXED));
+
+    return steps;
+}
+
+void sndx_meter_reset(sndx_meter_t* m) { __atomic_store_n(&m->reset, true, __ATOMIC_RELEASE); }
+
+/** @brief Owner's readings out to readers. */
+static void meter_publish_readings(sndx_meter_t* m)
+{
+    u32 seq = m->readings_seq;
+
+    __atomic_store_n(&m->readings_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(m->readings_pub, m->readings, m->channels * sizeof(sndx_meter_reading_t));
+    m->steps++;
+
+    __atomic_store_n(&m->readings_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/** @brief BS.1770 K-weighting for `rate`: high shelf pre-filter and RLB highpass, as biquads.
+ *
+ *  Designed from the analog prototypes of the 48 kHz coefficients in the recommendation, so
+ *  they match them at 48 kHz and hold at other rates.
+ */
+static void meter_k_weighting(sndx_meter_t* m)
+{
+    f64 f0 = 1681.974450955533;
+    f64 g  = 3.999843853973347;
+    f64 q  = 0.7071752369554196;
+
+    f64 k  = tan(M_PI * f0 / m->rate);
+    f64 vh = pow(10.0, g / 20.0);
+    f64 vb = pow(vh, 0.4996667741545416);
+    f64 a0 = 1.0 + k / q + k * k;
+
+    m->pre[0] = (vh + vb * k / q + k * k) / a0;
+    m->pre[1] = 2.0 * (k * k - vh) / a0;
+    m->pre[2] = (vh - vb * k / q + k * k) / a0;
+    m->pre[3] = 2.0 * (k * k - 1.0) / a0;
+    m->pre[4] = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q  = 0.5003270373238773;
+    k  = tan(M_PI * f0 / m->rate);
+    a0 = 1.0 + k / q + k * k;
+
+    m->rlb[0] = 1.0;
+    m->rlb[1] = -2.0;
+    m->rlb[2] = 1.0;
+    m->rlb[3] = 2.0 * (k * k - 1.0) / a0;
+    m->rlb[4] = (1.0 - k / q + k * k) / a0;
+}
+
+/** @brief Phases of a Hann windowed sinc, each normalised to unity gain and stored oldest sample first. */
+static void meter_true_peak_filter(sndx_meter_t* m)
+{
+    constexpr u32 os = SNDX_METER_OVERSAMPLE;
+    constexpr u32 nt = SNDX_METER_TP_TAPS;
+    constexpr u32 n  = os * nt;
+
+    f64 c = (n - 1) / 2.0;
+
+    RANGE(ph, os)
+    {
+        f64 sum = 0.0;
+        f64 h[nt];
+
+        RANGE(k, nt)
+        {
+            f64 t = (ph + (f64)os * k - c) / os;
+            f64 w = 0.5 - 0.5 * cos(2.0 * M_PI * (ph + os * k + 1) / (n + 1));
+
+            h[k]  = (t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t)) * w;
+            sum  += h[k];
+        }
+
+        RANGE(k, nt) { m->tp_coef[ph][nt - 1 - k] = (f32)(h[k] / sum); }
+    }
+}
+
+/** @brief y = b0 x + s0, s0 = b1 x - a1 y + s1, s1 = b2 x - a2 y. */
+static inline f64 meter_biquad(const f64* c, f64* s, f64 x)
+{
+    f64 y = c[0] * x + s[0];
+    s[0]  = c[1] * x - c[3] * y + s[1];
+    s[1]  = c[2] * x - c[4] * y;
+
+    return y;
+}
+
+/** @brief Highest magnitude of the signal between the samples of a step.
+ *
+ *  Each output reaches SNDX_METER_TP_TAPS - 1 samples back, the first `from` are not counted.
+ */
+static f64 meter_true_peak(sndx_meter_t* m, sndx_meter_channel_t* st, const float* x, uframes_t step, uframes_t from)
+{
+    constexpr u32 nt = SNDX_METER_TP_TAPS;
+
+    float* buf = m->tp_buf;
+    memcpy(buf, st->x, (nt - 1) * sizeof(float));
+    memcpy(buf + nt - 1, x, step * sizeof(float));
+
+    float tp = 0.0f;
+
+    RANGE(i, from, step)
+    {
+        RANGE(ph, SNDX_METER_OVERSAMPLE)
+        {
+            float y = 0.0f;
+            RANGE(k, nt) { y += m->tp_coef[ph][k] * buf[i + k]; }
+
+            y  = fabsf(y);
+            tp = y > tp ? y : tp;
+        }
+    }
+
+    memcpy(st->x, buf + step, (nt - 1) * sizeof(float));
+
+    return tp;
+}
+
+/** @brief Gated loudness of the blocks in a histogram, -INFINITY if none passed the absolute gate. */
+static f64 meter_integrated(sndx_meter_t* m, const u32* hist)
+{
+    f64 sum = 0.0;
+    u64 n   = 0;
+
+    RANGE(b, m->hist_bins)
+    {
+        sum += hist[b] * meter_bin_power((u32)b);
+        n   += hist[b];
+    }
+
+    if (!n) return -INFINITY;
+
+    // Relative gate, 10 LU under what passed the absolute one
+    f64   gate = meter_lufs(sum / n) - 10.0;
+    isize from = (isize)ceil((gate - SNDX_METER_HIST_MIN) / SNDX_METER_HIST_RES - 0.5);
+
+    sum = 0.0;
+    n   = 0;
+
+    RANGE(b, from > 0 ? from : 0, m->hist_bins)
+    {
+        sum += hist[b] * meter_bin_power((u32)b);
+        n   += hist[b];
+    }
+
+    return n ? meter_lufs(sum / n) : -INFINITY;
+}
+
+/** @brief Mean square of the last `steps` steps, 0 while there have not been as many. */
+static f64 meter_window(sndx_meter_t* m, sndx_meter_channel_t* st, u32 steps)
+{
+    if (m->nsteps < steps) return 0.0;
+
+    f64 sum = 0.0;
+    RANGE(i, steps) { sum += st->steps[(m->nsteps - 1 - i) % SNDX_METER_SHORT_STEPS]; }
+
+    return sum / steps;
+}
+
+static void meter_channel(sndx_meter_t* m, u32 chn, f64 rt_frames)
+{
+    sndx_meter_channel_t* st = &m->state[chn];
+    sndx_meter_reading_t* r  = &m->readings[chn];
+    const float*          x  = m->scratch + chn * m->step;
+
+    // RMS from the RT sums since the last step
+    if (rt_frames > 0.0) r->rms_db = meter_db((m->at[chn].sumsq - st->sumsq) / rt_frames);
+    st->sumsq = m->at[chn].sumsq;
+
+    // K-weighted mean square of the step
+    f64   ms   = 0.0;
+    float peak = 0.0f;
+
+    RANGE(i, m->step)
+    {
+        f64 y = meter_biquad(m->rlb, st->s2, meter_biquad(m->pre, st->s1, x[i]));
+        ms   += y * y;
+
+        float a = fabsf(x[i]);
+        peak    = a > peak ? a : peak;
+    }
+
+    st->steps[m->nsteps % SNDX_METER_SHORT_STEPS] = ms / m->step;
+
+    // Between the samples, and at them where the interpolator rounds off. Not from before a reset
+    uframes_t from = m->nsteps ? 0 : SNDX_METER_TP_TAPS - 1;
+
+    f64 tp = meter_true_peak(m, st, x, m->step, from);
+    tp     = tp > peak ? tp : peak;
+    st->tp = tp > st->tp ? tp : st->tp;
+
+    r->peak_db      = 20.0 * log10(peak);
+    r->true_peak_db = 20.0 * log10(st->tp);
+}
+
+/** @brief Loudness once the step is in the history of every channel. */
+static void meter_loudness(sndx_meter_t* m, u32 chn)
+{
+    sndx_meter_channel_t* st = &m->state[chn];
+    sndx_meter_reading_t* r  = &m->readings[chn];
+
+    f64 momentary = meter_window(m, st, SNDX_METER_MOMENTARY_STEPS);
+    f64 short_ms  = meter_window(m, st, SNDX_METER_SHORT_STEPS);
+
+    r->momentary  = meter_lufs(momentary);
+    r->short_term = meter_lufs(short_ms);
+
+    // The momentary block is the gating block, 400 ms every 100 ms
+    if (r->momentary >= SNDX_METER_HIST_MIN)
+    {
+        u32 b = (u32)((r->momentary - SNDX_METER_HIST_MIN) / SNDX_METER_HIST_RES);
+        st->hist[b < m->hist_bins ? b : m->hist_bins - 1]++;
+    }
+
+    r->integrated = meter_integrated(m, st->hist);
+}
+
+static void meter_start_over(sndx_meter_t* m)
+{
+    m->nsteps = 0;
+
+    RANGE(chn, m->channels)
+    {
+        sndx_meter_channel_t* st = &m->state[chn];
+
+        st->tp = 0.0;
+        memset(st->hist, 0, m->hist_bins * sizeof(u32));
+    }
+}
+
+static void meter_step(sndx_meter_t* m)
+{
+    sndx_ring_read_to_float_areas(m->ring, m->areas, 0, m->channels, m->step);
+
+    if (__atomic_exchange_n(&m->reset, false, __ATOMIC_ACQ_REL)) meter_start_over(m);
+
+    u64 frames;
+    sndx_meter_get_levels(m, m->at, &frames);
+
+    f64 rt_frames = (f64)(frames - m->at_frames);
+    m->at_frames  = frames;
+
+    RANGE(chn, m->channels) { meter_channel(m, (u32)chn, rt_frames); }
+
+    m->nsteps++;
+
+    RANGE(chn, m->channels) { meter_loudness(m, (u32)chn); }
+
+    meter_publish_readings(m);
+}
+
+static void* job_meter(void* data)
+{
+    sndx_meter_t* m = data;
+
+    // Readings are due every step, so never nap longer than one
+    tspec_t timeout = sndx_tspec_from_nsecs(m->step * 1000000000ULL / m->rate);
+
+    while (__atomic_load_n(&m->running, __ATOMIC_ACQUIRE))
+    {
+        u32 wake = __atomic_load_n(&m->wake, __ATOMIC_ACQUIRE);
+
+        if (sndx_ring_read_avail(m->ring) < m->step)
+        {
+            sndx_futex_wait(&m->wake, wake, &timeout);
+            continue;
+        }
+
+        meter_step(m);
+    }
+
+    return nullptr;
+}
+
+int sndx_meter_open(sndx_meter_t** meterp, u32 channels, u32 rate, output_t* output)
+{
+    int err;
+
+    sndx_meter_t* m;
+    m = calloc(1, sizeof(*m));
+    RetVal_(!m, -ENOMEM, "Failed calloc sndx_meter_t* m");
+
+    m->channels  = channels;
+    m->rate      = rate;
+    m->step      = (uframes_t)rate * SNDX_METER_STEP_MS / 1000;
+    m->hist_bins = (u32)lround((SNDX_METER_HIST_MAX - SNDX_METER_HIST_MIN) / SNDX_METER_HIST_RES);
+
+    err = -(!channels || !m->step) * EINVAL;
+    Goto_(err, __close, "Meter needs channels and a rate, got %d and %d", channels, rate);
+
+    // Eight steps queued before anything is dropped
+    uframes_t capacity = 1;
+    while (capacity < 8 * m->step) capacity <<= 1;
+
+    err = sndx_ring_open(&m->ring, SND_PCM_FORMAT_FLOAT, channels, capacity, output);
+    Goto_(err, __close, "Failed sndx_ring_open");
+
+    m->levels       = calloc(channels, sizeof(sndx_meter_level_t));
+    m->levels_pub   = calloc(channels, sizeof(sndx_meter_level_t));
+    m->at           = calloc(channels, sizeof(sndx_meter_level_t));
+    m->readings     = calloc(channels, sizeof(sndx_meter_reading_t));
+    m->readings_pub = calloc(channels, sizeof(sndx_meter_reading_t));
+    m->state        = calloc(channels, sizeof(sndx_meter_channel_t));
+    m->scratch      = calloc(channels * m->step, sizeof(float));
+    m->areas        = calloc(channels, sizeof(area_t));
+    m->tp_buf       = calloc(m->step + SNDX_METER_TP_TAPS, sizeof(float));
+
+    err = -(!m->levels || !m->levels_pub || !m->at || !m->readings || !m->readings_pub || !m->state || !m->scratch ||
+            !m->areas || !m->tp_buf);
+    Goto_(err, __close, "Failed calloc meter buffers for %d channels", channels);
+
+    RANGE(chn, channels)
+    {
+        m->state[chn].hist = calloc(m->hist_bins, sizeof(u32));
+        err                = -(!m->state[chn].hist);
+        Goto_(err, __close, "Failed calloc u32* hist");
+
+        m->areas[chn].addr  = m->scratch;
+        m->areas[chn].first = chn * m->step * sizeof(float) * 8;
+        m->areas[chn].step  = sizeof(float) * 8;
+
+        m->readings[chn] = (sndx_meter_reading_t){
+            .rms_db       = -INFINITY,
+            .peak_db      = -INFINITY,
+            .true_peak_db = -INFINITY,
+            .momentary    = -INFINITY,
+            .short_term   = -INFINITY,
+            .integrated   = -INFINITY,
+        };
+    }
+
+    memcpy(m->readings_pub, m->readings, channels * sizeof(sndx_meter_reading_t));
+
+    meter_k_weighting(m);
+    meter_true_peak_filter(m);
+
+    m->running = true;
+
+    err = -pthread_create(&m->tid, nullptr, job_meter, m);
+    if (err < 0) m->running = false;
+    Goto_(err, __close, "Failed: pthread_create: job_meter: %s", strerror(-err));
+
+    *meterp = m;
+
+    return 0;
+
+__close:
+    sndx_meter_close(m);
+    *meterp = nullptr;
+
+    return err;
+}
+
+void sndx_meter_close(sndx_meter_t* m)
+{
+    if (!m) return;
+
+    if (m->running)
+    {
+        __atomic_store_n(&m->running, false, __ATOMIC_RELEASE);
+        sndx_futex_post(&m->wake);
+        pthread_join(m->tid, nullptr);
+    }
+
+    if (m->state)
+    {
+        RANGE(chn, m->channels) { Free(m->state[chn].hist); }
+    }
+
+    sndx_ring_close(m->ring);
+    Free(m->levels);
+    Free(m->levels_pub);
+    Free(m->at);
+    Free(m->readings);
+    Free(m->readings_pub);
+    Free(m->state);
+    Free(m->scratch);
+    Free(m->areas);
+    Free(m->tp_buf);
+    Free(m);
+}
+
+void sndx_meter_dump(sndx_meter_t* m, output_t* output)
+{
+    sndx_meter_reading_t r[m->channels];
+    u64                  steps = sndx_meter_get(m, r);
+
+    a_info("Meter: %d channels at %d, %ld steps, %ld frames dropped", m->channels, m->rate, steps,
+           __atomic_load_n(&m->dropped, __ATOMIC_RELAXED));
+    a_info("  chn    rms   peak     tp    M LUFS    S LUFS    I LUFS");
+
+    RANGE(chn, m->channels)
+    {
+        a_info("  %3ld %6.1f %6.1f %6.1f %9.1f %9.1f %9.1f", chn, r[chn].rms_db, r[chn].peak_db, r[chn].true_peak_db,
+               r[chn].momentary, r[chn].short_term, r[chn].integrated);
+    }
+}
@@ -0,0 +1,315 @@
+/** @file pitch.c
+ *  @brief Streaming pitch estimator, @see pitch.h
+ */
+#include "sndx/pitch.h"
+
+int sndx_pitch_open(sndx_pitch_t** pitchp, u32 rate, u32 size, u32 hop, output_t* output)
+{
+    int err;
+
+    sndx_pitch_t* p;
+    p = calloc(1, sizeof(*p));
+    RetVal_(!p, -ENOMEM, "Failed calloc sndx_pitch_t* p");
+
+    p->rate = rate;
+    p->size = size;
+    p->hop  = hop && hop <= size ? hop : size / 4;
+
+    // Lags up to half the window, pitches up to where a guitar or a voice ends
+    p->fmin      = 2.0 * rate / size;
+    p->fmax      = 2000.0;
+    p->threshold = 0.15;
+    p->gate_db   = -60.0;
+
+    err = sndx_fft_open(&p->fft, size, output);
+    Goto_(err, __close, "Failed sndx_fft_open");
+
+    p->history = calloc(size, sizeof(float));
+    p->frame   = calloc(size, sizeof(float));
+    p->window  = calloc(size, sizeof(float));
+    p->re      = calloc(size, sizeof(float));
+    p->im      = calloc(size, sizeof(float));
+    p->cre     = calloc(size, sizeof(float));
+    p->cim     = calloc(size, sizeof(float));
+    p->hps     = calloc(size / 2, sizeof(float));
+    p->cmnd    = calloc(size / 2 + 1, sizeof(float));
+    p->energy  = calloc(size + 1, sizeof(f64));
+
+    err = -(!p->history || !p->frame || !p->window || !p->re || !p->im || !p->cre || !p->cim || !p->hps || !p->cmnd ||
+            !p->energy);
+    Goto_(err, __close, "Failed calloc pitch buffers of %d", size);
+
+    RANGE(i, size) { p->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / size)); }
+
+    *pitchp = p;
+
+    return 0;
+
+__close:
+    sndx_pitch_close(p);
+    *pitchp = nullptr;
+
+    return err;
+}
+
+void sndx_pitch_close(sndx_pitch_t* p)
+{
+    if (!p) return;
+
+    sndx_fft_close(p->fft);
+    Free(p->history);
+    Free(p->frame);
+    Free(p->window);
+    Free(p->re);
+    Free(p->im);
+    Free(p->cre);
+    Free(p->cim);
+    Free(p->hps);
+    Free(p->cmnd);
+    Free(p->energy);
+    Free(p);
+}
+
+void sndx_pitch_reset(sndx_pitch_t* p)
+{
+    memset(p->history, 0, p->size * sizeof(float));
+
+    p->write  = 0;
+    p->since  = 0;
+    p->frames = 0;
+    p->last   = (sndx_pitch_estimate_t){};
+}
+
+/** @brief Peak of the harmonic product spectrum of the windowed frame, 0 if none in range. */
+static f64 pitch_hps(sndx_pitch_t* p, const float* frame)
+{
+    u32 n = p->size;
+
+    RANGE(i, n)
+    {
+        p->re[i] = frame[i] * p->window[i];
+        p->im[i] = 0.0f;
+    }
+
+    sndx_fft_forward(p->fft, p->re, p->im);
+
+    float peak = 0.0f;
+    RANGE(k, n / 2)
+    {
+        p->re[k] = p->re[k] * p->re[k] + p->im[k] * p->im[k];
+        peak     = p->re[k] > peak ? p->re[k] : peak;
+    }
+
+    // Log power, so the product is a sum. Floored 60 dB under the peak, or a missing harmonic is all that counts
+    RANGE(k, n / 2) { p->re[k] = logf(p->re[k] + peak * 1e-6f + 1e-30f); }
+
+    u32 kmin = (u32)ceil(p->fmin * n / p->rate);
+    u32 kmax = (u32)(p->fmax * n / p->rate);
+
+    kmin = kmin ? kmin : 1;
+    kmax = kmax < (n / 2 - 1) / SNDX_PITCH_HARMONICS ? kmax : (n / 2 - 1) / SNDX_PITCH_HARMONICS;
+
+    if (kmin > kmax) return 0.0;
+
+    float best = -INFINITY;
+    float low  = logf(peak * 1e-4f + 1e-30f);
+
+    RANGE(k, kmin, kmax + 1)
+    {
+        // Only peaks within 40 dB of the loudest, not the skirt of one at low bins
+        bool candidate = p->re[k] > low && p->re[k] >= p->re[k - 1] && p->re[k] >= p->re[k + 1];
+
+        p->hps[k] = -INFINITY;
+        if (!candidate) continue;
+
+        float s = 0.0f;
+        RANGE(h, 1, SNDX_PITCH_HARMONICS + 1) { s += p->re[h * k]; }
+
+        p->hps[k] = s;
+        best      = s > best ? s : best;
+    }
+
+    if (best == -INFINITY) return 0.0;
+
+    // Subharmonics score as well as the fundamental when harmonics are missing (a pure tone),
+    // so the highest peak within 3 dB of the best one
+    u32 kbest = kmax;
+    while (kbest > kmin && p->hps[kbest] < best - (float)M_LN2) kbest--;
+
+    return (f64)kbest * p->rate / n;
+}
+
+/** @brief Cumulative mean normalised difference for lags up to `tmax` + 1.
+ *
+ *  d(t) = sum over the first half of (x[j] - x[j + t])^2 = e(first half) + e(half from t) - 2 r(t),
+ *  with r(t) the correlation of the first half with the window, from one complex FFT that
+ *  carries the zero padded first half as real part and the window as imaginary part.
+ */
+static void pitch_cmnd(sndx_pitch_t* p, const float* frame, u32 tmax)
+{
+    u32  n = p->size;
+    u32  w = n / 2;
+    f64* e = p->energy;
+
+    RANGE(i, n)
+    {
+        p->re[i] = i < w ? frame[i] : 0.0f;
+        p->im[i] = frame[i];
+    }
+
+    sndx_fft_forward(p->fft, p->re, p->im);
+
+    // Split the spectra of both, then conj(half) * window
+    RANGE(k, n)
+    {
+        u32 j = (u32)(n - k) & (n - 1);
+
+        float ar = 0.5f * (p->re[k] + p->re[j]);
+        float ai = 0.5f * (p->im[k] - p->im[j]);
+        float xr = 0.5f * (p->im[k] + p->im[j]);
+        float xi = 0.5f * (p->re[j] - p->re[k]);
+
+        p->cre[k] = ar * xr + ai * xi;
+        p->cim[k] = ar * xi - ai * xr;
+    }
+
+    sndx_fft_inverse(p->fft, p->cre, p->cim);
+
+    f64 sum    = 0.0;
+    p->cmnd[0] = 1.0f;
+
+    RANGE(t, 1, tmax + 2)
+    {
+        f64 d = e[w] + (e[t + w] - e[t]) - 2.0 * p->cre[t];
+        d     = d > 0.0 ? d : 0.0;
+        sum  += d;
+
+        p->cmnd[t] = sum > 0.0 ? (float)(d * t / sum) : 1.0f;
+    }
+}
+
+void sndx_pitch_analyse(sndx_pitch_t* p, const float* frame, sndx_pitch_estimate_t* est)
+{
+    u32  n = p->size;
+    u32  w = n / 2;
+    f64* e = p->energy;
+
+    *est = (sndx_pitch_estimate_t){.frame = p->frames};
+
+    // 1.
+    e[0] = 0.0;
+    RANGE(i, n) { e[i + 1] = e[i] + (f64)frame[i] * frame[i]; }
+
+    est->level_db = 10.0 * log10(e[n] / n + 1e-20);
+    if (est->level_db < p->gate_db) return;
+
+    // 2.
+    est->hps_freq = pitch_hps(p, frame);
+
+    // 3. One more lag than searched for the interpolation
+    u32 tmin = (u32)(p->rate / p->fmax);
+    u32 tmax = (u32)ceil(p->rate / p->fmin);
+
+    tmin = tmin > 2 ? tmin : 2;
+    tmax = tmax < w - 2 ? tmax : w - 2;
+    if (tmin >= tmax) return;
+
+    pitch_cmnd(p, frame, tmax);
+
+    u32 tau = 0;
+    RANGE(t, tmin, tmax + 1)
+    {
+        if (p->cmnd[t] >= p->threshold) continue;
+
+        tau = (u32)t;
+        break;
+    }
+
+    // Down to the bottom of the first dip
+    while (tau && tau < tmax && p->cmnd[tau + 1] < p->cmnd[tau]) tau++;
+
+    // No clear dip, take the deepest one within a bin of the spectrum's guess
+    if (!tau)
+    {
+        f64 bin = (f64)p->rate / n;
+        u32 lo  = tmin;
+        u32 hi  = tmax;
+
+        if (est->hps_freq > bin)
+        {
+            lo = (u32)(p->rate / (est->hps_freq + bin));
+            hi = (u32)ceil(p->rate / (est->hps_freq - bin));
+            lo = lo > tmin ? lo : tmin;
+            hi = hi < tmax ? hi : tmax;
+        }
+
+        tau = lo;
+        RANGE(t, lo, hi + 1)
+        {
+            if (p->cmnd[t] < p->cmnd[tau]) tau = (u32)t;
+        }
+    }
+
+    // 4.
+    f64 a     = p->cmnd[tau - 1];
+    f64 b     = p->cmnd[tau];
+    f64 c     = p->cmnd[tau + 1];
+    f64 den   = a - 2.0 * b + c;
+    f64 shift = den > 0.0 ? 0.5 * (a - c) / den : 0.0;
+
+    est->freq       = p->rate / (tau + shift);
+    est->confidence = b < 1.0 ? 1.0 - b : 0.0;
+    est->valid      = b < SNDX_PITCH_MAX_APERIODICITY;
+}
+
+bool sndx_pitch_push(sndx_pitch_t* p, const float* samples, uframes_t frames)
+{
+    bool fresh = false;
+    u32  mask  = p->size - 1;
+
+    while (frames)
+    {
+        uframes_t n = p->hop - p->since;
+        n           = n < frames ? n : frames;
+
+        RANGE(i, n)
+        {
+            p->history[p->write] = samples[i];
+            p->write             = (p->write + 1) & mask;
+        }
+
+        samples  += n;
+        frames   -= n;
+        p->since += (u32)n;
+        p->frames += n;
+
+        if (p->since < p->hop) break;
+        p->since = 0;
+
+        // Not a full window yet
+        if (p->frames < p->size) continue;
+
+        // Oldest first
+        u32 head = p->size - p->write;
+        memcpy(p->frame, p->history + p->write, head * sizeof(float));
+        memcpy(p->frame + head, p->history, p->write * sizeof(float));
+
+        sndx_pitch_analyse(p, p->frame, &p->last);
+        fresh = true;
+    }
+
+    return fresh;
+}
+
+const char* sndx_pitch_note(f64 freq, int* octave, f64* cents)
+{
+    static const char* names[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+    f64 midi = 69.0 + 12.0 * log2(freq / 440.0);
+    int note = (int)lround(midi);
+
+    *cents  = 100.0 * (midi - note);
+    *octave = note / 12 - 1;
+
+    return names[((note % 12) + 12) % 12];
+}
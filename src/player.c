@@ -0,0 +1,455 @@
+/** @file player.c
+ *  @brief Streaming disk player, @see player.h
+ */
+#include "sndx/player.h"
+#include "sndx/sys.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static usize player_frame_bytes(sndx_player_t* p) { return p->channels * sizeof(float); }
+
+void sndx_player_dump(sndx_player_t* p, output_t* output)
+{
+    u64 reads = __atomic_load_n(&p->reads, __ATOMIC_RELAXED);
+    u64 sum   = __atomic_load_n(&p->read_sum_nsecs, __ATOMIC_RELAXED);
+    u64 low   = __atomic_load_n(&p->low_water, __ATOMIC_RELAXED);
+
+    a_info("Player: %s", p->desc.path);
+    a_info("  source     : %s", p->source == SNDX_PLAYER_MMAP ? "mmap" : "sndfile");
+    a_info("  file       : %d channels, %d Hz, %ld frames%s", p->channels, p->rate, p->frames,
+           p->desc.loop ? ", looping" : "");
+    a_info("  chunk      : %ld frames", p->desc.chunk_frames);
+    a_info("  ring       : %ld frames, low water %ld (%.0f%%)", p->ring->capacity, low,
+           low * 100.0 / p->ring->capacity);
+    a_info("  position   : %ld", __atomic_load_n(&p->position, __ATOMIC_RELAXED));
+    a_info("  underruns  : %ld, %ld frames", __atomic_load_n(&p->underruns, __ATOMIC_RELAXED),
+           __atomic_load_n(&p->underrun_frames, __ATOMIC_RELAXED));
+    a_info("  seeks      : %ld", __atomic_load_n(&p->seeks, __ATOMIC_RELAXED));
+    a_info("  reads (us) : %ld, last %.0f, max %.0f, mean %.0f", reads,
+           __atomic_load_n(&p->read_last_nsecs, __ATOMIC_RELAXED) * 1e-3,
+           __atomic_load_n(&p->read_max_nsecs, __ATOMIC_RELAXED) * 1e-3, reads ? sum * 1e-3 / reads : 0.0);
+
+    int err = __atomic_load_n(&p->err, __ATOMIC_RELAXED);
+    if (err < 0) a_info("  error      : %s", strerror(-err));
+}
+
+static u16 player_le16(const u8* b) { return (u16)(b[0] | b[1] << 8); }
+static u32 player_le32(const u8* b) { return (u32)b[0] | (u32)b[1] << 8 | (u32)b[2] << 16 | (u32)b[3] << 24; }
+
+/** @brief Samples of a mapped WAV, -ENOTSUP unless they are 32 bit float the host can use as they are. */
+static int player_parse_wav(sndx_player_t* p, usize* data_len)
+{
+    const u8* m   = p->map;
+    usize     len = p->map_len;
+
+    if (__BYTE_ORDER != __LITTLE_ENDIAN) return -ENOTSUP;
+    if (len < 12 || memcmp(m, "RIFF", 4) || memcmp(m + 8, "WAVE", 4)) return -ENOTSUP;
+
+    bool  is_float = false;
+    usize pos      = 12;
+
+    while (pos + 8 <= len)
+    {
+        const u8* id   = m + pos;
+        u32       size = player_le32(m + pos + 4);
+        usize     body = pos + 8;
+
+        if (!memcmp(id, "fmt ", 4) && size >= 16 && body + size <= len)
+        {
+            u16 tag = player_le16(m + body);
+
+            // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the tag
+            if (tag == 0xFFFE && size >= 26) tag = player_le16(m + body + 24);
+
+            p->channels = player_le16(m + body + 2);
+            p->rate     = player_le32(m + body + 4);
+            is_float    = tag == 3 && player_le16(m + body + 14) == 32;
+        }
+
+        // Unfinished recordings have a size of 0 or ~0, up to the end of the file then
+        if (!memcmp(id, "data", 4))
+        {
+            p->data   = body;
+            *data_len = size && size <= len - body ? size : len - body;
+
+            return is_float && p->channels && body % sizeof(float) == 0 ? 0 : -ENOTSUP;
+        }
+
+        pos = body + size + (size & 1);
+    }
+
+    return -ENOTSUP;
+}
+
+static void player_unmap(sndx_player_t* p)
+{
+    if (p->map) munmap(p->map, p->map_len);
+    if (p->fd >= 0) close(p->fd);
+
+    p->map = nullptr;
+    p->fd  = -1;
+}
+
+static int player_open_mmap(sndx_player_t* p, output_t* output)
+{
+    int err;
+
+    const sndx_player_desc_t* desc = &p->desc;
+
+    p->fd = open(desc->path, O_RDONLY);
+    err   = p->fd < 0 ? -errno : 0;
+    Return_(err, "Failed open %s: %s", desc->path, strerror(-err));
+
+    struct stat st;
+    err = fstat(p->fd, &st) < 0 ? -errno : -(st.st_size <= 0) * EINVAL;
+    Return_(err, "Nothing to map in %s: %s", desc->path, strerror(-err));
+
+    p->map_len = (usize)st.st_size;
+    p->map     = mmap(nullptr, p->map_len, PROT_READ, MAP_SHARED, p->fd, 0);
+    if (p->map == MAP_FAILED) p->map = nullptr;
+
+    err = p->map ? 0 : -errno;
+    Return_(err, "Failed mmap %s: %s", desc->path, strerror(-err));
+
+    madvise(p->map, p->map_len, MADV_SEQUENTIAL);
+
+    usize data_len = p->map_len;
+    if (desc->raw)
+    {
+        p->channels = desc->channels;
+        p->rate     = desc->rate;
+
+        err = -(!p->channels || !p->rate) * EINVAL;
+        Return_(err, "Raw %s needs channels and rate", desc->path);
+    }
+    else
+    {
+        // Not an error for AUTO, libsndfile takes over
+        err = player_parse_wav(p, &data_len);
+        if (err < 0) return err;
+    }
+
+    p->source = SNDX_PLAYER_MMAP;
+    p->frames = data_len / player_frame_bytes(p);
+
+    return 0;
+}
+
+static int player_open_sndfile(sndx_player_t* p, output_t* output)
+{
+    int err;
+
+    SF_INFO info = {};
+    p->sf        = sf_open(p->desc.path, SFM_READ, &info);
+    err          = -(!p->sf) * EINVAL;
+    Return_(err, "Failed sf_open %s: %s", p->desc.path, sf_strerror(nullptr));
+
+    p->source   = SNDX_PLAYER_SNDFILE;
+    p->channels = (u32)info.channels;
+    p->rate     = (u32)info.samplerate;
+    p->frames   = (uframes_t)info.frames;
+
+    p->staging = calloc(p->desc.chunk_frames * p->channels, sizeof(float));
+    err        = -(!p->staging);
+    Return_(err, "Failed calloc float* p->staging");
+
+    return 0;
+}
+
+/** @brief Up to `frames` of the source into the ring, wrapping around or flagging the end at the end. */
+static int player_read(sndx_player_t* p, uframes_t frames)
+{
+    int       err    = 0;
+    output_t* output = p->output;
+
+    if (p->pos >= p->frames)
+    {
+        if (!p->desc.loop)
+        {
+            __atomic_store_n(&p->eof, true, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+        err = p->sf && sf_seek(p->sf, 0, SEEK_SET) < 0 ? -EIO : 0;
+        Goto_(err, __error, "Failed sf_seek to the start of %s: %s", p->desc.path, sf_strerror(p->sf));
+
+        p->pos = 0;
+    }
+
+    uframes_t room = sndx_ring_write_avail(p->ring);
+
+    frames = frames < p->frames - p->pos ? frames : p->frames - p->pos;
+    frames = frames < room ? frames : room;
+    if (!frames) return 0;
+
+    u64 start = sndx_nsecs();
+
+    if (p->sf)
+    {
+        sf_count_t n = sf_readf_float(p->sf, p->staging, (sf_count_t)frames);
+
+        // Shorter than announced, the end is here
+        if (n <= 0)
+        {
+            err = -(!p->pos) * EIO;
+            Goto_(err, __error, "Nothing to read from %s: %s", p->desc.path, sf_strerror(p->sf));
+
+            p->frames = p->pos;
+            return 0;
+        }
+
+        frames = (uframes_t)n;
+        sndx_ring_write_from_float_areas(p->ring, p->areas, 0, p->channels, frames);
+    }
+    else
+    {
+        // Copy first, the faults of this chunk are ours, then ask for the next one
+        sndx_ring_write_from_float_areas(p->ring, p->areas, p->pos, p->channels, frames);
+
+        usize page  = (usize)sysconf(_SC_PAGESIZE);
+        usize begin = (p->data + (p->pos + frames) * player_frame_bytes(p)) & ~(page - 1);
+        usize end   = p->data + (p->pos + 2 * frames) * player_frame_bytes(p);
+        if (begin < p->map_len) madvise(p->map + begin, (end < p->map_len ? end : p->map_len) - begin, MADV_WILLNEED);
+    }
+
+    u64 nsecs = sndx_nsecs() - start;
+
+    p->pos += frames;
+    __atomic_add_fetch(&p->produced, frames, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&p->reads, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&p->read_sum_nsecs, nsecs, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->read_last_nsecs, nsecs, __ATOMIC_RELAXED);
+    if (nsecs > p->read_max_nsecs) __atomic_store_n(&p->read_max_nsecs, nsecs, __ATOMIC_RELAXED);
+
+    return 0;
+
+__error:
+    __atomic_store_n(&p->err, err, __ATOMIC_RELAXED);
+
+    return err;
+}
+
+/** @brief Act on seek `req`: reposition, then publish what was queued before it. */
+static int player_reposition(sndx_player_t* p, u32 req)
+{
+    int       err    = 0;
+    output_t* output = p->output;
+
+    uframes_t frame = __atomic_load_n(&p->seek_frame, __ATOMIC_RELAXED);
+    frame           = frame < p->frames ? frame : p->frames;
+
+    err = p->sf && sf_seek(p->sf, (sf_count_t)frame, SEEK_SET) < 0 ? -EIO : 0;
+    Goto_(err, __error, "Failed sf_seek to %ld of %s: %s", frame, p->desc.path, sf_strerror(p->sf));
+
+    p->pos       = frame;
+    p->seek_base = frame;
+    __atomic_store_n(&p->eof, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->seek_mark, __atomic_load_n(&p->produced, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&p->seek_done, req, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&p->seeks, 1, __ATOMIC_RELAXED);
+
+    return 0;
+
+__error:
+    __atomic_store_n(&p->err, err, __ATOMIC_RELAXED);
+
+    return err;
+}
+
+static void* job_player(void* data)
+{
+    sndx_player_t* p     = data;
+    uframes_t      chunk = p->desc.chunk_frames;
+
+    // Pulls, seeks and close post `wake`, a chunk of playing time is just the longest it naps
+    tspec_t timeout = sndx_tspec_from_nsecs(chunk * 1000000000ULL / p->rate);
+
+    while (__atomic_load_n(&p->running, __ATOMIC_ACQUIRE))
+    {
+        u32 wake = __atomic_load_n(&p->wake, __ATOMIC_ACQUIRE);
+        u32 req  = __atomic_load_n(&p->seek_req, __ATOMIC_ACQUIRE);
+
+        if (req != p->seek_done)
+        {
+            if (player_reposition(p, req) < 0) break;
+            continue;
+        }
+
+        if (p->eof || sndx_ring_write_avail(p->ring) < chunk)
+        {
+            sndx_futex_wait(&p->wake, wake, &timeout);
+            continue;
+        }
+
+        if (player_read(p, chunk) < 0) break;
+    }
+
+    return nullptr;
+}
+
+bool sndx_player_done(sndx_player_t* p)
+{
+    if (!__atomic_load_n(&p->eof, __ATOMIC_ACQUIRE)) return false;
+    if (__atomic_load_n(&p->seek_req, __ATOMIC_ACQUIRE) != __atomic_load_n(&p->seek_done, __ATOMIC_ACQUIRE))
+        return false;
+
+    return __atomic_load_n(&p->consumed, __ATOMIC_RELAXED) >= __atomic_load_n(&p->produced, __ATOMIC_RELAXED);
+}
+
+uframes_t sndx_player_pull(sndx_player_t* p, const area_t* areas, u32 channels, uframes_t offset, uframes_t frames)
+{
+    u32       nch  = channels < p->channels ? channels : p->channels;
+    u32       done = __atomic_load_n(&p->seek_done, __ATOMIC_ACQUIRE);
+    uframes_t got  = 0;
+
+    // Skip what was queued before the seek, unless a pull got past it already
+    if (done != p->rt_seek)
+    {
+        u64 mark = __atomic_load_n(&p->seek_mark, __ATOMIC_RELAXED);
+        if (mark > p->consumed)
+        {
+            sndx_ring_read_advance(p->ring, (uframes_t)(mark - p->consumed));
+            __atomic_store_n(&p->consumed, mark, __ATOMIC_RELAXED);
+        }
+
+        p->rt_seek = done;
+        __atomic_store_n(&p->position, p->seek_base + (uframes_t)(p->consumed - mark), __ATOMIC_RELAXED);
+    }
+
+    // Silence while a newer seek is on its way
+    if (__atomic_load_n(&p->seek_req, __ATOMIC_ACQUIRE) == done)
+    {
+        uframes_t avail = sndx_ring_read_avail(p->ring);
+        uframes_t room  = p->ring->capacity - 1 - avail;
+
+        // The end of the file drains the ring, that is no sign of the disk falling behind
+        if (avail < p->low_water && !__atomic_load_n(&p->eof, __ATOMIC_RELAXED))
+            __atomic_store_n(&p->low_water, avail, __ATOMIC_RELAXED);
+
+        got = sndx_ring_read_to_float_areas(p->ring, areas, offset, nch, frames);
+        __atomic_store_n(&p->consumed, p->consumed + got, __ATOMIC_RELAXED);
+
+        uframes_t position = p->position + got;
+        if (p->desc.loop && p->frames) position %= p->frames;
+        __atomic_store_n(&p->position, position, __ATOMIC_RELAXED);
+
+        // Prefetch reads whole chunks, only the pull that frees room for one is worth a syscall
+        if (room < p->desc.chunk_frames && room + got >= p->desc.chunk_frames) sndx_futex_post(&p->wake);
+
+        if (got < frames && !sndx_player_done(p))
+        {
+            __atomic_add_fetch(&p->underruns, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&p->underrun_frames, frames - got, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (nch < channels && got) snd_pcm_areas_silence(areas + nch, offset, channels - nch, got, SND_PCM_FORMAT_FLOAT);
+    if (got < frames) snd_pcm_areas_silence(areas, offset + got, channels, frames - got, SND_PCM_FORMAT_FLOAT);
+
+    return got;
+}
+
+void sndx_player_seek(sndx_player_t* p, uframes_t frame)
+{
+    __atomic_store_n(&p->seek_frame, frame, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&p->seek_req, 1, __ATOMIC_RELEASE);
+    sndx_futex_post(&p->wake);
+}
+
+int sndx_player_open(sndx_player_t** playerp, const sndx_player_desc_t* desc, output_t* output)
+{
+    int err;
+
+    sndx_player_t* p;
+    p = calloc(1, sizeof(*p));
+    RetVal_(!p, -ENOMEM, "Failed calloc sndx_player_t* p");
+
+    p->fd     = -1;
+    p->desc   = *desc;
+    p->output = output;
+
+    sndx_player_desc_t* d = &p->desc;
+
+    err = -(!d->path) * EINVAL;
+    Goto_(err, __close, "Player needs a path");
+
+    if (!d->chunk_frames) d->chunk_frames = SNDX_PLAYER_CHUNK;
+    if (d->read_ahead <= 0.0) d->read_ahead = SNDX_PLAYER_READ_AHEAD;
+
+    // Float WAV and raw are mapped, the rest goes to libsndfile unless only MMAP will do
+    err = d->source == SNDX_PLAYER_SNDFILE ? -ENOTSUP : player_open_mmap(p, output);
+    if (err == -ENOTSUP && d->source != SNDX_PLAYER_MMAP && !d->raw)
+    {
+        player_unmap(p);
+        err = player_open_sndfile(p, output);
+    }
+    Goto_(err, __close, "Failed to open %s", d->path);
+
+    err = -(!p->frames || !p->channels || !p->rate) * EINVAL;
+    Goto_(err, __close, "Nothing to play in %s", d->path);
+
+    uframes_t ahead    = (uframes_t)(d->read_ahead * p->rate);
+    uframes_t capacity = 1;
+    while (capacity < ahead || capacity < 2 * d->chunk_frames) capacity <<= 1;
+
+    err = sndx_ring_open(&p->ring, SND_PCM_FORMAT_FLOAT, p->channels, capacity, output);
+    Goto_(err, __close, "Failed sndx_ring_open");
+
+    p->low_water = capacity;
+
+    p->areas = calloc(p->channels, sizeof(area_t));
+    err      = -(!p->areas);
+    Goto_(err, __close, "Failed calloc area_t* p->areas");
+
+    RANGE(chn, p->channels)
+    {
+        p->areas[chn].addr  = p->sf ? (void*)p->staging : (void*)(p->map + p->data);
+        p->areas[chn].first = chn * sizeof(float) * 8;
+        p->areas[chn].step  = p->channels * sizeof(float) * 8;
+    }
+
+    // Playback starts from a full ring
+    while (!p->eof && sndx_ring_write_avail(p->ring) >= d->chunk_frames)
+    {
+        err = player_read(p, d->chunk_frames);
+        Goto_(err, __close, "Failed to fill the ring from %s", d->path);
+    }
+
+    p->running = true;
+
+    err = -pthread_create(&p->tid, nullptr, job_player, p);
+    if (err < 0) p->running = false;
+    Goto_(err, __close, "Failed: pthread_create: job_player: %s", strerror(-err));
+
+    *playerp = p;
+
+    return 0;
+
+__close:
+    sndx_player_close(p);
+    *playerp = nullptr;
+
+    return err;
+}
+
+void sndx_player_close(sndx_player_t* p)
+{
+    if (!p) return;
+
+    if (p->running)
+    {
+        __atomic_store_n(&p->running, false, __ATOMIC_RELEASE);
+        sndx_futex_post(&p->wake);
+        pthread_join(p->tid, nullptr);
+    }
+
+    player_unmap(p);
+    if (p->sf) sf_close(p->sf);
+
+    sndx_ring_close(p->ring);
+    Free(p->areas);
+    Free(p->staging);
+    Free(p);
+}
@@ -1,8 +1,7 @@
 #include "sndx/pollfds.h"
+#include "sndx/log.h"
 #include "sndx/timer.h" // get_microseconds
 
-#define MAX_RETRY_COUNT 5
-
 int sndx_pollfds_open( //
     sndx_pollfds_t** pfdsp,
     snd_pcm_t*       play,
@@ -70,29 +69,42 @@ void sndx_pollfds_xrun(sndx_pollfds_t* p, snd_pcm_t* play, snd_pcm_t* capt, outp
 
     // NOTE: Strangely, none of these return on error, instead print error and continue ??
 
-    int err;
+    int         err;
+    sndx_log_t* rtlog = p->log;
 
     // Asserting here to show that sndx_pollfds_xrun can be of return type void
     AssertMsg(play != nullptr, "Invalid playback handle");
     AssertMsg(capt != nullptr, "Invalid capture handle");
 
-    status_t* status;
-    snd_pcm_status_alloca(&status);
+    status_t* local;
+    snd_pcm_status_alloca(&local);
 
     // NOTE: Jack only checks capt, since it uses `if (capt) {...}`,
     //       and we are assured capture handle
-    err = snd_pcm_status(capt, status);
-    SndCheck_(err, "Failed: snd_pcm_status (capt): %s");
+    //       State changed since any snapshot of the cycle, so a fresh one, shared if there is a cache
+    const status_t* status = local;
+    if (p->st_capt && p->st_capt->pcm == capt)
+    {
+        sndx_status_invalidate(p->st_capt);
+        status = sndx_status_get(p->st_capt);
+        err    = status ? 0 : -EIO;
+        if (!status) status = local;
+    }
+    else
+    {
+        err = snd_pcm_status(capt, local);
+    }
+    SndCheck_rt(err, "Failed: snd_pcm_status (capt): %s");
 
     if (snd_pcm_status_get_state(status) == SND_PCM_STATE_SUSPENDED)
     {
-        a_info("**** alsa_pcm: pcm in suspended state, resuming it");
+        r_info("**** alsa_pcm: pcm in suspended state, resuming it");
 
         err = snd_pcm_prepare(capt);
-        SndCheck_(err, "Failed: snd_pcm_prepare after suspend (capt): %s");
+        SndCheck_rt(err, "Failed: snd_pcm_prepare after suspend (capt): %s");
 
         err = snd_pcm_prepare(play);
-        SndCheck_(err, "Failed: snd_pcm_prepare after suspend (play): %s");
+        SndCheck_rt(err, "Failed: snd_pcm_prepare after suspend (play): %s");
     }
 
     if (snd_pcm_status_get_state(status) == SND_PCM_STATE_XRUN)
@@ -105,15 +117,23 @@ void sndx_pollfds_xrun(sndx_pollfds_t* p, snd_pcm_t* play, snd_pcm_t* capt, outp
 
         timersub(&now, &tstamp, &diff);
         p->delayed_usecs = diff.tv_sec * 1000000.0 + diff.tv_usec;
-        a_info("**** alsa_pcm: xrun of at least %.3f msecs", p->delayed_usecs / 1000.0);
 
-        a_info("Repreparing capture");
+        // Record before printing anything, and let the reader dump the preceding cycles
+        sndx_trace_push(p->trace, SNDX_TRACE_XRUN, SNDX_TRACE_CAPT, //
+                        snd_pcm_status_get_avail(status),           //
+                        snd_pcm_status_get_delay(status),           //
+                        (p->delayed_usecs * p->rate) / 1000000);
+        sndx_trace_request_dump(p->trace);
+
+        r_info("**** alsa_pcm: xrun of at least %.3f msecs", p->delayed_usecs / 1000.0);
+
+        r_info("Repreparing capture");
         err = snd_pcm_prepare(capt);
-        SndCheck_(err, "Failed: snd_pcm_prepare after xrun (capt): %s");
+        SndCheck_rt(err, "Failed: snd_pcm_prepare after xrun (capt): %s");
 
-        a_info("Repreparing playback");
+        r_info("Repreparing playback");
         err = snd_pcm_prepare(play);
-        SndCheck_(err, "Failed: snd_pcm_prepare after xrun (play): %s");
+        SndCheck_rt(err, "Failed: snd_pcm_prepare after xrun (play): %s");
     }
 
     // TODO: Jack calls restart here, only point of failure, all else are just checks
@@ -121,7 +141,8 @@ void sndx_pollfds_xrun(sndx_pollfds_t* p, snd_pcm_t* play, snd_pcm_t* capt, outp
 
 sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_pcm_t* capt, output_t* output)
 {
-    int err;
+    int         err;
+    sndx_log_t* rtlog = p->log;
 
     u64 poll_enter  = 0;
     u64 poll_ret    = 0;
@@ -130,19 +151,19 @@ sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_p
 
     // NOTE: Jack does not 'listen' to playback if extra_fd is present
 
-    bool xrun_detected = false; ///< Got xrun, so restrart
-    bool need_playback = true;  ///< Waiting for playback poll
-    bool need_capture  = true;  ///< Waiting for capture poll
+    bool xrun_detected = false;            ///< Got xrun, so restrart
+    bool need_playback = !p->capture_only; ///< Waiting for playback poll
+    bool need_capture  = true;             ///< Waiting for capture poll
 
     p->delayed_usecs = 0; ///< Reset delayed_usecs
 
     // Assuming both playback and capture handles are not null
     // so we avoid all the checks like jack for now
-    RetVal_(play == nullptr, POLLFD_FATAL, "Invalid playback handle");
-    RetVal_(capt == nullptr, POLLFD_FATAL, "Invalid capture handle");
+    RetVal_rt(play == nullptr, POLLFD_FATAL, "Invalid playback handle");
+    RetVal_rt(capt == nullptr, POLLFD_FATAL, "Invalid capture handle");
 
     // Keeping track of retry count here as opposed to jack
-    if (p->retry_count != 0) a_info("Wait: retrying: %d", p->retry_count);
+    if (p->retry_count != 0) r_info("Wait: retrying: %d", p->retry_count);
 
     // i64 count = 0;
     while ((need_playback || need_capture) && !xrun_detected)
@@ -181,36 +202,40 @@ sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_p
         if (poll_result < 0)
         {
             // Currently same as any errno, but jack has special handling for gdb errors here
-            if (errno == EINTR) { RetVal_(EINTR, POLLFD_FATAL, "Poll call failed due to interrupt"); }
-            RetVal_(EINTR, POLLFD_FATAL, "Poll call failed due to interrupt");
+            if (errno == EINTR) { RetVal_rt(EINTR, POLLFD_FATAL, "Poll call failed due to interrupt"); }
+            RetVal_rt(EINTR, POLLFD_FATAL, "Poll call failed due to interrupt");
         }
 
         poll_ret = get_microseconds(); // system time
 
         if (poll_result == 0)
         {
+            sndx_trace_push(p->trace, SNDX_TRACE_TIMEOUT, SNDX_TRACE_DUPLEX, 0, sndx_trace_delay(p->trace, p->st_capt), 0);
+
             p->retry_count++;
-            if (p->retry_count > MAX_RETRY_COUNT)
+            if (p->retry_count > SNDX_POLLFDS_MAX_RETRY_COUNT)
             {
-                RetVal_(-1, POLLFD_FATAL,
-                        "Poll time out"
-                        "   Polled for            = %ld usecs\n"
-                        "   Reached max retry cnt = %d       \n"
-                        "Exiting... ",
-                        poll_ret - poll_enter, MAX_RETRY_COUNT);
+                RetVal_rt(-1, POLLFD_FATAL,
+                          "Poll time out"
+                          "   Polled for            = %ld usecs\n"
+                          "   Reached max retry cnt = %d       \n"
+                          "Exiting... ",
+                          poll_ret - poll_enter, SNDX_POLLFDS_MAX_RETRY_COUNT);
             }
 
             // NOTE: Request restart instead, we are now tracking retry_count within p
             //       jack instead calls `xrun_recovery`
-            RetVal_(-1, POLLFD_NEEDS_RESTART,                   //
-                    "Poll time out, polled for %ld usecs,"      //
-                    "Retrying with a recovery, retry cnt = %d", //
-                    poll_ret - poll_enter, p->retry_count);
+            RetVal_rt(-1, POLLFD_NEEDS_RESTART,                     //
+                      "Poll time out, polled for %ld usecs,"      //
+                      "Retrying with a recovery, retry cnt = %d", //
+                      poll_ret - poll_enter, p->retry_count);
         }
 
         // Reset on successful poll
         p->retry_count = 0;
 
+        sndx_trace_push(p->trace, SNDX_TRACE_WAKEUP, SNDX_TRACE_DUPLEX, 0, sndx_trace_delay(p->trace, p->st_capt), 0);
+
         // Compute delay if poll_next is known and was underestimated
         if (p->poll_next && poll_ret > p->poll_next) { p->delayed_usecs = poll_ret - p->poll_next; }
 
@@ -233,12 +258,13 @@ sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_p
         if (need_playback)
         {
             err = snd_pcm_poll_descriptors_revents(play, &p->addr[0], p->play_nfds, &revents);
-            SndRetVal_(err, POLLFD_FATAL, "Failed: snd_pcm_poll_descriptors_revents (play): %s");
-            if (revents & POLLNVAL) SndRetVal_(-POLLNVAL, POLLFD_FATAL, "Device disconnected (play): %s");
+            SndRetVal_rt(err, POLLFD_FATAL, "Failed: snd_pcm_poll_descriptors_revents (play): %s");
+            if (revents & POLLNVAL) SndRetVal_rt(-POLLNVAL, POLLFD_FATAL, "Device disconnected (play): %s");
             if (revents & POLLERR)
             {
                 xrun_detected = true;
-                a_error("playback xrun");
+                sndx_trace_push(p->trace, SNDX_TRACE_XRUN, SNDX_TRACE_PLAY, 0, sndx_trace_delay(p->trace, p->st_play), 0);
+                r_error("playback xrun");
             } // Failure
             if (revents & POLLOUT) // NOTE: POLLOUT for playback
             {
@@ -249,12 +275,13 @@ sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_p
         if (need_capture)
         {
             err = snd_pcm_poll_descriptors_revents(capt, &p->addr[ci], p->capt_nfds, &revents);
-            SndRetVal_(err, POLLFD_FATAL, "Failed: snd_pcm_poll_descriptors_revents (capt): %s");
-            if (revents & POLLNVAL) SndRetVal_(-POLLNVAL, POLLFD_FATAL, "Device disconnected (capt): %s");
+            SndRetVal_rt(err, POLLFD_FATAL, "Failed: snd_pcm_poll_descriptors_revents (capt): %s");
+            if (revents & POLLNVAL) SndRetVal_rt(-POLLNVAL, POLLFD_FATAL, "Device disconnected (capt): %s");
             if (revents & POLLERR)
             {
                 xrun_detected = true;
-                a_error("capture xrun");
+                sndx_trace_push(p->trace, SNDX_TRACE_XRUN, SNDX_TRACE_CAPT, 0, sndx_trace_delay(p->trace, p->st_capt), 0);
+                r_error("capture xrun");
             } // Failure
             if (revents & POLLIN) // NOTE: POLLIN for capture
             {
@@ -266,7 +293,7 @@ sndx_pollfds_error_t sndx_pollfds_wait(sndx_pollfds_t* p, snd_pcm_t* play, snd_p
     }
 
     // NOTE: Request restart instead, we are now tracking retry_count within p
-    RetVal_(xrun_detected, POLLFD_NEEDS_RESTART, "Xrun detected, needs retart");
+    RetVal_rt(xrun_detected, POLLFD_NEEDS_RESTART, "Xrun detected, needs retart");
 
     // NOTE: jack also gets avail here as minimum of capt and play
     // we extract it to a different function
@@ -284,9 +311,11 @@ sndx_pollfds_error_t sndx_pollfds_avail( //
     sframes_t*      avail,
     output_t*       output)
 {
+    sndx_log_t* rtlog = p->log;
+
     // reason for no INT_MAX
-    RetVal_(play == nullptr, POLLFD_FATAL, "Invalid playback handle");
-    RetVal_(capt == nullptr, POLLFD_FATAL, "Invalid capture handle");
+    RetVal_rt(play == nullptr, POLLFD_FATAL, "Invalid playback handle");
+    RetVal_rt(capt == nullptr, POLLFD_FATAL, "Invalid capture handle");
 
     // NOTE: In case of unknown avail_update, using FATAL
     //       jack just uses the value after printing an error
@@ -295,18 +324,28 @@ sndx_pollfds_error_t sndx_pollfds_avail( //
     if (capt_avail < 0)
     {
         if (capt_avail == -EPIPE) { return POLLFD_NEEDS_RESTART; }
-        else RetVal_(capt_avail, POLLFD_FATAL, "Unknown avail_update value: %ld", capt_avail);
+        else RetVal_rt(capt_avail, POLLFD_FATAL, "Unknown avail_update value: %ld", capt_avail);
     }
 
     sframes_t play_avail = snd_pcm_avail_update(play);
     if (play_avail < 0)
     {
         if (play_avail == -EPIPE) { return POLLFD_NEEDS_RESTART; }
-        else RetVal_(play_avail, POLLFD_FATAL, "Unknown avail_update value: %ld", play_avail);
+        else RetVal_rt(play_avail, POLLFD_FATAL, "Unknown avail_update value: %ld", play_avail);
     }
 
-    // Choose the minimum of the two
-    *avail = capt_avail < play_avail ? capt_avail : play_avail;
+    // Start of the cycle for the status snapshots
+    if (p->st_capt) sndx_status_set_avail(p->st_capt, capt_avail);
+    if (p->st_play) sndx_status_set_avail(p->st_play, play_avail);
+
+    sframes_t capt_delay = sndx_trace_delay(p->trace, p->st_capt);
+    sframes_t play_delay = sndx_trace_delay(p->trace, p->st_play);
+
+    sndx_trace_push(p->trace, SNDX_TRACE_AVAIL, SNDX_TRACE_CAPT, capt_avail, capt_delay, 0);
+    sndx_trace_push(p->trace, SNDX_TRACE_AVAIL, SNDX_TRACE_PLAY, play_avail, play_delay, 0);
+
+    // Choose the minimum of the two, unless playback is not on the same clock
+    *avail = capt_avail < play_avail || p->capture_only ? capt_avail : play_avail;
 
     // NOTE: Another connection with duplex, need period_size
     *avail = *avail - (*avail % p->period_size);
@@ -0,0 +1,384 @@
+/** @file pool.c
+ *  @brief RT worker pool, @see pool.h
+ */
+#include "sndx/pool.h"
+#include "sndx/sys.h"
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define pool_relax() _mm_pause()
+#else
+#define pool_relax() __asm__ volatile("" ::: "memory")
+#endif
+
+/** @brief Owner only. False if full. */
+static bool deque_push(sndx_pool_deque_t* d, sndx_pool_task_t task)
+{
+    i64 b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    i64 t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    if (b - t >= SNDX_POOL_DEQUE_CAPACITY) return false;
+
+    d->tasks[b & (SNDX_POOL_DEQUE_CAPACITY - 1)] = task;
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/** @brief Owner only, newest first. */
+static bool deque_pop(sndx_pool_deque_t* d, sndx_pool_task_t* task)
+{
+    i64 b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if (t > b)
+    {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *task = d->tasks[b & (SNDX_POOL_DEQUE_CAPACITY - 1)];
+    if (t < b) return true;
+
+    // Last one, race thieves for it
+    bool won = __atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+
+    return won;
+}
+
+/** @brief Anyone, oldest first. */
+static bool deque_steal(sndx_pool_deque_t* d, sndx_pool_task_t* task)
+{
+    i64 t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+    if (t >= b) return false;
+
+    *task = d->tasks[t & (SNDX_POOL_DEQUE_CAPACITY - 1)];
+
+    return __atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/** @brief Own deque first, then one round over the others starting next to us. */
+static bool pool_find(sndx_pool_t* pool, sndx_pool_worker_t* w, sndx_pool_task_t* task)
+{
+    if (deque_pop(&w->deque, task)) return true;
+
+    RANGE(k, 1, pool->nworkers)
+    {
+        sndx_pool_worker_t* victim = &pool->workers[(w->id + k) % pool->nworkers];
+
+        if (deque_steal(&victim->deque, task))
+        {
+            w->stolen++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void pool_execute(sndx_pool_t* pool, sndx_pool_worker_t* w, sndx_pool_task_t* task)
+{
+    task->fn(pool, w->id, task->arg, task->index);
+    w->executed++;
+
+    // Last task of the run wakes the caller, if it went to sleep
+    if (__atomic_sub_fetch(&pool->remaining, 1, __ATOMIC_SEQ_CST) == 0 &&
+        __atomic_load_n(&pool->waiting, __ATOMIC_SEQ_CST))
+        sndx_futex_wake(&pool->remaining, 1);
+}
+
+/** @brief Tasks were added, wake sleepers if there are any. */
+static void pool_signal(sndx_pool_t* pool)
+{
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->nsleeping, __ATOMIC_SEQ_CST)) sndx_futex_wake(&pool->generation, INT32_MAX);
+}
+
+static void* job_worker(void* data)
+{
+    sndx_pool_worker_t* w    = data;
+    sndx_pool_t*        pool = w->pool;
+    sndx_pool_task_t    task;
+
+    while (__atomic_load_n(&pool->running, __ATOMIC_ACQUIRE))
+    {
+        // Read before looking, a push after the look changes it and the wait returns
+        u32 seen = __atomic_load_n(&pool->generation, __ATOMIC_SEQ_CST);
+
+        if (pool_find(pool, w, &task))
+        {
+            pool_execute(pool, w, &task);
+            continue;
+        }
+
+        bool found = false;
+        RANGE(i, pool->spin)
+        {
+            if (__atomic_load_n(&pool->generation, __ATOMIC_RELAXED) != seen) break;
+            if (__atomic_load_n(&pool->remaining, __ATOMIC_RELAXED) && pool_find(pool, w, &task))
+            {
+                found = true;
+                break;
+            }
+            pool_relax();
+        }
+
+        if (found)
+        {
+            pool_execute(pool, w, &task);
+            continue;
+        }
+
+        if (__atomic_load_n(&pool->generation, __ATOMIC_SEQ_CST) != seen) continue;
+
+        __atomic_add_fetch(&pool->nsleeping, 1, __ATOMIC_SEQ_CST);
+        w->sleeps++;
+        sndx_futex_wait(&pool->generation, seen, nullptr);
+        __atomic_sub_fetch(&pool->nsleeping, 1, __ATOMIC_SEQ_CST);
+    }
+
+    return nullptr;
+}
+
+/** @brief Cores in /sys/devices/system/cpu/isolated ("2-3,6"), up to `capacity`. */
+static u32 pool_isolated(int* cpus, u32 capacity)
+{
+    FILE* f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if (!f) return 0;
+
+    char line[256] = {};
+    bool ok        = fgets(line, sizeof(line), f) != nullptr;
+    fclose(f);
+    if (!ok) return 0;
+
+    u32   n = 0;
+    char* p = line;
+
+    while (n < capacity)
+    {
+        char* end;
+        long  lo = strtol(p, &end, 10);
+        if (end == p) break;
+
+        long hi = lo;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+
+        for (long c = lo; c <= hi && n < capacity; c++) cpus[n++] = (int)c;
+
+        if (*end != ',') break;
+        p = end + 1;
+    }
+
+    return n;
+}
+
+/** @brief Worker thread on `cpu` (-1 for any) at SCHED_FIFO `priority` (0 for the default policy), errno on failure. */
+static int pool_create(sndx_pool_worker_t* w, int cpu, int priority)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+
+    if (priority > 0)
+    {
+        struct sched_param param = {.sched_priority = priority};
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int err = pthread_create(&w->tid, &attr, job_worker, w);
+
+    pthread_attr_destroy(&attr);
+
+    return err;
+}
+
+/** @brief Thread at SCHED_FIFO on its core, falls back to the default policy without the rights. */
+static int pool_spawn(sndx_pool_t* pool, sndx_pool_worker_t* w)
+{
+    int err;
+
+    err   = pool_create(w, w->cpu, pool->priority);
+    w->rt = !err && pool->priority > 0;
+
+    // No rights for SCHED_FIFO: same core under the default policy, pinning needs no privilege
+    if ((err == EPERM || err == EINVAL) && pool->priority > 0) err = pool_create(w, w->cpu, 0);
+
+    // Core not there (or outside the allowed set): not pinned
+    if (err == EINVAL && w->cpu >= 0)
+    {
+        err    = pool_create(w, -1, 0);
+        w->cpu = -1;
+    }
+
+    w->alive = !err;
+
+    return -err;
+}
+
+int sndx_pool_open(sndx_pool_t** poolp, u32 nthreads, const int* cpus, int priority, output_t* output)
+{
+    int err;
+
+    sndx_pool_t* pool;
+    pool = aligned_alloc(64, (sizeof(*pool) + 63) & ~(usize)63);
+    RetVal_(!pool, -ENOMEM, "Failed aligned_alloc sndx_pool_t* pool");
+    memset(pool, 0, sizeof(*pool));
+
+    pool->nworkers = nthreads + 1;
+    pool->priority = priority;
+    pool->spin     = SNDX_POOL_SPIN;
+    pool->running  = true;
+    pool->out      = output;
+
+    usize bytes   = (pool->nworkers * sizeof(sndx_pool_worker_t) + 63) & ~(usize)63;
+    pool->workers = aligned_alloc(64, bytes);
+    err           = -(!pool->workers);
+    Goto_(err, __close, "Failed aligned_alloc sndx_pool_worker_t* pool->workers");
+    memset(pool->workers, 0, bytes);
+
+    // Explicit cores, else isolated ones round robin, else none
+    int isolated[64];
+    u32 nisolated = cpus ? 0 : pool_isolated(isolated, 64);
+
+    RANGE(i, pool->nworkers)
+    {
+        sndx_pool_worker_t* w = &pool->workers[i];
+
+        w->pool = pool;
+        w->id   = (u32)i;
+        w->cpu  = -1;
+
+        if (i == 0) continue;
+
+        if (cpus)
+            w->cpu = cpus[i - 1];
+        else if (nisolated)
+            w->cpu = isolated[(i - 1) % nisolated];
+
+        err = pool_spawn(pool, w);
+        Goto_(err, __close, "Failed pthread_create: worker %ld: %s", i, strerror(-err));
+    }
+
+    *poolp = pool;
+
+    return 0;
+
+__close:
+    sndx_pool_close(pool);
+    *poolp = nullptr;
+
+    return err;
+}
+
+void sndx_pool_close(sndx_pool_t* pool)
+{
+    if (!pool) return;
+
+    __atomic_store_n(&pool->running, false, __ATOMIC_RELEASE);
+
+    if (pool->workers)
+    {
+        pool_signal(pool);
+
+        RANGE(i, 1, pool->nworkers)
+        {
+            if (pool->workers[i].alive) pthread_join(pool->workers[i].tid, nullptr);
+        }
+    }
+
+    Free(pool->workers);
+    Free(pool);
+}
+
+void sndx_pool_push(sndx_pool_t* pool, u32 worker, sndx_pool_fn_t fn, void* arg, u32 index)
+{
+    sndx_pool_worker_t* w    = &pool->workers[worker];
+    sndx_pool_task_t    task = {.fn = fn, .arg = arg, .index = index};
+
+    __atomic_add_fetch(&pool->remaining, 1, __ATOMIC_SEQ_CST);
+
+    // Full: no room to share it, run it here
+    if (!deque_push(&w->deque, task))
+    {
+        pool_execute(pool, w, &task);
+        return;
+    }
+
+    pool_signal(pool);
+}
+
+void sndx_pool_run(sndx_pool_t* pool, sndx_pool_fn_t fn, void* arg, u32 ntasks)
+{
+    sndx_pool_worker_t* w = &pool->workers[0];
+    sndx_pool_task_t    task;
+
+    if (!ntasks) return;
+
+    pool->runs++;
+
+    // Count first, so no worker brings it to zero before all are queued
+    __atomic_add_fetch(&pool->remaining, ntasks, __ATOMIC_SEQ_CST);
+
+    u32 queued = 0;
+    while (queued < ntasks && deque_push(&w->deque, (sndx_pool_task_t){.fn = fn, .arg = arg, .index = queued}))
+        queued++;
+
+    pool_signal(pool);
+
+    // What did not fit is ours
+    RANGE(i, queued, ntasks)
+    {
+        task = (sndx_pool_task_t){.fn = fn, .arg = arg, .index = (u32)i};
+        pool_execute(pool, w, &task);
+    }
+
+    // Help until nothing is left to take, then wait for the tasks still running elsewhere
+    while (__atomic_load_n(&pool->remaining, __ATOMIC_SEQ_CST))
+    {
+        if (pool_find(pool, w, &task))
+        {
+            pool_execute(pool, w, &task);
+            continue;
+        }
+
+        u32 spins = 0;
+        while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) && spins++ < pool->spin) pool_relax();
+
+        __atomic_store_n(&pool->waiting, 1, __ATOMIC_SEQ_CST);
+
+        u32 remaining = __atomic_load_n(&pool->remaining, __ATOMIC_SEQ_CST);
+        if (remaining) sndx_futex_wait(&pool->remaining, remaining, nullptr);
+
+        __atomic_store_n(&pool->waiting, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+void sndx_pool_dump(sndx_pool_t* pool, output_t* output)
+{
+    a_info("Pool: %d threads + caller, priority %d, spin %d, %ld runs", pool->nworkers - 1, pool->priority,
+           pool->spin, pool->runs);
+
+    RANGE(i, pool->nworkers)
+    {
+        sndx_pool_worker_t* w = &pool->workers[i];
+
+        a_info("  %2ld: cpu %3d %-5s executed %8ld stolen %8ld sleeps %8ld", i, w->cpu,
+               i == 0 ? "call" : w->rt ? "fifo" : "other", w->executed, w->stolen, w->sleeps);
+    }
+}
@@ -0,0 +1,301 @@
+/** @file recorder.c
+ *  @brief Streaming disk recorder, @see recorder.h
+ */
+#define _GNU_SOURCE // O_DIRECT, fallocate
+#include "sndx/recorder.h"
+#include "sndx/sys.h"
+#include <fcntl.h>
+
+static usize recorder_frame_bytes(sndx_recorder_t* rec) { return rec->desc.channels * sizeof(float); }
+
+void sndx_recorder_dump(sndx_recorder_t* rec, output_t* output)
+{
+    u64 writes = __atomic_load_n(&rec->writes, __ATOMIC_RELAXED);
+    u64 sum    = __atomic_load_n(&rec->disk_sum_nsecs, __ATOMIC_RELAXED);
+    u64 high   = __atomic_load_n(&rec->high_water, __ATOMIC_RELAXED);
+
+    a_info("Recorder: %s", rec->desc.path);
+    a_info("  mode       : %s", rec->sf ? "sndfile" : (rec->direct ? "raw, O_DIRECT" : "raw, buffered"));
+    a_info("  channels   : %d", rec->desc.channels);
+    a_info("  chunk      : %ld frames", rec->desc.chunk_frames);
+    a_info("  ring       : %ld frames, high water %ld (%.0f%%)", rec->ring->capacity, high,
+           high * 100.0 / rec->ring->capacity);
+    a_info("  pushed     : %ld", __atomic_load_n(&rec->pushed, __ATOMIC_RELAXED));
+    a_info("  dropped    : %ld", __atomic_load_n(&rec->dropped, __ATOMIC_RELAXED));
+    a_info("  written    : %ld", __atomic_load_n(&rec->written, __ATOMIC_RELAXED));
+    a_info("  reserved   : %.1f MiB", __atomic_load_n(&rec->reserved, __ATOMIC_RELAXED) / 1048576.0);
+    a_info("  writes     : %ld, %ld slower than realtime", writes, __atomic_load_n(&rec->disk_late, __ATOMIC_RELAXED));
+    a_info("  disk (us)  : last %.0f, max %.0f, mean %.0f",
+           __atomic_load_n(&rec->disk_last_nsecs, __ATOMIC_RELAXED) * 1e-3,
+           __atomic_load_n(&rec->disk_max_nsecs, __ATOMIC_RELAXED) * 1e-3, writes ? sum * 1e-3 / writes : 0.0);
+
+    int err = __atomic_load_n(&rec->err, __ATOMIC_RELAXED);
+    if (err < 0) a_info("  error      : %s", strerror(-err));
+}
+
+/** @brief Keep at least half a step reserved past `end`, one step at a time. */
+static void recorder_reserve(sndx_recorder_t* rec, off_t end)
+{
+    if (!rec->prealloc || end + rec->prealloc / 2 <= rec->reserved) return;
+
+    // Not supported, or no space left: writes find out on their own
+    if (fallocate(rec->fd, FALLOC_FL_KEEP_SIZE, rec->reserved, rec->prealloc) < 0)
+    {
+        rec->prealloc = 0;
+        return;
+    }
+
+    __atomic_store_n(&rec->reserved, rec->reserved + rec->prealloc, __ATOMIC_RELAXED);
+}
+
+/** @brief Up to `frames` from the ring to disk in one call, a partial chunk is only written at close. */
+static int recorder_write(sndx_recorder_t* rec, uframes_t frames)
+{
+    int       err    = 0;
+    usize     bytes  = 0;
+    output_t* output = rec->output;
+
+    frames = sndx_ring_read_to_float_areas(rec->ring, rec->areas, 0, rec->desc.channels, frames);
+    if (!frames) return 0;
+
+    bytes = frames * recorder_frame_bytes(rec);
+    recorder_reserve(rec, rec->bytes + (off_t)bytes);
+
+    u64 start = sndx_nsecs();
+
+    if (rec->sf)
+    {
+        sf_count_t n = sf_writef_float(rec->sf, rec->chunk, (sf_count_t)frames);
+        err          = -(n != (sf_count_t)frames) * EIO;
+        Goto_(err, __error, "Failed sf_writef_float: %s", sf_strerror(rec->sf));
+    }
+    else
+    {
+        // O_DIRECT takes whole blocks, the tail is padded and truncated away at close
+        usize len = rec->direct ? (bytes + SNDX_RECORDER_ALIGN - 1) & ~(usize)(SNDX_RECORDER_ALIGN - 1) : bytes;
+        if (len > bytes) memset((char*)rec->chunk + bytes, 0, len - bytes);
+
+        isize n = write(rec->fd, rec->chunk, len);
+        err     = n < 0 ? -errno : -(n != (isize)len) * EIO;
+        Goto_(err, __error, "Failed write %s: %s", rec->desc.path, strerror(-err));
+    }
+
+    u64 nsecs = sndx_nsecs() - start;
+
+    rec->bytes += (off_t)bytes;
+
+    __atomic_add_fetch(&rec->written, frames, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&rec->writes, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&rec->disk_sum_nsecs, nsecs, __ATOMIC_RELAXED);
+    __atomic_store_n(&rec->disk_last_nsecs, nsecs, __ATOMIC_RELAXED);
+    if (nsecs > rec->disk_max_nsecs) __atomic_store_n(&rec->disk_max_nsecs, nsecs, __ATOMIC_RELAXED);
+    if (nsecs * rec->desc.rate > frames * 1000000000ULL) __atomic_add_fetch(&rec->disk_late, 1, __ATOMIC_RELAXED);
+
+    return 0;
+
+__error:
+    __atomic_store_n(&rec->err, err, __ATOMIC_RELAXED);
+
+    return err;
+}
+
+static void* job_recorder(void* data)
+{
+    sndx_recorder_t* rec   = data;
+    uframes_t        chunk = rec->desc.chunk_frames;
+
+    // Only a missed wakeup would need the timeout, a chunk is a long time
+    tspec_t timeout = sndx_tspec_from_nsecs(chunk * 1000000000ULL / rec->desc.rate);
+
+    while (__atomic_load_n(&rec->running, __ATOMIC_ACQUIRE))
+    {
+        u32 wake = __atomic_load_n(&rec->wake, __ATOMIC_ACQUIRE);
+
+        if (sndx_ring_read_avail(rec->ring) < chunk)
+        {
+            sndx_futex_wait(&rec->wake, wake, &timeout);
+            continue;
+        }
+
+        if (recorder_write(rec, chunk) < 0) break;
+    }
+
+    return nullptr;
+}
+
+uframes_t sndx_recorder_push(sndx_recorder_t* rec, const area_t* areas, uframes_t offset, uframes_t frames)
+{
+    uframes_t chunk  = rec->desc.chunk_frames;
+    uframes_t before = sndx_ring_read_avail(rec->ring);
+    uframes_t queued = sndx_ring_write_from_float_areas(rec->ring, areas, offset, rec->desc.channels, frames);
+    uframes_t after  = sndx_ring_read_avail(rec->ring);
+
+    __atomic_add_fetch(&rec->pushed, queued, __ATOMIC_RELAXED);
+    if (queued < frames) __atomic_add_fetch(&rec->dropped, frames - queued, __ATOMIC_RELAXED);
+
+    // Single producer, nobody else raises it
+    if (after > rec->high_water) __atomic_store_n(&rec->high_water, after, __ATOMIC_RELAXED);
+
+    // The writer sleeps below a chunk, wake it once when this push crosses it
+    if (before < chunk && after >= chunk) sndx_futex_post(&rec->wake);
+
+    return queued;
+}
+
+static int recorder_open_file(sndx_recorder_t* rec, output_t* output)
+{
+    int err;
+
+    const sndx_recorder_desc_t* desc = &rec->desc;
+
+    if (desc->mode == SNDX_RECORDER_DIRECT)
+    {
+        rec->direct = true;
+        rec->fd     = open(desc->path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+
+        // tmpfs and some network filesystems refuse O_DIRECT
+        if (rec->fd < 0 && errno == EINVAL)
+        {
+            a_info("No O_DIRECT on %s, writing through the page cache", desc->path);
+            rec->direct = false;
+            rec->fd     = open(desc->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+
+        err = rec->fd < 0 ? -errno : 0;
+        Return_(err, "Failed open %s: %s", desc->path, strerror(-err));
+
+        return 0;
+    }
+
+    // libsndfile may read back its header, and the descriptor stays ours to truncate at close
+    rec->fd = open(desc->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    err     = rec->fd < 0 ? -errno : 0;
+    Return_(err, "Failed open %s: %s", desc->path, strerror(-err));
+
+    SF_INFO info = {
+        .samplerate = (int)desc->rate,
+        .channels   = (int)desc->channels,
+        .format     = desc->sf_format,
+    };
+
+    rec->sf = sf_open_fd(rec->fd, SFM_WRITE, &info, SF_FALSE);
+    err     = -(!rec->sf) * EINVAL;
+    Return_(err, "Failed sf_open_fd %s: %s", desc->path, sf_strerror(nullptr));
+
+    return 0;
+}
+
+int sndx_recorder_open(sndx_recorder_t** recp, const sndx_recorder_desc_t* desc, output_t* output)
+{
+    int err;
+
+    sndx_recorder_t* rec;
+    rec = calloc(1, sizeof(*rec));
+    RetVal_(!rec, -ENOMEM, "Failed calloc sndx_recorder_t* rec");
+
+    rec->fd     = -1;
+    rec->desc   = *desc;
+    rec->output = output;
+
+    sndx_recorder_desc_t* d = &rec->desc;
+
+    err = -(!d->path || !d->channels || !d->rate) * EINVAL;
+    Goto_(err, __close, "Recorder needs a path, channels and rate");
+
+    // Whole 4 KiB blocks of a float sample per channel, so every chunk is O_DIRECT aligned
+    if (!d->chunk_frames) d->chunk_frames = SNDX_RECORDER_CHUNK;
+    d->chunk_frames = (d->chunk_frames + 1023) & ~(uframes_t)1023;
+
+    if (!d->ring_frames) d->ring_frames = 8 * d->chunk_frames;
+    if (d->ring_frames < 2 * d->chunk_frames) d->ring_frames = 2 * d->chunk_frames;
+
+    uframes_t capacity = 1;
+    while (capacity < d->ring_frames) capacity <<= 1;
+    d->ring_frames = capacity;
+
+    if (!d->sf_format) d->sf_format = SF_FORMAT_W64 | SF_FORMAT_FLOAT;
+    if (d->prealloc_seconds == 0.0) d->prealloc_seconds = 60.0;
+
+    err = sndx_ring_open(&rec->ring, SND_PCM_FORMAT_FLOAT, d->channels, d->ring_frames, output);
+    Goto_(err, __close, "Failed sndx_ring_open");
+
+    usize bytes = d->chunk_frames * recorder_frame_bytes(rec);
+    rec->chunk  = aligned_alloc(SNDX_RECORDER_ALIGN, bytes);
+    err         = -(!rec->chunk);
+    Goto_(err, __close, "Failed aligned_alloc float* rec->chunk");
+
+    rec->areas = calloc(d->channels, sizeof(area_t));
+    err        = -(!rec->areas);
+    Goto_(err, __close, "Failed calloc area_t* rec->areas");
+
+    RANGE(chn, d->channels)
+    {
+        rec->areas[chn].addr  = rec->chunk;
+        rec->areas[chn].first = chn * sizeof(float) * 8;
+        rec->areas[chn].step  = d->channels * sizeof(float) * 8;
+    }
+
+    err = recorder_open_file(rec, output);
+    Goto_(err, __close, "Failed recorder_open_file");
+
+    if (d->prealloc_seconds > 0.0)
+    {
+        rec->prealloc = (off_t)(d->prealloc_seconds * d->rate) * (off_t)recorder_frame_bytes(rec);
+        recorder_reserve(rec, 0);
+        if (!rec->prealloc) a_info("No fallocate on %s, recording without reserved space", d->path);
+    }
+
+    rec->running = true;
+
+    err = -pthread_create(&rec->tid, nullptr, job_recorder, rec);
+    if (err < 0) rec->running = false;
+    Goto_(err, __close, "Failed: pthread_create: job_recorder: %s", strerror(-err));
+
+    *recp = rec;
+
+    return 0;
+
+__close:
+    sndx_recorder_close(rec);
+    *recp = nullptr;
+
+    return err;
+}
+
+int sndx_recorder_close(sndx_recorder_t* rec)
+{
+    if (!rec) return 0;
+
+    if (rec->running)
+    {
+        __atomic_store_n(&rec->running, false, __ATOMIC_RELEASE);
+        sndx_futex_post(&rec->wake);
+        pthread_join(rec->tid, nullptr);
+    }
+
+    // Whatever came in after the last chunk, the tail included
+    while (rec->ring && !rec->err && sndx_ring_read_avail(rec->ring))
+    {
+        if (recorder_write(rec, rec->desc.chunk_frames) < 0) break;
+    }
+
+    if (rec->sf) sf_close(rec->sf);
+
+    if (rec->fd >= 0)
+    {
+        // Drops the O_DIRECT padding, and the reserve past the end even at the same size (ext4, xfs)
+        off_t size = rec->sf ? lseek(rec->fd, 0, SEEK_END) : rec->bytes;
+        if (size >= 0 && ftruncate(rec->fd, size) < 0 && !rec->err) rec->err = -errno;
+
+        close(rec->fd);
+    }
+
+    int err = rec->err;
+
+    sndx_ring_close(rec->ring);
+    Free(rec->areas);
+    Free(rec->chunk);
+    Free(rec);
+
+    return err;
+}
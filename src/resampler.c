@@ -0,0 +1,339 @@
+/** @file resampler.c
+ *  @brief Polyphase windowed sinc resampler on non-interleaved float areas.
+ */
+#include "sndx/resampler.h"
+#include <math.h>
+
+/** @brief Eight floats, maps to one AVX or two SSE/NEON registers. */
+typedef float v8f __attribute__((vector_size(32)));
+
+/** @brief Same, for loads from input at any frame (aligned to a float only). */
+typedef float v8f_u __attribute__((vector_size(32), aligned(4), may_alias));
+
+typedef struct
+{
+    u32 ntaps;   ///< Filter length at a ratio of 1
+    u32 nphases; ///< Table rows
+    f64 cutoff;  ///< Relative to Nyquist
+    f64 beta;    ///< Kaiser window
+
+} resampler_filter_t;
+
+static const resampler_filter_t filters[] = {
+    [SNDX_RESAMPLER_BEST]    = {.ntaps = 64, .nphases = 256, .cutoff = 0.97, .beta = 10.0},
+    [SNDX_RESAMPLER_MEDIUM]  = {.ntaps = 32, .nphases = 128, .cutoff = 0.94, .beta = 8.0},
+    [SNDX_RESAMPLER_FASTEST] = {.ntaps = 16, .nphases = 64, .cutoff = 0.90, .beta = 6.0},
+    [SNDX_RESAMPLER_LINEAR]  = {.ntaps = 2, .nphases = 0, .cutoff = 1.0, .beta = 0.0},
+};
+
+static const char* quality_names[] = {
+    [SNDX_RESAMPLER_BEST]    = "best",    //
+    [SNDX_RESAMPLER_MEDIUM]  = "medium",  //
+    [SNDX_RESAMPLER_FASTEST] = "fastest", //
+    [SNDX_RESAMPLER_LINEAR]  = "linear",
+};
+
+const char* sndx_resampler_quality_name(sndx_resampler_quality_t quality)
+{
+    if (quality > SNDX_RESAMPLER_QUALITY_LAST) return "unknown";
+    return quality_names[quality];
+}
+
+void sndx_resampler_dump(sndx_resampler_t* r, output_t* output)
+{
+    a_info("Resampler:");
+    a_info("  quality   : %s", sndx_resampler_quality_name(r->quality));
+    a_info("  channels  : %d", r->channels);
+    a_info("  taps      : %d", r->ntaps);
+    a_info("  phases    : %d", r->nphases);
+    a_info("  cutoff    : %.3f", r->cutoff);
+    a_info("  ratio     : %.9f", 1.0 / r->step);
+    a_info("  latency   : %.1f frames", sndx_resampler_latency(r));
+    a_info("  max frames: %ld in, %ld out", r->max_frames, r->max_out);
+}
+
+/** @brief Zeroth order modified Bessel function of the first kind, for the Kaiser window. */
+static f64 bessel_i0(f64 x)
+{
+    f64 sum  = 1.0;
+    f64 term = 1.0;
+
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum  += term;
+        if (term < sum * 1e-12) break;
+    }
+
+    return sum;
+}
+
+/** @brief Row p holds the taps for an output frame p / nphases past the middle of the filter, normalized. */
+static void resampler_build_table(sndx_resampler_t* r, f64 beta)
+{
+    u32 half = r->ntaps / 2;
+    f64 i0b  = bessel_i0(beta);
+
+    RANGE(p, r->nphases + 1)
+    {
+        float* row  = &r->table[p * r->ntaps];
+        f64    frac = (f64)p / r->nphases;
+        f64    sum  = 0;
+
+        RANGE(k, r->ntaps)
+        {
+            f64 d = (f64)k - (half - 1) - frac;
+            f64 x = d / half;
+            f64 w = fabs(x) < 1.0 ? bessel_i0(beta * sqrt(1.0 - x * x)) / i0b : 0.0;
+            f64 s = fabs(d) < 1e-12 ? 1.0 : sin(M_PI * r->cutoff * d) / (M_PI * r->cutoff * d);
+
+            row[k]  = (float)(r->cutoff * s * w);
+            sum    += row[k];
+        }
+
+        // Unity gain at DC for every phase
+        RANGE(k, r->ntaps) { row[k] = (float)(row[k] / sum); }
+    }
+}
+
+int sndx_resampler_open(                 //
+    sndx_resampler_t**       rp,         //
+    sndx_resampler_quality_t quality,    //
+    u32                      channels,   //
+    f64                      ratio,      //
+    uframes_t                max_frames, //
+    output_t*                output)
+{
+    int err;
+
+    RetVal_(quality > SNDX_RESAMPLER_QUALITY_LAST, -EINVAL, "Failed: unknown quality %d", quality);
+    RetVal_(ratio <= 0, -EINVAL, "Failed: ratio %f", ratio);
+
+    sndx_resampler_t* r;
+    r = calloc(1, sizeof(*r));
+    RetVal_(!r, -ENOMEM, "Failed calloc sndx_resampler_t* r");
+
+    const resampler_filter_t* f = &filters[quality];
+
+    r->quality     = quality;
+    r->channels    = channels;
+    r->max_frames  = max_frames;
+    r->max_out     = (uframes_t)ceil(max_frames * ratio * 1.01) + 2;
+    r->ntaps       = f->ntaps;
+    r->nphases     = f->nphases;
+    r->cutoff      = f->cutoff;
+    r->step_target = 1.0 / ratio;
+
+    if (quality != SNDX_RESAMPLER_LINEAR)
+    {
+        // Downsampling: lower the cutoff below the output Nyquist, the filter gets longer by as much
+        if (ratio < 1.0)
+        {
+            u32 half  = (u32)ceil(f->ntaps / 2 / ratio);
+            half      = (half + 3) & ~3u;
+            r->ntaps  = 2 * half;
+            r->cutoff = f->cutoff * ratio;
+        }
+
+        usize bytes = (r->nphases + 1) * r->ntaps * sizeof(float);
+        r->table    = aligned_alloc(32, (bytes + 31) & ~(usize)31);
+        err         = -(!r->table);
+        Goto_(err, __close, "Failed aligned_alloc float* r->table");
+
+        resampler_build_table(r, f->beta);
+    }
+
+    r->work = calloc(channels * (r->ntaps - 1 + max_frames), sizeof(float));
+    err     = -(!r->work);
+    Goto_(err, __close, "Failed calloc float* r->work");
+
+    r->index = calloc(r->max_out, sizeof(isize));
+    err      = -(!r->index);
+    Goto_(err, __close, "Failed calloc isize* r->index");
+
+    r->phase = calloc(r->max_out, sizeof(u32));
+    err      = -(!r->phase);
+    Goto_(err, __close, "Failed calloc u32* r->phase");
+
+    r->alpha = calloc(r->max_out, sizeof(float));
+    err      = -(!r->alpha);
+    Goto_(err, __close, "Failed calloc float* r->alpha");
+
+    sndx_resampler_reset(r);
+
+    *rp = r;
+
+    return 0;
+
+__close:
+    sndx_resampler_close(r);
+    *rp = nullptr;
+
+    return err;
+}
+
+void sndx_resampler_close(sndx_resampler_t* r)
+{
+    if (!r) return;
+
+    Free(r->table);
+    Free(r->work);
+    Free(r->index);
+    Free(r->phase);
+    Free(r->alpha);
+    Free(r);
+}
+
+void sndx_resampler_reset(sndx_resampler_t* r)
+{
+    memset(r->work, 0, r->channels * (r->ntaps - 1 + r->max_frames) * sizeof(float));
+
+    // Linear starts on the first input frame, sinc fades in from the silent history
+    r->pos  = r->quality == SNDX_RESAMPLER_LINEAR ? 1.0 : 0.0;
+    r->step = r->step_target;
+}
+
+void sndx_resampler_set_ratio(sndx_resampler_t* r, f64 ratio) { r->step_target = 1.0 / ratio; }
+
+f64 sndx_resampler_latency(sndx_resampler_t* r)
+{
+    return r->quality == SNDX_RESAMPLER_LINEAR ? 0.0 : r->ntaps / 2.0;
+}
+
+/** @brief Float pointer of planar area at offset, nullptr if the area is not planar float. */
+static float* resampler_area_ptr(const area_t* area, uframes_t offset)
+{
+    if (area->step != sizeof(float) * 8 || area->first % 8) return nullptr;
+
+    return (float*)((char*)area->addr + area->first / 8) + offset;
+}
+
+/** @brief Both dot products of `x` with neighbouring rows in a single pass. */
+static inline void resampler_dot2(const float* x, const float* h0, const float* h1, u32 ntaps, float* d0, float* d1)
+{
+    v8f a0 = {};
+    v8f a1 = {};
+
+    for (u32 k = 0; k < ntaps; k += 8)
+    {
+        v8f xv  = *(const v8f_u*)&x[k];
+        a0     += xv * *(const v8f*)&h0[k];
+        a1     += xv * *(const v8f*)&h1[k];
+    }
+
+    float s0 = 0;
+    float s1 = 0;
+
+    RANGE(i, 8)
+    {
+        s0 += a0[i];
+        s1 += a1[i];
+    }
+
+    *d0 = s0;
+    *d1 = s1;
+}
+
+int sndx_resampler_process(       //
+    sndx_resampler_t* r,          //
+    const area_t*     in,         //
+    uframes_t         in_offset,  //
+    uframes_t*        in_frames,  //
+    const area_t*     out,        //
+    uframes_t         out_offset, //
+    uframes_t*        out_frames)
+{
+    // All areas before any state, a refused call leaves every channel as it was
+    RANGE(chn, r->channels)
+    {
+        if (!resampler_area_ptr(&in[chn], in_offset) || !resampler_area_ptr(&out[chn], out_offset)) return -EINVAL;
+    }
+
+    u32       hist   = r->ntaps - 1;
+    uframes_t stride = hist + r->max_frames;
+    uframes_t n      = *in_frames < r->max_frames ? *in_frames : r->max_frames;
+    uframes_t cap    = *out_frames < r->max_out ? *out_frames : r->max_out;
+
+    // Positions are the same for all channels, glide the step over the outputs of this call
+    f64       t     = r->pos;
+    f64       step  = r->step;
+    f64       dstep = 0;
+    uframes_t m     = 0;
+
+    if (step != r->step_target)
+    {
+        f64 expected = n / r->step_target;
+        expected     = expected > cap ? cap : expected < 1 ? 1 : expected;
+        dstep        = (r->step_target - step) / expected;
+    }
+
+    while (m < cap)
+    {
+        isize j = (isize)t;
+        if (j >= (isize)n) break;
+
+        f64 frac = t - (f64)j;
+        f64 ph   = frac * r->nphases;
+        u32 k    = (u32)ph;
+
+        r->index[m] = j;
+        r->phase[m] = k;
+        r->alpha[m] = (float)(r->nphases ? ph - k : frac);
+        m++;
+
+        t += step;
+
+        if (dstep != 0)
+        {
+            step += dstep;
+            if ((dstep > 0) == (step >= r->step_target))
+            {
+                step  = r->step_target;
+                dstep = 0;
+            }
+        }
+    }
+
+    // Everything before the first frame under the next output is done with
+    isize     next     = (isize)t;
+    uframes_t consumed = next < (isize)n ? (uframes_t)next : n;
+
+    RANGE(chn, r->channels)
+    {
+        float* src = resampler_area_ptr(&in[chn], in_offset);
+        float* dst = resampler_area_ptr(&out[chn], out_offset);
+        float* w   = &r->work[chn * stride];
+
+        memcpy(&w[hist], src, n * sizeof(float));
+
+        if (r->quality == SNDX_RESAMPLER_LINEAR)
+        {
+            RANGE(i, m)
+            {
+                const float* x = &w[r->index[i]];
+                dst[i]         = x[0] + r->alpha[i] * (x[1] - x[0]);
+            }
+        }
+        else
+        {
+            RANGE(i, m)
+            {
+                const float* h0 = &r->table[r->phase[i] * r->ntaps];
+                float        d0, d1;
+
+                resampler_dot2(&w[r->index[i]], h0, h0 + r->ntaps, r->ntaps, &d0, &d1);
+                dst[i] = d0 + r->alpha[i] * (d1 - d0);
+            }
+        }
+
+        // History for the next call ends right before the first frame not consumed
+        memmove(w, &w[consumed], hist * sizeof(float));
+    }
+
+    r->pos      = t - (f64)consumed;
+    r->step     = step;
+    *in_frames  = consumed;
+    *out_frames = m;
+
+    return 0;
+}
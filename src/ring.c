@@ -34,8 +34,13 @@ int sndx_ring_open(sndx_ring_t** rbp, format_t format, u32 channels, uframes_t c
     rb->channels = channels;
     rb->capacity = capacity;
 
-    rb->from_int = snd_pcm_linear_get_index(format, SND_PCM_FORMAT_S32);
-    rb->to_int   = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, format);
+    // Floats are copied as they are, only native 32 bit ones can be
+    err = -(snd_pcm_format_float(format) == 1 && format != SND_PCM_FORMAT_FLOAT) * EINVAL;
+    Goto_(err, __close, "Float format %s is not native 32 bit float", snd_pcm_format_name(format));
+
+    rb->is_float = format == SND_PCM_FORMAT_FLOAT;
+    rb->from_int = rb->is_float ? 0 : snd_pcm_linear_get_index(format, SND_PCM_FORMAT_S32);
+    rb->to_int   = rb->is_float ? 0 : snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, format);
 
     rb->data = calloc(channels * capacity, sizeof(float));
     err      = -(!rb->data);
@@ -121,6 +126,8 @@ uframes_t sndx_ring_write_from_areas( //
     u32           channels,
     uframes_t     frames)
 {
+    if (rb->is_float) return sndx_ring_write_from_float_areas(rb, src_areas, src_offset, channels, frames);
+
     // Check available
     sframes_t w     = rb->write;
     uframes_t avail = sndx_ring_write_avail(rb);
@@ -173,6 +180,8 @@ uframes_t sndx_ring_read_to_areas( //
     u32           channels,
     uframes_t     frames)
 {
+    if (rb->is_float) return sndx_ring_read_to_float_areas(rb, dst_areas, dst_offset, channels, frames);
+
     // Check available
     sframes_t r     = rb->read;
     uframes_t avail = sndx_ring_read_avail(rb);
@@ -216,3 +225,87 @@ uframes_t sndx_ring_read_to_areas( //
 
     return frames;
 }
+
+/** @brief Copy floats between areas, bulk copy for planar areas (step of one float), strided otherwise. */
+static void ring_copy_float( //
+    const area_t* dst_areas,
+    uframes_t     dst_offset,
+    const area_t* src_areas,
+    uframes_t     src_offset,
+    u32           channels,
+    uframes_t     frames)
+{
+    RANGE(chn, channels)
+    {
+        const area_t* s = &src_areas[chn];
+        const area_t* d = &dst_areas[chn];
+
+        char* src = (char*)s->addr + (s->first + src_offset * s->step) / 8;
+        char* dst = (char*)d->addr + (d->first + dst_offset * d->step) / 8;
+
+        if (s->step == sizeof(float) * 8 && d->step == sizeof(float) * 8)
+        {
+            memcpy(dst, src, frames * sizeof(float));
+            continue;
+        }
+
+        // Interleaved float, e.g. FLOAT_LE device areas
+        RANGE(i, frames)
+        {
+            *(float*)dst  = *(float*)src;
+            src          += s->step / 8;
+            dst          += d->step / 8;
+        }
+    }
+}
+
+uframes_t sndx_ring_write_from_float_areas( //
+    sndx_ring_t*  rb,
+    const area_t* src_areas,
+    uframes_t     src_offset,
+    u32           channels,
+    uframes_t     frames)
+{
+    sframes_t w     = rb->write;
+    uframes_t avail = sndx_ring_write_avail(rb);
+
+    frames = frames > avail ? avail : frames;
+
+    // Up to the end of the ring, then from its start
+    uframes_t offset  = sndx_ring_mask(rb, w);
+    uframes_t frames1 = frames > rb->capacity - offset ? rb->capacity - offset : frames;
+    uframes_t frames2 = frames - frames1;
+
+    ring_copy_float(rb->areas, offset, src_areas, src_offset, channels, frames1);
+    if (frames2) ring_copy_float(rb->areas, 0, src_areas, src_offset + frames1, channels, frames2);
+
+    __atomic_thread_fence(__ATOMIC_RELEASE); /* ensure pointer increment happens after copy */
+    rb->write = sndx_ring_mask(rb, w + frames);
+
+    return frames;
+}
+
+uframes_t sndx_ring_read_to_float_areas( //
+    sndx_ring_t*  rb,
+    const area_t* dst_areas,
+    uframes_t     dst_offset,
+    u32           channels,
+    uframes_t     frames)
+{
+    sframes_t r     = rb->read;
+    uframes_t avail = sndx_ring_read_avail(rb);
+
+    frames = frames > avail ? avail : frames;
+
+    uframes_t offset  = sndx_ring_mask(rb, r);
+    uframes_t frames1 = frames > rb->capacity - offset ? rb->capacity - offset : frames;
+    uframes_t frames2 = frames - frames1;
+
+    ring_copy_float(dst_areas, dst_offset, rb->areas, offset, channels, frames1);
+    if (frames2) ring_copy_float(dst_areas, dst_offset + frames1, rb->areas, 0, channels, frames2);
+
+    __atomic_thread_fence(__ATOMIC_RELEASE); /* ensure pointer increment happens after copy */
+    rb->read = sndx_ring_mask(rb, r + frames);
+
+    return frames;
+}
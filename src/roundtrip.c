@@ -0,0 +1,271 @@
+/** @file roundtrip.c
+ *  @brief Round-trip latency by cross-correlation, @see roundtrip.h
+ */
+#include "sndx/roundtrip.h"
+
+/** @brief Galois LFSR feedback of a primitive polynomial per order, 10 to 20. */
+static const u32 mls_taps[] = {
+    0x240, 0x500, 0xE08, 0x1C80, 0x3802, 0x6000, 0xD008, 0x12000, 0x20400, 0x72000, 0x90000,
+};
+
+constexpr u32 mls_order_min = 10;
+constexpr u32 mls_order_max = 20;
+
+/** @brief Lags next to the peak left out of the noise floor. */
+constexpr isize roundtrip_guard = 16;
+
+static const char* roundtrip_signal_names[] = {"mls", "chirp"};
+
+const char* sndx_roundtrip_signal_name(sndx_roundtrip_signal_t signal)
+{
+    return signal <= SNDX_ROUNDTRIP_SIGNAL_LAST ? roundtrip_signal_names[signal] : "unknown";
+}
+
+static void roundtrip_mls(sndx_roundtrip_t* rt, u32 order, float level)
+{
+    u32 taps = mls_taps[order - mls_order_min];
+    u32 lfsr = 1;
+
+    RANGE(i, rt->length)
+    {
+        rt->stimulus[i] = lfsr & 1 ? level : -level;
+        lfsr            = (lfsr >> 1) ^ (-(lfsr & 1u) & taps);
+    }
+}
+
+/** @brief Exponential sweep from 20 Hz to 0.45 rate (20 kHz at most), raised cosine fades at the ends. */
+static void roundtrip_chirp(sndx_roundtrip_t* rt, float level)
+{
+    f64 f1 = 20.0;
+    f64 f2 = 0.45 * rt->rate < 20000.0 ? 0.45 * rt->rate : 20000.0;
+    f64 T  = (f64)rt->length / rt->rate;
+    f64 L  = T / log(f2 / f1);
+
+    uframes_t fade = rt->length / 8 < 256 ? rt->length / 8 : 256;
+
+    RANGE(i, rt->length)
+    {
+        f64 t = (f64)i / rt->rate;
+        f64 g = 1.0;
+
+        if ((uframes_t)i < fade) g = 0.5 - 0.5 * cos(M_PI * i / fade);
+        if ((uframes_t)i >= rt->length - fade) g = 0.5 - 0.5 * cos(M_PI * (rt->length - 1 - i) / fade);
+
+        rt->stimulus[i] = (float)(level * g * sin(2.0 * M_PI * f1 * L * (exp(t / L) - 1.0)));
+    }
+}
+
+int sndx_roundtrip_open(        //
+    sndx_roundtrip_t**      rtp,
+    sndx_roundtrip_signal_t signal,
+    u32                     order,
+    u32                     rate,
+    float                   level,
+    uframes_t               max_latency,
+    output_t*               output)
+{
+    int err;
+
+    RetVal_(signal > SNDX_ROUNDTRIP_SIGNAL_LAST, -EINVAL, "Failed: unknown signal %d", signal);
+    RetVal_(order < mls_order_min || order > mls_order_max, -EINVAL, "Failed: order %d not within %d to %d", order,
+            mls_order_min, mls_order_max);
+
+    sndx_roundtrip_t* rt;
+    rt = calloc(1, sizeof(*rt));
+    RetVal_(!rt, -ENOMEM, "Failed calloc sndx_roundtrip_t* rt");
+
+    rt->signal      = signal;
+    rt->rate        = rate;
+    rt->length      = ((uframes_t)1 << order) - 1;
+    rt->max_latency = max_latency;
+    rt->capacity    = rt->length + max_latency;
+
+    rt->stimulus = calloc(rt->length, sizeof(float));
+    err          = -(!rt->stimulus);
+    Goto_(err, __close, "Failed calloc float* rt->stimulus");
+
+    rt->record = calloc(rt->capacity, sizeof(float));
+    err        = -(!rt->record);
+    Goto_(err, __close, "Failed calloc float* rt->record");
+
+    // Linear correlation up to max_latency without wrapping around
+    err = sndx_fft_open(&rt->fft, sndx_fft_size(rt->capacity + rt->length), output);
+    Goto_(err, __close, "Failed sndx_fft_open");
+
+    u32 n = rt->fft->n;
+
+    rt->re  = calloc(n, sizeof(float));
+    rt->im  = calloc(n, sizeof(float));
+    rt->sre = calloc(n, sizeof(float));
+    rt->sim = calloc(n, sizeof(float));
+    err     = -(!rt->re || !rt->im || !rt->sre || !rt->sim);
+    Goto_(err, __close, "Failed calloc spectra");
+
+    if (signal == SNDX_ROUNDTRIP_MLS) roundtrip_mls(rt, order, level);
+    else roundtrip_chirp(rt, level);
+
+    sndx_fft_real(rt->fft, rt->stimulus, rt->length, rt->sre, rt->sim);
+
+    *rtp = rt;
+
+    return 0;
+
+__close:
+    sndx_roundtrip_close(rt);
+    *rtp = nullptr;
+
+    return err;
+}
+
+void sndx_roundtrip_close(sndx_roundtrip_t* rt)
+{
+    if (!rt) return;
+
+    sndx_fft_close(rt->fft);
+
+    Free(rt->stimulus);
+    Free(rt->record);
+    Free(rt->re);
+    Free(rt->im);
+    Free(rt->sre);
+    Free(rt->sim);
+    Free(rt);
+}
+
+void sndx_roundtrip_reset(sndx_roundtrip_t* rt)
+{
+    rt->recorded = 0;
+    rt->played   = 0;
+    rt->latency  = 0.0;
+    rt->peak     = 0.0;
+    rt->snr_db   = 0.0;
+    rt->inverted = false;
+}
+
+bool sndx_roundtrip_process(sndx_roundtrip_t* rt, const float* capt, float* play, uframes_t frames)
+{
+    uframes_t nrec = rt->capacity - rt->recorded < frames ? rt->capacity - rt->recorded : frames;
+
+    memcpy(rt->record + rt->recorded, capt, nrec * sizeof(float));
+    rt->recorded += nrec;
+
+    RANGE(i, frames) { play[i] = rt->played < rt->length ? rt->stimulus[rt->played++] : 0.0f; }
+
+    return rt->recorded >= rt->capacity;
+}
+
+int sndx_roundtrip_run(sndx_roundtrip_t* rt, sndx_duplex_t* d, u32 channel)
+{
+    int       err;
+    output_t* output = d->out;
+
+    RetVal_(channel >= d->ch_capt, -EINVAL, "Failed: capture channel %d of %d", channel, d->ch_capt);
+
+    bool done = false;
+    while (!done)
+    {
+        uframes_t avail = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        SndReturn_(err, "Failed: sndx_duplex_wait: %s");
+
+        uframes_t frames = avail;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        SndReturn_(err, "Failed: sndx_duplex_read: %s");
+
+        const float* capt = d->buf_capt->bufdata + channel * d->buf_capt->frames + offset;
+        float*       play = d->buf_play->bufdata + offset;
+
+        done = sndx_roundtrip_process(rt, capt, play, frames);
+
+        RANGE(chn, 1, d->ch_play)
+        {
+            memcpy(play + chn * d->buf_play->frames, play, frames * sizeof(float));
+        }
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        SndReturn_(err, "Failed: sndx_duplex_write: %s");
+    }
+
+    return 0;
+}
+
+int sndx_roundtrip_analyse(sndx_roundtrip_t* rt, output_t* output)
+{
+    RetVal_(rt->recorded < rt->capacity, -EAGAIN, "Failed: %ld of %ld frames recorded", rt->recorded, rt->capacity);
+
+    u32 n = rt->fft->n;
+
+    sndx_fft_real(rt->fft, rt->record, rt->capacity, rt->re, rt->im);
+
+    // Record times conjugate stimulus, back in time that is the correlation at each lag
+    RANGE(k, n)
+    {
+        float a = rt->re[k];
+        float b = rt->im[k];
+
+        rt->re[k] = a * rt->sre[k] + b * rt->sim[k];
+        rt->im[k] = b * rt->sre[k] - a * rt->sim[k];
+    }
+
+    sndx_fft_inverse(rt->fft, rt->re, rt->im);
+
+    const float* r    = rt->re;
+    isize        lags = (isize)rt->max_latency + 1;
+    isize        best = 0;
+
+    RANGE(k, lags)
+    {
+        if (fabsf(r[k]) > fabsf(r[best])) best = k;
+    }
+
+    // Parabola through the peak and its neighbours, on the magnitude so polarity does not matter
+    f64 shift = 0.0;
+    if (best > 0 && best < lags - 1)
+    {
+        f64 ym = fabs(r[best - 1]);
+        f64 y0 = fabs(r[best]);
+        f64 yp = fabs(r[best + 1]);
+        f64 dd = ym - 2.0 * y0 + yp;
+
+        if (dd < 0.0) shift = 0.5 * (ym - yp) / dd;
+    }
+
+    f64 es = 0.0;
+    f64 er = 0.0;
+    RANGE(i, rt->length)
+    {
+        es += (f64)rt->stimulus[i] * rt->stimulus[i];
+        er += (f64)rt->record[best + i] * rt->record[best + i];
+    }
+
+    f64 noise = 0.0;
+    u64 count = 0;
+    RANGE(k, lags)
+    {
+        if (k >= best - roundtrip_guard && k <= best + roundtrip_guard) continue;
+
+        noise += (f64)r[k] * r[k];
+        count++;
+    }
+
+    rt->latency  = (f64)best + shift;
+    rt->inverted = r[best] < 0.0f;
+    rt->peak     = es > 0.0 && er > 0.0 ? fabs(r[best]) / sqrt(es * er) : 0.0;
+    rt->snr_db   = count && noise > 0.0 ? 20.0 * log10(fabs(r[best]) / sqrt(noise / count)) : INFINITY;
+
+    RetVal_(rt->peak < SNDX_ROUNDTRIP_MIN_PEAK, -EIO, "Failed: correlation peak %.3f at %ld frames, no loopback?",
+            rt->peak, best);
+
+    return 0;
+}
+
+void sndx_roundtrip_dump(sndx_roundtrip_t* rt, output_t* output)
+{
+    a_info("Round trip (%s, %ld frames, fft %d):", sndx_roundtrip_signal_name(rt->signal), rt->length, rt->fft->n);
+    a_info("  latency : %.2f frames (%.3f ms)", rt->latency, 1000.0 * rt->latency / rt->rate);
+    a_info("  peak    : %.3f%s", rt->peak, rt->inverted ? " (inverted)" : "");
+    a_info("  snr     : %.1f dB", rt->snr_db);
+}
@@ -0,0 +1,328 @@
+/** @file router.c
+ *  @brief Routing matrix, @see router.h
+ */
+#include "sndx/router.h"
+#include <math.h>
+
+/** @brief Eight floats, maps to one AVX or two SSE/NEON registers. */
+typedef float v8f __attribute__((vector_size(32)));
+
+/** @brief Same, for loads and stores at any frame (aligned to a float only). */
+typedef float v8f_u __attribute__((vector_size(32), aligned(4), may_alias));
+
+static void router_plan_free(sndx_router_plan_t* p)
+{
+    if (!p) return;
+
+    Free(p->points);
+    Free(p->rows);
+    Free(p->from);
+    Free(p);
+}
+
+int sndx_router_open(sndx_router_t** rp, u32 ch_capt, u32 ch_play, uframes_t ramp_frames, output_t* output)
+{
+    int err;
+
+    sndx_router_t* r;
+    r = calloc(1, sizeof(*r));
+    RetVal_(!r, -ENOMEM, "Failed calloc sndx_router_t* r");
+
+    r->ch_capt     = ch_capt;
+    r->ch_play     = ch_play;
+    r->ramp_frames = ramp_frames;
+    r->out         = output;
+
+    r->matrix = calloc((usize)ch_play * ch_capt + 1, sizeof(f32));
+    err       = -(!r->matrix);
+    Goto_(err, __close, "Failed calloc f32* r->matrix");
+
+    *rp = r;
+
+    return 0;
+
+__close:
+    sndx_router_close(r);
+    *rp = nullptr;
+
+    return err;
+}
+
+void sndx_router_close(sndx_router_t* r)
+{
+    if (!r) return;
+
+    router_plan_free(r->next);
+    router_plan_free(r->current);
+    router_plan_free(r->retired);
+
+    Free(r->matrix);
+    Free(r);
+}
+
+int sndx_router_set(sndx_router_t* r, u32 capt, u32 play, f32 gain)
+{
+    output_t* output = r->out;
+
+    RetVal_(capt >= r->ch_capt, -EINVAL, "No capture channel %d of %d", capt, r->ch_capt);
+    RetVal_(play >= r->ch_play, -EINVAL, "No playback channel %d of %d", play, r->ch_play);
+
+    r->matrix[play * r->ch_capt + capt] = gain;
+
+    return 0;
+}
+
+void sndx_router_clear(sndx_router_t* r)
+{
+    memset(r->matrix, 0, r->ch_play * r->ch_capt * sizeof(f32));
+}
+
+void sndx_router_preset_copy(sndx_router_t* r, f32 gain)
+{
+    sndx_router_clear(r);
+    if (!r->ch_capt) return;
+
+    RANGE(play, r->ch_play) { r->matrix[play * r->ch_capt + play % r->ch_capt] = gain; }
+}
+
+/** @brief Crosspoints with a gain, and those of the last plan that may still sound on the audio thread.
+ *
+ *  A crosspoint of the last plan is kept (at 0, it fades out) unless that plan was picked up and its
+ *  ramp finished with the crosspoint at 0. Kept ones carry over from plan to plan while commits come
+ *  faster than ramps, so nothing the audio thread still plays is ever cut.
+ */
+static int router_compile(sndx_router_t* r, sndx_router_plan_t** planp)
+{
+    int       err;
+    output_t* output = r->out;
+
+    u32                 nc   = r->ch_capt;
+    u32                 np   = r->ch_play;
+    sndx_router_plan_t* prev = r->committed;
+
+    sndx_router_plan_t* p = calloc(1, sizeof(*p));
+    RetVal_(!p, -ENOMEM, "Failed calloc sndx_router_plan_t* p");
+
+    bool* keep = calloc((usize)np * nc + 1, sizeof(bool));
+
+    p->rows = calloc(np + 1, sizeof(u32));
+    p->from = calloc((usize)np * nc + 1, sizeof(f32));
+
+    err = -(!keep || !p->rows || !p->from);
+    Goto_(err, __close, "Failed calloc compile tables");
+
+    if (prev)
+    {
+        bool settled = __atomic_load_n(&prev->settled, __ATOMIC_ACQUIRE);
+
+        RANGE(i, prev->npoints)
+        {
+            sndx_router_point_t* pt = &prev->points[i];
+            if (!settled || pt->target != 0.0f) keep[pt->play * nc + pt->capt] = true;
+        }
+    }
+
+    u32 npoints = 0;
+    RANGE(i, np * nc) { npoints += r->matrix[i] != 0.0f || keep[i]; }
+
+    p->points = calloc(npoints ? npoints : 1, sizeof(sndx_router_point_t));
+    err       = -(!p->points);
+    Goto_(err, __close, "Failed calloc sndx_router_point_t* p->points");
+
+    RANGE(play, np)
+    {
+        p->rows[play] = p->npoints;
+
+        RANGE(capt, nc)
+        {
+            isize i = play * nc + capt;
+            if (r->matrix[i] == 0.0f && !keep[i]) continue;
+
+            p->points[p->npoints++] = (sndx_router_point_t){.capt = capt, .play = play, .target = r->matrix[i]};
+        }
+    }
+    p->rows[np] = p->npoints;
+
+    Free(keep);
+
+    *planp = p;
+
+    return 0;
+
+__close:
+    Free(keep);
+    router_plan_free(p);
+
+    return err;
+}
+
+void sndx_router_collect(sndx_router_t* r)
+{
+    sndx_router_plan_t* retired = __atomic_exchange_n(&r->retired, nullptr, __ATOMIC_ACQ_REL);
+    router_plan_free(retired);
+}
+
+int sndx_router_commit(sndx_router_t* r)
+{
+    int err;
+
+    sndx_router_plan_t* p;
+    err = router_compile(r, &p);
+    if (err < 0) return err;
+
+    // A plan committed earlier and never picked up is ours again
+    sndx_router_plan_t* stale = __atomic_exchange_n(&r->next, p, __ATOMIC_ACQ_REL);
+    router_plan_free(stale);
+
+    r->committed = p;
+
+    sndx_router_collect(r);
+
+    return 0;
+}
+
+/** @brief Start `p` from the gains `old` has now, ramping to its targets. */
+static void router_pick_up(sndx_router_t* r, sndx_router_plan_t* p, sndx_router_plan_t* old)
+{
+    u32 nc = r->ch_capt;
+
+    memset(p->from, 0, r->ch_play * nc * sizeof(f32));
+    if (old)
+    {
+        RANGE(i, old->npoints) { p->from[old->points[i].play * nc + old->points[i].capt] = old->points[i].gain; }
+    }
+
+    RANGE(i, p->npoints)
+    {
+        sndx_router_point_t* pt = &p->points[i];
+
+        pt->gain = r->ramp_frames ? p->from[pt->play * nc + pt->capt] : pt->target;
+        pt->step = r->ramp_frames ? (pt->target - pt->gain) / (f32)r->ramp_frames : 0.0f;
+    }
+
+    p->ramp_left = r->ramp_frames;
+    if (!p->ramp_left) __atomic_store_n(&p->settled, true, __ATOMIC_RELEASE);
+}
+
+/** @brief out = (or +=) in * (g + step * (i + 1)) on [0, n), the ramp part of a call. */
+static void router_mix_ramp(float* out, const float* in, f32 g, f32 step, isize n, bool add)
+{
+    isize i     = 0;
+    v8f   lanes = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    for (; i + 8 <= n; i += 8)
+    {
+        v8f x = *(const v8f_u*)&in[i] * (g + step * (lanes + (f32)i));
+
+        if (add) x += *(v8f_u*)&out[i];
+        *(v8f_u*)&out[i] = x;
+    }
+
+    for (; i < n; i++)
+    {
+        f32 x  = in[i] * (g + step * (f32)(i + 1));
+        out[i] = add ? out[i] + x : x;
+    }
+}
+
+/** @brief out = (or +=) in * g on [from, n), the steady part, one loop each so neither branches inside. */
+static void router_mix(float* out, const float* in, f32 g, isize from, isize n, bool add)
+{
+    isize i = from;
+
+    if (add)
+    {
+        for (; i + 8 <= n; i += 8) { *(v8f_u*)&out[i] += *(const v8f_u*)&in[i] * g; }
+        for (; i < n; i++) { out[i] += in[i] * g; }
+    }
+    else
+    {
+        for (; i + 8 <= n; i += 8) { *(v8f_u*)&out[i] = *(const v8f_u*)&in[i] * g; }
+        for (; i < n; i++) { out[i] = in[i] * g; }
+    }
+}
+
+void sndx_router_process(sndx_router_t* r, sndx_buffer_t* buf_capt, sndx_buffer_t* buf_play, sframes_t len)
+{
+    AssertMsg(len >= 0, "Received negative len: %ld", len);
+
+    // New plan only once the one replaced before was collected, the audio thread never frees.
+    // Plain loads first, the exchange is a locked instruction and most calls have nothing to pick up
+    if (__atomic_load_n(&r->next, __ATOMIC_RELAXED) && !__atomic_load_n(&r->retired, __ATOMIC_ACQUIRE))
+    {
+        sndx_router_plan_t* next = __atomic_exchange_n(&r->next, nullptr, __ATOMIC_ACQ_REL);
+        if (next)
+        {
+            router_pick_up(r, next, r->current);
+            __atomic_store_n(&r->retired, r->current, __ATOMIC_RELEASE);
+            r->current = next;
+        }
+    }
+
+    sndx_router_plan_t* p      = r->current;
+    isize               n      = buf_play->frames;
+    isize               n_capt = buf_capt->frames;
+    isize               ramp   = 0; ///< Frames of this call still ramping
+
+    if (p) ramp = p->ramp_left < (uframes_t)len ? (isize)p->ramp_left : len;
+
+    RANGE(play, buf_play->channels)
+    {
+        float* out = buf_play->bufdata + play * n;
+        bool   add = false;
+
+        u32 first = p && (u32)play < r->ch_play ? p->rows[play] : 0;
+        u32 end   = p && (u32)play < r->ch_play ? p->rows[play + 1] : 0;
+
+        RANGE(k, first, end)
+        {
+            sndx_router_point_t* pt = &p->points[k];
+
+            // Faded out, kept only until the control thread drops it
+            if (!ramp && pt->target == 0.0f) continue;
+
+            const float* in = buf_capt->bufdata + (pt->capt % buf_capt->channels) * n_capt;
+
+            if (ramp) router_mix_ramp(out, in, pt->gain, pt->step, ramp, add);
+            router_mix(out, in, pt->target, ramp, len, add);
+
+            add = true;
+        }
+
+        if (!add) memset(out, 0, len * sizeof(float));
+    }
+
+    if (!p || !p->ramp_left) return;
+
+    // Ramp state for the next call, exact targets once done
+    p->ramp_left -= (uframes_t)ramp;
+
+    RANGE(i, p->npoints)
+    {
+        sndx_router_point_t* pt = &p->points[i];
+        pt->gain                = p->ramp_left ? pt->gain + pt->step * (f32)ramp : pt->target;
+    }
+
+    if (!p->ramp_left) __atomic_store_n(&p->settled, true, __ATOMIC_RELEASE);
+}
+
+void sndx_router_dump(sndx_router_t* r, output_t* output)
+{
+    sndx_router_plan_t* p = r->committed;
+
+    a_info("Router: %d capture x %d playback, ramp %ld frames", r->ch_capt, r->ch_play, r->ramp_frames);
+    if (!p) return;
+
+    u32 active = 0;
+    RANGE(i, p->npoints) { active += p->points[i].target != 0.0f; }
+
+    a_info("  crosspoints: %d of %d, %d fading out", active, r->ch_capt * r->ch_play, p->npoints - active);
+
+    RANGE(i, p->npoints)
+    {
+        sndx_router_point_t* pt = &p->points[i];
+        if (pt->target == 0.0f) continue;
+
+        a_info("  %3d -> %-3d %+8.3f (%+.1f dB)", pt->capt, pt->play, pt->target, 20.0 * log10(fabs(pt->target)));
+    }
+}
@@ -0,0 +1,575 @@
+/** @file sim.c
+ *  @brief Simulated loopback pair of PCM handles on alsa-lib ioplug, @see sim.h
+ */
+#include "sndx/sim.h"
+#include "sndx/sys.h"
+#include <sys/timerfd.h>
+
+static const unsigned int sim_access[] = {
+    SND_PCM_ACCESS_MMAP_INTERLEAVED,
+    SND_PCM_ACCESS_RW_INTERLEAVED,
+};
+
+static const unsigned int sim_formats[] = {
+    SND_PCM_FORMAT_S16_LE,
+    SND_PCM_FORMAT_S24_3LE,
+    SND_PCM_FORMAT_S32_LE,
+    SND_PCM_FORMAT_FLOAT_LE,
+};
+
+/** @brief xorshift64*, enough for jitter and reproducible from the seed. */
+static u64 sim_rand(sndx_sim_stream_t* s)
+{
+    s->rng ^= s->rng >> 12;
+    s->rng ^= s->rng << 25;
+    s->rng ^= s->rng >> 27;
+    return s->rng * 2685821657736338717ull;
+}
+
+/** @brief Nominal rate of the stream scaled by its clock error. */
+static f64 sim_rate(sndx_sim_stream_t* s) { return s->io.rate * (1.0 + s->config.drift_ppm * 1e-6); }
+
+static const char* const sim_fault_names[] = {
+    [SNDX_SIM_FAULT_XRUN]    = "xrun",    //
+    [SNDX_SIM_FAULT_NVAL]    = "nval",    //
+    [SNDX_SIM_FAULT_STALL]   = "stall",   //
+    [SNDX_SIM_FAULT_SUSPEND] = "suspend", //
+};
+
+const char* sndx_sim_fault_name(sndx_sim_fault_kind_t kind)
+{
+    return kind <= SNDX_SIM_FAULT_LAST ? sim_fault_names[kind] : "unknown";
+}
+
+/** @brief Part of the current stall after start, up to `now`. */
+static u64 sim_stalled(sndx_sim_stream_t* s, u64 now)
+{
+    u64 from = s->stall_from > s->start ? s->stall_from : s->start;
+    u64 to   = now < s->stall_until ? now : s->stall_until;
+    return to > from ? to - from : 0;
+}
+
+/** @brief Nanoseconds the clock ran since start, standing still during stalls. */
+static u64 sim_elapsed(sndx_sim_stream_t* s)
+{
+    u64 now  = sndx_nsecs();
+    u64 lost = s->lost;
+
+    if (s->stall_until) lost += sim_stalled(s, now);
+
+    // Stall over, account for it once
+    if (s->stall_until && now >= s->stall_until)
+    {
+        s->lost        = lost;
+        s->stall_until = 0;
+    }
+
+    return now - s->start - lost;
+}
+
+/** @brief Wake poll on `tick`, late by the jitter drawn for it. */
+static void sim_arm(sndx_sim_stream_t* s, u64 tick)
+{
+    // Suspended: nothing until resume or prepare
+    if (s->stall_until == UINT64_MAX) return;
+
+    // Stalled: the clock comes back at stall_until, ticks resume from there
+    u64 lost = s->lost + (s->stall_until ? sim_stalled(s, s->stall_until) : 0);
+
+    u64 jitter = s->config.jitter_usecs ? sim_rand(s) % (s->config.jitter_usecs * 1000ull + 1) : 0;
+    u64 at     = s->start + lost + (u64)(tick * s->tick_nsecs) + jitter;
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec  = at / 1000000000;
+    its.it_value.tv_nsec = at % 1000000000;
+
+    timerfd_settime(s->timerfd, TFD_TIMER_ABSTIME, &its, nullptr);
+    s->tick_next = tick;
+}
+
+static void sim_disarm(sndx_sim_stream_t* s)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    timerfd_settime(s->timerfd, 0, &its, nullptr);
+
+    // Expiry not yet read would wake the next poll
+    u64 expirations;
+    if (read(s->timerfd, &expirations, sizeof(expirations)) < 0) return;
+}
+
+/** @brief Move the hw pointer to the last tick, -EPIPE on xrun (injected first, then natural). */
+static int sim_update(sndx_sim_stream_t* s)
+{
+    snd_pcm_ioplug_t* io = &s->io;
+
+    if (!s->running) return 0;
+
+    u64 ticks = (u64)(sim_elapsed(s) / s->tick_nsecs);
+    s->hw     = ticks * io->period_size;
+
+    if (s->config.xrun_every && ticks >= s->xrun_next)
+    {
+        s->xrun_next = (ticks / s->config.xrun_every + 1) * s->config.xrun_every;
+        s->injected++;
+        s->running = false;
+        sim_disarm(s);
+        return -EPIPE;
+    }
+
+    // Same condition as the kernel with stop_threshold == buffer_size
+    bool drained = io->stream == SND_PCM_STREAM_PLAYBACK && s->hw >= io->appl_ptr;
+    bool overrun = io->stream == SND_PCM_STREAM_CAPTURE && s->hw > io->appl_ptr + io->buffer_size;
+
+    if (drained || overrun)
+    {
+        s->xruns++;
+        s->running = false;
+        sim_disarm(s);
+        return -EPIPE;
+    }
+
+    return 0;
+}
+
+static int sim_cb_start(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    s->start     = sndx_nsecs();
+    s->lost      = 0;
+    s->hw        = 0;
+    s->xrun_next = s->config.xrun_every;
+    s->running   = true;
+
+    sim_arm(s, 1);
+
+    return 0;
+}
+
+static int sim_cb_stop(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    s->running = false;
+    sim_disarm(s);
+
+    return 0;
+}
+
+static int sim_cb_prepare(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    s->running = false;
+    s->hw      = 0;
+    sim_disarm(s);
+
+    // Prepare ends a suspend, a stall goes on
+    if (s->stall_until == UINT64_MAX) s->stall_until = 0;
+
+    return 0;
+}
+
+static int sim_cb_resume(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    if (s->stall_until != UINT64_MAX) return 0;
+
+    // Clock goes on from where it froze
+    s->stall_until = sndx_nsecs();
+    sim_elapsed(s);
+
+    snd_pcm_ioplug_set_state(io, SND_PCM_STATE_RUNNING);
+    sim_arm(s, (u64)(sim_elapsed(s) / s->tick_nsecs) + 1);
+
+    return 0;
+}
+
+static sframes_t sim_cb_pointer(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    int err = sim_update(s);
+    if (err < 0) return err;
+
+    return (sframes_t)(s->hw % io->buffer_size);
+}
+
+static int sim_cb_hw_params(snd_pcm_ioplug_t* io, [[maybe_unused]] hw_params_t* params)
+{
+    sndx_sim_stream_t* s   = io->private_data;
+    sndx_sim_t*        sim = s->sim;
+
+    s->tick_nsecs = io->period_size * 1e9 / sim_rate(s);
+
+    if (io->stream == SND_PCM_STREAM_CAPTURE) return 0;
+
+    // Wire holds what playback queued plus what is playing, a few buffers cover both
+    usize bytes = snd_pcm_format_physical_width(io->format) / 8 * io->channels;
+
+    Free(sim->wire);
+    sim->format      = io->format;
+    sim->channels    = io->channels;
+    sim->wire_frames = 4 * io->buffer_size;
+    sim->wire        = malloc(sim->wire_frames * bytes);
+    if (!sim->wire) return -ENOMEM;
+
+    return snd_pcm_format_set_silence(sim->format, sim->wire, sim->wire_frames * sim->channels);
+}
+
+/** @brief Playback: queue frames at their position since prepare. */
+static void sim_transfer_play(sndx_sim_stream_t* s, const area_t* areas, uframes_t offset, uframes_t size)
+{
+    sndx_sim_t*       sim   = s->sim;
+    snd_pcm_ioplug_t* io    = &s->io;
+    u32               bytes = snd_pcm_format_physical_width(sim->format) / 8;
+
+    RANGE(i, (isize)size)
+    {
+        char* dst = sim->wire + ((io->appl_ptr + i) % sim->wire_frames) * bytes * sim->channels;
+
+        RANGE(chn, sim->channels)
+        {
+            memcpy(dst + chn * bytes, snd_pcm_channel_area_addr(&areas[chn], offset + i), bytes);
+        }
+    }
+}
+
+/** @brief Capture: each frame is the playback frame playing when it was captured, silence if there is none. */
+static void sim_transfer_capt(sndx_sim_stream_t* s, const area_t* areas, uframes_t offset, uframes_t size)
+{
+    sndx_sim_t*        sim   = s->sim;
+    sndx_sim_stream_t* play  = &sim->play;
+    snd_pcm_ioplug_t*  io    = &s->io;
+    u32                bytes = snd_pcm_format_physical_width(io->format) / 8;
+
+    bool wired = sim->wire && play->running && sim->format == io->format;
+
+    // Playback position at the capture time of frame 0, and playback frames per capture frame
+    f64 p0    = wired ? ((f64)(s->start + s->lost) - (f64)(play->start + play->lost)) * 1e-9 * sim_rate(play) : 0;
+    f64 ratio = wired ? sim_rate(play) / sim_rate(s) : 0;
+
+    RANGE(i, (isize)size)
+    {
+        f64  p    = p0 + (f64)(io->appl_ptr + i) * ratio;
+        bool hold = wired && p >= 0 && p < play->io.appl_ptr && p + sim->wire_frames >= play->io.appl_ptr;
+
+        RANGE(chn, io->channels)
+        {
+            char* dst = snd_pcm_channel_area_addr(&areas[chn], offset + i);
+
+            if (hold)
+            {
+                u64   n   = (u64)p % sim->wire_frames;
+                char* src = sim->wire + (n * sim->channels + chn % sim->channels) * bytes;
+                memcpy(dst, src, bytes);
+            }
+            else
+            {
+                snd_pcm_format_set_silence(io->format, dst, 1);
+            }
+        }
+    }
+}
+
+/** @brief Fire the scheduled faults due on this wakeup, -EPIPE if the stream stopped. */
+static int sim_fault(sndx_sim_stream_t* s, bool* nval)
+{
+    snd_pcm_ioplug_t* io  = &s->io;
+    int               ret = 0;
+
+    while (s->fault_next < s->config.nfaults && s->config.faults[s->fault_next].wakeup <= s->ticks)
+    {
+        const sndx_sim_fault_t* f   = &s->config.faults[s->fault_next++];
+        u64                     now = sndx_nsecs();
+
+        s->faults[f->kind]++;
+        s->fault_nsecs = now;
+
+        switch (f->kind)
+        {
+        case SNDX_SIM_FAULT_XRUN:
+            s->running = false;
+            sim_disarm(s);
+            snd_pcm_ioplug_set_state(io, SND_PCM_STATE_XRUN);
+            ret = -EPIPE;
+            break;
+
+        case SNDX_SIM_FAULT_NVAL: *nval = true; break;
+
+        case SNDX_SIM_FAULT_STALL:
+            s->stall_from  = now;
+            s->stall_until = now + (u64)(f->periods * 1e9 * io->period_size / io->rate);
+            s->fault_nsecs = s->stall_until;
+            break;
+
+        case SNDX_SIM_FAULT_SUSPEND:
+            s->stall_from  = now;
+            s->stall_until = UINT64_MAX;
+            sim_disarm(s);
+            snd_pcm_ioplug_set_state(io, SND_PCM_STATE_SUSPENDED);
+            ret = -EPIPE;
+            break;
+        }
+
+        if (ret < 0) break;
+    }
+
+    return ret;
+}
+
+static sframes_t sim_cb_transfer(snd_pcm_ioplug_t* io, const area_t* areas, uframes_t offset, uframes_t size)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    if (io->stream == SND_PCM_STREAM_PLAYBACK)
+        sim_transfer_play(s, areas, offset, size);
+    else
+        sim_transfer_capt(s, areas, offset, size);
+
+    return (sframes_t)size;
+}
+
+static int sim_cb_poll_revents(                   //
+    snd_pcm_ioplug_t*               io,          //
+    [[maybe_unused]] struct pollfd* pfd,         //
+    [[maybe_unused]] unsigned int   nfds,        //
+    unsigned short*                 revents)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    *revents = 0;
+
+    if (io->state == SND_PCM_STATE_XRUN || io->state == SND_PCM_STATE_SUSPENDED)
+    {
+        *revents = POLLERR;
+        return 0;
+    }
+
+    // Woken by something else, or the expiry was already read
+    u64 expirations;
+    if (read(s->timerfd, &expirations, sizeof(expirations)) != sizeof(expirations)) return 0;
+
+    s->ticks++;
+
+    if (sim_update(s) < 0)
+    {
+        snd_pcm_ioplug_set_state(io, SND_PCM_STATE_XRUN);
+        *revents = POLLERR;
+        return 0;
+    }
+
+    bool nval = false;
+
+    if (sim_fault(s, &nval) < 0)
+    {
+        *revents = POLLERR;
+        return 0;
+    }
+
+    // Late wakeups skip ticks, like a late interrupt
+    sim_arm(s, (u64)(sim_elapsed(s) / s->tick_nsecs) + 1);
+
+    *revents = nval ? POLLNVAL : io->stream == SND_PCM_STREAM_PLAYBACK ? POLLOUT : POLLIN;
+
+    return 0;
+}
+
+static int sim_cb_close(snd_pcm_ioplug_t* io)
+{
+    sndx_sim_stream_t* s = io->private_data;
+
+    if (s->timerfd >= 0) close(s->timerfd);
+    s->timerfd = -1;
+    s->closed  = true;
+
+    return 0;
+}
+
+static const snd_pcm_ioplug_callback_t sim_callback = {
+    .start        = sim_cb_start,
+    .stop         = sim_cb_stop,
+    .pointer      = sim_cb_pointer,
+    .transfer     = sim_cb_transfer,
+    .close        = sim_cb_close,
+    .hw_params    = sim_cb_hw_params,
+    .prepare      = sim_cb_prepare,
+    .resume       = sim_cb_resume,
+    .poll_revents = sim_cb_poll_revents,
+};
+
+static int sim_stream_open(                    //
+    sndx_sim_t*                     sim,       //
+    sndx_sim_stream_t*              s,         //
+    const sndx_sim_stream_config_t* config,    //
+    stream_t                        stream,    //
+    const char*                     name,      //
+    u64                             seed,      //
+    output_t*                       output)
+{
+    int err;
+
+    s->sim     = sim;
+    s->config  = *config;
+    s->rng     = seed;
+    s->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    RetVal_(s->timerfd < 0, -errno, "Failed timerfd_create: %s", strerror(errno));
+
+    s->io.version      = SND_PCM_IOPLUG_VERSION;
+    s->io.name         = name;
+    s->io.flags        = SND_PCM_IOPLUG_FLAG_MONOTONIC;
+    s->io.poll_fd      = s->timerfd;
+    s->io.poll_events  = POLLIN;
+    s->io.mmap_rw      = 1;
+    s->io.callback     = &sim_callback;
+    s->io.private_data = s;
+
+    err = snd_pcm_ioplug_create(&s->io, name, stream, SND_PCM_NONBLOCK);
+    SndReturn_(err, "Failed snd_pcm_ioplug_create: %s");
+
+    err = snd_pcm_ioplug_set_param_list(&s->io, SND_PCM_IOPLUG_HW_ACCESS, 2, sim_access);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_list (access): %s");
+
+    err = snd_pcm_ioplug_set_param_list(&s->io, SND_PCM_IOPLUG_HW_FORMAT, 4, sim_formats);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_list (format): %s");
+
+    err = snd_pcm_ioplug_set_param_minmax(&s->io, SND_PCM_IOPLUG_HW_CHANNELS, config->channels, config->channels);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_minmax (channels): %s");
+
+    err = snd_pcm_ioplug_set_param_minmax(&s->io, SND_PCM_IOPLUG_HW_RATE, 8000, 192000);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_minmax (rate): %s");
+
+    err = snd_pcm_ioplug_set_param_minmax(&s->io, SND_PCM_IOPLUG_HW_PERIOD_BYTES, 32, 1 << 20);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_minmax (period bytes): %s");
+
+    err = snd_pcm_ioplug_set_param_minmax(&s->io, SND_PCM_IOPLUG_HW_BUFFER_BYTES, 64, 1 << 22);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_minmax (buffer bytes): %s");
+
+    err = snd_pcm_ioplug_set_param_minmax(&s->io, SND_PCM_IOPLUG_HW_PERIODS, 2, 64);
+    SndReturn_(err, "Failed snd_pcm_ioplug_set_param_minmax (periods): %s");
+
+    return 0;
+}
+
+int sndx_sim_open(sndx_sim_t** simp, const sndx_sim_config_t* config, output_t* output)
+{
+    int err;
+
+    sndx_sim_t* sim;
+    sim = calloc(1, sizeof(*sim));
+    RetVal_(!sim, -ENOMEM, "Failed calloc sndx_sim_t* sim");
+
+    sim->out          = output;
+    sim->play.timerfd = -1;
+    sim->capt.timerfd = -1;
+
+    u64 seed = config->seed ? config->seed : 0x9E3779B97F4A7C15ull;
+
+    err = sim_stream_open(sim, &sim->play, &config->play, SND_PCM_STREAM_PLAYBACK, "sndx_sim_play", seed, output);
+    Goto_(err, __close, "Failed sim_stream_open (play)");
+
+    err = sim_stream_open(sim, &sim->capt, &config->capt, SND_PCM_STREAM_CAPTURE, "sndx_sim_capt", seed ^ 1, output);
+    Goto_(err, __close, "Failed sim_stream_open (capt)");
+
+    *simp = sim;
+
+    return 0;
+
+__close:
+    sndx_sim_close(sim);
+    *simp = nullptr;
+
+    return err;
+}
+
+/** @brief Close the handle if its owner did not, else only what the close callback did not free. */
+static void sim_stream_close(sndx_sim_stream_t* s)
+{
+    if (s->closed) return;
+
+    if (s->io.pcm)
+        snd_pcm_close(s->io.pcm);
+    else if (s->timerfd >= 0)
+        close(s->timerfd);
+}
+
+void sndx_sim_close(sndx_sim_t* sim)
+{
+    if (!sim) return;
+
+    sim_stream_close(&sim->play);
+    sim_stream_close(&sim->capt);
+
+    Free(sim->wire);
+    Free(sim);
+}
+
+void sndx_sim_dump(sndx_sim_t* sim, output_t* output)
+{
+    sndx_sim_stream_t* streams[] = {&sim->play, &sim->capt};
+
+    a_info("Simulated pair:");
+
+    RANGE(i, 2)
+    {
+        sndx_sim_stream_t* s = streams[i];
+
+        a_info("  %s:", s->io.name);
+        a_info("    channels : %d", s->config.channels);
+        a_info("    drift    : %+.1f ppm", s->config.drift_ppm);
+        a_info("    jitter   : %d usecs", s->config.jitter_usecs);
+        a_info("    xrun     : every %d periods", s->config.xrun_every);
+        a_info("    ticks    : %ld", s->ticks);
+        a_info("    hw       : %ld frames", s->hw);
+        a_info("    xruns    : %ld injected, %ld natural", s->injected, s->xruns);
+
+        RANGE(k, SNDX_SIM_FAULT_LAST + 1)
+        {
+            if (s->faults[k]) a_info("    %-8s : %ld", sndx_sim_fault_name(k), s->faults[k]);
+        }
+    }
+}
+
+int sndx_sim_faults_parse(const char* script, sndx_sim_fault_t* faults, u32 capacity, output_t* output)
+{
+    const char* p = script;
+    u32         n = 0;
+
+    while (true)
+    {
+        p += strspn(p, ", ");
+        if (!*p) break;
+
+        RetVal_(n == capacity, -ENOSPC, "Fault script has more than %d entries", capacity);
+
+        char               name[16];
+        unsigned long long wakeup  = 0;
+        unsigned int       periods = 1;
+        int                used    = 0;
+
+        RetVal_(sscanf(p, "%15[a-z]@%llu%n", name, &wakeup, &used) != 2, -EINVAL, "Bad fault entry: %s", p);
+        p += used;
+
+        if (*p == ':')
+        {
+            RetVal_(sscanf(p, ":%u%n", &periods, &used) != 1, -EINVAL, "Bad fault periods: %s", p);
+            p += used;
+        }
+
+        int kind = -1;
+        RANGE(k, SNDX_SIM_FAULT_LAST + 1)
+        {
+            if (!strcmp(name, sim_fault_names[k])) kind = (int)k;
+        }
+
+        RetVal_(kind < 0, -EINVAL, "Unknown fault: %s", name);
+        RetVal_(n && wakeup < faults[n - 1].wakeup, -EINVAL, "Fault %s@%llu out of order", name, wakeup);
+
+        faults[n++] = (sndx_sim_fault_t){.wakeup = wakeup, .kind = kind, .periods = periods};
+    }
+
+    return (int)n;
+}
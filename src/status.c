@@ -0,0 +1,97 @@
+/** @file status.c
+ *  @brief Per-cycle status snapshot, @see status.h
+ */
+#include "sndx/status.h"
+
+int sndx_status_init(sndx_status_t* s, snd_pcm_t* pcm, output_t* output)
+{
+    int err;
+
+    memset(s, 0, sizeof(*s));
+
+    hw_params_t* hw_params;
+    snd_pcm_hw_params_alloca(&hw_params);
+
+    err = snd_pcm_hw_params_current(pcm, hw_params);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_current: %s");
+
+    err = snd_pcm_hw_params_get_buffer_size(hw_params, &s->buffer_size);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_buffer_size: %s");
+
+    err = snd_pcm_status_malloc(&s->status);
+    SndReturn_(err, "Failed: snd_pcm_status_malloc: %s");
+
+    s->pcm    = pcm;
+    s->stream = snd_pcm_stream(pcm);
+
+    return 0;
+}
+
+void sndx_status_free(sndx_status_t* s)
+{
+    if (s->status) snd_pcm_status_free(s->status);
+    s->status = nullptr;
+}
+
+void sndx_status_set_avail(sndx_status_t* s, sframes_t avail)
+{
+    s->avail     = avail;
+    s->delay     = s->stream == SND_PCM_STREAM_CAPTURE ? avail : (sframes_t)s->buffer_size - avail;
+    s->has_avail = true;
+    s->has_full  = false;
+}
+
+void sndx_status_moved(sndx_status_t* s, uframes_t frames)
+{
+    s->avail -= (sframes_t)frames;
+    s->delay += s->stream == SND_PCM_STREAM_CAPTURE ? -(sframes_t)frames : (sframes_t)frames;
+}
+
+void sndx_status_invalidate(sndx_status_t* s)
+{
+    s->has_avail = false;
+    s->has_full  = false;
+}
+
+const status_t* sndx_status_get(sndx_status_t* s)
+{
+    s->requests++;
+    if (s->has_full) return s->status;
+
+    s->ioctls++;
+
+    snd_pcm_status_set_audio_htstamp_config(s->status, &s->config);
+    if (snd_pcm_status(s->pcm, s->status) < 0) return nullptr;
+
+    // Exact position from here on, frames moved before are in it already
+    s->avail     = (sframes_t)snd_pcm_status_get_avail(s->status);
+    s->delay     = snd_pcm_status_get_delay(s->status);
+    s->has_avail = true;
+    s->has_full  = true;
+
+    return s->status;
+}
+
+int sndx_status_delay(sndx_status_t* s, sframes_t* delay)
+{
+    if (!s->has_avail)
+    {
+        if (!sndx_status_get(s)) return -EIO;
+    }
+    else
+    {
+        s->requests++;
+    }
+
+    *delay = s->delay;
+
+    return 0;
+}
+
+void sndx_status_dump(sndx_status_t* s, u64 cycles, output_t* output)
+{
+    f64 saved = cycles ? (f64)(s->requests - s->ioctls) / (f64)cycles : 0.0;
+
+    a_info("  %-8s status: %ld requests, %ld ioctls, %.2f ioctls saved per cycle",
+           s->stream == SND_PCM_STREAM_CAPTURE ? "capture" : "playback", s->requests, s->ioctls, saved);
+}
@@ -212,6 +212,15 @@ int sndx_hstats_update(sndx_hstats_t* t, snd_pcm_t* handle, uframes_t frames_pro
     err = snd_pcm_status(handle, status);
     SndReturn_(err, "Failed: snd_pcm_status: %s");
 
+    sndx_hstats_from_status(t, status, 0);
+
+    return 0;
+}
+
+void sndx_hstats_from_status(sndx_hstats_t* t, const status_t* status, uframes_t frames_processed)
+{
+    t->frames += frames_processed;
+
     snd_pcm_status_get_trigger_htstamp(status, &t->trigger);
     snd_pcm_status_get_htstamp(status, &t->tstamp);
     snd_pcm_status_get_audio_htstamp(status, &t->audio);
@@ -219,8 +228,6 @@ int sndx_hstats_update(sndx_hstats_t* t, snd_pcm_t* handle, uframes_t frames_pro
 
     t->avail = snd_pcm_status_get_avail(status);
     t->delay = snd_pcm_status_get_delay(status);
-
-    return 0;
 }
 
 /** @brief Print report of current snapshot and print difference in sys and snd time */
@@ -0,0 +1,216 @@
+/** @file trace.c
+ *  @brief Fixed size binary ring of per-cycle events, written from the realtime path.
+ */
+#include "sndx/trace.h"
+#include <unistd.h> // getpid
+
+static const char* trace_type_names[] = {
+    [SNDX_TRACE_WAKEUP]  = "wakeup", //
+    [SNDX_TRACE_AVAIL]   = "avail",  //
+    [SNDX_TRACE_READ]    = "read",   //
+    [SNDX_TRACE_WRITE]   = "write",  //
+    [SNDX_TRACE_XRUN]    = "xrun",   //
+    [SNDX_TRACE_START]   = "start",  //
+    [SNDX_TRACE_STOP]    = "stop",   //
+    [SNDX_TRACE_TIMEOUT] = "timeout",
+};
+
+static const char* trace_stream_names[] = {
+    [SNDX_TRACE_DUPLEX] = "duplex", //
+    [SNDX_TRACE_PLAY]   = "play",   //
+    [SNDX_TRACE_CAPT]   = "capt",
+};
+
+const char* sndx_trace_type_name(sndx_trace_type_t type)
+{
+    if (type > SNDX_TRACE_TYPE_LAST) return "unknown";
+    return trace_type_names[type];
+}
+
+void sndx_trace_dump(sndx_trace_t* t, output_t* output)
+{
+    a_info("Trace:");
+    a_info("  capacity: %ld", t->capacity);
+    a_info("  written : %ld", t->write);
+    a_info("  cycle   : %d", t->cycle);
+    a_info("  dumps   : %d", t->dumps);
+}
+
+int sndx_trace_open(sndx_trace_t** tp, u64 capacity, output_t* output)
+{
+    int err;
+
+    sndx_trace_t* t;
+    t = calloc(1, sizeof(*t));
+    RetVal_(!t, -ENOMEM, "Failed calloc sndx_trace_t* t");
+
+    // Round up to power of two for masking
+    t->capacity = 1;
+    while (t->capacity < capacity) t->capacity <<= 1;
+
+    t->events = calloc(t->capacity, sizeof(sndx_trace_event_t));
+    err       = -(!t->events);
+    Goto_(err, __close, "Failed calloc sndx_trace_event_t* t->events");
+
+    *tp = t;
+
+    return 0;
+
+__close:
+    sndx_trace_close(t);
+    *tp = nullptr;
+
+    return err;
+}
+
+void sndx_trace_close(sndx_trace_t* t)
+{
+    if (!t) return;
+    Free(t->events);
+    Free(t);
+}
+
+void sndx_trace_push( //
+    sndx_trace_t*       t,
+    sndx_trace_type_t   type,
+    sndx_trace_stream_t stream,
+    sframes_t           avail,
+    sframes_t           delay,
+    uframes_t           frames)
+{
+    if (!t) return;
+
+    tspec_t now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (type == SNDX_TRACE_WAKEUP) t->cycle++;
+
+    // Single writer, so plain read of our own index is fine
+    u64                 w = t->write;
+    sndx_trace_event_t* e = &t->events[w & (t->capacity - 1)];
+
+    e->nsecs  = (u64)now.tv_sec * 1000000000ULL + (u64)now.tv_nsec;
+    e->type   = type;
+    e->stream = stream;
+    e->cycle  = t->cycle;
+    e->avail  = avail;
+    e->delay  = delay;
+    e->frames = frames;
+
+    // Publish after the record is complete
+    __atomic_store_n(&t->write, w + 1, __ATOMIC_RELEASE);
+}
+
+sframes_t sndx_trace_delay(sndx_trace_t* t, sndx_status_t* s)
+{
+    if (!t || !s) return 0;
+
+    sframes_t delay;
+    return sndx_status_delay(s, &delay) < 0 ? 0 : delay;
+}
+
+void sndx_trace_request_dump(sndx_trace_t* t)
+{
+    if (!t) return;
+    __atomic_add_fetch(&t->dumps, 1, __ATOMIC_RELEASE);
+}
+
+bool sndx_trace_dump_pending(sndx_trace_t* t)
+{
+    if (!t) return false;
+    return __atomic_exchange_n(&t->dumps, 0, __ATOMIC_ACQ_REL) != 0;
+}
+
+u64 sndx_trace_snapshot(sndx_trace_t* t, sndx_trace_event_t* dst, u64 max)
+{
+    u64 w1 = __atomic_load_n(&t->write, __ATOMIC_ACQUIRE);
+
+    u64 count = w1 < t->capacity ? w1 : t->capacity;
+    count     = count < max ? count : max;
+
+    u64 start = w1 - count;
+    RANGE(i, count) { dst[i] = t->events[(start + i) & (t->capacity - 1)]; }
+
+    // Writer may have lapped us while copying, those records may be torn
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    u64 w2 = __atomic_load_n(&t->write, __ATOMIC_ACQUIRE);
+
+    // Index i is safe only if the writer (possibly busy with index w2) has not reached i + capacity
+    u64 first_valid = w2 >= t->capacity ? w2 - t->capacity + 1 : 0;
+    if (first_valid <= start) return count;
+    if (first_valid >= w1) return 0;
+
+    u64 skip = first_valid - start;
+    memmove(dst, &dst[skip], (count - skip) * sizeof(sndx_trace_event_t));
+
+    return count - skip;
+}
+
+int sndx_trace_write_chrome(sndx_trace_t* t, FILE* file, u64 last_nsecs, output_t* output)
+{
+    int err;
+
+    sndx_trace_event_t* events = calloc(t->capacity, sizeof(sndx_trace_event_t));
+    RetVal_(!events, -ENOMEM, "Failed calloc sndx_trace_event_t* events");
+
+    u64 count = sndx_trace_snapshot(t, events, t->capacity);
+
+    // Only keep the window [latest - last_nsecs, latest]
+    u64 first = 0;
+    if (count && last_nsecs)
+    {
+        u64 latest = events[count - 1].nsecs;
+        while (first < count && latest - events[first].nsecs > last_nsecs) first++;
+    }
+
+    // Timestamps relative to first exported event keep the numbers readable
+    u64 origin = count ? events[first].nsecs : 0;
+    int pid    = getpid();
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    RANGE(tid, SNDX_TRACE_CAPT + 1)
+    {
+        fprintf(file,
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}},\n", //
+                pid, tid, trace_stream_names[tid]);
+    }
+
+    RANGE(i, first, count)
+    {
+        sndx_trace_event_t* e  = &events[i];
+        f64                 ts = (f64)(e->nsecs - origin) / 1000.0; // chrome expects usecs
+        const char*         sn = trace_stream_names[e->stream <= SNDX_TRACE_CAPT ? e->stream : 0];
+
+        // Xruns are global instants so they show as a line through all tracks
+        fprintf(file,
+                "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+                "\"args\":{\"cycle\":%u,\"avail\":%ld,\"delay\":%ld,\"frames\":%lu}},\n",
+                sndx_trace_type_name(e->type), e->type == SNDX_TRACE_XRUN ? "g" : "t", //
+                ts, pid, e->stream, e->cycle, e->avail, e->delay, e->frames);
+
+        // Counters give the avail/delay graphs
+        if (e->type == SNDX_TRACE_AVAIL || e->type == SNDX_TRACE_XRUN)
+        {
+            fprintf(file,
+                    "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,"
+                    "\"args\":{\"avail\":%ld,\"delay\":%ld}},\n",
+                    sn, ts, pid, e->avail, e->delay);
+        }
+    }
+
+    // Trailing metadata record avoids dealing with the last comma
+    fprintf(file,
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"sndx\"}}\n"
+            "]}\n",
+            pid);
+
+    err = fflush(file);
+    SysCheck_(err, "Failed: fflush: %s");
+
+    a_info("Trace: wrote %ld events (%ld in ring)", count - first, count);
+
+    free(events);
+
+    return err < 0 ? -errno : 0;
+}
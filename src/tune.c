@@ -0,0 +1,229 @@
+/** @file tune.c
+ *  @brief Period size / periods auto-tuner, @see tune.h
+ */
+#include "sndx/sys.h"
+#include "sndx/tune.h"
+#include <pthread.h>
+#include <sched.h>
+
+static const uframes_t tune_period_sizes[] = {16, 32, 64, 128, 256, 512, 1024};
+static const u32       tune_periods[]      = {2, 3, 4};
+
+uframes_t sndx_tune_latency(const sndx_tune_result_t* r) { return r->period_size * r->periods; }
+
+/** @brief Smallest buffer first, fewer periods first for the same buffer. */
+static int tune_compare(const void* a, const void* b)
+{
+    const sndx_tune_result_t* ra = a;
+    const sndx_tune_result_t* rb = b;
+
+    uframes_t la = sndx_tune_latency(ra);
+    uframes_t lb = sndx_tune_latency(rb);
+
+    if (la != lb) return la < lb ? -1 : 1;
+    return (int)ra->periods - (int)rb->periods;
+}
+
+static void tune_late(sndx_tune_result_t* r, f64 usecs)
+{
+    u32 bin = 0;
+    while (bin < SNDX_TUNE_HIST_BINS - 1 && usecs >= (f64)(1u << bin)) bin++;
+
+    r->hist[bin]++;
+    if (usecs > r->late_max_us) r->late_max_us = usecs;
+}
+
+static void tune_percentile(sndx_tune_result_t* r)
+{
+    u64 total = 0;
+    RANGE(b, SNDX_TUNE_HIST_BINS) { total += r->hist[b]; }
+
+    u64 sum = 0;
+    RANGE(b, SNDX_TUNE_HIST_BINS)
+    {
+        sum += r->hist[b];
+        if (sum * 100 < total * 99) continue;
+
+        r->late_p99_us = b ? (f64)(1u << b) : 0.0;
+        if (b == SNDX_TUNE_HIST_BINS - 1) r->late_p99_us = r->late_max_us;
+        break;
+    }
+}
+
+/** @brief Silence through the duplex for `seconds`, every failure recovered and counted. */
+static int tune_candidate(sndx_duplex_t* d, f64 seconds, sndx_tune_result_t* r, output_t* output)
+{
+    int err;
+
+    err = sndx_duplex_start(d);
+    SndReturn_(err, "Failed sndx_duplex_start: %s");
+
+    r->ran = true;
+
+    u64 start = sndx_nsecs();
+    u64 end   = start + (u64)(seconds * 1e9);
+
+    while (sndx_nsecs() < end)
+    {
+        uframes_t avail = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        if (err >= 0)
+        {
+            // Capture beyond one period at wakeup is how late the wakeup came
+            sframes_t late = d->st_capt.avail - (sframes_t)d->period_size;
+            tune_late(r, late > 0 ? late * 1e6 / d->rate : 0.0);
+
+            uframes_t frames = avail;
+            uframes_t offset = 0;
+
+            err = sndx_duplex_read(d, &frames, &offset);
+            if (err >= 0)
+            {
+                RANGE(chn, d->ch_play)
+                {
+                    memset(d->buf_play->bufdata + chn * d->buf_play->frames + offset, 0, frames * sizeof(float));
+                }
+
+                err = sndx_duplex_write(d, &frames, &offset);
+            }
+
+            if (err >= 0) r->cycles++;
+        }
+
+        if (err >= 0) continue;
+
+        r->xruns++;
+
+        err = sndx_duplex_recover(d);
+        Goto_(err, __stop, "Failed sndx_duplex_recover, giving up on %ld x %d", d->period_size, d->periods);
+    }
+
+__stop:
+    r->seconds = (sndx_nsecs() - start) * 1e-9;
+
+    sndx_duplex_stop(d);
+
+    return err < 0 ? err : 0;
+}
+
+int sndx_tune_run(                 //
+    const sndx_tune_desc_t* desc,
+    sndx_tune_result_t*     results,
+    u32                     capacity,
+    u32*                    nresults,
+    output_t*               output)
+{
+    int err;
+
+    const uframes_t* sizes   = desc->period_sizes ? desc->period_sizes : tune_period_sizes;
+    u32              nsizes  = desc->period_sizes ? desc->nperiod_sizes : sizeof(tune_period_sizes) / sizeof(*sizes);
+    const u32*       periods = desc->periods ? desc->periods : tune_periods;
+    u32              nper    = desc->periods ? desc->nperiods : sizeof(tune_periods) / sizeof(*periods);
+    f64              seconds = desc->seconds > 0 ? desc->seconds : 10.0;
+
+    sndx_tune_result_t candidates[SNDX_TUNE_MAX_CANDIDATES];
+    u32                ncandidates = 0;
+
+    RANGE(i, nsizes)
+    RANGE(j, nper)
+    {
+        if (ncandidates == SNDX_TUNE_MAX_CANDIDATES) break;
+        candidates[ncandidates++] = (sndx_tune_result_t){.period_size = sizes[i], .periods = periods[j]};
+    }
+
+    qsort(candidates, ncandidates, sizeof(*candidates), tune_compare);
+
+    // Keep the policy of the caller to put it back afterwards
+    int                policy = 0;
+    struct sched_param saved  = {};
+    bool               rt     = false;
+
+    if (desc->priority > 0)
+    {
+        pthread_getschedparam(pthread_self(), &policy, &saved);
+
+        struct sched_param param = {.sched_priority = desc->priority};
+        rt                       = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+        if (!rt) a_info("Could not set SCHED_FIFO %d, tuning with the default policy", desc->priority);
+    }
+
+    int best  = -ENOENT;
+    *nresults = 0;
+
+    RANGE(k, ncandidates)
+    {
+        if (*nresults == capacity) break;
+
+        sndx_tune_result_t* r = &results[(*nresults)++];
+        *r                    = candidates[k];
+
+        a_info("Tuning %ld x %d (%ld frames) for %.1f s", r->period_size, r->periods, sndx_tune_latency(r), seconds);
+
+        sndx_duplex_t* d = nullptr;
+        if (desc->open)
+        {
+            err = desc->open(&d, r->period_size, r->periods, desc->data, output);
+        }
+        else
+        {
+            err = sndx_duplex_open(&d, desc->play, desc->capt, desc->format, desc->rate, r->period_size, r->periods,
+                                   desc->access, output);
+        }
+
+        // Refused by the device, not a failure of the sweep
+        if (err < 0)
+        {
+            a_info("  %ld x %d not accepted: %s", r->period_size, r->periods, snd_strerror(err));
+            continue;
+        }
+
+        // The device may round, the result is what ran, at the rate it opened with (a custom open may ignore desc)
+        r->period_size = d->period_size;
+        r->periods     = d->periods;
+        r->headroom_us = (f64)(r->periods - 1) * r->period_size * 1e6 / d->rate;
+
+        err = tune_candidate(d, seconds, r, output);
+        sndx_duplex_close(d);
+
+        tune_percentile(r);
+
+        r->xrun_rate = r->seconds > 0 ? r->xruns * 3600.0 / r->seconds : 0.0;
+        r->stable    = err >= 0 && r->ran && r->xrun_rate <= desc->max_xrun_rate;
+
+        a_info("  %ld cycles, %ld xruns (%.1f per hour), lateness p99 %.0f us, max %.0f us of %.0f us headroom%s",
+               r->cycles, r->xruns, r->xrun_rate, r->late_p99_us, r->late_max_us, r->headroom_us,
+               r->stable ? ", stable" : "");
+
+        if (r->stable && best < 0) best = (int)(*nresults - 1);
+        if (best >= 0 && !desc->sweep_all) break;
+    }
+
+    if (rt) pthread_setschedparam(pthread_self(), policy, &saved);
+
+    return best;
+}
+
+void sndx_tune_dump(const sndx_tune_result_t* results, u32 nresults, int best, u32 rate, output_t* output)
+{
+    a_info("  %6s %7s %7s %9s %8s %6s %10s %10s %10s", "period", "periods", "frames", "ms", "cycles", "xruns",
+           "p99 us", "max us", "room us");
+
+    RANGE(i, nresults)
+    {
+        const sndx_tune_result_t* r = &results[i];
+
+        if (!r->ran)
+        {
+            a_info("  %6ld %7d %7ld %9.2f   not accepted", r->period_size, r->periods, sndx_tune_latency(r),
+                   sndx_tune_latency(r) * 1000.0 / rate);
+            continue;
+        }
+
+        a_info("  %6ld %7d %7ld %9.2f %8ld %6ld %10.0f %10.0f %10.0f %s", r->period_size, r->periods,
+               sndx_tune_latency(r), sndx_tune_latency(r) * 1000.0 / rate, r->cycles, r->xruns, r->late_p99_us,
+               r->late_max_us, r->headroom_us, i == best ? "<- recommended" : (r->stable ? "stable" : ""));
+    }
+
+    if (best < 0) a_info("  nothing stable within the xrun budget");
+}
@@ -1,4 +1,5 @@
 #include "sndx/xrun.h"
+#include "sndx/timer.h" // htstamp_diff_nsecs
 
 int sndx_xrun_recovery_alsalib(snd_pcm_t* pcm, int err, output_t* output)
 {
@@ -26,3 +27,267 @@ int sndx_xrun_recovery_alsalib(snd_pcm_t* pcm, int err, output_t* output)
 
     return err;
 }
+
+static const char* xrun_strategy_names[] = {
+    [SNDX_XRUN_NONE]    = "none",    //
+    [SNDX_XRUN_FORWARD] = "forward", //
+    [SNDX_XRUN_TOPUP]   = "topup",   //
+    [SNDX_XRUN_REWIND]  = "rewind",  //
+    [SNDX_XRUN_RESUME]  = "resume",  //
+    [SNDX_XRUN_PREPARE] = "prepare", //
+    [SNDX_XRUN_FAILED]  = "failed",
+};
+
+const char* sndx_xrun_strategy_name(sndx_xrun_strategy_t strategy)
+{
+    if (strategy > SNDX_XRUN_STRATEGY_LAST) return "unknown";
+    return xrun_strategy_names[strategy];
+}
+
+void sndx_xrun_dump(sndx_xrun_t* x, output_t* output)
+{
+    a_info("Xrun (%s):", x->stream == SND_PCM_STREAM_PLAYBACK ? "play" : "capt");
+    a_info("  target    : %ld", x->target);
+    a_info("  last      : %s, lost %ld frames", sndx_xrun_strategy_name(x->strategy), x->lost);
+    a_info("  lost total: %ld frames", x->lost_total);
+    RANGE(i, SNDX_XRUN_NONE + 1, SNDX_XRUN_STRATEGY_LAST + 1)
+    {
+        a_info("  %-10s: %ld", xrun_strategy_names[i], x->count[i]);
+    }
+}
+
+int sndx_xrun_init(sndx_xrun_t* x, snd_pcm_t* pcm, output_t* output)
+{
+    int err;
+
+    memset(x, 0, sizeof(*x));
+
+    hw_params_t* hw_params;
+    snd_pcm_hw_params_alloca(&hw_params);
+
+    err = snd_pcm_hw_params_current(pcm, hw_params);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_current: %s");
+
+    err = snd_pcm_hw_params_get_access(hw_params, &x->access);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_access: %s");
+
+    err = snd_pcm_hw_params_get_format(hw_params, &x->format);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_format: %s");
+
+    err = snd_pcm_hw_params_get_channels(hw_params, &x->channels);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_channels: %s");
+
+    err = snd_pcm_hw_params_get_rate(hw_params, &x->rate, 0);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_rate: %s");
+
+    err = snd_pcm_hw_params_get_period_size(hw_params, &x->period_size, 0);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_period_size: %s");
+
+    err = snd_pcm_hw_params_get_buffer_size(hw_params, &x->buffer_size);
+    SndReturn_(err, "Failed: snd_pcm_hw_params_get_buffer_size: %s");
+
+    x->stream = snd_pcm_stream(pcm);
+
+    // Capture: read a period next cycle, Playback: what a duplex has queued right before writing a period
+    x->target = x->stream == SND_PCM_STREAM_CAPTURE ? x->period_size : x->buffer_size - x->period_size;
+
+    return 0;
+}
+
+/** @brief Silence `frames` after appl_ptr with writei, from a chunk on the stack (RT safe). */
+static int xrun_topup_rw(snd_pcm_t* pcm, uframes_t frames, sndx_xrun_t* x)
+{
+    u8 chunk[8192];
+
+    uframes_t per = sizeof(chunk) / snd_pcm_frames_to_bytes(pcm, 1);
+    if (!per) return -EINVAL;
+
+    int err = snd_pcm_format_set_silence(x->format, chunk, per * x->channels);
+    if (err < 0) return err;
+
+    while (frames)
+    {
+        sframes_t n = snd_pcm_writei(pcm, chunk, frames < per ? frames : per);
+        if (n < 0) return n;
+        if (!n) return -EPIPE;
+
+        frames -= n;
+    }
+
+    return 0;
+}
+
+/** @brief Silence `frames` after appl_ptr and commit them, mmap or RW interleaved access. */
+static int xrun_topup(snd_pcm_t* pcm, uframes_t frames, sndx_xrun_t* x)
+{
+    int err;
+
+    if (x->access == SND_PCM_ACCESS_RW_INTERLEAVED) return xrun_topup_rw(pcm, frames, x);
+
+    const area_t* areas;
+    uframes_t     offset = 0;
+    uframes_t     n      = 0;
+
+    while (frames)
+    {
+        n = frames;
+
+        err = snd_pcm_mmap_begin(pcm, &areas, &offset, &n);
+        if (err < 0) return err;
+        if (!n) return -EPIPE;
+
+        err = snd_pcm_areas_silence(areas, offset, x->channels, n, x->format);
+        if (err < 0) return err;
+
+        err = snd_pcm_mmap_commit(pcm, offset, n);
+        if (err < 0) return err;
+
+        frames -= n;
+    }
+
+    return 0;
+}
+
+/** @brief Frames that passed between the stream stopping and now. */
+static sframes_t xrun_frames_stopped(snd_pcm_t* pcm, sndx_xrun_t* x)
+{
+    snd_pcm_status_t* status;
+    snd_pcm_status_alloca(&status);
+
+    if (snd_pcm_status(pcm, status) < 0) return 0;
+
+    htstamp_t now, trigger;
+    snd_pcm_status_get_htstamp(status, &now);
+    snd_pcm_status_get_trigger_htstamp(status, &trigger);
+
+    i64 nsecs = htstamp_diff_nsecs(now, trigger);
+
+    return nsecs > 0 ? (sframes_t)(nsecs * x->rate / 1000000000LL) : 0;
+}
+
+/** @brief Grade 5: prepare, refill if playback, start. */
+static int xrun_prepare(snd_pcm_t* pcm, sndx_xrun_t* x)
+{
+    int err;
+
+    err = snd_pcm_prepare(pcm);
+    if (err < 0) return err;
+
+    if (x->stream == SND_PCM_STREAM_PLAYBACK)
+    {
+        err = xrun_topup(pcm, x->target, x);
+        if (err < 0) return err;
+    }
+
+    // Linked capture is started along with playback
+    if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)
+    {
+        err = snd_pcm_start(pcm);
+        if (err < 0) return err;
+    }
+
+    return 0;
+}
+
+/** @brief Grades 1-3, only while running. */
+static int xrun_soft(snd_pcm_t* pcm, sframes_t avail, sndx_xrun_t* x)
+{
+    sframes_t n;
+
+    if (x->stream == SND_PCM_STREAM_CAPTURE)
+    {
+        // Less than a period left before the hardware overwrites unread frames
+        if (avail <= (sframes_t)(x->buffer_size - x->period_size)) return SNDX_XRUN_NONE;
+
+        n = snd_pcm_forward(pcm, avail - x->target);
+        if (n < 0) return n;
+
+        x->lost = n;
+        return SNDX_XRUN_FORWARD;
+    }
+
+    sframes_t queued = x->buffer_size - avail;
+
+    if (queued < (sframes_t)x->period_size)
+    {
+        n = x->target - queued;
+
+        int err = xrun_topup(pcm, n, x);
+        if (err < 0) return err;
+
+        x->lost = n;
+        return SNDX_XRUN_TOPUP;
+    }
+
+    if (queued > (sframes_t)(x->target + x->period_size))
+    {
+        n = snd_pcm_rewindable(pcm);
+        if (n < 0) return n;
+
+        n = snd_pcm_rewind(pcm, n < queued - (sframes_t)x->target ? n : queued - (sframes_t)x->target);
+        if (n < 0) return n;
+
+        x->lost = n;
+        return n ? SNDX_XRUN_REWIND : SNDX_XRUN_NONE;
+    }
+
+    return SNDX_XRUN_NONE;
+}
+
+int sndx_xrun_recovery_graded(snd_pcm_t* pcm, int err, sndx_xrun_t* x)
+{
+    int ret = SNDX_XRUN_NONE;
+
+    x->lost = 0;
+
+    snd_pcm_state_t state = snd_pcm_state(pcm);
+
+    if (err == -ESTRPIPE || state == SND_PCM_STATE_SUSPENDED)
+    {
+        // Never sleep here, if the driver is not ready yet, prepare
+        err = snd_pcm_resume(pcm);
+        if (err == 0)
+        {
+            ret = SNDX_XRUN_RESUME;
+            goto __done;
+        }
+
+        state = SND_PCM_STATE_XRUN;
+    }
+
+    if (state == SND_PCM_STATE_RUNNING && err != -EPIPE)
+    {
+        sframes_t avail = snd_pcm_avail_update(pcm);
+        if (avail >= 0)
+        {
+            ret = xrun_soft(pcm, avail, x);
+            goto __done;
+        }
+
+        // Stopped in between
+        state = SND_PCM_STATE_XRUN;
+    }
+
+    // Prepared counts too, callers like `sndx_pollfds_xrun` prepare, but do not refill or start
+    if (err == -EPIPE || state == SND_PCM_STATE_XRUN || state == SND_PCM_STATE_PREPARED)
+    {
+        x->lost = xrun_frames_stopped(pcm, x);
+
+        ret = xrun_prepare(pcm, x);
+        if (ret == 0) ret = SNDX_XRUN_PREPARE;
+    }
+
+__done:
+    if (ret < 0)
+    {
+        x->strategy = SNDX_XRUN_FAILED;
+        x->count[SNDX_XRUN_FAILED]++;
+        return ret;
+    }
+
+    x->strategy    = ret;
+    x->lost_total += x->lost;
+    x->count[ret]++;
+
+    return ret;
+}
@@ -0,0 +1,98 @@
+/** @file test_aggregate.c
+ *  @brief Start and restart of an aggregate with two playback devices linked to a capture master.
+ *
+ *  Needs two playback devices on the card of the master, so both can be linked to it.
+ *
+ *  Checklist:
+ *      1. Both playback devices are linked, not run through drift
+ *      2. Right after start every playback buffer is still full of silence: a prepare of the
+ *         group after filling one member would have emptied it, and the group would underrun
+ *      3. Same after a restart
+ *      4. A few cycles of wait-read-write run without an error
+ */
+#include "sndx/aggregate.h"
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr u32       periods     = 3;
+
+/** @brief 2. and 3., a period at most may have played since start. */
+static int check_filled(sndx_aggregate_t* a, output_t* output)
+{
+    RANGE(i, a->ndevs)
+    {
+        sndx_aggregate_dev_t* dev = &a->devs[i];
+        if (dev->stream != SND_PCM_STREAM_PLAYBACK) continue;
+
+        sframes_t avail = snd_pcm_avail(dev->pcm);
+
+        int err = -(avail < 0 || (uframes_t)avail > a->period_size);
+        Return_(err, "%s: %ld frames avail after start, buffer of %ld", dev->name, avail,
+                a->period_size * a->periods);
+    }
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const sndx_aggregate_desc_t desc[] = {
+        {.name = "hw:A96,0", .stream = SND_PCM_STREAM_CAPTURE},
+        {.name = "hw:A96,0", .stream = SND_PCM_STREAM_PLAYBACK},
+        {.name = "hw:A96,1", .stream = SND_PCM_STREAM_PLAYBACK},
+    };
+
+    sndx_aggregate_t* a;
+    err = sndx_aggregate_open(&a, desc, 3, 0, SND_PCM_FORMAT_S32_LE, rate, period_size, periods, output);
+    SndFatal(err, "Failed sndx_aggregate_open: %s");
+
+    sndx_dump_aggregate(a, output);
+
+    // 1.
+    err = -(!a->devs[1].linked || !a->devs[2].linked);
+    Goto_(err, __close, "Playback devices not linked to the master");
+
+    // 2.
+    err = sndx_aggregate_start(a);
+    SndGoto_(err, __close, "Failed sndx_aggregate_start: %s");
+
+    err = check_filled(a, output);
+    Goto_(err, __stop, "Silence lost on start");
+
+    // 3.
+    err = sndx_aggregate_restart(a);
+    SndGoto_(err, __stop, "Failed sndx_aggregate_restart: %s");
+
+    err = check_filled(a, output);
+    Goto_(err, __stop, "Silence lost on restart");
+
+    // 4.
+    RANGE(i, 100)
+    {
+        err = sndx_aggregate_wait(a);
+        SndGoto_(err, __stop, "Failed sndx_aggregate_wait: %s");
+
+        err = sndx_aggregate_read(a);
+        SndGoto_(err, __stop, "Failed sndx_aggregate_read: %s");
+
+        err = sndx_aggregate_write(a);
+        SndGoto_(err, __stop, "Failed sndx_aggregate_write: %s");
+    }
+
+    a_info("Aggregate: all checks passed");
+
+__stop:
+    sndx_aggregate_stop(a);
+
+__close:
+    sndx_aggregate_close(a);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/** @file test_clock.c
+ *  @brief Drift estimator on synthetic timestamps, read concurrently from another thread.
+ *
+ *  Checklist:
+ *      1. Constant drift with timestamp noise is found within a fraction of a ppm
+ *      2. Late snapshots are rejected as outliers and do not move the estimate
+ *      3. A step in the timeline starts the fit over, once, and the drift is found again
+ *      4. A change of drift is followed within a few windows
+ *      5. A reader on another thread only ever sees whole estimates
+ */
+#include "sndx/clock.h"
+#include <pthread.h>
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr f64       window      = 10.0;
+constexpr i64       period_ns   = (i64)period_size * 1000000000 / rate;
+
+typedef struct
+{
+    sndx_clock_t* c;
+    int           stop;
+    u64           reads;
+    u64           torn;
+
+} reader_t;
+
+static void* job_reader(void* data)
+{
+    reader_t* r = data;
+
+    while (!__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE))
+    {
+        sndx_clock_estimate_t est;
+        sndx_clock_get(r->c, &est);
+
+        // Fields written together have to come together
+        if (est.valid != (est.samples >= SNDX_CLOCK_WARMUP)) r->torn++;
+        if (!est.samples && (est.ppm != 0.0 || est.span_s != 0.0)) r->torn++;
+
+        r->reads++;
+    }
+
+    return nullptr;
+}
+
+/** @brief Snapshots from `*sys` on for `seconds`, every 100th taken late by 500 us. */
+static void feed(sndx_clock_t* c, i64* sys, f64* audio, f64 ppm, f64 seconds)
+{
+    u64 n = (u64)(seconds * 1e9 / period_ns);
+
+    RANGE(i, n)
+    {
+        *sys   += period_ns;
+        *audio += period_ns * (1.0 + ppm * 1e-6);
+
+        // Interrupt to timestamp noise of a couple of microseconds
+        i64 noise = (rand() % 4000) - 2000;
+        i64 late  = i % 100 == 99 ? 500000 : 0;
+
+        sndx_clock_update_ns(c, *sys + late, (i64)*audio + noise);
+    }
+}
+
+static int check_ppm(sndx_clock_t* c, f64 ppm, f64 tolerance, const char* what, output_t* output)
+{
+    sndx_clock_estimate_t est;
+    sndx_clock_get(c, &est);
+
+    sndx_clock_dump(c, what, output);
+
+    RetVal_(!est.valid, -1, "%s: estimate not valid", what);
+    RetVal_(fabs(est.ppm - ppm) > tolerance, -1, "%s: %.3f ppm, expected %.3f", what, est.ppm, ppm);
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    srand(1);
+
+    sndx_clock_t c;
+    sndx_clock_init(&c, rate, period_size, window);
+
+    reader_t reader = {.c = &c};
+
+    pthread_t tid;
+    err = pthread_create(&tid, nullptr, job_reader, &reader);
+    Fatal_(err, "Failed: pthread_create");
+
+    i64 sys   = 0;
+    f64 audio = 0;
+
+    // 1. and 2.
+    feed(&c, &sys, &audio, 50.0, 30.0);
+
+    err = check_ppm(&c, 50.0, 0.1, "constant", output);
+    Goto_(err, __close, "Constant drift");
+
+    u64 late = (u64)(30.0 * 1e9 / period_ns) / 100;
+    err      = -(c.est.rejected < late * 9 / 10 || c.est.rejected > late * 11 / 10);
+    Goto_(err, __close, "%ld rejected, expected about %ld", c.est.rejected, late);
+
+    err = -(c.est.resets != 0);
+    Goto_(err, __close, "Started over without a step");
+
+    // 3. Audio jumps 10 ms ahead (xrun without a new trigger)
+    audio += 1e7;
+    feed(&c, &sys, &audio, 50.0, 30.0);
+
+    err = check_ppm(&c, 50.0, 0.1, "step", output);
+    Goto_(err, __close, "After step");
+
+    err = -(c.est.resets != 1);
+    Goto_(err, __close, "%ld start overs, expected 1", c.est.resets);
+
+    // 4. The slope settles slower than the means, a few windows later the old drift is forgotten
+    feed(&c, &sys, &audio, -20.0, 8 * window);
+
+    err = check_ppm(&c, -20.0, 0.5, "change", output);
+    Goto_(err, __close, "After change of drift");
+
+__close:
+    __atomic_store_n(&reader.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(tid, nullptr);
+
+    a_info("Reader: %ld reads, %ld torn", reader.reads, reader.torn);
+
+    if (!err)
+    {
+        err = -(reader.torn != 0);
+        Check_(err, "Reader saw torn estimates");
+    }
+
+    if (!err) a_info("Clock: all checks passed");
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,314 @@
+/** @file test_drift.c
+ *  @brief Drift compensation against a simulated pair of clocks, no hardware needed.
+ *
+ *  Push: capture hands over a period per cycle, playback consumes `period * (1 + ppm)`.
+ *  Pull: a foreign capture clock delivers `period * (1 + ppm)` per cycle, a period is pulled.
+ *  The measured fill level is jittered by up to a quarter period, like wakeup jitter would.
+ *
+ *  Checklist:
+ *      1. Fill level settles at target for SIMPLE and SAMPLERATE
+ *      2. Mean ratio settles at the simulated drift
+ *      3. Resampled sine has no steps at period boundaries
+ *      4. Same for `sndx_drift_pull`, without underruns once settled, a pull of no frames changes nothing
+ *      5. Rate shift: frames pass untouched, the shifted clock (playback or capture) settles the fill
+ */
+#include "sndx/drift.h"
+#include <math.h>
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr u32       channels    = 2;
+constexpr f64       drift_ppm   = 120.0;
+constexpr u32       seconds     = 60;
+
+static int run(sndx_sync_type_t sync, output_t* output)
+{
+    int err;
+
+    sndx_buffer_t* in;
+    err = sndx_buffer_open(&in, SND_PCM_FORMAT_S32_LE, channels, period_size, output);
+    SndReturn_(err, "Failed sndx_buffer_open: %s");
+
+    f64           target = period_size * 3 / 2;
+    sndx_drift_t* dr;
+    err = sndx_drift_open(&dr, sync, SND_PCM_FORMAT_S32_LE, channels, rate, period_size, target, output);
+    SndGoto_(err, __close, "Failed sndx_drift_open: %s");
+
+    srand(1);
+
+    u64   cycles   = (u64)seconds * rate / period_size;
+    u64   phase    = 0;
+    f64   fill     = target;
+    f64   consumed = period_size * (1.0 + drift_ppm * 1e-6);
+    f64   max_err  = 0;
+    f64   max_step = 0;
+    float prev     = 0;
+    f64   omega    = 2 * M_PI * 440.0 / rate;
+    u64   win_in   = 0;
+    u64   win_out  = 0;
+
+    RANGE(c, cycles)
+    {
+        RANGE(chn, channels)
+        RANGE(i, period_size) { in->bufdata[chn * period_size + i] = (float)(0.5 * sin(omega * (phase + i))); }
+        phase = (phase + period_size) % rate; // 440 Hz repeats every second, keeps the argument small
+
+        sframes_t out = sndx_drift_process(dr, in, 0, period_size);
+        err           = (int)(out < 0 ? out : 0);
+        SndGoto_(err, __close, "Failed sndx_drift_process: %s");
+
+        // Largest jump between neighbouring output samples, across blocks too
+        RANGE(i, out)
+        {
+            f64 step = fabs(dr->buf->bufdata[i] - prev);
+            max_step = step > max_step ? step : max_step;
+            prev     = dr->buf->bufdata[i];
+        }
+
+        fill += (f64)out - consumed;
+
+        isize jitter = (rand() % (period_size / 2)) - period_size / 4;
+        sndx_drift_update(dr, (sframes_t)(fill + jitter));
+
+        // Last 10 seconds
+        if ((u64)c > cycles - (u64)10 * rate / period_size)
+        {
+            f64 e    = fabs(fill - target);
+            max_err  = e > max_err ? e : max_err;
+            win_in  += period_size;
+            win_out += out;
+        }
+    }
+
+    sndx_drift_dump(dr, output);
+    a_info("  max fill error (last 10s): %.2f frames", max_err);
+    a_info("  max sample step          : %.4f (ideal %.4f)", max_step, 0.5 * omega);
+
+    // Instantaneous ratio follows the jitter, the mean has to match the drift
+    f64 ppm = ((f64)win_out / win_in - 1.0) * 1e6;
+
+    a_info("  mean ratio (last 10s)    : %+.2f ppm", ppm);
+
+    err = -(max_err > period_size / 4.0);
+    Goto_(err, __close, "Fill did not settle: %.2f frames off", max_err);
+
+    err = -(fabs(ppm - drift_ppm) > 20.0);
+    Goto_(err, __close, "Ratio did not settle: %.2f ppm instead of %.2f", ppm, drift_ppm);
+
+    // Linear interpolation never steps further than the input does, SIMPLE may drop a frame
+    f64 max_allowed = (sync == SNDX_SYNC_SIMPLE ? 2.0 : 1.0) * 0.5 * omega * 1.01;
+
+    err = -(max_step > max_allowed);
+    Goto_(err, __close, "Discontinuity: step %.4f", max_step);
+
+__close:
+    sndx_drift_close(dr);
+    sndx_buffer_close(in);
+
+    return err;
+}
+
+/** @brief Clock of one device follows the rate shift value, quantized like the control (10 ppm). */
+static int run_shift(sndx_sync_type_t sync, output_t* output)
+{
+    int err;
+
+    sndx_buffer_t* in;
+    err = sndx_buffer_open(&in, SND_PCM_FORMAT_S32_LE, channels, period_size, output);
+    SndReturn_(err, "Failed sndx_buffer_open: %s");
+
+    f64           target = period_size * 3 / 2;
+    sndx_drift_t* dr;
+    err = sndx_drift_open(&dr, sync, SND_PCM_FORMAT_S32_LE, channels, rate, period_size, target, output);
+    SndGoto_(err, __close, "Failed sndx_drift_open: %s");
+
+    srand(1);
+
+    u64 cycles  = (u64)seconds * rate / period_size;
+    f64 fill    = target;
+    f64 max_err = 0;
+    f64 sum     = 0;
+    u64 n       = 0;
+
+    RANGE(i, channels * period_size) { in->bufdata[i] = (float)i; }
+
+    RANGE(c, cycles)
+    {
+        sframes_t out = sndx_drift_process(dr, in, 0, period_size);
+
+        err = -(out != (sframes_t)period_size || memcmp(dr->buf->bufdata, in->bufdata, period_size * sizeof(float)) != 0);
+        Goto_(err, __close, "Rate shift changed the frames: %ld out of %ld", out, period_size);
+
+        // Shifted playback consumes faster by the value, shifted capture makes each period shorter
+        f64 shift  = (f64)sndx_drift_rate_shift(dr) / SNDX_DRIFT_RATE_SHIFT_UNITY;
+        f64 clock  = sync == SNDX_SYNC_PLAYRATESHIFT ? shift : 1.0 / shift;
+        fill      += (f64)out - period_size * (1.0 + drift_ppm * 1e-6) * clock;
+
+        isize jitter = (rand() % (period_size / 2)) - period_size / 4;
+        sndx_drift_update(dr, (sframes_t)(fill + jitter));
+
+        if ((u64)c > cycles - (u64)10 * rate / period_size)
+        {
+            f64 e   = fabs(fill - target);
+            max_err = e > max_err ? e : max_err;
+            sum    += (1.0 + drift_ppm * 1e-6) * clock;
+            n++;
+        }
+    }
+
+    f64 ppm = (sum / n - 1.0) * 1e6;
+
+    sndx_drift_dump(dr, output);
+    a_info("  max fill error (last 10s): %.2f frames", max_err);
+    a_info("  clock error (last 10s)   : %+.2f ppm", ppm);
+
+    err = -(max_err > period_size / 4.0);
+    Goto_(err, __close, "Fill did not settle: %.2f frames off", max_err);
+
+    err = -(fabs(ppm) > 20.0);
+    Goto_(err, __close, "Shifted clock did not settle: %.2f ppm off", ppm);
+
+__close:
+    sndx_drift_close(dr);
+    sndx_buffer_close(in);
+
+    return err;
+}
+
+static int run_pull(sndx_sync_type_t sync, output_t* output)
+{
+    int err;
+
+    f64           target = 2 * period_size;
+    sndx_drift_t* dr;
+    err = sndx_drift_open(&dr, sync, SND_PCM_FORMAT_S32_LE, channels, rate, period_size, target, output);
+    SndReturn_(err, "Failed sndx_drift_open: %s");
+
+    float* out = calloc(channels * period_size, sizeof(float));
+    err        = -(!out);
+    Goto_(err, __close, "Failed calloc float* out");
+
+    srand(1);
+
+    u64   cycles    = (u64)seconds * rate / period_size;
+    u64   phase     = 0;
+    f64   delivered = 0;
+    f64   max_err   = 0;
+    f64   max_step  = 0;
+    float prev      = 0;
+    f64   omega     = 2 * M_PI * 440.0 / rate;
+    u64   win_in    = 0;
+    u64   win_out   = 0;
+    u64   dropped   = 0;
+
+    RANGE(c, cycles)
+    {
+        // Foreign clock runs fast by drift_ppm
+        delivered  += period_size * (1.0 + drift_ppm * 1e-6);
+        uframes_t n = (uframes_t)delivered;
+        delivered  -= n;
+
+        float* fifo = &dr->in->bufdata[dr->in_frames];
+
+        RANGE(chn, channels)
+        RANGE(i, n) { fifo[chn * dr->in->frames + i] = (float)(0.5 * sin(omega * (phase + i))); }
+        phase          = (phase + n) % rate;
+        dr->in_frames += n;
+
+        isize jitter = (rand() % (period_size / 2)) - period_size / 4;
+        sndx_drift_update(dr, (sframes_t)(dr->in_frames + jitter));
+
+        u64 in_before = dr->frames_in;
+
+        err = sndx_drift_pull(dr, out, period_size, period_size);
+        SndGoto_(err, __close, "Failed sndx_drift_pull: %s");
+
+        RANGE(i, period_size)
+        {
+            f64 step = fabs(out[i] - prev);
+            max_step = step > max_step ? step : max_step;
+            prev     = out[i];
+        }
+
+        // Last 10 seconds
+        if ((u64)c > cycles - (u64)10 * rate / period_size)
+        {
+            f64 e    = fabs(dr->in_frames + period_size - target);
+            max_err  = e > max_err ? e : max_err;
+            win_in  += dr->frames_in - in_before;
+            win_out += period_size;
+        }
+        else
+        {
+            dropped = dr->dropped;
+        }
+    }
+
+    sndx_drift_dump(dr, output);
+    a_info("  max fill error (last 10s): %.2f frames", max_err);
+    a_info("  max sample step          : %.4f (ideal %.4f)", max_step, 0.5 * omega);
+
+    // Pulling a period out of `period * (1 + ppm)` means consuming faster by the drift
+    f64 ppm = ((f64)win_in / win_out - 1.0) * 1e6;
+
+    a_info("  mean consumed (last 10s) : %+.2f ppm", ppm);
+
+    err = -(max_err > period_size / 4.0 + 1);
+    Goto_(err, __close, "Fill did not settle: %.2f frames off", max_err);
+
+    err = -(fabs(ppm - drift_ppm) > 20.0);
+    Goto_(err, __close, "Ratio did not settle: %.2f ppm instead of %.2f", ppm, drift_ppm);
+
+    err = -(dr->dropped != dropped);
+    Goto_(err, __close, "Underrun after settling: %ld frames", dr->dropped - dropped);
+
+    f64 max_allowed = (sync == SNDX_SYNC_SIMPLE ? 2.0 : 1.0) * 0.5 * omega * 1.01;
+
+    err = -(max_step > max_allowed);
+    Goto_(err, __close, "Discontinuity: step %.4f", max_step);
+
+    // Nothing pulled, nothing consumed and the held frame stays
+    uframes_t queued = dr->in_frames;
+    float     held   = dr->last[0];
+
+    err = sndx_drift_pull(dr, out, period_size, 0);
+    err = err ? err : -(dr->in_frames != queued || dr->last[0] != held);
+    Goto_(err, __close, "Pull of no frames changed the state");
+
+__close:
+    Free(out);
+    sndx_drift_close(dr);
+
+    return err;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    err = run(SNDX_SYNC_SIMPLE, output);
+    SndCheck_(err, "Failed run(SIMPLE): %s");
+
+    if (!err) err = run(SNDX_SYNC_SAMPLERATE, output);
+    SndCheck_(err, "Failed run(SAMPLERATE): %s");
+
+    if (!err) err = run_shift(SNDX_SYNC_PLAYRATESHIFT, output);
+    SndCheck_(err, "Failed run_shift(PLAYRATESHIFT): %s");
+
+    if (!err) err = run_shift(SNDX_SYNC_CAPTRATESHIFT, output);
+    SndCheck_(err, "Failed run_shift(CAPTRATESHIFT): %s");
+
+    if (!err) err = run_pull(SNDX_SYNC_SIMPLE, output);
+    SndCheck_(err, "Failed run_pull(SIMPLE): %s");
+
+    if (!err) err = run_pull(SNDX_SYNC_SAMPLERATE, output);
+    SndCheck_(err, "Failed run_pull(SAMPLERATE): %s");
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
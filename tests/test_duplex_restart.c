@@ -0,0 +1,121 @@
+/** @file test_duplex_restart.c
+ *  @brief Wall clock cost of xrun recovery: `sndx_duplex_restart` vs stop + prepare + start.
+ *
+ *  Checklist:
+ *      1. Restart leaves both handles RUNNING
+ *      2. Playback is full of silence after restart (avail ~ 0)
+ *      3. Lean restart is sub-millisecond
+ *
+ *  Old path dumps status and fills silence a period at a time with avail_update each,
+ *  its output goes to /dev/null so only the formatting is measured, not the terminal.
+ */
+#include "sndx/duplex.h"
+
+#define NRESTARTS     200
+#define TARGET_NSECS  1000000
+#define PERIOD_USECS  (128 * 1000000 / 48000)
+
+static u64 nsecs_now()
+{
+    tspec_t t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ULL + (u64)t.tv_nsec;
+}
+
+static int restart_old(sndx_duplex_t* d)
+{
+    int       err;
+    output_t* output = d->out;
+
+    err = sndx_duplex_stop(d);
+    SndReturn_(err, "Failed sndx_duplex_stop: %s");
+
+    err = snd_pcm_prepare(d->play);
+    SndReturn_(err, "Failed snd_pcm_prepare: %s");
+
+    err = sndx_duplex_start(d);
+    SndReturn_(err, "Failed sndx_duplex_start: %s");
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    output_t* null;
+    err = snd_output_stdio_open(&null, "/dev/null", "w");
+    SndFatal(err, "Failed snd_output_stdio_open: %s");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        "hw:A96,0", "hw:A96,0",          //
+        SND_PCM_FORMAT_S32_LE,           //
+        48000, 128, 2,                   //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        null);
+    SndFatal(err, "Failed sndx_duplex_open: %s");
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed sndx_duplex_start: %s");
+
+    // Old path
+    u64 old_total = 0;
+    u64 old_max   = 0;
+    RANGE(i, NRESTARTS)
+    {
+        usleep(PERIOD_USECS);
+
+        u64 t0 = nsecs_now();
+        err    = restart_old(d);
+        u64 dt = nsecs_now() - t0;
+        SndGoto_(err, __stop, "Failed restart_old: %s");
+
+        old_total += dt;
+        old_max    = dt > old_max ? dt : old_max;
+    }
+
+    // Lean path
+    RANGE(i, NRESTARTS)
+    {
+        usleep(PERIOD_USECS);
+
+        err = sndx_duplex_restart(d);
+        SndGoto_(err, __stop, "Failed sndx_duplex_restart: %s");
+
+        err = -(snd_pcm_state(d->play) != SND_PCM_STATE_RUNNING);
+        Goto_(err, __stop, "Playback not running after restart: %s", snd_pcm_state_name(snd_pcm_state(d->play)));
+
+        err = -(snd_pcm_state(d->capt) != SND_PCM_STATE_RUNNING);
+        Goto_(err, __stop, "Capture not running after restart: %s", snd_pcm_state_name(snd_pcm_state(d->capt)));
+
+        sframes_t avail = snd_pcm_avail_update(d->play);
+        err             = -(avail < 0 || avail > (sframes_t)d->period_size);
+        Goto_(err, __stop, "Playback not filled after restart: avail = %ld", avail);
+    }
+
+    a_info("Old  : mean %8.3f usecs, max %8.3f usecs", //
+           old_total / 1000.0 / NRESTARTS, old_max / 1000.0);
+    a_info("Lean : mean %8.3f usecs, max %8.3f usecs", //
+           d->restart_nsecs_total / 1000.0 / d->restart_count, d->restart_nsecs_max / 1000.0);
+
+    sndx_duplex_dump_restart(d, output);
+
+    err = -(d->restart_nsecs_total / d->restart_count > TARGET_NSECS);
+    Check_(err, "Mean restart above %d usecs", TARGET_NSECS / 1000);
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+    snd_output_close(null);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/** @file test_duplex_sim.c
+ *  @brief Duplex loop on the simulated loopback pair, no hardware needed.
+ *
+ *  Playback sends a 1 kHz sine, capture runs 80 ppm fast with up to 300 usecs of wakeup
+ *  jitter and an injected xrun every 250 periods, for 3 seconds.
+ *
+ *  Checklist:
+ *      1. Every xrun (injected or not) is recovered and the loop keeps running
+ *      2. Cycles run stay within 10 % of the periods in 3 seconds
+ *      3. The sine comes back on capture (loopback through the drift stage)
+ */
+#include "sndx/duplex.h"
+#include "sndx/sim.h"
+#include <math.h>
+
+static u64 nsecs_now()
+{
+    tspec_t t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ULL + (u64)t.tv_nsec;
+}
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr u32       periods     = 3;
+constexpr u32       seconds     = 3;
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_sim_config_t config = {
+        .play = {.channels = 2},
+        .capt = {.channels = 2, .drift_ppm = 80.0, .jitter_usecs = 300, .xrun_every = 250},
+        .seed = 42,
+    };
+
+    sndx_sim_t* sim;
+    err = sndx_sim_open(&sim, &config, output);
+    SndFatal_(err, "Failed sndx_sim_open: %s");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open_pcm(             //
+        &d,                                 //
+        sim->play.io.pcm, sim->capt.io.pcm, //
+        SND_PCM_FORMAT_S16_LE,              //
+        rate, period_size, periods,         //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED,    //
+        output);
+    SndGoto_(err, __close, "Failed sndx_duplex_open_pcm: %s");
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed sndx_duplex_start: %s");
+
+    u64 cycles     = 0;
+    u64 recoveries = 0;
+    u64 phase      = 0;
+    f64 sumsq      = 0;
+    u64 nsamples   = 0;
+    u64 expected   = (u64)seconds * rate / period_size;
+    u64 end        = nsecs_now() + seconds * 1000000000ULL;
+
+    while (nsecs_now() < end)
+    {
+        uframes_t avail  = 0;
+        uframes_t frames = period_size;
+        uframes_t offset = 0;
+
+        err = sndx_duplex_wait(d, &avail);
+        if (err >= 0) err = sndx_duplex_read(d, &frames, &offset);
+
+        if (err < 0)
+        {
+            err = sndx_duplex_recover(d);
+            SndGoto_(err, __stop, "Failed sndx_duplex_recover: %s");
+
+            recoveries++;
+            continue;
+        }
+
+        // Level of what came back, after the first second (pipeline filled, controller settled)
+        if (cycles > expected / seconds)
+        {
+            RANGE(i, (isize)frames)
+            {
+                sumsq += d->buf_capt->bufdata[i] * d->buf_capt->bufdata[i];
+                nsamples++;
+            }
+        }
+
+        RANGE(chn, d->ch_play)
+        RANGE(i, (isize)frames)
+        {
+            f64 t = (f64)(phase + i) / rate;
+
+            d->buf_play->bufdata[chn * d->buf_play->frames + i] = (float)(0.5 * sin(2 * M_PI * 1000.0 * t));
+        }
+        phase += frames;
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        if (err < 0)
+        {
+            err = sndx_duplex_recover(d);
+            SndGoto_(err, __stop, "Failed sndx_duplex_recover: %s");
+
+            recoveries++;
+            continue;
+        }
+
+        cycles++;
+    }
+
+    sndx_sim_dump(sim, output);
+    sndx_duplex_dump_restart(d, output);
+
+    f64 rms   = nsamples ? sqrt(sumsq / nsamples) : 0;
+    u64 xruns = sim->play.injected + sim->play.xruns + sim->capt.injected + sim->capt.xruns;
+
+    a_info("cycles %ld, recoveries %ld, xruns %ld, capture rms %.3f (sine 0.354)", cycles, recoveries, xruns, rms);
+
+    // 1. Injected xruns all surfaced and were recovered
+    err = -(sim->capt.injected < 2 || recoveries < sim->capt.injected);
+    Goto_(err, __stop, "Xruns not recovered: %ld injected, %ld recoveries", sim->capt.injected, recoveries);
+
+    // 2. Loop kept up with the capture clock, each recovery costs about a period
+    err = -(cycles + recoveries < expected * 9 / 10);
+    Goto_(err, __stop, "Loop fell behind: %ld cycles of %ld", cycles, expected);
+
+    // 3. Loopback carries the signal (gaps from xruns only lower it a little)
+    err = -(rms < 0.2);
+    Goto_(err, __stop, "Sine did not come back: rms %.3f", rms);
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+    sndx_sim_close(sim);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
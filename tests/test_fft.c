@@ -0,0 +1,94 @@
+/** @file test_fft.c
+ *  @brief FFT against the definition.
+ *
+ *  Checklist:
+ *      1. Sizes that are not powers of two are refused
+ *      2. A cosine lands in its two bins with n / 2 each, nothing elsewhere
+ *      3. Forward matches a direct DFT on random input
+ *      4. Inverse of forward gives the input back
+ */
+#include "sndx/fft.h"
+
+constexpr u32 n = 1024;
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    srand(1);
+
+    float x[n];
+    float re[n];
+    float im[n];
+
+    sndx_fft_t* fft = nullptr;
+
+    // 1.
+    err = sndx_fft_open(&fft, 1000, output);
+    err = -(err != -EINVAL);
+    Goto_(err, __close, "Size 1000 accepted");
+
+    err = sndx_fft_open(&fft, n, output);
+    Goto_(err, __close, "Failed sndx_fft_open");
+
+    // 2.
+    constexpr u32 bin = 37;
+    RANGE(i, n) { x[i] = (float)cos(2.0 * M_PI * bin * i / n); }
+
+    sndx_fft_real(fft, x, n, re, im);
+
+    RANGE(k, n)
+    {
+        f64 expect = k == bin || k == n - bin ? n / 2.0 : 0.0;
+        f64 mag    = hypot(re[k], im[k]);
+
+        err = -(fabs(mag - expect) > 1e-2);
+        Goto_(err, __close, "Bin %ld: %f, expected %f", k, mag, expect);
+    }
+
+    // 3.
+    RANGE(i, n) { x[i] = (float)rand() / RAND_MAX - 0.5f; }
+
+    sndx_fft_real(fft, x, n, re, im);
+
+    f64 worst = 0.0;
+    for (isize k = 0; k < n; k += 31)
+    {
+        f64 dr = 0.0;
+        f64 di = 0.0;
+        RANGE(i, n)
+        {
+            dr += x[i] * cos(2.0 * M_PI * k * i / n);
+            di -= x[i] * sin(2.0 * M_PI * k * i / n);
+        }
+
+        f64 e = hypot(re[k] - dr, im[k] - di);
+        worst = e > worst ? e : worst;
+    }
+
+    a_info("FFT %d: worst error against DFT %.2e", n, worst);
+
+    err = -(worst > 1e-3);
+    Goto_(err, __close, "Forward differs from DFT by %e", worst);
+
+    // 4.
+    sndx_fft_inverse(fft, re, im);
+
+    RANGE(i, n)
+    {
+        err = -(fabsf(re[i] - x[i]) > 1e-5f || fabsf(im[i]) > 1e-5f);
+        Goto_(err, __close, "Sample %ld: %f + %fi, expected %f", i, re[i], im[i], x[i]);
+    }
+
+    a_info("FFT: all checks passed");
+
+__close:
+    sndx_fft_close(fft);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/** @file test_graph.c
+ *  @brief DSP graph: order, buffer reuse, results, refused edits and plan swaps, no hardware needed.
+ *
+ *  Checklist:
+ *      1. Chain added out of order runs in topological order
+ *      2. Chain of 4 stereo nodes needs 4 buffers, not 8 (liveness)
+ *      3. Playback gets capture times the product of the gains
+ *      4. Taken input and cycle are refused, the plan in use is kept
+ *      5. New plan picked up on the next call, the old one handed back and collected
+ *      6. Mono capture to stereo playback, same as `sndx_duplex_copy_capt_to_play`
+ */
+#include "sndx/callback.h"
+#include <math.h>
+
+#define FRAMES 64
+
+static float gains[] = {0.5f, 2.0f, 0.25f, 3.0f};
+
+static int check_output(sndx_buffer_t* capt, sndx_buffer_t* play, float gain, u32 frames, output_t* output)
+{
+    RANGE(chn, play->channels)
+    RANGE(i, (isize)frames)
+    {
+        float x = capt->bufdata[(chn % capt->channels) * capt->frames + i] * gain;
+        float y = play->bufdata[chn * play->frames + i];
+
+        RetVal_(fabsf(x - y) > 1e-6f, -1, "Channel %ld frame %ld: %f, expected %f", chn, i, y, x);
+    }
+
+    return 0;
+}
+
+/** @brief capture -> trim -> eq -> comp -> route -> playback, added back to front. */
+static int build_chain(sndx_graph_t* g, u32 channels, int* ids)
+{
+    int err;
+
+    const char* names[] = {"trim", "eq", "comp", "route"};
+
+    RANGE(k, 4)
+    {
+        isize i = 3 - k;
+        ids[i]  = sndx_graph_add(g, names[i], sndx_graph_gain, &gains[i], channels, channels);
+        if (ids[i] < 0) return ids[i];
+    }
+
+    RANGE(chn, channels)
+    {
+        err = sndx_graph_connect(g, SNDX_GRAPH_CAPTURE, chn, ids[0], chn);
+        if (err < 0) return err;
+
+        RANGE(i, 3)
+        {
+            err = sndx_graph_connect(g, ids[i], chn, ids[i + 1], chn);
+            if (err < 0) return err;
+        }
+
+        err = sndx_graph_connect(g, ids[3], chn, SNDX_GRAPH_PLAYBACK, chn);
+        if (err < 0) return err;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_buffer_t* capt  = nullptr;
+    sndx_buffer_t* mono  = nullptr;
+    sndx_buffer_t* play  = nullptr;
+    sndx_graph_t*  g     = nullptr;
+    sndx_graph_t*  g1    = nullptr;
+    float          total = gains[0] * gains[1] * gains[2] * gains[3];
+
+    err = sndx_buffer_open(&capt, SND_PCM_FORMAT_S32_LE, 2, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_buffer_open(&mono, SND_PCM_FORMAT_S32_LE, 1, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_buffer_open(&play, SND_PCM_FORMAT_S32_LE, 2, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    RANGE(i, FRAMES * 2) { capt->bufdata[i] = sinf(0.1f * i); }
+    RANGE(i, FRAMES) { mono->bufdata[i] = cosf(0.1f * i); }
+
+    err = sndx_graph_open(&g, 2, 2, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_graph_open: %s");
+
+    int ids[4];
+    err = build_chain(g, 2, ids);
+    Goto_(err, __close, "Failed build_chain");
+
+    err = sndx_graph_commit(g);
+    Goto_(err, __close, "Failed sndx_graph_commit");
+
+    sndx_graph_dump(g, output);
+
+    // 1. Processing order, whatever the order of addition
+    RANGE(i, 4)
+    {
+        err = -(g->committed->steps[i].node != (u32)ids[i]);
+        Goto_(err, __close, "Step %ld is %s", i, g->nodes[g->committed->steps[i].node].name);
+    }
+
+    // 2. Two stages alive at a time
+    err = -(g->committed->nbuffers - 1 != 4);
+    Goto_(err, __close, "Expected 4 buffers, got %d", g->committed->nbuffers - 1);
+
+    // 3. Values
+    sndx_graph_process(g, capt, play, FRAMES);
+
+    err = check_output(capt, play, total, FRAMES, output);
+    Goto_(err, __close, "Chain output wrong");
+
+    // 4. Refused edits
+    err = sndx_graph_connect(g, SNDX_GRAPH_CAPTURE, 0, ids[1], 0);
+    err = -(err != -EBUSY);
+    Goto_(err, __close, "Taken input accepted");
+
+    sndx_graph_reset(g);
+
+    int a  = sndx_graph_add(g, "a", sndx_graph_gain, &gains[0], 1, 1);
+    int b  = sndx_graph_add(g, "b", sndx_graph_gain, &gains[0], 1, 1);
+    err    = sndx_graph_connect(g, a, 0, b, 0);
+    err   |= sndx_graph_connect(g, b, 0, a, 0);
+    Goto_(err, __close, "Failed sndx_graph_connect");
+
+    err = sndx_graph_commit(g);
+    err = -(err != -EINVAL);
+    Goto_(err, __close, "Cycle accepted");
+
+    sndx_graph_process(g, capt, play, FRAMES);
+
+    err = check_output(capt, play, total, FRAMES, output);
+    Goto_(err, __close, "Plan in use changed by a refused commit");
+
+    // 5. Swap to a single gain, old plan handed back on the next call
+    sndx_graph_reset(g);
+
+    int single = sndx_graph_add(g, "single", sndx_graph_gain, &gains[1], 2, 2);
+    RANGE(chn, 2)
+    {
+        err  = sndx_graph_connect(g, SNDX_GRAPH_CAPTURE, chn, single, chn);
+        err |= sndx_graph_connect(g, single, chn, SNDX_GRAPH_PLAYBACK, chn);
+        Goto_(err, __close, "Failed sndx_graph_connect");
+    }
+
+    err = sndx_graph_commit(g);
+    Goto_(err, __close, "Failed sndx_graph_commit");
+
+    sndx_graph_process(g, capt, play, FRAMES);
+
+    err = check_output(capt, play, gains[1], FRAMES, output);
+    Goto_(err, __close, "New plan not picked up");
+
+    err = -(g->retired == nullptr);
+    Goto_(err, __close, "Old plan not handed back");
+
+    sndx_graph_collect(g);
+
+    err = -(g->retired != nullptr);
+    Goto_(err, __close, "Old plan not collected");
+
+    // 6. Mono to stereo
+    err = sndx_graph_open(&g1, 1, 2, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_graph_open: %s");
+
+    int up = sndx_graph_add(g1, "up", sndx_graph_gain, &gains[0], 1, 2);
+    err    = sndx_graph_connect(g1, SNDX_GRAPH_CAPTURE, 0, up, 0);
+    err   |= sndx_graph_connect(g1, up, 0, SNDX_GRAPH_PLAYBACK, 0);
+    err   |= sndx_graph_connect(g1, up, 1, SNDX_GRAPH_PLAYBACK, 1);
+    Goto_(err, __close, "Failed sndx_graph_connect");
+
+    err = sndx_graph_commit(g1);
+    Goto_(err, __close, "Failed sndx_graph_commit");
+
+    sndx_graph_process(g1, mono, play, FRAMES);
+
+    err = check_output(mono, play, gains[0], FRAMES, output);
+    Goto_(err, __close, "Mono to stereo output wrong");
+
+    a_info("Graph: all checks passed");
+
+__close:
+    sndx_graph_close(g1);
+    sndx_graph_close(g);
+    sndx_buffer_close(play);
+    sndx_buffer_close(mono);
+    sndx_buffer_close(capt);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
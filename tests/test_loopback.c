@@ -0,0 +1,152 @@
+/** @file test_loopback.c
+ *  @brief Several loops on simulated pairs, grouped into threads, one of them faulted.
+ *
+ *  Checklist:
+ *      1. Period size derived from latency_req when none is given
+ *      2. Loops sharing a thread and loops on their own thread all move audio
+ *      3. Capture xrun on one loop is recovered and audio flows again after it
+ *      4. The other loops never see it: no recovery, no stop
+ *      5. Stop joins every thread, start again runs the same loops
+ *      6. Capture delay and latency probes come from the cycle snapshot, not from status ioctls
+ */
+#include "sndx/loopback.h"
+#include "sndx/sim.h"
+
+#define RATE        48000
+#define PERIOD_SIZE 128
+#define PERIODS     3
+#define NLOOPS      3
+#define RUN_USECS   300000
+
+static int check(sndx_loopback_t* lb, u64 expect_cycles, output_t* output)
+{
+    RANGE(i, NLOOPS)
+    {
+        sndx_loopback_loop_t* loop = &lb->loops[i];
+
+        RetVal_(loop->failed, -1, "%s: stopped", loop->id);
+        RetVal_(loop->cycles < expect_cycles, -1, "%s: %ld cycles, expected at least %ld", loop->id, loop->cycles,
+                expect_cycles);
+
+        // 6. Playback asks once per cycle, capture only when a wakeup carries more than one period
+        sndx_duplex_t* d = loop->d;
+        RetVal_(d->st_capt.ioctls >= d->st_play.ioctls, -1, "%s: %ld capture status ioctls for %ld playback ones",
+                loop->id, d->st_capt.ioctls, d->st_play.ioctls);
+    }
+
+    RetVal_(!lb->loops[0].recoveries, -1, "%s: capture xrun not recovered", lb->loops[0].id);
+    RetVal_(lb->loops[1].recoveries, -1, "%s: recovered, has no fault", lb->loops[1].id);
+    RetVal_(lb->loops[2].recoveries, -1, "%s: recovered, has no fault", lb->loops[2].id);
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_sim_t*      sims[NLOOPS] = {};
+    sndx_loopback_t* lb           = nullptr;
+    sndx_sim_fault_t faults[1];
+
+    // About half a period of cycles over the run, whatever the load on the host
+    u64 expect_cycles = RUN_USECS / 1000 * RATE / 1000 / PERIOD_SIZE / 2;
+
+    err = sndx_sim_faults_parse("xrun@20", faults, 1, output);
+    Goto_(err, __close, "Failed sndx_sim_faults_parse");
+
+    RANGE(i, NLOOPS)
+    {
+        sndx_sim_config_t config = {
+            .play = {.channels = 2, .drift_ppm = 100.0 * i},
+            .capt = {.channels = 2},
+        };
+
+        if (i == 0)
+        {
+            config.capt.faults  = faults;
+            config.capt.nfaults = 1;
+        }
+
+        err = sndx_sim_open(&sims[i], &config, output);
+        SndGoto_(err, __close, "Failed sndx_sim_open: %s");
+    }
+
+    err = sndx_loopback_open(&lb, 0, output);
+    SndGoto_(err, __close, "Failed sndx_loopback_open: %s");
+
+    // Loops 0 and 1 share thread 0, loop 2 has its period from the latency
+    sndx_loopback_desc_t descs[NLOOPS] = {};
+    RANGE(i, NLOOPS)
+    {
+        descs[i] = (sndx_loopback_desc_t){
+            .format      = SND_PCM_FORMAT_S16_LE,
+            .rate        = RATE,
+            .period_size = PERIOD_SIZE,
+            .periods     = PERIODS,
+            .sync        = SNDX_SYNC_SAMPLERATE,
+        };
+    }
+
+    descs[0].id = "faulted";
+    descs[1].id = "shared";
+    descs[2].id = "latency";
+
+    descs[2].period_size = 0;
+    descs[2].periods     = 2;
+    descs[2].latency_req = 2 * PERIOD_SIZE;
+    descs[2].thread      = 1;
+
+    RANGE(i, NLOOPS)
+    {
+        err = sndx_loopback_add_pcm(lb, &descs[i], sims[i]->play.io.pcm, sims[i]->capt.io.pcm);
+        Goto_(err, __close, "Failed sndx_loopback_add_pcm: %s", descs[i].id);
+    }
+
+    // 1. Two periods of PERIOD_SIZE in 2 * PERIOD_SIZE of latency
+    err = -(lb->loops[2].d->period_size != PERIOD_SIZE);
+    Goto_(err, __close, "Period size %ld from latency, expected %d", lb->loops[2].d->period_size, PERIOD_SIZE);
+
+    // 2. to 4.
+    err = sndx_loopback_start(lb);
+    Goto_(err, __close, "Failed sndx_loopback_start");
+
+    usleep(RUN_USECS);
+
+    err = sndx_loopback_stop(lb);
+    Goto_(err, __close, "Thread stopped early");
+
+    err = -(lb->nthreads != 0);
+    Goto_(err, __close, "Threads left after stop");
+
+    err = check(lb, expect_cycles, output);
+    if (err < 0) sndx_loopback_dump(lb, output);
+    Goto_(err, __close, "First run failed");
+
+    // 5. Again, the counters go on
+    err = sndx_loopback_start(lb);
+    Goto_(err, __close, "Failed sndx_loopback_start (again)");
+
+    usleep(RUN_USECS);
+
+    sndx_loopback_dump(lb, output);
+
+    err = sndx_loopback_stop(lb);
+    Goto_(err, __close, "Thread stopped early (again)");
+
+    err = check(lb, 2 * expect_cycles, output);
+    Goto_(err, __close, "Second run failed");
+
+    a_info("Loopback: all checks passed");
+
+__close:
+    sndx_loopback_close(lb);
+    RANGE(i, NLOOPS) { sndx_sim_close(sims[i]); }
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/** @file test_meter.c
+ *  @brief Meters on synthetic signals, pushed a period at a time like an audio thread would.
+ *
+ *  Checklist:
+ *      1. RT levels: frames and sums of squares add up, peak is of the latest block
+ *      2. A 1 kHz sine at -20 dBFS reads -23 LUFS momentary, short-term and integrated, RMS -23 dBFS
+ *      3. Silence reads -INFINITY everywhere
+ *      4. A 12 kHz sine sampled 45 degrees off its peaks: sample peak 3 dB under the true peak
+ *      5. Quiet passage under the relative gate does not pull the integrated loudness down
+ *      6. Reset starts true peak and integrated loudness over
+ *      7. Nothing dropped when pushed in real time
+ */
+#include "sndx/meter.h"
+
+constexpr u32       channels = 4;
+constexpr u32       rate     = 48000;
+constexpr uframes_t period   = 256;
+
+/** @brief Sample of channel `chn` in phase 0 (channel 3 drops by 40 dB after four seconds), or 1 after reset. */
+static float sample(u32 chn, uframes_t frame, u32 phase)
+{
+    f64 t     = (f64)frame / rate;
+    f64 scale = phase ? 0.5 : 1.0;
+
+    switch (chn)
+    {
+    case 0: return (float)(0.1 * scale * sin(2.0 * M_PI * 1000.0 * t));
+    case 2: return (float)(0.5 * scale * sin(2.0 * M_PI * 12000.0 * t + M_PI / 4.0));
+    case 3: return (float)((frame < 4 * rate || phase ? 0.1 : 0.001) * sin(2.0 * M_PI * 1000.0 * t));
+    default: return 0.0f;
+    }
+}
+
+/** @brief Push `total` frames in periods at about five times real time, then wait for the meter thread. */
+static int push(sndx_meter_t* m, sndx_buffer_t* b, uframes_t total, u32 phase, f64* sumsq, output_t* output)
+{
+    sndx_meter_reading_t r[channels];
+    u64                  before = sndx_meter_get(m, r);
+
+    for (uframes_t done = 0; done < total; done += period)
+    {
+        RANGE(chn, channels)
+        RANGE(i, period)
+        {
+            float v = sample((u32)chn, done + i, phase);
+
+            b->bufdata[chn * b->frames + i]  = v;
+            sumsq[chn]                      += (f64)v * v;
+        }
+
+        sndx_meter_push(m, b, 0, period);
+        usleep(1000);
+    }
+
+    u64 expect = before + total / m->step;
+    u64 steps  = 0;
+
+    RANGE(i, 1000)
+    {
+        steps = sndx_meter_get(m, r);
+        if (steps >= expect) break;
+        usleep(1000);
+    }
+
+    int err = -(steps != expect);
+    Return_(err, "%ld steps, expected %ld", steps, expect);
+
+    return 0;
+}
+
+static int near(f64 value, f64 expect, f64 tolerance, const char* what, output_t* output)
+{
+    int err = -(!(fabs(value - expect) <= tolerance));
+    Return_(err, "%s: %.3f, expected %.3f within %.3f", what, value, expect, tolerance);
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    constexpr uframes_t total = 8 * rate;
+
+    f64                  sumsq[channels] = {};
+    sndx_meter_level_t   levels[channels];
+    sndx_meter_reading_t r[channels];
+    u64                  frames;
+
+    sndx_meter_t*  m = nullptr;
+    sndx_buffer_t* b = nullptr;
+
+    err = sndx_buffer_open(&b, SND_PCM_FORMAT_S32_LE, channels, period, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_meter_open(&m, channels, rate, output);
+    Goto_(err, __close, "Failed sndx_meter_open");
+
+    err = push(m, b, total, 0, sumsq, output);
+    Goto_(err, __close, "Meter thread did not keep up");
+
+    sndx_meter_dump(m, output);
+
+    // 1.
+    sndx_meter_get_levels(m, levels, &frames);
+
+    err = -(frames != total);
+    Goto_(err, __close, "%ld frames, expected %ld", frames, total);
+
+    RANGE(chn, channels)
+    {
+        err = -(fabs(levels[chn].sumsq - sumsq[chn]) > 1e-4 * sumsq[chn]);
+        Goto_(err, __close, "Channel %ld: sum of squares %f, expected %f", chn, levels[chn].sumsq, sumsq[chn]);
+
+        float peak = 0.0f;
+        RANGE(i, period) { peak = fmaxf(peak, fabsf(b->bufdata[chn * b->frames + i])); }
+
+        err = -(levels[chn].peak != peak);
+        Goto_(err, __close, "Channel %ld: block peak %f, expected %f", chn, levels[chn].peak, peak);
+    }
+
+    sndx_meter_get(m, r);
+
+    // 2.
+    err = near(r[0].momentary, -23.01, 0.05, "1 kHz momentary", output);
+    err = err ? err : near(r[0].short_term, -23.01, 0.05, "1 kHz short-term", output);
+    err = err ? err : near(r[0].integrated, -23.01, 0.1, "1 kHz integrated", output);
+    err = err ? err : near(r[0].rms_db, -23.01, 0.05, "1 kHz RMS", output);
+    Goto_(err, __close, "Loudness of a 1 kHz sine");
+
+    // 3.
+    err = -(r[1].momentary != -INFINITY || r[1].integrated != -INFINITY || r[1].true_peak_db != -INFINITY ||
+            r[1].rms_db != -INFINITY);
+    Goto_(err, __close, "Silence: %f LUFS, %f dBTP", r[1].integrated, r[1].true_peak_db);
+
+    // 4.
+    err = near(r[2].peak_db, 20.0 * log10(0.5 * M_SQRT1_2), 0.01, "12 kHz sample peak", output);
+    err = err ? err : near(r[2].true_peak_db, 20.0 * log10(0.5), 0.5, "12 kHz true peak", output);
+    Goto_(err, __close, "Peaks of a 12 kHz sine");
+
+    // 5. The three blocks across the edge pass the gate, 37 loud blocks and 0.75 + 0.5 + 0.25 of one in 40
+    f64 edge = -23.01 + 10.0 * log10((37.0 + 1.5) / 40.0);
+
+    err = near(r[3].momentary, -63.01, 0.1, "Quiet passage momentary", output);
+    err = err ? err : near(r[3].integrated, edge, 0.1, "Gated integrated", output);
+    Goto_(err, __close, "Relative gate");
+
+    // 6.
+    sndx_meter_reset(m);
+
+    err = push(m, b, 2 * rate, 1, sumsq, output);
+    Goto_(err, __close, "Meter thread did not keep up after reset");
+
+    sndx_meter_get(m, r);
+
+    err = near(r[0].integrated, -29.03, 0.1, "Integrated after reset", output);
+    err = err ? err : near(r[2].true_peak_db, 20.0 * log10(0.25), 0.5, "True peak after reset", output);
+    Goto_(err, __close, "Reset");
+
+    // 7.
+    err = -(m->dropped != 0);
+    Goto_(err, __close, "%ld frames dropped", m->dropped);
+
+    sndx_meter_dump(m, output);
+    a_info("Meter: all checks passed");
+
+__close:
+    sndx_meter_close(m);
+    sndx_buffer_close(b);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/** @file test_pitch.c
+ *  @brief Pitch estimator on synthetic tones.
+ *
+ *  Checklist:
+ *      1. Sines across the guitar range and above are found within a cent, and by HPS within a bin
+ *      2. A tone with a weak fundamental and strong harmonics gives the fundamental, not a harmonic
+ *      3. Silence and noise give no valid pitch
+ *      4. Pushed in odd blocks, an estimate comes every hop once a window is full, and follows a change of pitch
+ *      5. Notes and cents from frequencies
+ */
+#include "sndx/pitch.h"
+
+constexpr u32 rate = 48000;
+constexpr u32 size = 4096;
+constexpr u32 hop  = 1024;
+
+static f64 cents(f64 freq, f64 expect) { return 1200.0 * log2(freq / expect); }
+
+/** @brief 1. and 2., harmonics 1..4 with the given amplitudes. */
+static int tone(sndx_pitch_t* p, f64 freq, const f64* amps, output_t* output)
+{
+    int err;
+
+    float frame[size];
+    RANGE(i, size)
+    {
+        f64 v = 0.0;
+        RANGE(h, 4) { v += amps[h] * sin(2.0 * M_PI * freq * (h + 1) * i / rate + h); }
+        frame[i] = (float)v;
+    }
+
+    sndx_pitch_estimate_t est;
+    sndx_pitch_analyse(p, frame, &est);
+
+    f64 off = est.valid ? cents(est.freq, freq) : INFINITY;
+    a_info("%8.2f Hz: %8.3f Hz, %+.3f cents, confidence %.3f, hps %.1f Hz", freq, est.freq, off, est.confidence,
+           est.hps_freq);
+
+    err = -(!est.valid || fabs(off) > 1.0);
+    Return_(err, "%.2f Hz estimated as %.3f Hz, valid %d", freq, est.freq, est.valid);
+
+    // Coarse, but within a bin and not an octave off
+    err = -(fabs(est.hps_freq - freq) > (f64)rate / size);
+    Return_(err, "%.2f Hz estimated by HPS as %.1f Hz", freq, est.hps_freq);
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    srand(1);
+
+    sndx_pitch_t* p = nullptr;
+    err             = sndx_pitch_open(&p, rate, size, hop, output);
+    Goto_(err, __close, "Failed sndx_pitch_open");
+
+    // 1.
+    const f64 pure[4] = {0.5, 0.0, 0.0, 0.0};
+    const f64 freqs[] = {82.41, 110.0, 196.0, 440.0, 1000.0, 1318.51};
+
+    RANGE(i, sizeof(freqs) / sizeof(freqs[0]))
+    {
+        err = tone(p, freqs[i], pure, output);
+        Goto_(err, __close, "Sine");
+    }
+
+    // 2.
+    const f64 weak[4] = {0.05, 0.4, 0.3, 0.2};
+
+    err = tone(p, 110.0, weak, output);
+    Goto_(err, __close, "Weak fundamental");
+
+    // 3.
+    {
+        float                 frame[size];
+        sndx_pitch_estimate_t est;
+
+        RANGE(i, size) { frame[i] = 0.0f; }
+        sndx_pitch_analyse(p, frame, &est);
+
+        err = -(est.valid);
+        Goto_(err, __close, "Silence has a pitch of %f Hz", est.freq);
+
+        RANGE(i, size) { frame[i] = (float)rand() / RAND_MAX - 0.5f; }
+        sndx_pitch_analyse(p, frame, &est);
+
+        err = -(est.valid);
+        Goto_(err, __close, "Noise has a pitch of %f Hz, confidence %f", est.freq, est.confidence);
+    }
+
+    // 4. 440 Hz for a second, then 330 Hz, pushed 100 samples at a time
+    {
+        constexpr u32 block = 100;
+
+        float     buf[block];
+        u32       estimates = 0;
+        uframes_t sent      = 0;
+        f64       phase     = 0.0;
+
+        sndx_pitch_reset(p);
+
+        while (sent < 2 * rate)
+        {
+            f64 freq = sent < rate ? 440.0 : 330.0;
+
+            RANGE(i, block)
+            {
+                buf[i]  = (float)(0.5 * sin(phase));
+                phase  += 2.0 * M_PI * freq / rate;
+            }
+
+            sent += block;
+            if (!sndx_pitch_push(p, buf, block)) continue;
+
+            estimates++;
+
+            // A full window after each hop boundary
+            err = -(p->last.frame % hop != 0 || p->last.frame < size);
+            Goto_(err, __close, "Estimate at %ld samples", p->last.frame);
+
+            // Settled on either tone, not the mix
+            bool settled = p->last.frame <= rate || p->last.frame >= rate + size;
+            f64  expect  = p->last.frame <= rate ? 440.0 : 330.0;
+
+            err = -(settled && (!p->last.valid || fabs(cents(p->last.freq, expect)) > 1.0));
+            Goto_(err, __close, "At %ld samples: %f Hz, expected %f", p->last.frame, p->last.freq, expect);
+        }
+
+        err = -(estimates != (2 * rate - size) / hop + 1);
+        Goto_(err, __close, "%d estimates, expected %d", estimates, (2 * rate - size) / hop + 1);
+    }
+
+    // 5.
+    {
+        int octave;
+        f64 off;
+
+        const char* name = sndx_pitch_note(440.0, &octave, &off);
+        err              = -(strcmp(name, "A") != 0 || octave != 4 || fabs(off) > 1e-9);
+        Goto_(err, __close, "440 Hz is %s%d %+f cents", name, octave, off);
+
+        name = sndx_pitch_note(82.41, &octave, &off);
+        err  = -(strcmp(name, "E") != 0 || octave != 2 || fabs(off) > 0.1);
+        Goto_(err, __close, "82.41 Hz is %s%d %+f cents", name, octave, off);
+
+        name = sndx_pitch_note(440.0 * pow(2.0, 0.3 / 12.0), &octave, &off);
+        err  = -(strcmp(name, "A") != 0 || fabs(off - 30.0) > 1e-6);
+        Goto_(err, __close, "30 cents sharp of A4 is %s%d %+f cents", name, octave, off);
+    }
+
+    a_info("Pitch: all checks passed");
+
+__close:
+    sndx_pitch_close(p);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/** @file test_player.c
+ *  @brief Player on files written here, pulled like an audio thread would.
+ *
+ *  Checklist:
+ *      1. A float WAV is mapped, and plays to its end in order, channels beyond the file silent
+ *      2. The same file through libsndfile plays the same
+ *      3. A seek is followed by silence at most, then the file from the new position
+ *      4. A looping raw file starts over at its end, and is never done
+ *      5. WAV that is not float goes to libsndfile
+ */
+#include "sndx/player.h"
+
+constexpr u32       channels = 2;
+constexpr u32       rate     = 48000;
+constexpr uframes_t period   = 256;
+constexpr uframes_t total    = 100000 + 33;
+
+static float sample(uframes_t frame, u32 chn) { return (float)(frame * channels + chn); }
+
+static void put_le(FILE* f, u32 v, u32 bytes)
+{
+    RANGE(i, bytes) { fputc((int)(v >> (8 * i)) & 0xFF, f); }
+}
+
+/** @brief Canonical 44 byte header, 32 bit float ramp or 16 bit silence. */
+static int write_wav(const char* path, uframes_t frames, bool is_float)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return -errno;
+
+    u32 bits = is_float ? 32 : 16;
+    u32 len  = (u32)(frames * channels * bits / 8);
+
+    fwrite("RIFF", 1, 4, f);
+    put_le(f, 36 + len, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_le(f, 16, 4);
+    put_le(f, is_float ? 3 : 1, 2);
+    put_le(f, channels, 2);
+    put_le(f, rate, 4);
+    put_le(f, rate * channels * bits / 8, 4);
+    put_le(f, channels * bits / 8, 2);
+    put_le(f, bits, 2);
+    fwrite("data", 1, 4, f);
+    put_le(f, len, 4);
+
+    RANGE(i, frames)
+    RANGE(chn, channels)
+    {
+        float v = sample(i, chn);
+        if (is_float) fwrite(&v, sizeof(v), 1, f);
+        else put_le(f, 0, 2);
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+static int write_raw(const char* path, uframes_t frames)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return -errno;
+
+    RANGE(i, frames)
+    RANGE(chn, channels)
+    {
+        float v = sample(i, chn);
+        fwrite(&v, sizeof(v), 1, f);
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+/** @brief Pull a period at a time into planar areas with one channel more than the file.
+ *
+ *  Keeps up to `want` frames that came from the file in `out` (interleaved), until the player is done.
+ *  Returns the frames kept, -EIO if the extra channel was not silent.
+ */
+static isize play(sndx_player_t* p, float* out, uframes_t want)
+{
+    float  buf[(channels + 1) * period];
+    area_t areas[channels + 1];
+
+    RANGE(chn, channels + 1)
+    {
+        areas[chn].addr  = buf;
+        areas[chn].first = chn * period * sizeof(float) * 8;
+        areas[chn].step  = sizeof(float) * 8;
+    }
+
+    uframes_t kept = 0;
+    for (u32 pulls = 0; kept < want && !sndx_player_done(p) && pulls < 100000; pulls++)
+    {
+        RANGE(i, (channels + 1) * period) { buf[i] = -1.0f; }
+
+        uframes_t n   = want - kept < period ? want - kept : period;
+        uframes_t got = sndx_player_pull(p, areas, channels + 1, 0, n);
+
+        RANGE(i, n)
+        {
+            if (buf[channels * period + i] != 0.0f) return -EIO;
+        }
+
+        RANGE(i, got)
+        RANGE(chn, channels) { out[(kept + i) * channels + chn] = buf[chn * period + i]; }
+
+        kept += got;
+        usleep(200);
+    }
+
+    return (isize)kept;
+}
+
+/** @brief `frames` of `out` against the ramp from file frame `start`, wrapping at `length`. */
+static int verify(const float* out, uframes_t frames, uframes_t start, uframes_t length, output_t* output)
+{
+    int err = 0;
+
+    RANGE(i, frames)
+    RANGE(chn, channels)
+    {
+        uframes_t frame = (start + i) % length;
+
+        err = -(out[i * channels + chn] != sample(frame, chn));
+        Return_(err, "Frame %ld channel %ld: %f, expected %f", i, chn, out[i * channels + chn], sample(frame, chn));
+    }
+
+    return 0;
+}
+
+/** @brief 1. and 2. */
+static int play_whole(const sndx_player_desc_t* desc, sndx_player_source_t expect, float* out, output_t* output)
+{
+    int err;
+
+    sndx_player_t* p;
+    err = sndx_player_open(&p, desc, output);
+    Return_(err, "Failed sndx_player_open %s", desc->path);
+
+    err = -(p->source != expect || p->channels != channels || p->rate != rate || p->frames != total);
+    Goto_(err, __close, "Source %d, %d channels at %d, %ld frames", p->source, p->channels, p->rate, p->frames);
+
+    isize kept = play(p, out, total + period);
+    err        = kept < 0 ? (int)kept : -(kept != (isize)total || !sndx_player_done(p));
+    Goto_(err, __close, "Played %ld of %ld frames, done %d", kept, total, sndx_player_done(p));
+
+    err = verify(out, total, 0, total, output);
+    Goto_(err, __close, "Content of %s", desc->path);
+
+    err = -(p->underruns != 0);
+    Goto_(err, __close, "%ld underruns", p->underruns);
+
+__close:
+    sndx_player_dump(p, output);
+    sndx_player_close(p);
+
+    return err;
+}
+
+/** @brief 3. */
+static int play_seek(const sndx_player_desc_t* desc, float* out, output_t* output)
+{
+    int err;
+
+    constexpr uframes_t before = 1000;
+    constexpr uframes_t target = 50000;
+    constexpr uframes_t after  = 20000;
+
+    sndx_player_t* p;
+    err = sndx_player_open(&p, desc, output);
+    Return_(err, "Failed sndx_player_open %s", desc->path);
+
+    isize kept = play(p, out, before);
+    err        = -(kept != (isize)before);
+    Goto_(err, __close, "Played %ld of %ld frames before the seek", kept, before);
+
+    sndx_player_seek(p, target);
+
+    kept = play(p, out, after);
+    err  = -(kept != (isize)after);
+    Goto_(err, __close, "Played %ld of %ld frames after the seek", kept, after);
+
+    err = verify(out, after, target, total, output);
+    Goto_(err, __close, "Content after the seek to %ld", target);
+
+    err = -(p->position != target + after || p->seeks != 1);
+    Goto_(err, __close, "Position %ld, expected %ld, %ld seeks", p->position, target + after, p->seeks);
+
+__close:
+    sndx_player_close(p);
+
+    return err;
+}
+
+/** @brief 4. */
+static int play_loop(const sndx_player_desc_t* desc, float* out, output_t* output)
+{
+    int err;
+
+    constexpr uframes_t length = 10000;
+    constexpr uframes_t want   = 25000;
+
+    sndx_player_t* p;
+    err = sndx_player_open(&p, desc, output);
+    Return_(err, "Failed sndx_player_open %s", desc->path);
+
+    err = -(p->source != SNDX_PLAYER_MMAP || p->frames != length);
+    Goto_(err, __close, "Source %d, %ld frames", p->source, p->frames);
+
+    isize kept = play(p, out, want);
+    err        = -(kept != (isize)want || sndx_player_done(p));
+    Goto_(err, __close, "Played %ld of %ld frames, done %d", kept, want, sndx_player_done(p));
+
+    err = verify(out, want, 0, length, output);
+    Goto_(err, __close, "Content of the loop");
+
+    err = -(p->position != want % length);
+    Goto_(err, __close, "Position %ld, expected %ld", p->position, want % length);
+
+__close:
+    sndx_player_close(p);
+
+    return err;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char* path_wav = "/tmp/test_player.wav";
+    const char* path_raw = "/tmp/test_player.raw";
+    const char* path_s16 = "/tmp/test_player_s16.wav";
+
+    float* out = calloc(total * channels, sizeof(float));
+    err        = -(!out);
+    Goto_(err, __close, "Failed calloc float* out");
+
+    err = write_wav(path_wav, total, true);
+    Goto_(err, __close, "Failed to write %s", path_wav);
+
+    err = write_raw(path_raw, 10000);
+    Goto_(err, __close, "Failed to write %s", path_raw);
+
+    err = write_wav(path_s16, 1000, false);
+    Goto_(err, __close, "Failed to write %s", path_s16);
+
+    // A quarter of a second ahead, so the prefetch thread has to keep up
+    sndx_player_desc_t desc = {.path = path_wav, .read_ahead = 0.25};
+
+    // 1.
+    err = play_whole(&desc, SNDX_PLAYER_MMAP, out, output);
+    Goto_(err, __close, "Playing %s mapped", path_wav);
+
+    // 2.
+    desc.source = SNDX_PLAYER_SNDFILE;
+    err         = play_whole(&desc, SNDX_PLAYER_SNDFILE, out, output);
+    Goto_(err, __close, "Playing %s through libsndfile", path_wav);
+
+    // 3.
+    RANGE(source, SNDX_PLAYER_MMAP, SNDX_PLAYER_SNDFILE + 1)
+    {
+        desc.source = (sndx_player_source_t)source;
+        err         = play_seek(&desc, out, output);
+        Goto_(err, __close, "Seeking in %s, source %ld", path_wav, source);
+    }
+
+    // 4.
+    sndx_player_desc_t loop = {
+        .path         = path_raw,
+        .raw          = true,
+        .channels     = channels,
+        .rate         = rate,
+        .loop         = true,
+        .chunk_frames = 1024,
+        .read_ahead   = 0.05,
+    };
+
+    err = play_loop(&loop, out, output);
+    Goto_(err, __close, "Looping %s", path_raw);
+
+    // 5.
+    {
+        sndx_player_desc_t s16 = {.path = path_s16};
+
+        sndx_player_t* p;
+        err = sndx_player_open(&p, &s16, output);
+        Goto_(err, __close, "Failed sndx_player_open %s", path_s16);
+
+        err = -(p->source != SNDX_PLAYER_SNDFILE);
+        sndx_player_close(p);
+        Goto_(err, __close, "16 bit WAV was not given to libsndfile");
+    }
+
+    a_info("Player: all checks passed");
+
+__close:
+    free(out);
+    unlink(path_wav);
+    unlink(path_raw);
+    unlink(path_s16);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
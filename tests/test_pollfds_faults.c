@@ -0,0 +1,152 @@
+/** @file test_pollfds_faults.c
+ *  @brief Every failure branch of `sndx_pollfds_wait`, driven by fault schedules on the simulated pair.
+ *
+ *  Each case runs a fresh pair with a single fault on wakeup 20, in the loop of `dump_trace`
+ *  (wait, avail, read, write, and on restart `sndx_pollfds_xrun` + `sndx_duplex_restart`).
+ *
+ *  Checklist:
+ *      1. Capture xrun (POLLERR on capture)       -> needs restart, audio again after it
+ *      2. Playback xrun (POLLERR on playback)     -> needs restart, audio again after it
+ *      3. Disconnect (POLLNVAL)                   -> fatal
+ *      4. Stalled device, no restart in between   -> needs restart per timeout, fatal past SNDX_POLLFDS_MAX_RETRY_COUNT
+ *      5. Suspend                                 -> needs restart, prepared out of suspend, audio again after it
+ */
+#include "sndx/duplex.h"
+#include "sndx/sim.h"
+
+#define RATE        48000
+#define PERIOD_SIZE 128
+#define PERIODS     3
+
+typedef struct
+{
+    const char*          name;    ///< Printed
+    const char*          play;    ///< Fault script of playback
+    const char*          capt;    ///< Fault script of capture
+    bool                 both;    ///< Poll playback too, not only capture
+    bool                 restart; ///< Restart on POLLFD_NEEDS_RESTART, else wait again as is
+    sndx_pollfds_error_t expect;  ///< First failure the fault has to surface as
+    u32                  retries; ///< POLLFD_NEEDS_RESTART expected before POLLFD_FATAL
+
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    {"capture xrun", "", "xrun@20", false, true, POLLFD_NEEDS_RESTART, 0},
+    {"playback xrun", "xrun@20", "", true, true, POLLFD_NEEDS_RESTART, 0},
+    {"disconnect", "", "nval@20", false, true, POLLFD_FATAL, 0},
+    {"timeout", "", "stall@20:400", false, false, POLLFD_FATAL, SNDX_POLLFDS_MAX_RETRY_COUNT},
+    {"suspend", "", "suspend@20", false, true, POLLFD_NEEDS_RESTART, 0},
+};
+
+#define COUNT(x) ((isize)(sizeof(x) / sizeof(x[0])))
+
+static int run(const scenario_t* sc, output_t* output)
+{
+    int err;
+
+    sndx_sim_fault_t play_faults[4];
+    sndx_sim_fault_t capt_faults[4];
+
+    sndx_sim_config_t config = {
+        .play = {.channels = 2, .faults = play_faults},
+        .capt = {.channels = 2, .faults = capt_faults},
+    };
+
+    err = sndx_sim_faults_parse(sc->play, play_faults, 4, output);
+    RetVal_(err < 0, err, "Failed sndx_sim_faults_parse (play)");
+    config.play.nfaults = err;
+
+    err = sndx_sim_faults_parse(sc->capt, capt_faults, 4, output);
+    RetVal_(err < 0, err, "Failed sndx_sim_faults_parse (capt)");
+    config.capt.nfaults = err;
+
+    sndx_sim_t* sim;
+    err = sndx_sim_open(&sim, &config, output);
+    SndReturn_(err, "Failed sndx_sim_open: %s");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open_pcm(             //
+        &d,                                 //
+        sim->play.io.pcm, sim->capt.io.pcm, //
+        SND_PCM_FORMAT_S16_LE,              //
+        RATE, PERIOD_SIZE, PERIODS,         //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED,    //
+        output);
+    SndGoto_(err, __close, "Failed sndx_duplex_open_pcm: %s");
+
+    // Timeouts of a few periods, not a second each
+    d->pfd->capture_only = !sc->both;
+    d->pfd->poll_timeout = 4 * PERIOD_SIZE * 1000 / RATE;
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed sndx_duplex_start: %s");
+
+    sndx_pollfds_error_t first   = POLLFD_SUCCESS;
+    u32                  retries = 0;
+    u32                  after   = 0;
+
+    RANGE(n, 200)
+    {
+        uframes_t            frames;
+        sndx_pollfds_error_t perr = sndx_pollfds_wait(d->pfd, d->play, d->capt, d->out);
+        if (perr == POLLFD_SUCCESS) perr = sndx_duplex_passthrough(d, &frames);
+
+        if (perr == POLLFD_SUCCESS)
+        {
+            if (first != POLLFD_SUCCESS && ++after == 20) break;
+            continue;
+        }
+
+        if (first == POLLFD_SUCCESS) first = perr;
+        if (perr == POLLFD_FATAL) break;
+
+        retries++;
+        if (!sc->restart) continue;
+
+        sndx_pollfds_xrun(d->pfd, d->play, d->capt, d->out);
+
+        err = sndx_duplex_restart(d);
+        SndGoto_(err, __stop, "Failed sndx_duplex_restart: %s");
+    }
+
+    a_info("%-14s: first %d, retries %d, cycles after %d, capture state %s", sc->name, first, retries, after,
+           snd_pcm_state_name(snd_pcm_state(d->capt)));
+
+    err = -(first != sc->expect);
+    Goto_(err, __stop, "%s: expected %d, got %d", sc->name, sc->expect, first);
+
+    // Fatal on timeouts only after the retries ran out
+    err = -(sc->expect == POLLFD_FATAL && retries != sc->retries);
+    Goto_(err, __stop, "%s: expected %d retries, got %d", sc->name, sc->retries, retries);
+
+    // Recovered faults have audio flowing again
+    err = -(sc->expect == POLLFD_NEEDS_RESTART && after < 20);
+    Goto_(err, __stop, "%s: only %d cycles after recovery", sc->name, after);
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+    sndx_sim_close(sim);
+
+    return err;
+}
+
+int main()
+{
+    int err = 0;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    RANGE(i, COUNT(scenarios))
+    {
+        if (!err) err = run(&scenarios[i], output);
+    }
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/** @file test_pool.c
+ *  @brief Worker pool and the graph on it: every task once, nested tasks, same output as serial.
+ *
+ *  Checklist:
+ *      1. Runs of 1000 tasks (more than a deque holds), each index run exactly once per run, over 1000 runs
+ *      2. Tasks pushing tasks (`sndx_pool_push`), the run waits for all of them
+ *      3. Graph with 8 parallel branches gives the same output on the pool as serial
+ *      4. Workers pinned to core 0 stay there, with or without the rights for SCHED_FIFO
+ *
+ *  Priority 1 is asked for, without the rights the workers run under the default policy.
+ */
+#include "sndx/callback.h"
+#include <math.h>
+
+#define THREADS 3
+#define TASKS   1000
+#define RUNS    1000
+#define FRAMES  64
+#define SPLIT   8
+
+typedef struct
+{
+    u32 counts[TASKS]; ///< Times each index ran
+    u32 total;         ///< Tasks run, nested included
+
+} counter_t;
+
+static void task_count(sndx_pool_t* pool [[maybe_unused]], u32 worker [[maybe_unused]], void* arg, u32 index)
+{
+    counter_t* c = arg;
+
+    __atomic_add_fetch(&c->counts[index], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->total, 1, __ATOMIC_RELAXED);
+}
+
+/** @brief Index i spawns i nested tasks of index 0. */
+static void task_spawn(sndx_pool_t* pool, u32 worker, void* arg, u32 index)
+{
+    counter_t* c = arg;
+
+    RANGE(i, index) { sndx_pool_push(pool, worker, task_count, c, 0); }
+    __atomic_add_fetch(&c->total, 1, __ATOMIC_RELAXED);
+}
+
+static int check_counts(counter_t* c, u32 ntasks, u32 runs, output_t* output)
+{
+    RANGE(i, ntasks)
+    {
+        RetVal_(c->counts[i] != runs, -1, "Task %ld ran %d times, expected %d", i, c->counts[i], runs);
+    }
+
+    return 0;
+}
+
+/** @brief capture -> SPLIT branches of 2 gains each -> mixed into playback by channel. */
+static int build_branches(sndx_graph_t* g, float* gains)
+{
+    int err;
+
+    RANGE(b, SPLIT)
+    {
+        int first  = sndx_graph_add(g, "pre", sndx_graph_gain, &gains[2 * b], 1, 1);
+        int second = sndx_graph_add(g, "post", sndx_graph_gain, &gains[2 * b + 1], 1, 1);
+        if (first < 0 || second < 0) return -ENOMEM;
+
+        err  = sndx_graph_connect(g, SNDX_GRAPH_CAPTURE, b % 2, first, 0);
+        err |= sndx_graph_connect(g, first, 0, second, 0);
+        err |= sndx_graph_connect(g, second, 0, SNDX_GRAPH_PLAYBACK, b);
+        if (err < 0) return err;
+    }
+
+    return 0;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    sndx_pool_t*   pool   = nullptr;
+    sndx_buffer_t* capt   = nullptr;
+    sndx_buffer_t* serial = nullptr;
+    sndx_buffer_t* play   = nullptr;
+    sndx_graph_t*  g      = nullptr;
+    counter_t*     c      = calloc(1, sizeof(counter_t));
+
+    float gains[2 * SPLIT];
+    RANGE(i, 2 * SPLIT) { gains[i] = 0.1f * (i + 1); }
+
+    err = -(!c);
+    Goto_(err, __close, "Failed calloc counter_t* c");
+
+    err = sndx_pool_open(&pool, THREADS, nullptr, 1, output);
+    SndGoto_(err, __close, "Failed sndx_pool_open: %s");
+
+    sndx_pool_dump(pool, output);
+
+    // 1. Every index once per run
+    RANGE(r, RUNS) { sndx_pool_run(pool, task_count, c, TASKS); }
+
+    err = check_counts(c, TASKS, RUNS, output);
+    Goto_(err, __close, "Counts wrong after %d runs", RUNS);
+
+    // 2. Nested: 20 tasks spawning 0 + 1 + ... + 19 more
+    memset(c, 0, sizeof(*c));
+    RANGE(r, RUNS) { sndx_pool_run(pool, task_spawn, c, 20); }
+
+    err = -(c->total != RUNS * (20 + 190));
+    Goto_(err, __close, "Nested: %d tasks ran, expected %d", c->total, RUNS * (20 + 190));
+
+    // 3. Graph: serial, then the same on the pool
+    err = sndx_buffer_open(&capt, SND_PCM_FORMAT_S32_LE, 2, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_buffer_open(&serial, SND_PCM_FORMAT_S32_LE, SPLIT, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    err = sndx_buffer_open(&play, SND_PCM_FORMAT_S32_LE, SPLIT, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_buffer_open: %s");
+
+    RANGE(i, FRAMES * 2) { capt->bufdata[i] = sinf(0.1f * i); }
+
+    err = sndx_graph_open(&g, 2, SPLIT, FRAMES, output);
+    SndGoto_(err, __close, "Failed sndx_graph_open: %s");
+
+    err = build_branches(g, gains);
+    Goto_(err, __close, "Failed build_branches");
+
+    err = sndx_graph_commit(g);
+    Goto_(err, __close, "Failed sndx_graph_commit");
+
+    err = -(g->committed->nlevels != 2);
+    Goto_(err, __close, "Expected 2 levels, got %d", g->committed->nlevels);
+
+    sndx_graph_process(g, capt, serial, FRAMES);
+
+    sndx_graph_set_pool(g, pool);
+    sndx_graph_dump(g, output);
+
+    RANGE(r, RUNS)
+    {
+        sndx_graph_process(g, capt, play, FRAMES);
+
+        err = -!!memcmp(play->bufdata, serial->bufdata, SPLIT * FRAMES * sizeof(float));
+        Goto_(err, __close, "Run %ld: pool output differs from serial", r);
+    }
+
+    RANGE(b, SPLIT)
+    {
+        float x = capt->bufdata[(b % 2) * FRAMES + 5] * gains[2 * b] * gains[2 * b + 1];
+        float y = play->bufdata[b * FRAMES + 5];
+
+        err = -(fabsf(x - y) > 1e-6f);
+        Goto_(err, __close, "Branch %ld: %f, expected %f", b, y, x);
+    }
+
+    sndx_pool_dump(pool, output);
+
+    // 4. Pinning survives the fallback to the default policy
+    sndx_pool_close(pool);
+
+    const int cpus[THREADS] = {};
+    err = sndx_pool_open(&pool, THREADS, cpus, 1, output);
+    SndGoto_(err, __close, "Failed sndx_pool_open (pinned): %s");
+
+    RANGE(i, 1, pool->nworkers)
+    {
+        cpu_set_t set;
+        err = -pthread_getaffinity_np(pool->workers[i].tid, sizeof(set), &set);
+        Goto_(err, __close, "Failed pthread_getaffinity_np: worker %ld", i);
+
+        err = -(pool->workers[i].cpu != 0 || !CPU_ISSET(0, &set) || CPU_COUNT(&set) != 1);
+        Goto_(err, __close, "Worker %ld: cpu %d (rt %d), not pinned to core 0", i, pool->workers[i].cpu,
+              pool->workers[i].rt);
+    }
+
+    a_info("Pool: all checks passed");
+
+__close:
+    sndx_graph_close(g);
+    sndx_buffer_close(play);
+    sndx_buffer_close(serial);
+    sndx_buffer_close(capt);
+    sndx_pool_close(pool);
+    Free(c);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/** @file test_recorder.c
+ *  @brief Recorder in both modes, fed like an audio thread would, then read back.
+ *
+ *  Checklist:
+ *      1. Every frame pushed is on disk in order, the partial chunk at the end included
+ *      2. Raw files are exactly the samples, the O_DIRECT padding is gone
+ *      3. Stats add up: nothing dropped, high water within the ring, one write per chunk
+ *      4. A push larger than the ring keeps what fits and counts the rest as dropped
+ */
+#include "sndx/recorder.h"
+
+constexpr u32       channels = 2;
+constexpr u32       rate     = 48000;
+constexpr uframes_t period   = 256;
+constexpr uframes_t chunk    = 4096;
+constexpr uframes_t total    = 200000 + 77;
+
+static float sample(uframes_t frame, u32 chn) { return (float)(frame * channels + chn); }
+
+/** @brief `frames` of the ramp from `start`, a period at a time about ten times faster than realtime. */
+static void feed(sndx_recorder_t* rec, uframes_t start, uframes_t frames)
+{
+    float  buf[channels * period];
+    area_t areas[channels];
+
+    RANGE(chn, channels)
+    {
+        areas[chn].addr  = buf;
+        areas[chn].first = chn * period * sizeof(float) * 8;
+        areas[chn].step  = sizeof(float) * 8;
+    }
+
+    for (uframes_t pos = 0; pos < frames; pos += period)
+    {
+        uframes_t n = frames - pos < period ? frames - pos : period;
+
+        RANGE(chn, channels)
+        RANGE(i, n) { buf[chn * period + i] = sample(start + pos + i, chn); }
+
+        sndx_recorder_push(rec, areas, 0, n);
+        usleep(500);
+    }
+}
+
+/** @brief Interleaved samples of the file against the ramp. */
+static int verify(const float* data, uframes_t frames, output_t* output)
+{
+    int err = 0;
+
+    RANGE(i, frames)
+    RANGE(chn, channels)
+    {
+        err = -(data[i * channels + chn] != sample(i, chn));
+        Return_(err, "Frame %ld channel %ld: %f, expected %f", i, chn, data[i * channels + chn], sample(i, chn));
+    }
+
+    return 0;
+}
+
+/** @brief 3. Before close, the last partial chunk is still queued. */
+static int check_stats(sndx_recorder_t* rec, uframes_t frames, output_t* output)
+{
+    int err;
+
+    uframes_t chunks = frames / chunk;
+
+    err = -(rec->pushed != frames || rec->written != chunks * chunk || rec->dropped);
+    Return_(err, "Pushed %ld, written %ld, dropped %ld of %ld", rec->pushed, rec->written, rec->dropped, frames);
+
+    err = -(rec->high_water < chunk || rec->high_water >= rec->ring->capacity);
+    Return_(err, "High water %ld of %ld", rec->high_water, rec->ring->capacity);
+
+    err = -(rec->writes != chunks);
+    Return_(err, "%ld writes for %ld chunks", rec->writes, chunks);
+
+    return 0;
+}
+
+static int record(const sndx_recorder_desc_t* desc, output_t* output)
+{
+    int err;
+
+    sndx_recorder_t* rec;
+    err = sndx_recorder_open(&rec, desc, output);
+    Return_(err, "Failed sndx_recorder_open");
+
+    feed(rec, 0, total);
+    usleep(10000);
+
+    err = check_stats(rec, total, output);
+
+    sndx_recorder_dump(rec, output);
+
+    int errc = sndx_recorder_close(rec);
+    Return_(errc, "Failed sndx_recorder_close: %s", strerror(-errc));
+
+    return err;
+}
+
+/** @brief 4. One push of twice the ring. */
+static int overflow(const sndx_recorder_desc_t* desc, output_t* output)
+{
+    int err;
+
+    area_t areas[channels];
+
+    sndx_recorder_t* rec;
+    err = sndx_recorder_open(&rec, desc, output);
+    Return_(err, "Failed sndx_recorder_open");
+
+    uframes_t big = 2 * rec->ring->capacity;
+    float*    buf = calloc(big * channels, sizeof(float));
+    err           = -(!buf);
+    Goto_(err, __close, "Failed calloc float* buf");
+
+    RANGE(chn, channels)
+    {
+        areas[chn].addr  = buf;
+        areas[chn].first = chn * sizeof(float) * 8;
+        areas[chn].step  = channels * sizeof(float) * 8;
+    }
+
+    uframes_t queued = sndx_recorder_push(rec, areas, 0, big);
+
+    err = -(queued != rec->ring->capacity - 1 || rec->dropped != big - queued || rec->pushed != queued);
+    Check_(err, "Queued %ld, dropped %ld of %ld", queued, rec->dropped, big);
+
+__close:
+    free(buf);
+
+    int errc = sndx_recorder_close(rec);
+
+    return err < 0 ? err : errc;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    const char* path_sf  = "/tmp/test_recorder.w64";
+    const char* path_raw = "/tmp/test_recorder.raw";
+
+    float* data = calloc(total * channels, sizeof(float));
+    err         = -(!data);
+    Goto_(err, __close, "Failed calloc float* data");
+
+    // 1. and 3.
+    sndx_recorder_desc_t desc = {
+        .path         = path_sf,
+        .mode         = SNDX_RECORDER_SNDFILE,
+        .channels     = channels,
+        .rate         = rate,
+        .chunk_frames = chunk,
+    };
+
+    err = record(&desc, output);
+    Goto_(err, __close, "Recording %s", path_sf);
+
+    SF_INFO  info = {};
+    SNDFILE* sf   = sf_open(path_sf, SFM_READ, &info);
+    err           = -(!sf);
+    Goto_(err, __close, "Failed sf_open %s: %s", path_sf, sf_strerror(nullptr));
+
+    sf_count_t n = sf_readf_float(sf, data, total);
+    sf_close(sf);
+
+    err = -(n != (sf_count_t)total || info.frames != (sf_count_t)total || info.channels != (int)channels ||
+           info.samplerate != (int)rate);
+    Goto_(err, __close, "Read %ld of %ld frames, %d channels at %d", n, info.frames, info.channels, info.samplerate);
+
+    err = verify(data, total, output);
+    Goto_(err, __close, "Content of %s", path_sf);
+
+    // 2. and 3.
+    desc.path = path_raw;
+    desc.mode = SNDX_RECORDER_DIRECT;
+
+    err = record(&desc, output);
+    Goto_(err, __close, "Recording %s", path_raw);
+
+    FILE* f = fopen(path_raw, "rb");
+    err     = -(!f);
+    Goto_(err, __close, "Failed fopen %s", path_raw);
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    n = (sf_count_t)fread(data, sizeof(float) * channels, total, f);
+    fclose(f);
+
+    err = -(size != (long)(total * channels * sizeof(float)) || n != (sf_count_t)total);
+    Goto_(err, __close, "Raw file of %ld bytes, expected %ld", size, total * channels * sizeof(float));
+
+    err = verify(data, total, output);
+    Goto_(err, __close, "Content of %s", path_raw);
+
+    // 4.
+    err = overflow(&desc, output);
+    Goto_(err, __close, "Overflow of %s", path_raw);
+
+    a_info("Recorder: all checks passed");
+
+__close:
+    free(data);
+    unlink(path_sf);
+    unlink(path_raw);
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
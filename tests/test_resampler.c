@@ -0,0 +1,269 @@
+/** @file test_resampler.c
+ *  @brief Resampler against an ideal sine, no hardware needed.
+ *
+ *  Input is a 1 kHz sine at 48 kHz, passed in blocks of a period (last block of each
+ *  run is cut short to exercise partial input). Output is compared to the sine at
+ *  the position each output frame stands for, less the reported latency.
+ *
+ *  Checklist:
+ *      1. SNR per quality, drift ratio and 48k -> 44.1k / 44.1k -> 48k
+ *      2. Same output whether processed in one call or in blocks
+ *      3. Ratio change glides, no jump in the step between output positions
+ *      4. Output limited calls leave the rest of the input for the next call
+ *      5. A call refused for an area that is not planar float leaves every channel as it was
+ */
+#include "sndx/resampler.h"
+#include <math.h>
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr u32       channels    = 2;
+constexpr uframes_t frames      = 48000;
+
+static const f64 min_snr[] = {
+    [SNDX_RESAMPLER_BEST]    = 90.0,
+    [SNDX_RESAMPLER_MEDIUM]  = 75.0,
+    [SNDX_RESAMPLER_FASTEST] = 55.0,
+    [SNDX_RESAMPLER_LINEAR]  = 45.0,
+};
+
+/** @brief Planar areas over `data`, `stride` frames apart. */
+static void set_areas(area_t* areas, float* data, uframes_t stride)
+{
+    RANGE(chn, channels)
+    {
+        areas[chn].addr  = data;
+        areas[chn].first = chn * stride * sizeof(float) * 8;
+        areas[chn].step  = sizeof(float) * 8;
+    }
+}
+
+/** @brief Feed `in` in blocks of `block`, output into `out`, returns frames produced. */
+static uframes_t run_blocks(sndx_resampler_t* r, float* in, float* out, uframes_t out_cap, uframes_t block)
+{
+    area_t in_areas[channels];
+    area_t out_areas[channels];
+
+    set_areas(in_areas, in, frames);
+    set_areas(out_areas, out, out_cap);
+
+    uframes_t in_pos  = 0;
+    uframes_t out_pos = 0;
+
+    while (in_pos < frames && out_pos < out_cap)
+    {
+        uframes_t n = frames - in_pos < block ? frames - in_pos : block;
+        uframes_t m = out_cap - out_pos;
+
+        sndx_resampler_process(r, in_areas, in_pos, &n, out_areas, out_pos, &m);
+
+        in_pos  += n;
+        out_pos += m;
+    }
+
+    return out_pos;
+}
+
+static int run(sndx_resampler_quality_t quality, f64 ratio, output_t* output)
+{
+    int err;
+
+    f64       omega   = 2 * M_PI * 1000.0 / rate;
+    uframes_t out_cap = (uframes_t)(frames * ratio) + 16;
+
+    float* in   = calloc(channels * frames, sizeof(float));
+    float* out  = calloc(channels * out_cap, sizeof(float));
+    float* once = calloc(channels * out_cap, sizeof(float));
+
+    sndx_resampler_t* r = nullptr;
+
+    err = -(!in || !out || !once);
+    Goto_(err, __close, "Failed calloc");
+
+    RANGE(chn, channels)
+    RANGE(i, frames) { in[chn * frames + i] = (float)(0.5 * sin(omega * i)); }
+
+    err = sndx_resampler_open(&r, quality, channels, ratio, frames, output);
+    SndGoto_(err, __close, "Failed sndx_resampler_open: %s");
+
+    // 1. SNR, skipping the fade in from the silent history and the unfinished tail
+    uframes_t produced = run_blocks(r, in, out, out_cap, period_size);
+    f64       latency  = sndx_resampler_latency(r);
+    f64       step     = 1.0 / ratio;
+    f64       start    = quality == SNDX_RESAMPLER_LINEAR ? 1.0 : 0.0;
+    f64       sig      = 0;
+    f64       noise    = 0;
+
+    RANGE(k, (isize)(2 * r->ntaps * ratio) + 1, (isize)produced - 1)
+    {
+        f64 t  = start + k * step - (quality == SNDX_RESAMPLER_LINEAR ? 1.0 : latency);
+        f64 e  = out[k] - 0.5 * sin(omega * t);
+        sig   += 0.25 * 0.5;
+        noise += e * e;
+    }
+
+    f64 snr = 10 * log10(sig / noise);
+
+    a_info("%-8s ratio %.6f: produced %6ld, latency %5.1f, snr %6.1f dB", sndx_resampler_quality_name(quality), ratio,
+           produced, latency, snr);
+
+    err = -(snr < min_snr[quality]);
+    Goto_(err, __close, "SNR too low: %.1f < %.1f", snr, min_snr[quality]);
+
+    // 2. Blocks are invisible in the output
+    sndx_resampler_reset(r);
+    uframes_t produced_once = run_blocks(r, in, once, out_cap, frames);
+
+    err = -(produced_once != produced);
+    Goto_(err, __close, "Produced %ld in one call, %ld in blocks", produced_once, produced);
+
+    RANGE(chn, channels)
+    RANGE(k, produced)
+    {
+        f64 d = fabs(out[chn * out_cap + k] - once[chn * out_cap + k]);
+
+        err = -(d > 1e-6);
+        Goto_(err, __close, "Block boundary visible at %ld: %g", k, d);
+    }
+
+__close:
+    sndx_resampler_close(r);
+    Free(in);
+    Free(out);
+    Free(once);
+
+    return err;
+}
+
+/** @brief Ratio switched by 1000 ppm: the step between output positions never jumps. */
+static int run_glide(output_t* output)
+{
+    int err;
+
+    sndx_resampler_t* r;
+    err = sndx_resampler_open(&r, SNDX_RESAMPLER_LINEAR, 1, 1.0, period_size, output);
+    SndReturn_(err, "Failed sndx_resampler_open: %s");
+
+    float  in[period_size];
+    float  out[2 * period_size];
+    area_t in_area  = {.addr = in, .first = 0, .step = 32};
+    area_t out_area = {.addr = out, .first = 0, .step = 32};
+
+    memset(in, 0, sizeof(in));
+
+    // Input positions of the output frames of the last call are index + alpha (linear)
+    f64 max_jump = 0;
+
+    RANGE(c, 4)
+    {
+        if (c == 2) sndx_resampler_set_ratio(r, 1.001);
+
+        uframes_t n = period_size;
+        uframes_t m = 2 * period_size;
+        sndx_resampler_process(r, &in_area, 0, &n, &out_area, 0, &m);
+
+        RANGE(k, 2, (isize)m)
+        {
+            f64 t0   = r->index[k - 2] + (f64)r->alpha[k - 2];
+            f64 t1   = r->index[k - 1] + (f64)r->alpha[k - 1];
+            f64 t2   = r->index[k] + (f64)r->alpha[k];
+            f64 jump = fabs((t2 - t1) - (t1 - t0));
+            max_jump = jump > max_jump ? jump : max_jump;
+        }
+    }
+
+    a_info("glide    : step 1 -> %.6f, largest change of step between frames %.2e", 1 / 1.001, max_jump);
+
+    // Switched at once, the step would change by 1e-3 from one frame to the next
+    err = -(max_jump > 1e-4);
+    Goto_(err, __close, "Ratio change not smooth: %g", max_jump);
+
+    // 4. Output limited: 10 frames out consume about 10 in, the rest is passed again
+    sndx_resampler_reset(r);
+
+    uframes_t n = period_size;
+    uframes_t m = 10;
+    sndx_resampler_process(r, &in_area, 0, &n, &out_area, 0, &m);
+
+    a_info("limited  : 10 frames out consumed %ld of %ld", n, period_size);
+
+    err = -(m != 10 || n < 8 || n > 12);
+    Goto_(err, __close, "Output limited call consumed %ld for %ld", n, m);
+
+__close:
+    sndx_resampler_close(r);
+
+    return err;
+}
+
+/** @brief 5. Second output area interleaved, after a call that filled the history. */
+static int run_refused(output_t* output)
+{
+    int err;
+
+    sndx_resampler_t* r;
+    err = sndx_resampler_open(&r, SNDX_RESAMPLER_MEDIUM, channels, 1.0, period_size, output);
+    SndReturn_(err, "Failed sndx_resampler_open: %s");
+
+    float  in[channels * period_size];
+    float  out[channels * 2 * period_size];
+    area_t in_areas[channels];
+    area_t out_areas[channels];
+
+    set_areas(in_areas, in, period_size);
+    set_areas(out_areas, out, 2 * period_size);
+
+    RANGE(i, channels * period_size) { in[i] = (float)sin(0.01 * i); }
+
+    uframes_t n = period_size;
+    uframes_t m = 2 * period_size;
+    sndx_resampler_process(r, in_areas, 0, &n, out_areas, 0, &m);
+
+    usize  bytes  = channels * (r->ntaps - 1 + r->max_frames) * sizeof(float);
+    float* before = malloc(bytes);
+    err           = -(!before);
+    Goto_(err, __close, "Failed malloc float* before");
+
+    memcpy(before, r->work, bytes);
+    f64 pos = r->pos;
+
+    out_areas[1].step = channels * sizeof(float) * 8;
+
+    n   = period_size;
+    m   = 2 * period_size;
+    err = sndx_resampler_process(r, in_areas, 0, &n, out_areas, 0, &m);
+    err = -(err != -EINVAL || memcmp(before, r->work, bytes) || r->pos != pos);
+    free(before);
+    Goto_(err, __close, "Refused call changed the state");
+
+    a_info("refused  : state untouched");
+
+__close:
+    sndx_resampler_close(r);
+
+    return err;
+}
+
+int main()
+{
+    int err = 0;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    f64 ratios[] = {1.0, 1.0 + 120e-6, 44100.0 / 48000.0, 48000.0 / 44100.0};
+
+    RANGE(q, SNDX_RESAMPLER_QUALITY_LAST + 1)
+    RANGE(i, (isize)(sizeof(ratios) / sizeof(ratios[0])))
+    {
+        if (!err) err = run(q, ratios[i], output);
+    }
+
+    if (!err) err = run_glide(output);
+    if (!err) err = run_refused(output);
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -1,5 +1,149 @@
 #include "sndx/ring.h"
 
+constexpr uframes_t bench_capacity = 1024;
+constexpr uframes_t bench_period   = 128;
+constexpr u32       bench_cycles   = 100000;
+
+static u64 now_nsecs()
+{
+    tspec_t t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/** @brief Planar areas of `bits` wide samples, `stride` frames between channels. */
+static void planar_areas(area_t* areas, void* data, u32 channels, uframes_t stride, u32 bits)
+{
+    RANGE(chn, channels)
+    {
+        areas[chn].addr  = data;
+        areas[chn].first = chn * stride * bits;
+        areas[chn].step  = bits;
+    }
+}
+
+/** @brief Float ring round trip across the wrap, values come back as they went in. */
+static int test_float(output_t* output)
+{
+    int err;
+
+    constexpr u32       channels = 3;
+    constexpr uframes_t capacity = 16;
+    constexpr uframes_t block    = 5;
+
+    float  src[channels * block];
+    float  dst[channels * block];
+    area_t src_areas[channels];
+    area_t dst_areas[channels];
+
+    planar_areas(src_areas, src, channels, block, 32);
+    planar_areas(dst_areas, dst, channels, block, 32);
+
+    sndx_ring_t* rb;
+    err = sndx_ring_open(&rb, SND_PCM_FORMAT_FLOAT, channels, capacity, output);
+    SndReturn_(err, "Failed sndx_ring_open: %s");
+
+    // 5 does not divide 16, so every offset into the ring is hit and the copy wraps
+    RANGE(iter, 16)
+    {
+        RANGE(chn, channels)
+        RANGE(i, block) { src[chn * block + i] = (float)(iter * 100 + chn * 10 + i); }
+
+        uframes_t nwritten = sndx_ring_write_from_areas(rb, src_areas, 0, channels, block);
+        uframes_t nread    = sndx_ring_read_to_float_areas(rb, dst_areas, 0, channels, block);
+
+        err = -(nwritten != block || nread != block || memcmp(src, dst, sizeof(src)));
+        Goto_(err, __close, "Float round trip failed at iteration %ld", iter);
+    }
+
+    a_info("Float round trip: ok");
+
+__close:
+    sndx_ring_close(rb);
+
+    return err;
+}
+
+/** @brief Float formats that are not native 32 bit would be copied as if they were, so open refuses them. */
+static int test_float_formats(output_t* output)
+{
+    int err;
+
+    const format_t formats[] = {SND_PCM_FORMAT_FLOAT64_LE, SND_PCM_FORMAT_FLOAT64_BE, SND_PCM_FORMAT_FLOAT_BE};
+
+    RANGE(i, sizeof(formats) / sizeof(formats[0]))
+    {
+        sndx_ring_t* rb = nullptr;
+
+        err = sndx_ring_open(&rb, formats[i], 2, 16, output);
+        sndx_ring_close(rb);
+
+        err = -(err != -EINVAL || rb);
+        Return_(err, "Ring opened with %s", snd_pcm_format_name(formats[i]));
+    }
+
+    a_info("Non-native float formats refused: ok");
+
+    return 0;
+}
+
+/** @brief ns per frame for a period written and read, int conversion path against float copies. */
+static int bench_float(u32 channels, output_t* output)
+{
+    int err;
+
+    sndx_ring_t* rb_int   = nullptr;
+    sndx_ring_t* rb_float = nullptr;
+
+    i32*    int_buf   = calloc(channels * bench_period, sizeof(i32));
+    float*  float_buf = calloc(channels * bench_period, sizeof(float));
+    area_t* areas_int = calloc(channels, sizeof(area_t));
+    area_t* areas_flt = calloc(channels, sizeof(area_t));
+
+    err = -(!int_buf || !float_buf || !areas_int || !areas_flt);
+    Goto_(err, __close, "Failed calloc");
+
+    planar_areas(areas_int, int_buf, channels, bench_period, 32);
+    planar_areas(areas_flt, float_buf, channels, bench_period, 32);
+
+    err = sndx_ring_open(&rb_int, SND_PCM_FORMAT_S32_LE, channels, bench_capacity, output);
+    SndGoto_(err, __close, "Failed sndx_ring_open: %s");
+
+    err = sndx_ring_open(&rb_float, SND_PCM_FORMAT_FLOAT, channels, bench_capacity, output);
+    SndGoto_(err, __close, "Failed sndx_ring_open: %s");
+
+    u64 t0 = now_nsecs();
+    RANGE(i, bench_cycles)
+    {
+        sndx_ring_write_from_areas(rb_int, areas_int, 0, channels, bench_period);
+        sndx_ring_read_to_areas(rb_int, areas_int, 0, channels, bench_period);
+    }
+    u64 t1 = now_nsecs();
+    RANGE(i, bench_cycles)
+    {
+        sndx_ring_write_from_float_areas(rb_float, areas_flt, 0, channels, bench_period);
+        sndx_ring_read_to_float_areas(rb_float, areas_flt, 0, channels, bench_period);
+    }
+    u64 t2 = now_nsecs();
+
+    f64 frames   = (f64)bench_cycles * bench_period;
+    f64 ns_int   = (t1 - t0) / frames;
+    f64 ns_float = (t2 - t1) / frames;
+
+    a_info("%2d channels: int conversion %7.2f ns/frame, float copy %7.2f ns/frame (%.1fx)", channels, ns_int,
+           ns_float, ns_int / ns_float);
+
+__close:
+    sndx_ring_close(rb_int);
+    sndx_ring_close(rb_float);
+    Free(int_buf);
+    Free(float_buf);
+    Free(areas_int);
+    Free(areas_flt);
+
+    return err;
+}
+
 int main()
 {
     int err;
@@ -94,11 +238,26 @@ int main()
         iter++;
     }
 
+    err = test_float(output);
+    SndGoto_(err, __close, "Failed test_float: %s");
+
+    err = test_float_formats(output);
+    SndGoto_(err, __close, "Failed test_float_formats: %s");
+
+    a_title("Write + read of a period of %ld frames", bench_period);
+
+    u32 bench_channels[] = {2, 8, 32};
+    RANGE(i, 3)
+    {
+        err = bench_float(bench_channels[i], output);
+        SndGoto_(err, __close, "Failed bench_float: %s");
+    }
+
 __close:
     Free(capt_buf);
     Free(play_buf);
     sndx_ring_close(rb);
     snd_output_close(output);
 
-    return 0;
+    return err < 0 ? 1 : 0;
 }
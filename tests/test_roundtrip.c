@@ -0,0 +1,129 @@
+/** @file test_roundtrip.c
+ *  @brief Round-trip latency through a software loopback of known delay.
+ *
+ *  Checklist:
+ *      1. MLS and chirp find an integer delay exactly
+ *      2. Half a frame of delay (two tap average) is found within a tenth of a frame
+ *      3. Noise and gain below one do not move the peak
+ *      4. An inverting path is found and reported as inverted
+ *      5. No loopback at all is refused
+ */
+#include "sndx/roundtrip.h"
+
+constexpr u32       rate        = 48000;
+constexpr uframes_t period_size = 128;
+constexpr uframes_t max_latency = 4096;
+constexpr u32       order       = 14;
+
+/** @brief Cycles of `rt` with capture = gain * (delayed playback, averaged over `taps` frames) + noise. */
+static void loop(sndx_roundtrip_t* rt, float* stream, uframes_t delay, u32 taps, float gain, float noise)
+{
+    float    capt[period_size];
+    uframes_t pos  = 0;
+    bool      done = false;
+
+    while (!done)
+    {
+        RANGE(i, period_size)
+        {
+            f64 x = 0.0;
+            RANGE(t, taps)
+            {
+                isize at  = (isize)(pos + i) - (isize)delay - t;
+                x        += at >= 0 ? stream[at] : 0.0f;
+            }
+
+            f64 n   = noise * ((f64)rand() / RAND_MAX - 0.5);
+            capt[i] = (float)(gain * x / taps + n);
+        }
+
+        done  = sndx_roundtrip_process(rt, capt, stream + pos, period_size);
+        pos  += period_size;
+    }
+}
+
+static int measure(                 //
+    sndx_roundtrip_signal_t signal, //
+    uframes_t               delay,  //
+    u32                     taps,   //
+    float                   gain,   //
+    f64                     expect, //
+    output_t*               output)
+{
+    int err;
+
+    sndx_roundtrip_t* rt;
+    err = sndx_roundtrip_open(&rt, signal, order, rate, 0.5f, max_latency, output);
+    Return_(err, "Failed sndx_roundtrip_open");
+
+    float* stream = calloc(rt->capacity + period_size, sizeof(float));
+    err           = -(!stream);
+    Goto_(err, __close, "Failed calloc float* stream");
+
+    loop(rt, stream, delay, taps, gain, 0.05f);
+
+    err = sndx_roundtrip_analyse(rt, output);
+    Goto_(err, __close, "Failed sndx_roundtrip_analyse");
+
+    sndx_roundtrip_dump(rt, output);
+
+    err = -(fabs(rt->latency - expect) > 0.1);
+    Goto_(err, __close, "%s: %.3f frames, expected %.3f", sndx_roundtrip_signal_name(signal), rt->latency, expect);
+
+    err = -(rt->inverted != (gain < 0));
+    Goto_(err, __close, "%s: polarity %d, gain %.2f", sndx_roundtrip_signal_name(signal), rt->inverted, gain);
+
+__close:
+    sndx_roundtrip_close(rt);
+    free(stream);
+
+    return err;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    srand(1);
+
+    RANGE(s, SNDX_ROUNDTRIP_SIGNAL_LAST + 1)
+    {
+        // 1. and 3.
+        err = measure(s, 777, 1, 0.5f, 777.0, output);
+        Goto_(err, __close, "Integer delay");
+
+        // 2.
+        err = measure(s, 300, 2, 0.8f, 300.5, output);
+        Goto_(err, __close, "Half frame delay");
+
+        // 4.
+        err = measure(s, 1500, 1, -0.7f, 1500.0, output);
+        Goto_(err, __close, "Inverted");
+    }
+
+    // 5. Only noise comes back
+    sndx_roundtrip_t* rt;
+    err = sndx_roundtrip_open(&rt, SNDX_ROUNDTRIP_MLS, order, rate, 0.5f, max_latency, output);
+    Goto_(err, __close, "Failed sndx_roundtrip_open");
+
+    float* stream = calloc(rt->capacity + period_size, sizeof(float));
+    if (stream) loop(rt, stream, 0, 1, 0.0f, 0.1f);
+
+    err = stream ? sndx_roundtrip_analyse(rt, output) : -ENOMEM;
+    err = -(err != -EIO);
+    Check_(err, "Noise taken for a loopback");
+
+    sndx_roundtrip_close(rt);
+    free(stream);
+
+    if (!err) a_info("Roundtrip: all checks passed");
+
+__close:
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
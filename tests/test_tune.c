@@ -0,0 +1,119 @@
+/** @file test_tune.c
+ *  @brief Tuner on simulated pairs that wake up to 4 ms late, no hardware needed.
+ *
+ *  Late wakeups overrun capture once they pass the headroom of (periods - 1) periods,
+ *  so the smallest stable candidate is 128 x 3 (5.3 ms of headroom), 128 x 2 has 2.7 ms.
+ *
+ *  Checklist:
+ *      1. Candidates run from the smallest buffer up, and stop at the first stable one
+ *      2. Candidates without the headroom see xruns, and are not stable
+ *      3. 128 x 3 is recommended, with its lateness inside the headroom
+ *      4. Headroom comes from the rate the pair opened at, `desc.rate` is left 0 with a custom opener
+ */
+#include "sndx/sim.h"
+#include "sndx/tune.h"
+
+constexpr u32 rate   = 48000;
+constexpr u32 jitter = 4000;
+
+typedef struct
+{
+    sndx_sim_t* sims[SNDX_TUNE_MAX_CANDIDATES];
+    u32         nsims;
+
+} sims_t;
+
+/** @brief Fresh pair per candidate, closed at the end (after the duplex that owns its handles). */
+static int open_sim(sndx_duplex_t** d, uframes_t period_size, u32 periods, void* data, output_t* output)
+{
+    int     err;
+    sims_t* s = data;
+
+    sndx_sim_config_t config = {
+        .play = {.channels = 2},
+        .capt = {.channels = 2, .jitter_usecs = jitter},
+        .seed = 7,
+    };
+
+    sndx_sim_t* sim;
+    err = sndx_sim_open(&sim, &config, output);
+    SndReturn_(err, "Failed sndx_sim_open: %s");
+
+    s->sims[s->nsims++] = sim;
+
+    return sndx_duplex_open_pcm(            //
+        d,                                  //
+        sim->play.io.pcm, sim->capt.io.pcm, //
+        SND_PCM_FORMAT_S16_LE,              //
+        rate, period_size, periods,         //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED,    //
+        output);
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    static const uframes_t sizes[]   = {32, 128, 256};
+    static const u32       periods[] = {2, 3};
+
+    sims_t sims = {};
+
+    sndx_tune_desc_t desc = {
+        .period_sizes  = sizes,
+        .nperiod_sizes = 3,
+        .periods       = periods,
+        .nperiods      = 2,
+        .seconds       = 1.0,
+        .max_xrun_rate = 0.0,
+        .open          = open_sim,
+        .data          = &sims,
+    };
+
+    sndx_tune_result_t results[SNDX_TUNE_MAX_CANDIDATES];
+    u32                nresults = 0;
+
+    int best = sndx_tune_run(&desc, results, SNDX_TUNE_MAX_CANDIDATES, &nresults, output);
+    sndx_tune_dump(results, nresults, best, rate, output);
+
+    // 1. 32 x 2, 32 x 3, 128 x 2, 128 x 3, then stop
+    err = -(nresults != 4);
+    Goto_(err, __close, "%d candidates run, expected 4", nresults);
+
+    RANGE(i, 1, nresults)
+    {
+        err = -(sndx_tune_latency(&results[i]) < sndx_tune_latency(&results[i - 1]));
+        Goto_(err, __close, "Candidate %ld has less latency than the one before", i);
+    }
+
+    // 2.
+    RANGE(i, nresults - 1)
+    {
+        err = -(results[i].stable || !results[i].xruns);
+        Goto_(err, __close, "%ld x %d: %ld xruns, stable %d", results[i].period_size, results[i].periods,
+              results[i].xruns, results[i].stable);
+    }
+
+    // 3.
+    err = -(best != 3 || results[3].period_size != 128 || results[3].periods != 3);
+    Goto_(err, __close, "Recommended %d, expected 128 x 3", best);
+
+    err = -(results[3].late_max_us > results[3].headroom_us || results[3].late_max_us <= 0.0);
+    Goto_(err, __close, "Lateness %.0f us of %.0f us headroom", results[3].late_max_us, results[3].headroom_us);
+
+    // 4.
+    err = -(fabs(results[3].headroom_us - 2 * 128 * 1e6 / rate) > 1e-6);
+    Goto_(err, __close, "Headroom %f us, expected %f us", results[3].headroom_us, 2 * 128 * 1e6 / rate);
+
+    a_info("Tune: all checks passed");
+
+__close:
+    RANGE(i, sims.nsims) { sndx_sim_close(sims.sims[i]); }
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/** @file test_xrun.c
+ *  @brief Graded xrun recovery picks the cheapest strategy and reports frames lost.
+ *
+ *  Checklist:
+ *      1. Nothing wrong right after start -> none
+ *      2. Sleeping till less than a period of headroom -> capture forward, playback topup, still running
+ *      3. Sleeping past the buffer -> stream stops, prepare, lost ~ time overslept
+ *
+ *  Same checks with mmap and with RW access, where the silence goes through writei.
+ */
+#include "sndx/duplex.h"
+
+#define RATE        48000
+#define PERIOD_SIZE 128
+#define PERIODS     2
+
+static u64 frames_to_usecs(u64 frames) { return frames * 1000000 / RATE; }
+
+static void report(sndx_duplex_t* d, const char* what, output_t* output)
+{
+    a_info("%-8s: play %-8s lost %-6ld capt %-8s lost %-6ld", what,           //
+           sndx_xrun_strategy_name(d->xrun_play.strategy), d->xrun_play.lost, //
+           sndx_xrun_strategy_name(d->xrun_capt.strategy), d->xrun_capt.lost);
+}
+
+static int test_access(access_t access, output_t* output)
+{
+    int err;
+
+    a_title("Access %s", snd_pcm_access_name(access));
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(         //
+        &d,                         //
+        "hw:A96,0", "hw:A96,0",     //
+        SND_PCM_FORMAT_S32_LE,      //
+        RATE, PERIOD_SIZE, PERIODS, //
+        access,                     //
+        output);
+    SndReturn_(err, "Failed sndx_duplex_open: %s");
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __close, "Failed sndx_duplex_start: %s");
+
+    // 1. Buffer is full of silence, nothing captured yet
+    err = sndx_duplex_recover(d);
+    SndGoto_(err, __stop, "Failed sndx_duplex_recover: %s");
+    report(d, "none", output);
+
+    err = -(d->xrun_play.strategy != SNDX_XRUN_NONE || d->xrun_capt.strategy != SNDX_XRUN_NONE);
+    Goto_(err, __stop, "Expected none");
+
+    // 2. Half a period of headroom left
+    usleep(frames_to_usecs(PERIOD_SIZE * PERIODS - PERIOD_SIZE / 2));
+
+    err = sndx_duplex_recover(d);
+    SndGoto_(err, __stop, "Failed sndx_duplex_recover: %s");
+    report(d, "soft", output);
+
+    err = -(d->xrun_capt.strategy != SNDX_XRUN_FORWARD || d->xrun_play.strategy != SNDX_XRUN_TOPUP);
+    Goto_(err, __stop, "Expected forward and topup");
+
+    err = -(snd_pcm_state(d->play) != SND_PCM_STATE_RUNNING);
+    Goto_(err, __stop, "Expected running, got %s", snd_pcm_state_name(snd_pcm_state(d->play)));
+
+    // 3. Two buffers overslept
+    usleep(frames_to_usecs(3 * PERIOD_SIZE * PERIODS));
+
+    err = sndx_duplex_recover(d);
+    SndGoto_(err, __stop, "Failed sndx_duplex_recover: %s");
+    report(d, "hard", output);
+
+    err = -(d->xrun_play.strategy != SNDX_XRUN_PREPARE || err == 1);
+    Goto_(err, __stop, "Expected prepare without restart");
+
+    err = -(snd_pcm_state(d->capt) != SND_PCM_STATE_RUNNING);
+    Goto_(err, __stop, "Expected running, got %s", snd_pcm_state_name(snd_pcm_state(d->capt)));
+
+    sndx_xrun_dump(&d->xrun_play, output);
+    sndx_xrun_dump(&d->xrun_capt, output);
+
+__stop:
+    sndx_duplex_stop(d);
+
+__close:
+    sndx_duplex_close(d);
+
+    return err;
+}
+
+int main()
+{
+    int err;
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stdout, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    err = test_access(SND_PCM_ACCESS_MMAP_INTERLEAVED, output);
+    if (!err) err = test_access(SND_PCM_ACCESS_RW_INTERLEAVED, output);
+
+    snd_output_close(output);
+
+    return err < 0 ? 1 : 0;
+}
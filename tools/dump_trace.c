@@ -0,0 +1,172 @@
+/** @file dump_trace.c
+ *  @brief Run a duplex passthrough and dump the last N seconds of cycles as Chrome trace JSON.
+ *
+ *  USAGE: dump_trace [DEVICE] [SECONDS] [PREFIX]
+ *
+ *  Dumps are written to `PREFIX-<n>.json`:
+ *      1. on every xrun (requested by `sndx_pollfds_xrun`)
+ *      2. on demand with `kill -USR1 <pid>`
+ *
+ *  Open with `chrome://tracing` or https://ui.perfetto.dev
+ */
+#include "sndx/duplex.h"
+#include <pthread.h>
+#include <signal.h>
+
+static int           stop        = 0;
+static sndx_trace_t* trace       = nullptr;
+static u64           dump_nsecs  = 5 * 1000000000ULL;
+static const char*   dump_prefix = "trace";
+static int           dump_count  = 0;
+static const char*   device      = "hw:A96,0";
+
+static void sig_handler(int sig ATTRIBUTE_UNUSED) { stop = 1; }
+
+// Only touches an atomic, so fine from a signal handler
+static void sig_handler_dump(int sig ATTRIBUTE_UNUSED) { sndx_trace_request_dump(trace); }
+
+static void dump_trace(output_t* output)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s-%d.json", dump_prefix, dump_count++);
+
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        a_error("Failed: fopen %s: %s", path, strerror(errno));
+        return;
+    }
+
+    sndx_trace_write_chrome(trace, f, dump_nsecs, output);
+    fclose(f);
+
+    a_info("Trace: dumped to %s", path);
+}
+
+/** @brief Does all file I/O, so the audio thread never does. */
+static void* job_dumper(void* data)
+{
+    output_t* output = data;
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        if (sndx_trace_dump_pending(trace)) dump_trace(output);
+        usleep(100000);
+    }
+
+    return nullptr;
+}
+
+static int duplex_restart(sndx_duplex_t* d)
+{
+    // Prints and requests the trace dump, everything else is the lean path
+    sndx_pollfds_xrun(d->pfd, d->play, d->capt, d->out);
+
+    return sndx_duplex_restart(d);
+}
+
+int main(int argc, char* argv[])
+{
+    int err;
+
+    if (argc > 1) device = argv[1];
+    if (argc > 2) dump_nsecs = (u64)(atof(argv[2]) * 1e9);
+    if (argc > 3) dump_prefix = argv[3];
+
+    output_t* output;
+    err = snd_output_stdio_attach(&output, stderr, 0);
+    SndFatal(err, "Failed snd_output_stdio_attach: %s");
+
+    err = sndx_duplex_set_schduler(output);
+    SndCheck_(err, "Failed sndx_duplex_set_schduler: %s");
+
+    sndx_duplex_t* d;
+    err = sndx_duplex_open(              //
+        &d,                              //
+        device, device,                  //
+        SND_PCM_FORMAT_S32_LE,           //
+        48000, 128, 2,                   //
+        SND_PCM_ACCESS_MMAP_INTERLEAVED, //
+        output);
+    SndFatal_(err, "Failed sndx_duplex_open: %s");
+
+    err = sndx_duplex_enable_trace(d, SNDX_TRACE_DEFAULT_CAPACITY);
+    SndGoto_(err, __close, "Failed sndx_duplex_enable_trace: %s");
+
+    trace = d->trace;
+
+    // Xrun reports are printed from the RT loop, keep them off it
+    err = sndx_duplex_enable_log(d, SNDX_LOG_DEFAULT_CAPACITY);
+    SndGoto_(err, __close, "Failed sndx_duplex_enable_log: %s");
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+    signal(SIGUSR1, sig_handler_dump);
+
+    pthread_t dumper;
+    err = pthread_create(&dumper, nullptr, job_dumper, output);
+    Goto(err, __close, "Failed: pthread_create: job_dumper");
+
+    err = sndx_duplex_start(d);
+    SndGoto_(err, __join, "Failed sndx_duplex_start: %s");
+
+    a_info("Tracing %s, dump with: kill -USR1 %d", device, getpid());
+
+    uframes_t offset = 0;
+    while (!stop)
+    {
+        sndx_pollfds_error_t perr;
+        sframes_t            avail = 0;
+
+        perr = sndx_pollfds_wait(d->pfd, d->play, d->capt, d->out);
+        if (perr == POLLFD_SUCCESS) perr = sndx_pollfds_avail(d->pfd, d->play, d->capt, &avail, d->out);
+
+        switch (perr)
+        {
+        case POLLFD_SUCCESS: break;
+        case POLLFD_FATAL: a_error("Fatal: Poll failed"); goto __stop;
+        case POLLFD_NEEDS_RESTART:
+            err = duplex_restart(d);
+            SndGoto_(err, __stop, "Failed: duplex_restart: %s");
+            continue;
+        }
+
+        // Keep within a single period, the rest is picked up next cycle
+        uframes_t frames = avail > (sframes_t)d->period_size ? d->period_size : (uframes_t)avail;
+        if (!frames) continue;
+
+        err = sndx_duplex_read(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_read: %s");
+
+        // Passthrough: first capture channel to all playback channels
+        RANGE(chn, d->ch_play)
+        RANGE(i, offset, (isize)(offset + frames))
+        {
+            d->buf_play->bufdata[i + chn * d->buf_play->frames] = d->buf_capt->bufdata[i];
+        }
+
+        err = sndx_duplex_write(d, &frames, &offset);
+        SndGoto_(err, __stop, "Failed: sndx_duplex_write: %s");
+
+        offset = (offset + frames) % (d->period_size * d->periods);
+    }
+
+__stop:
+    err = sndx_duplex_stop(d);
+    SndCheck_(err, "Failed sndx_duplex_stop: %s");
+
+    sndx_duplex_dump_restart(d, output);
+
+__join:
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(dumper, nullptr);
+
+    // Always leave the final state behind
+    dump_trace(output);
+
+__close:
+    sndx_duplex_close(d);
+    snd_output_close(output);
+
+    return 0;
+}